@@ -32,8 +32,8 @@ void HostSyncReader::handle_message( const ms::Message& message ) {
 			std::size_t num_requests = 0; // XXX
 			fw::ChunkVector runner;
 
-			for( runner.z = cuboid->z; runner.z < cuboid->z + cuboid->width; ++runner.z ) {
-				for( runner.y = cuboid->y; runner.y < cuboid->y + cuboid->width; ++runner.y ) {
+			for( runner.z = cuboid->z; runner.z < cuboid->z + cuboid->depth; ++runner.z ) {
+				for( runner.y = cuboid->y; runner.y < cuboid->y + cuboid->height; ++runner.y ) {
 					for( runner.x = cuboid->x; runner.x < cuboid->x + cuboid->width; ++runner.x ) {
 						fw::msg::RequestChunk req_msg;
 
@@ -14,6 +14,7 @@
 #include <SFML/Window.hpp>
 #include <boost/filesystem.hpp>
 #include <fstream>
+#include <iostream>
 
 static const bool SHOW_NOTICES = false;
 static const float FADE_SPEED = 3000.0f;
@@ -127,6 +128,7 @@ void MenuState::init() {
 
 	// Cleanup the backend.
 	get_shared().account_manager.reset();
+	get_shared().account_store.reset();
 	get_shared().host.reset();
 	get_shared().lock_facility.reset();
 	get_shared().world.reset();
@@ -328,6 +330,30 @@ void MenuState::on_insta_click() {
 
 	// Prepare backend and session host.
 	get_shared().account_manager.reset( new fw::AccountManager );
+	get_shared().account_store.reset( new fw::AccountStore( UserSettings::get_profile_path() + "/accounts" ) );
+
+	try {
+		get_shared().account_store->open();
+
+		// Migrate accounts saved as YAML files before.
+		if( get_shared().account_store->get_num_accounts() == 0 ) {
+			std::size_t num_failed = 0;
+			std::size_t num_imported = get_shared().account_store->import_directory( get_shared().account_store->get_directory(), num_failed );
+
+			if( num_imported > 0 || num_failed > 0 ) {
+				std::cout << "Imported " << num_imported << " accounts (" << num_failed << " failed)." << std::endl;
+			}
+		}
+
+		get_shared().account_manager->set_store( get_shared().account_store.get() );
+	}
+	catch( const fw::AccountStore::ReadException& e ) {
+		std::cerr << "Failed to open account store, accounts won't be saved: " << e.what() << std::endl;
+	}
+	catch( const fw::AccountStore::WriteException& e ) {
+		std::cerr << "Failed to import accounts: " << e.what() << std::endl;
+	}
+
 	get_shared().lock_facility.reset( new fw::LockFacility );
 	get_shared().world.reset( new fw::World );
 
@@ -347,6 +373,10 @@ void MenuState::on_insta_click() {
 	// Set auth mode.
 	get_shared().host->set_auth_mode( fw::SessionHost::OPEN_AUTH );
 
+	// Save planets and entities to the user's profile.
+	get_shared().host->set_planets_path( UserSettings::get_profile_path() + "/planets" );
+	get_shared().host->set_entities_path( UserSettings::get_profile_path() + "/entities" );
+
 	// Set endpoint.
 	get_shared().host->set_ip( "127.0.0.1" );
 
@@ -4,6 +4,7 @@
 #include <FlexWorld/LockFacility.hpp>
 #include <FlexWorld/World.hpp>
 #include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Types.hpp>
 
 #include <FWMS/Router.hpp>
 #include <FWMS/Message.hpp>
@@ -70,16 +71,10 @@ void SessionStateReader::handle_message( const ms::Message& message ) {
 				std::cout << "WARNING: SessionStateReader: Host sent an invalid position, view cuboid might be corrupt." << std::endl;
 			}
 
-			m_lock_facility->lock_planet( *planet, false );
+			// The view cuboid is centered at the player and clamped to the planet.
+			m_session_state->view_cuboid = planet->get_chunk_cuboid( chunk_pos, fw::VIEW_RADIUS );
 
-			m_session_state->view_cuboid = util::Cuboid<fw::PlanetSizeType>(
-				static_cast<fw::PlanetSizeType>( chunk_pos.x - std::min( chunk_pos.x, fw::PlanetSizeType( 30 ) ) ),
-				static_cast<fw::PlanetSizeType>( chunk_pos.y - std::min( chunk_pos.y, fw::PlanetSizeType( 30 ) ) ),
-				static_cast<fw::PlanetSizeType>( chunk_pos.z - std::min( chunk_pos.z, fw::PlanetSizeType( 30 ) ) ),
-				std::min( static_cast<fw::PlanetSizeType>( planet->get_size().x - chunk_pos.x ), fw::PlanetSizeType( 30 ) ),
-				std::min( static_cast<fw::PlanetSizeType>( planet->get_size().y - chunk_pos.y ), fw::PlanetSizeType( 30 ) ),
-				std::min( static_cast<fw::PlanetSizeType>( planet->get_size().z - chunk_pos.z ), fw::PlanetSizeType( 30 ) )
-			);
+			m_lock_facility->lock_planet( *planet, false );
 
 			// Send message to notify readers about the view cuboid change.
 			std::shared_ptr<ms::Message> vc_message = std::make_shared<ms::Message>( VIEW_CUBOID_UPDATE_ID );
@@ -5,6 +5,7 @@
 #include <FlexWorld/Client.hpp>
 #include <FlexWorld/SessionHost.hpp>
 #include <FlexWorld/AccountManager.hpp>
+#include <FlexWorld/AccountStore.hpp>
 #include <FlexWorld/LockFacility.hpp>
 #include <FlexWorld/World.hpp>
 #include <FlexWorld/Entity.hpp>
@@ -43,6 +44,7 @@ class Shared {
 		std::unique_ptr<fw::Client> client; ///< Client.
 		std::unique_ptr<fw::SessionHost> host; ///< Session host.
 
+		std::unique_ptr<fw::AccountStore> account_store; ///< Account store.
 		std::unique_ptr<fw::AccountManager> account_manager; ///< Account manager.
 		std::unique_ptr<fw::LockFacility> lock_facility; ///< Lock facility.
 		std::unique_ptr<fw::World> world; ///< World.
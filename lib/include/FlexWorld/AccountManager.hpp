@@ -6,10 +6,16 @@
 
 namespace fw {
 
+class AccountStore;
+
 /** Account manager.
  * The account manager is a simple storage class for managing accounts. Besides
  * of a normal container it doesn't allow to overwrite accounts. Instead,
  * accounts are updated.
+ *
+ * With a store set, the store holds all accounts and the manager only keeps
+ * those that were looked up or changed. Changes are written to the store
+ * immediately.
  */
 class AccountManager {
 	public:
@@ -24,6 +30,17 @@ class AccountManager {
 		 */
 		AccountManager();
 
+		/** Set store.
+		 * Drops all accounts kept by the manager.
+		 * @param store Opened store or nullptr to keep accounts in memory only (referenced).
+		 */
+		void set_store( AccountStore* store );
+
+		/** Get store.
+		 * @return Store or nullptr.
+		 */
+		AccountStore* get_store() const;
+
 		/** Find existing account.
 		 * @param username Username.
 		 * @return Account or nullptr if not found.
@@ -55,7 +72,8 @@ class AccountManager {
 
 		/** Load accounts from directory.
 		 * After loading only those accounts from the directory will exist in the
-		 * manager. Everything else is dropped.
+		 * manager. Everything else is dropped. Only for managers without a
+		 * store, see AccountStore::import_directory() for migrating into one.
 		 * @param path_ Path.
 		 * @param strategy Strategy for failures.
 		 * @return Number of accounts loaded.
@@ -65,7 +83,10 @@ class AccountManager {
 	private:
 		typedef std::map<const std::string, Account> AccountMap;
 
-		AccountMap m_accounts;
+		void store_account( const Account& account );
+
+		mutable AccountMap m_accounts;
+		AccountStore* m_store;
 };
 
 }
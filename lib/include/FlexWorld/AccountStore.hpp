@@ -0,0 +1,153 @@
+#pragma once
+
+#include <FlexWorld/Account.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+/** Indexed, persistent account database.
+ *
+ * Accounts live in a data file ("accounts.fwa") that's only appended to.
+ * Every put record holds a whole account, remove records drop one. Records
+ * end with a CRC-32, all numbers are little-endian.
+ *
+ * An index file ("accounts.fwi") maps usernames to the offset of their
+ * latest put record: an open addressing hash table of fixed-size slots (64
+ * bit hash, 64 bit offset) with a power of two size, written as it is kept
+ * in memory. Opening reads the index in one go and only scans the data
+ * records written after the index was saved, so opening doesn't depend on
+ * the number of accounts. Records are read when an account is looked up.
+ *
+ * Changed accounts are appended to the data file right away, the index is
+ * written with flush() (and on destruction). A missing or outdated index is
+ * rebuilt from the data file.
+ */
+class AccountStore {
+	public:
+		/** Thrown when the store can't be read.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( ReadException );
+
+		/** Thrown when the store can't be written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( WriteException );
+
+		static const std::string DATA_FILENAME; ///< Filename of the data file in the store's directory.
+		static const std::string INDEX_FILENAME; ///< Filename of the index file in the store's directory.
+
+		/** Ctor.
+		 * @param directory Directory.
+		 */
+		AccountStore( const std::string& directory );
+
+		/** Dtor.
+		 * Writes the index if it changed.
+		 */
+		~AccountStore();
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		AccountStore( const AccountStore& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		AccountStore& operator=( const AccountStore& other ) = delete;
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Open.
+		 * Creates the store if it doesn't exist. A damaged tail of the data
+		 * file (e.g. from a crash while writing) is cut off.
+		 * @throws ReadException if the files can't be opened or are invalid.
+		 */
+		void open();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get number of accounts.
+		 * @return Number of accounts.
+		 */
+		std::size_t get_num_accounts() const;
+
+		/** Find account.
+		 * Reads the account's record from the data file.
+		 * @param username Username.
+		 * @param account Account receiving the data if found.
+		 * @return true if found.
+		 * @throws ReadException if the record can't be read.
+		 */
+		bool find_account( const std::string& username, Account& account ) const;
+
+		/** Add or replace account.
+		 * @param account Account (username and password must not be empty).
+		 * @throws WriteException if writing fails.
+		 */
+		void put_account( const Account& account );
+
+		/** Remove account.
+		 * @param username Username.
+		 * @return true if the account existed.
+		 * @throws WriteException if writing fails.
+		 */
+		bool remove_account( const std::string& username );
+
+		/** Write the index.
+		 * @throws WriteException if writing fails.
+		 */
+		void flush();
+
+		/** Import accounts from a directory of YAML files.
+		 * Migrates the former one file per account format (see AccountDriver).
+		 * Existing accounts with the same username are replaced.
+		 * @param path Path.
+		 * @param num_failed Set to the number of files that couldn't be read.
+		 * @return Number of imported accounts.
+		 * @throws WriteException if writing fails.
+		 */
+		std::size_t import_directory( const std::string& path, std::size_t& num_failed );
+
+	private:
+		struct Slot {
+			uint64_t hash;
+			uint64_t offset;
+		};
+
+		typedef std::vector<Slot> SlotArray;
+		typedef std::vector<char> Buffer;
+
+		std::string make_path( const std::string& filename ) const;
+		bool read_index( uint64_t data_size );
+		uint64_t scan_records( uint64_t offset, uint64_t data_size );
+		bool read_record( uint64_t offset, Buffer& record ) const;
+		std::size_t find_slot( const std::string& username, uint64_t hash ) const;
+		void insert_slot( uint64_t hash, uint64_t offset );
+		void grow();
+		void append( const Buffer& record );
+
+		std::string m_directory;
+
+		SlotArray m_slots;
+		std::size_t m_num_accounts;
+		std::size_t m_num_used_slots;
+		uint64_t m_data_size;
+
+		mutable std::ifstream m_in;
+		std::ofstream m_out;
+
+		bool m_open;
+		bool m_index_changed;
+};
+
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/Planet.hpp>
+
+#include <boost/thread.hpp>
+#include <map>
+#include <string>
+
+namespace fw {
+
+class LockFacility;
+class BlockJournal;
+
+/** Service for saving planets periodically in the background.
+ *
+ * Every added planet is saved to its own directory (named after the planet's
+ * ID) below the service's directory, see PlanetWriter. A save only covers
+ * chunks that have been changed since the last save, taken from the planet's
+ * dirty chunks.
+ *
+ * Saves run in a worker thread. The planet is locked through the LockFacility
+ * only for copying a single chunk's blocks, encoding and writing happens
+ * without any lock held. Chunks changed while a save is running are marked
+ * dirty again and picked up by the next save.
+ *
+ * A planet can be added with its BlockJournal. Every save then rotates the
+ * journal when taking the dirty chunks and removes the segments covered by
+ * the save once it's flushed. After a failed save, segments are kept until
+ * a later save of the planet succeeded.
+ *
+ * A handler gets notified after every periodic save, e.g. to save other data
+ * in the same cycle.
+ */
+class AutosaveService {
+	public:
+		/** Handler for periodic saves.
+		 */
+		class Handler {
+			public:
+				/** Dtor.
+				 */
+				virtual ~Handler();
+
+				/** Handle periodic save.
+				 * Called from the worker thread after every periodic save, with no
+				 * locks held.
+				 */
+				virtual void handle_autosave() = 0;
+		};
+
+		/** Statistics.
+		 * Times are in microseconds.
+		 */
+		struct Statistics {
+			/** Ctor.
+			 */
+			Statistics();
+
+			std::size_t num_saves; ///< Number of completed saves.
+			std::size_t num_failed_saves; ///< Number of saves that failed writing.
+			std::size_t num_saved_chunks; ///< Number of chunks saved in total.
+			std::size_t last_num_chunks; ///< Number of chunks saved by the last save.
+			uint64_t last_save_time; ///< Duration of the last save.
+			uint64_t last_max_lock_time; ///< Longest planet lock held by the last save.
+			uint64_t max_lock_time; ///< Longest planet lock held by any save.
+			uint64_t total_lock_time; ///< Time planets have been locked in total.
+		};
+
+		/** Ctor.
+		 * @param lock_facility Lock facility (reference is stored!).
+		 * @param directory Directory for saved planets.
+		 */
+		AutosaveService( LockFacility& lock_facility, const std::string& directory );
+
+		/** Dtor.
+		 * Stops the worker thread.
+		 */
+		~AutosaveService();
+
+		/** Set handler.
+		 * @param handler Handler (reference is stored!).
+		 */
+		void set_handler( Handler& handler );
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Get directory of a planet's save.
+		 * @param planet_id Planet ID.
+		 * @return Directory.
+		 */
+		std::string get_planet_directory( const std::string& planet_id ) const;
+
+		/** Set interval between saves.
+		 * @param seconds Seconds (> 0).
+		 */
+		void set_interval( uint32_t seconds );
+
+		/** Get interval between saves.
+		 * @return Seconds.
+		 */
+		uint32_t get_interval() const;
+
+		/** Add planet.
+		 * The planet must have a lock at the lock facility. An existing save of
+		 * the planet is updated.
+		 * @param planet Planet (reference is stored!).
+		 * @param journal Opened journal of the planet's edits or nullptr (pointer is stored!).
+		 * @throws PlanetWriter::WriteException if the save can't be opened.
+		 */
+		void add_planet( Planet& planet, BlockJournal* journal = nullptr );
+
+		/** Check if planet has been added.
+		 * @param planet Planet.
+		 * @return true if added.
+		 */
+		bool has_planet( const Planet& planet ) const;
+
+		/** Remove planet.
+		 * Blocks while a save is running.
+		 * @param planet Planet.
+		 */
+		void remove_planet( const Planet& planet );
+
+		/** Save all planets in the calling thread.
+		 * Blocks while the worker thread is saving. The planets must not be
+		 * locked by the caller.
+		 * @return Number of saved chunks.
+		 */
+		std::size_t save();
+
+		/** Check if a save is running.
+		 * @return true if saving.
+		 */
+		bool is_saving() const;
+
+		/** Get number of chunks left in the running save.
+		 * @return Number of chunks (0 if not saving).
+		 */
+		std::size_t get_num_pending_chunks() const;
+
+		/** Get statistics.
+		 * @return Statistics.
+		 */
+		Statistics get_statistics() const;
+
+		/** Start worker thread.
+		 */
+		void start();
+
+		/** Stop worker thread.
+		 * Waits for a running save. Doesn't save, call save() afterwards for a
+		 * final save.
+		 */
+		void stop();
+
+		/** Check if worker thread is running.
+		 * @return true if running.
+		 */
+		bool is_running() const;
+
+	private:
+		struct PlanetEntry {
+			PlanetEntry( Planet& planet_, BlockJournal* journal_, const std::string& directory );
+
+			Planet* planet;
+			BlockJournal* journal;
+			PlanetWriter writer;
+			bool keep_journal;
+		};
+
+		typedef std::map<const Planet*, PlanetEntry*> PlanetEntryMap;
+
+		std::size_t save_planet( PlanetEntry& entry, uint64_t& max_lock_time, uint64_t& total_lock_time );
+		void run();
+
+		PlanetEntryMap m_planets;
+		std::string m_directory;
+		uint32_t m_interval;
+		Handler* m_handler;
+
+		Statistics m_statistics;
+		std::size_t m_num_pending_chunks;
+		bool m_saving;
+
+		boost::thread m_thread;
+		mutable boost::mutex m_internal_lock;
+		boost::mutex m_save_lock;
+		boost::condition_variable m_condition;
+
+		LockFacility& m_lock_facility;
+		bool m_stop;
+};
+
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <FlexWorld/FlexID.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+class Class;
+
+/** Write-ahead journal of block edits.
+ *
+ * The journal makes single block edits durable between two saves of a
+ * planet, without rewriting chunks. It's kept in the planet's save directory
+ * as a sequence of segment files ("journal.<segment>.fwj"), each starting
+ * with a header (magic "FWJL", format version and segment number).
+ *
+ * Segments hold records: class records map a segment-local class index to a
+ * class ID, edit records hold the edited block's position (packed into 64
+ * bits), its class index (or Chunk::INVALID_BLOCK for removed blocks) and the
+ * chunk's revision after the edit. Every record ends with a CRC-32, so torn
+ * writes after a crash are detected. All numbers are little-endian.
+ *
+ * Appending only encodes the record into a buffer. Buffered records are
+ * written and synced to disk in groups (group commit), either by the commit
+ * thread every commit interval or by sync().
+ *
+ * When a planet is saved, rotate() starts a new segment at the time the
+ * dirty chunks are taken. Once the save is complete, the old segments are
+ * covered by the save and can be removed. On startup, the remaining segments
+ * are replayed on top of the saved planet. Edits already contained in the
+ * save are skipped by comparing revisions.
+ */
+class BlockJournal {
+	public:
+		/** Thrown when the journal can't be read or written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( IOException );
+
+		/** Block edit.
+		 */
+		struct Edit {
+			Planet::BlockPosition position; ///< Absolute block position.
+			Chunk::Block cls; ///< Index into the class IDs read, Chunk::INVALID_BLOCK for removed blocks.
+			Chunk::Revision revision; ///< Chunk revision after the edit.
+		};
+
+		typedef std::vector<Edit> EditArray; ///< Array of edits.
+
+		/** Statistics.
+		 * Times are in microseconds.
+		 */
+		struct Statistics {
+			/** Ctor.
+			 */
+			Statistics();
+
+			std::size_t num_edits; ///< Number of appended edits.
+			std::size_t num_commits; ///< Number of group commits (write + sync).
+			std::size_t num_failed_commits; ///< Number of failed commits (their records are kept for the next one).
+			std::size_t num_bytes; ///< Number of bytes written.
+			uint64_t last_commit_time; ///< Duration of the last commit.
+			uint64_t max_commit_time; ///< Longest commit.
+		};
+
+		/** Read all segments of a journal.
+		 * Reading stops at the first damaged or incomplete record.
+		 * @param directory Directory of the saved planet.
+		 * @param class_ids Array receiving the class IDs referenced by the edits (cleared).
+		 * @param edits Array receiving the edits in order (cleared).
+		 * @return Number of segments read.
+		 * @throws IOException if a segment can't be opened or has an invalid header.
+		 */
+		static std::size_t read( const std::string& directory, std::vector<FlexID>& class_ids, EditArray& edits );
+
+		/** Apply edits to a planet.
+		 * Edits with a revision not newer than their chunk's are skipped.
+		 * Changed chunks get the edits' revisions and are marked dirty.
+		 * @param planet Planet.
+		 * @param edits Edits.
+		 * @param classes Classes of the class IDs read with the edits.
+		 * @return Number of applied edits.
+		 */
+		static std::size_t apply( Planet& planet, const EditArray& edits, const Planet::ClassArray& classes );
+
+		/** Ctor.
+		 * @param directory Directory of the saved planet.
+		 */
+		BlockJournal( const std::string& directory );
+
+		/** Dtor.
+		 * Stops the commit thread and commits buffered records.
+		 */
+		~BlockJournal();
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		BlockJournal( const BlockJournal& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		BlockJournal& operator=( const BlockJournal& other ) = delete;
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Open.
+		 * Starts a new segment after the existing ones, which are kept.
+		 * @throws IOException if the segment can't be created.
+		 */
+		void open();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get current segment.
+		 * @return Segment number.
+		 */
+		uint32_t get_segment() const;
+
+		/** Append edit.
+		 * @param position Absolute block position.
+		 * @param cls Class or nullptr for removed blocks.
+		 * @param revision Chunk revision after the edit.
+		 */
+		void append( const Planet::BlockPosition& position, const Class* cls, Chunk::Revision revision );
+
+		/** Get number of buffered bytes not committed yet.
+		 * @return Number of bytes.
+		 */
+		std::size_t get_num_buffered_bytes() const;
+
+		/** Commit buffered records.
+		 * Blocks until all records appended before are on disk. If writing
+		 * fails, the records that didn't make it stay buffered for the next
+		 * commit.
+		 * @throws IOException if writing fails.
+		 */
+		void sync();
+
+		/** Start a new segment.
+		 * Records appended afterwards go to the new segment.
+		 * @return Number of the last segment before the new one.
+		 */
+		uint32_t rotate();
+
+		/** Remove segments.
+		 * Commits buffered records before.
+		 * @param last Number of the last segment to remove.
+		 * @throws IOException if writing fails.
+		 */
+		void remove_segments( uint32_t last );
+
+		/** Set interval between group commits of the commit thread.
+		 * @param milliseconds Milliseconds (> 0).
+		 */
+		void set_commit_interval( uint32_t milliseconds );
+
+		/** Get interval between group commits.
+		 * @return Milliseconds.
+		 */
+		uint32_t get_commit_interval() const;
+
+		/** Get statistics.
+		 * @return Statistics.
+		 */
+		Statistics get_statistics() const;
+
+		/** Start commit thread.
+		 */
+		void start();
+
+		/** Stop commit thread.
+		 * Commits buffered records.
+		 */
+		void stop();
+
+		/** Check if commit thread is running.
+		 * @return true if running.
+		 */
+		bool is_running() const;
+
+	private:
+		typedef std::vector<char> Buffer;
+		typedef std::map<const Class*, Chunk::Block> ClassIndexMap;
+
+		struct PendingSegment {
+			uint32_t segment;
+			Buffer buffer;
+		};
+
+		typedef std::vector<PendingSegment> PendingSegmentArray;
+
+		std::string make_path( uint32_t segment ) const;
+		void commit();
+		void run();
+
+		std::string m_directory;
+		uint32_t m_commit_interval;
+
+		// Guarded by m_internal_lock.
+		PendingSegmentArray m_pending_segments;
+		ClassIndexMap m_class_indices;
+		uint32_t m_segment;
+		Statistics m_statistics;
+		bool m_open;
+		bool m_stop;
+
+		// Guarded by m_commit_lock.
+		std::FILE* m_file;
+		uint32_t m_file_segment;
+
+		boost::thread m_thread;
+		mutable boost::mutex m_internal_lock;
+		boost::mutex m_commit_lock;
+		boost::condition_variable m_condition;
+};
+
+}
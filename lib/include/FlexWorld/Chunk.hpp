@@ -6,23 +6,48 @@
 namespace fw {
 
 class Class;
+class ChunkAllocator;
 
 /** Chunk.
  * Contains blocks.
+ *
+ * Blocks are stored palette-compressed: every distinct block value of the
+ * chunk gets a palette entry, and each block stores the bit-packed index of
+ * its entry. Indices start with 1 bit and grow to 2, 4 and 8 bits as the
+ * palette fills up. Chunks with more than 256 distinct values switch to 16
+ * bits per block and store the values directly.
+ *
+ * Uniform chunks (all blocks unset or all blocks of the same class) don't
+ * allocate any block storage. Storage is allocated on the first differing
+ * set_block() and released again when an edit makes a palette-compressed
+ * chunk uniform. Chunks with direct storage only become uniform through
+ * fill() or clear().
+ *
+ * Palette, reference counts and indices live in one buffer. If the chunk was
+ * created with a ChunkAllocator, buffers are taken from its pools instead of
+ * the heap.
  */
 class Chunk {
 	public:
 		typedef uint8_t ScalarType; ///< Size type for block coordinates.
 		typedef uint16_t Block; ///< Block.
 		typedef sf::Vector3<ScalarType> Vector; ///< Vector.
+		typedef uint32_t Revision; ///< Revision.
 
 		static const Block MAX_BLOCK_ID; ///< Maximum allowed block class ID.
+		static const Block INVALID_BLOCK; ///< Invalid/unset block (as found in raw data).
 
 		/** Ctor.
 		 * @param size Size.
 		 */
 		Chunk( const Vector& size );
 
+		/** Ctor.
+		 * @param size Size.
+		 * @param allocator Allocator for block storage (referenced).
+		 */
+		Chunk( const Vector& size, ChunkAllocator& allocator );
+
 		/** Dtor.
 		 */
 		~Chunk();
@@ -38,9 +63,34 @@ class Chunk {
 		Chunk& operator=( const Chunk& other ) = delete;
 
 		/** Clear chunk.
+		 * Unsets all blocks and releases block storage.
 		 */
 		void clear();
 
+		/** Set all blocks.
+		 * Releases block storage.
+		 * @param id ID.
+		 */
+		void fill( Block id );
+
+		/** Check if all blocks are the same (or all are unset).
+		 * @return true if uniform.
+		 */
+		bool is_uniform() const;
+
+		/** Check if no block is set.
+		 * @return true if empty.
+		 */
+		bool is_empty() const;
+
+		/** Get block of a uniform chunk.
+		 * Undefined behaviour if chunk is not uniform or empty.
+		 * @return Block (class ID).
+		 * @see is_uniform
+		 * @see is_empty
+		 */
+		Block get_uniform_block() const;
+
 		/** Check if a block is set.
 		 * @param pos Position.
 		 * @return true if set.
@@ -52,6 +102,11 @@ class Chunk {
 		 */
 		const Vector& get_size() const;
 
+		/** Get number of blocks.
+		 * @return Number of blocks (size.x * size.y * size.z).
+		 */
+		std::size_t get_num_blocks() const;
+
 		/** Get block.
 		 * Undefined behaviour if no block is set at given position.
 		 * @param pos Position.
@@ -72,15 +127,66 @@ class Chunk {
 		void reset_block( const Vector& pos );
 
 		/** Get raw block data.
-		 * @return Block data.
+		 * Materializes the flat block array, ordered by z, y, x. Unset blocks are
+		 * stored as INVALID_BLOCK.
+		 * @param buffer Buffer receiving get_num_blocks() blocks.
+		 */
+		void get_raw_data( Block* buffer ) const;
+
+		/** Set raw block data.
+		 * Replaces all blocks at once, picking the smallest storage for the
+		 * buffer's distinct values.
+		 * @param buffer Buffer with get_num_blocks() blocks, ordered like get_raw_data() (INVALID_BLOCK for unset blocks).
+		 */
+		void set_raw_data( const Block* buffer );
+
+		/** Get number of bits used per block.
+		 * @return Bits (0 for uniform chunks, 1, 2, 4, 8 or 16 otherwise).
+		 */
+		uint8_t get_bits_per_block() const;
+
+		/** Get revision.
+		 * The revision is increased with every change of the chunk's blocks. New
+		 * chunks start at 1, 0 is never used.
+		 * @return Revision.
+		 */
+		Revision get_revision() const;
+
+		/** Set revision.
+		 * Used to restore the revision of a chunk loaded from disk.
+		 * @param revision Revision (must not be 0).
 		 */
-		const Block* get_raw_data() const;
+		void set_revision( Revision revision );
 
 	private:
-		static const Block INVALID_BLOCK; ///< Invalid/unset block.
+		typedef uint32_t Word;
+
+		Word* allocate_buffer( uint8_t bits_shift );
+		void release_buffer( Word* buffer, uint8_t bits_shift );
+		void attach_buffer( Word* buffer, uint8_t bits_shift );
+
+		std::size_t get_index( const Vector& pos ) const;
+		Word get_value( std::size_t index ) const;
+		void set_value( std::size_t index, Word value );
+		void store( std::size_t index, Block id );
+		Word find_or_add_palette_entry( Block id );
+		void grow();
+		void expand();
+		void collapse( Block id );
+		void bump_revision();
 
 		Vector m_size;
-		Block* m_blocks;
+		std::size_t m_num_blocks;
+		ChunkAllocator* m_allocator;
+
+		Word* m_buffer; // nullptr if uniform.
+		Word* m_data;
+		uint32_t* m_palette_counts;
+		Block* m_palette; // Points to m_uniform_block if uniform.
+		std::size_t m_palette_size;
+		Block m_uniform_block;
+		uint8_t m_bits_shift; // log2 of bits per block.
+		Revision m_revision;
 };
 
 }
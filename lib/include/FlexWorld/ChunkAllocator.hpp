@@ -0,0 +1,106 @@
+#pragma once
+
+#include <FlexWorld/Chunk.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace fw {
+
+/** Chunk allocator.
+ *
+ * Slab allocator for chunks and their block storage. Memory is taken from
+ * SLAB_SIZE sized slabs and handed out in fixed-size slots; every slot size
+ * has its own pool with a free list, so released slots are reused in
+ * constant time.
+ *
+ * clear() releases all slabs at once without destroying the chunks created by
+ * the allocator, which is only valid because chunks don't own anything
+ * besides their block storage.
+ */
+class ChunkAllocator {
+	public:
+		static const std::size_t SLAB_SIZE; ///< Default slab size in bytes.
+
+		/** Ctor.
+		 */
+		ChunkAllocator();
+
+		/** Dtor.
+		 * Releases all slabs.
+		 */
+		~ChunkAllocator();
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		ChunkAllocator( const ChunkAllocator& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		ChunkAllocator& operator=( const ChunkAllocator& other ) = delete;
+
+		/** Allocate memory.
+		 * @param size Size in bytes (> 0).
+		 * @return Memory (uninitialized).
+		 */
+		void* allocate( std::size_t size );
+
+		/** Release memory.
+		 * @param ptr Memory returned by allocate().
+		 * @param size Size passed to allocate().
+		 */
+		void release( void* ptr, std::size_t size );
+
+		/** Create chunk.
+		 * The chunk uses this allocator for its block storage.
+		 * @param size Chunk size.
+		 * @return Chunk.
+		 */
+		Chunk& create_chunk( const Chunk::Vector& size );
+
+		/** Destroy chunk.
+		 * @param chunk Chunk created by create_chunk().
+		 */
+		void destroy_chunk( Chunk& chunk );
+
+		/** Release all memory.
+		 * All chunks and memory handed out before become invalid.
+		 */
+		void clear();
+
+		/** Get number of allocated slabs.
+		 * @return Number of slabs.
+		 */
+		std::size_t get_num_slabs() const;
+
+		/** Get number of bytes allocated for slabs.
+		 * @return Bytes.
+		 */
+		std::size_t get_num_slab_bytes() const;
+
+		/** Get number of slots in use.
+		 * @return Number of slots.
+		 */
+		std::size_t get_num_allocations() const;
+
+	private:
+		struct Pool {
+			std::size_t slot_size;
+			char* next;
+			char* end;
+			std::vector<void*> free_slots;
+		};
+
+		static std::size_t get_slot_size( std::size_t size );
+
+		Pool& get_pool( std::size_t slot_size );
+
+		std::vector<Pool> m_pools;
+		std::vector<void*> m_slabs;
+		std::size_t m_num_slab_bytes;
+		std::size_t m_num_allocations;
+};
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <SFML/System/Vector3.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace fw {
+
+class Chunk;
+
+/** Chunk directory.
+ *
+ * Maps chunk positions to chunks in constant time. Small planets use a dense
+ * index with one slot per possible chunk position. Planets with more possible
+ * positions than MAX_DENSE_SLOTS use an open-addressing hash table keyed by
+ * the packed chunk position instead, so memory only grows with the number of
+ * chunks actually created.
+ *
+ * The directory doesn't own the chunks, it only references them.
+ */
+class ChunkDirectory {
+	public:
+		typedef uint16_t ScalarType; ///< Scalar type for chunk positions.
+		typedef sf::Vector3<ScalarType> Vector; ///< Chunk position.
+
+		/** Lookup mode.
+		 */
+		enum Mode {
+			DENSE = 0, ///< Dense index, one slot per possible position.
+			HASHED ///< Open-addressing hash table.
+		};
+
+		static const std::size_t MAX_DENSE_SLOTS; ///< Maximum number of slots for automatic dense mode.
+
+		/** Ctor.
+		 * The mode is selected by the number of possible chunk positions.
+		 * @param size Size in chunks.
+		 */
+		ChunkDirectory( const Vector& size );
+
+		/** Ctor.
+		 * @param size Size in chunks.
+		 * @param mode Mode.
+		 */
+		ChunkDirectory( const Vector& size, Mode mode );
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		ChunkDirectory( const ChunkDirectory& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		ChunkDirectory& operator=( const ChunkDirectory& other ) = delete;
+
+		/** Get mode.
+		 * @return Mode.
+		 */
+		Mode get_mode() const;
+
+		/** Get size.
+		 * @return Size in chunks.
+		 */
+		const Vector& get_size() const;
+
+		/** Get number of chunks.
+		 * @return Number of chunks.
+		 */
+		std::size_t get_num_chunks() const;
+
+		/** Find chunk.
+		 * @param position Position (must be valid).
+		 * @return Chunk or nullptr if not found.
+		 */
+		Chunk* find( const Vector& position ) const;
+
+		/** Insert chunk.
+		 * Undefined behaviour if a chunk at the given position exists.
+		 * @param position Position (must be valid).
+		 * @param chunk Chunk (referenced).
+		 */
+		void insert( const Vector& position, Chunk& chunk );
+
+		/** Get nth chunk position.
+		 * Positions are stored in insertion order.
+		 * @param index Index (must be valid).
+		 * @return Position.
+		 */
+		const Vector& get_position( std::size_t index ) const;
+
+		/** Get nth chunk.
+		 * @param index Index (must be valid).
+		 * @return Chunk.
+		 */
+		Chunk& get_chunk( std::size_t index ) const;
+
+		/** Clear.
+		 * Removes all references. Chunks are NOT deleted.
+		 */
+		void clear();
+
+	private:
+		typedef uint64_t Key;
+
+		struct Slot {
+			Key key;
+			Chunk* chunk;
+		};
+
+		struct Entry {
+			Vector position;
+			Chunk* chunk;
+		};
+
+		typedef std::vector<Chunk*> ChunkPtrArray;
+		typedef std::vector<Slot> SlotArray;
+		typedef std::vector<Entry> EntryArray;
+
+		static const Key EMPTY_KEY;
+
+		static Key pack( const Vector& position );
+
+		std::size_t find_slot( Key key ) const;
+		void grow();
+
+		Vector m_size;
+		Mode m_mode;
+
+		ChunkPtrArray m_dense;
+		SlotArray m_slots;
+		std::size_t m_slot_mask;
+		unsigned int m_slot_shift;
+
+		EntryArray m_entries;
+};
+
+}
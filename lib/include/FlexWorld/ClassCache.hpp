@@ -1,7 +1,6 @@
 #pragma once
 
 #include <vector>
-#include <map>
 #include <cstdint>
 
 namespace fw {
@@ -12,6 +11,10 @@ class Class;
  * Every cached class has a use (reference) counter. It's incremented with
  * every cache() call and decremented when calling forget(). As soon as 0 is
  * reached, the class is removed from the cache.
+ *
+ * IDs of removed classes are kept in a free list and reused first. Classes
+ * are mapped to their IDs with an open-addressing hash table, so caching,
+ * forgetting and reference counting are constant time.
  */
 class ClassCache {
 	public:
@@ -45,14 +48,35 @@ class ClassCache {
 
 		/** Cache class.
 		 * @param cls Class.
+		 * @param num_refs Number of uses to add (> 0).
 		 * @return ID.
 		 */
-		IdType cache( const Class& cls );
+		IdType cache( const Class& cls, uint32_t num_refs = 1 );
 
 		/** Forget class.
-		 * @param cls Class.
+		 * @param cls Class (must be cached).
+		 * @param num_refs Number of uses to remove (> 0, at most the current use count).
+		 */
+		void forget( const Class& cls, uint32_t num_refs = 1 );
+
+		/** Add uses to a cached class.
+		 * @param id ID (must be valid).
+		 * @param num_refs Number of uses to add.
+		 */
+		void add_refs( IdType id, uint32_t num_refs );
+
+		/** Remove uses from a cached class.
+		 * The class is removed if no uses are left.
+		 * @param id ID (must be valid).
+		 * @param num_refs Number of uses to remove (at most the current use count).
+		 */
+		void release_refs( IdType id, uint32_t num_refs );
+
+		/** Get number of uses of a cached class.
+		 * @param id ID (must be valid).
+		 * @return Number of uses.
 		 */
-		void forget( const Class& cls );
+		uint32_t get_num_refs( IdType id ) const;
 
 		/** Get number of holes.
 		 * @return Holes.
@@ -60,14 +84,32 @@ class ClassCache {
 		uint32_t get_num_holes() const;
 
 	private:
-		typedef std::vector<const Class*> ClassVector;
-		typedef std::pair<IdType, uint32_t> IdUsePair;
-		typedef std::map<const Class*, IdUsePair> IdUsePairMap;
-
-		uint32_t m_num_holes;
-
-		ClassVector m_classes;
-		IdUsePairMap m_ids;
+		struct Entry {
+			const Class* cls; // nullptr for holes.
+			uint32_t num_refs;
+		};
+
+		struct Slot {
+			const Class* cls; // nullptr for empty slots.
+			IdType id;
+		};
+
+		typedef std::vector<Entry> EntryVector;
+		typedef std::vector<IdType> IdVector;
+		typedef std::vector<Slot> SlotVector;
+
+		std::size_t get_home_slot( const Class* cls ) const;
+		std::size_t find_slot( const Class* cls ) const;
+		void insert_slot( const Class* cls, IdType id );
+		void erase_slot( const Class* cls );
+		void rehash( std::size_t num_slots );
+
+		EntryVector m_classes;
+		IdVector m_free_ids;
+		SlotVector m_slots;
+		std::size_t m_num_cached_classes;
+		std::size_t m_slot_mask;
+		unsigned int m_slot_shift;
 };
 
 }
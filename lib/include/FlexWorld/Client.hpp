@@ -2,6 +2,7 @@
 
 #include <FlexWorld/MessageHandler.hpp>
 #include <FlexWorld/ServerProtocol.hpp>
+#include <FlexWorld/ReceiveBuffer.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 
@@ -77,7 +78,7 @@ class Client {
 		Handler& get_handler();
 
 	private:
-		enum { READ_BUFFER_SIZE = 1024 };
+		enum { MIN_READ_SIZE = 4096 };
 
 		void handle_connect( const boost::system::error_code& error );
 		void start_read();
@@ -87,8 +88,7 @@ class Client {
 		boost::asio::io_service& m_io_service;
 		std::unique_ptr<boost::asio::ip::tcp::socket> m_socket;
 
-		char m_receive_buffer[READ_BUFFER_SIZE];
-		ServerProtocol::Buffer m_buffer;
+		ReceiveBuffer m_receive_buffer;
 
 		Handler* m_handler;
 		bool m_started;
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <FlexWorld/FlexID.hpp>
+#include <FlexWorld/Entity.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+class World;
+class Class;
+
+/** Binary store for a world's entities.
+ *
+ * All entities live in one file ("entities.fwe" in the store's directory),
+ * starting with a header (magic "FWEN" and format version), followed by
+ * records. Class records and planet records append to the store's class and
+ * planet tables, entity records hold an entity's ID, class and planet index,
+ * position, rotation, amount, parent, hook and custom name, delete records
+ * remove an entity. Every record ends with a CRC-32, all numbers are
+ * little-endian.
+ *
+ * The file is a log: saving only appends records of entities that changed
+ * (compared by their records' CRCs) or vanished since the last save or load.
+ * Once superseded records outnumber the live ones, the file is rewritten
+ * (compacted) instead.
+ *
+ * Opening reads the whole file sequentially and indexes the latest record of
+ * every entity, load_entities() then creates the entities in ID order
+ * without parsing anything twice.
+ */
+class EntityStore {
+	public:
+		/** Thrown when the store can't be read.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( ReadException );
+
+		/** Thrown when the store can't be written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( WriteException );
+
+		typedef std::vector<const Class*> ClassArray; ///< Array of classes, indexed like the class table.
+
+		static const std::string FILENAME; ///< Filename of the store in its directory.
+
+		/** Ctor.
+		 * @param directory Directory.
+		 */
+		EntityStore( const std::string& directory );
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		EntityStore( const EntityStore& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		EntityStore& operator=( const EntityStore& other ) = delete;
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Get path of the store's file.
+		 * @return Path.
+		 */
+		std::string get_path() const;
+
+		/** Open.
+		 * Reads the stored entities if the file exists, otherwise the store
+		 * starts empty. A damaged tail (e.g. from a crash while saving) is
+		 * dropped and the file is compacted with the next save.
+		 * @throws ReadException if the file can't be read or has an invalid header.
+		 */
+		void open();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get number of classes in the class table.
+		 * @return Number of classes.
+		 */
+		std::size_t get_num_classes() const;
+
+		/** Get class ID.
+		 * @param index Index (< get_num_classes()).
+		 * @return Class ID.
+		 */
+		const FlexID& get_class_id( std::size_t index ) const;
+
+		/** Get number of stored entities.
+		 * @return Number of entities.
+		 */
+		std::size_t get_num_entities() const;
+
+		/** Get number of records in the file.
+		 * Includes superseded entity records and delete records.
+		 * @return Number of records.
+		 */
+		std::size_t get_num_records() const;
+
+		/** Load stored entities into a world.
+		 * Entities keep their IDs, which mustn't be used in the world. Links to
+		 * planets that don't exist are dropped. Entities referencing a missing
+		 * class (nullptr) are skipped, children attached to them too. Only
+		 * callable once after opening.
+		 * @param world World.
+		 * @param classes Classes of the class table, each added to the world.
+		 * @return Number of loaded entities.
+		 */
+		std::size_t load_entities( World& world, const ClassArray& classes );
+
+		/** Save entities of a world.
+		 * Only entities that changed since the last save are written.
+		 * @param world World.
+		 * @return Number of written entity and delete records.
+		 * @throws WriteException if writing fails.
+		 */
+		std::size_t save( const World& world );
+
+		/** Save a single entity of a world.
+		 * Writes the entity only if it changed, e.g. to store a new entity right
+		 * away instead of waiting for the next save(). A store that needs
+		 * compaction is rewritten as a whole.
+		 * @param world World.
+		 * @param entity Entity (must be in world).
+		 * @return true if written.
+		 * @throws WriteException if writing fails.
+		 */
+		bool save_entity( const World& world, const Entity& entity );
+
+	private:
+		typedef std::vector<char> Buffer;
+		typedef std::map<std::string, uint32_t> IndexMap;
+
+		void read_records();
+		uint32_t get_class_index( const Class& cls, Buffer& tables );
+		uint32_t get_planet_index( const std::string& planet_id, Buffer& tables );
+		void write_tables( Buffer& buffer ) const;
+		uint32_t encode_entity( const World& world, const Entity& entity, Buffer& buffer, Buffer& tables );
+		std::size_t compact( const World& world );
+		void append( const Buffer& buffer );
+
+		std::string m_directory;
+
+		std::vector<FlexID> m_class_ids;
+		IndexMap m_class_indices;
+		std::vector<std::string> m_planet_ids;
+		IndexMap m_planet_indices;
+
+		// CRCs of the latest records, indexed by entity ID.
+		std::vector<uint32_t> m_record_crcs;
+		std::vector<bool> m_stored;
+		std::size_t m_num_entities;
+		std::size_t m_num_records;
+
+		// Latest record of every stored entity, only kept until loaded.
+		Buffer m_data;
+		std::vector<std::size_t> m_record_offsets;
+
+		bool m_open;
+		bool m_needs_compaction;
+};
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/TerrainGenerator.hpp>
+
+#include <boost/thread.hpp>
+#include <deque>
+#include <map>
+#include <set>
+
+namespace fw {
+
+class LockFacility;
+
+/** Queue for generating terrain lazily in the background.
+ *
+ * Planets added to the queue are generated on demand, one chunk column (all
+ * chunks with the same x and z position) at a time, when one of the column's
+ * chunks is requested for the first time. Requests are processed in FIFO
+ * order by a worker thread, which locks the planet through the LockFacility
+ * while generating.
+ *
+ * The generated state of a column is changed while the planet is locked. So
+ * when checking with the planet locked, a column that's reported as not
+ * generated will be notified to the handler later.
+ */
+class GeneratorQueue {
+	public:
+		/** Handler for generated columns.
+		 */
+		class Handler {
+			public:
+				/** Dtor.
+				 */
+				virtual ~Handler();
+
+				/** Handle generated column.
+				 * Called from the worker thread after the planet has been unlocked,
+				 * or from generate_now() in the calling thread with the planet still
+				 * locked by the caller.
+				 * @param planet Planet.
+				 * @param x Chunk X position of the column.
+				 * @param z Chunk Z position of the column.
+				 */
+				virtual void handle_generated_column( const Planet& planet, Planet::ScalarType x, Planet::ScalarType z ) = 0;
+		};
+
+		/** Ctor.
+		 * @param lock_facility Lock facility (reference is stored!).
+		 */
+		GeneratorQueue( LockFacility& lock_facility );
+
+		/** Dtor.
+		 * Stops the worker thread.
+		 */
+		~GeneratorQueue();
+
+		/** Set handler.
+		 * @param handler Handler (reference is stored!).
+		 */
+		void set_handler( Handler& handler );
+
+		/** Add planet for lazy generation.
+		 * The planet must have a lock at the lock facility.
+		 * @param planet Planet (reference is stored!).
+		 * @param generator Generator (is copied).
+		 */
+		void add_planet( Planet& planet, const TerrainGenerator& generator );
+
+		/** Check if planet has been added.
+		 * @param planet Planet.
+		 * @return true if added.
+		 */
+		bool has_planet( const Planet& planet ) const;
+
+		/** Remove planet.
+		 * Pending requests for the planet are dropped. Blocks while a column of
+		 * the planet is being generated.
+		 * @param planet Planet.
+		 */
+		void remove_planet( const Planet& planet );
+
+		/** Check if a chunk's column has been generated.
+		 * Chunks of planets not added to the queue count as generated.
+		 * @param planet Planet.
+		 * @param position Chunk position.
+		 * @return true if generated.
+		 */
+		bool is_generated( const Planet& planet, const Planet::Vector& position ) const;
+
+		/** Mark a chunk's column as generated.
+		 * Used for columns loaded from disk, so they aren't generated over.
+		 * @param planet Planet (must be added).
+		 * @param position Chunk position.
+		 */
+		void set_generated( const Planet& planet, const Planet::Vector& position );
+
+		/** Request generation of a chunk's column.
+		 * Does nothing if the column is generated or queued already.
+		 * @param planet Planet.
+		 * @param position Chunk position.
+		 * @return true if the column is generated already.
+		 */
+		bool request_chunk( const Planet& planet, const Planet::Vector& position );
+
+		/** Request generation of all columns around a chunk.
+		 * Columns are queued from the center outwards.
+		 * @param planet Planet.
+		 * @param center Center chunk position.
+		 * @param radius Radius in chunks.
+		 */
+		void request_area( const Planet& planet, const Planet::Vector& center, Planet::ScalarType radius );
+
+		/** Generate a chunk's column in the calling thread, if not done yet.
+		 * Use this when the chunk is needed immediately. The handler is called
+		 * if the column was generated, with the planet still locked. The planet
+		 * must be locked by the caller.
+		 * @param planet Planet.
+		 * @param position Chunk position.
+		 */
+		void generate_now( const Planet& planet, const Planet::Vector& position );
+
+		/** Get number of queued columns.
+		 * @return Number of queued columns.
+		 */
+		std::size_t get_num_queued_columns() const;
+
+		/** Start worker thread.
+		 */
+		void start();
+
+		/** Stop worker thread.
+		 * Waits for the column currently being generated, queued columns are
+		 * kept.
+		 */
+		void stop();
+
+		/** Check if worker thread is running.
+		 * @return true if running.
+		 */
+		bool is_running() const;
+
+		/** Generate all queued columns in the calling thread.
+		 * The worker thread must not be running.
+		 * @return Number of generated columns.
+		 */
+		std::size_t process_queue();
+
+	private:
+		typedef std::set<uint32_t> ColumnSet;
+
+		struct PlanetEntry {
+			PlanetEntry( Planet& planet_, const TerrainGenerator& generator_ );
+
+			Planet* planet;
+			TerrainGenerator generator;
+			ColumnSet requested_columns; // Queued or generated.
+			ColumnSet generated_columns;
+		};
+
+		struct Request {
+			Planet* planet;
+			Planet::ScalarType x;
+			Planet::ScalarType z;
+		};
+
+		typedef std::map<const Planet*, PlanetEntry*> PlanetEntryMap;
+		typedef std::deque<Request> RequestDeque;
+
+		bool request_column( PlanetEntry& entry, Planet::ScalarType x, Planet::ScalarType z );
+		bool process_request( const Request& request, bool notify );
+		void run();
+
+		PlanetEntryMap m_planets;
+		RequestDeque m_requests;
+
+		boost::thread m_thread;
+		mutable boost::mutex m_internal_lock;
+		boost::condition_variable m_condition;
+
+		LockFacility& m_lock_facility;
+		Handler* m_handler;
+		bool m_stop;
+};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+namespace fw {
+
+/** Heightmap generator.
+ *
+ * Generates 2D fractal gradient (Perlin) noise: the sum of a number of
+ * octaves, each with double the frequency of the previous one and its
+ * amplitude multiplied by the persistence. Values of a single octave are in
+ * the range [-1, 1].
+ *
+ * Grids of samples are evaluated in batches: lattice gradients are computed
+ * once per noise cell, and the samples inside a cell are interpolated with
+ * SIMD instructions (AVX or SSE2, depending on the target) or a scalar
+ * fallback. get_value() evaluates a single sample with the same arithmetic.
+ */
+class HeightmapGenerator {
+	public:
+		/** Ctor.
+		 */
+		HeightmapGenerator();
+
+		/** Get seed.
+		 * @return Seed.
+		 */
+		int get_seed() const;
+
+		/** Set seed.
+		 * @param seed Seed.
+		 */
+		void set_seed( int seed );
+
+		/** Get number of octaves.
+		 * @return Number of octaves.
+		 */
+		unsigned int get_num_octaves() const;
+
+		/** Set number of octaves.
+		 * @param num_octaves Number of octaves (> 0).
+		 */
+		void set_num_octaves( unsigned int num_octaves );
+
+		/** Get persistence.
+		 * @return Persistence.
+		 */
+		double get_persistence() const;
+
+		/** Set persistence.
+		 * @param persistence Amplitude factor from one octave to the next.
+		 */
+		void set_persistence( double persistence );
+
+		/** Get frequency.
+		 * @return Frequency.
+		 */
+		double get_frequency() const;
+
+		/** Set frequency of the first octave.
+		 * @param frequency Noise cells per unit.
+		 */
+		void set_frequency( double frequency );
+
+		/** Get value of a single sample.
+		 * @param x X position.
+		 * @param z Z position.
+		 * @return Value.
+		 */
+		double get_value( double x, double z ) const;
+
+		/** Generate values for a grid of samples at integer positions.
+		 * @param x X position of the first sample.
+		 * @param z Z position of the first sample.
+		 * @param width Number of samples along X.
+		 * @param depth Number of samples along Z.
+		 * @param values Buffer receiving width * depth values, indexed by z * width + x.
+		 */
+		void generate( int32_t x, int32_t z, uint32_t width, uint32_t depth, double* values ) const;
+
+		/** Get number of samples interpolated per instruction by generate().
+		 * @return 4 for AVX, 2 for SSE2, 1 for the scalar fallback.
+		 */
+		static unsigned int get_batch_width();
+
+	private:
+		int m_seed;
+		unsigned int m_num_octaves;
+		double m_persistence;
+		double m_frequency;
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <FlexWorld/ServerProtocol.hpp>
+#include <FlexWorld/Planet.hpp>
+
+#include <FWU/Cuboid.hpp>
+#include <unordered_map>
+#include <map>
+#include <vector>
+
+namespace fw {
+
+/** Interest manager for finding the connections that see a chunk.
+ *
+ * Every connection has an interest: a planet and a cuboid of chunks (the
+ * view). Per planet, views are indexed in a uniform grid of cells (cell size
+ * given in chunks), every cell lists the connections whose view overlaps it.
+ * Looking up a chunk only checks the connections of the chunk's cell, so the
+ * cost depends on the number of players nearby, not on the total number.
+ */
+class InterestManager {
+	public:
+		typedef ServerProtocol::ConnectionID ConnectionID; ///< Connection ID.
+		typedef std::vector<ConnectionID> ConnectionIDArray; ///< Array of connection IDs.
+		typedef util::Cuboid<Planet::ScalarType> ChunkCuboid; ///< Cuboid of chunk positions.
+
+		static const Planet::ScalarType DEFAULT_CELL_SIZE; ///< Default cell size in chunks.
+
+		/** Ctor.
+		 * @param cell_size Cell size in chunks (> 0).
+		 */
+		InterestManager( Planet::ScalarType cell_size = DEFAULT_CELL_SIZE );
+
+		/** Get cell size.
+		 * @return Cell size in chunks.
+		 */
+		Planet::ScalarType get_cell_size() const;
+
+		/** Get number of connections with an interest.
+		 * @return Number of interests.
+		 */
+		std::size_t get_num_interests() const;
+
+		/** Set interest of a connection.
+		 * Replaces the previous interest. An empty view removes the interest.
+		 * @param conn_id Connection ID.
+		 * @param planet Planet (referenced).
+		 * @param view View.
+		 */
+		void set_interest( ConnectionID conn_id, const Planet& planet, const ChunkCuboid& view );
+
+		/** Remove interest of a connection.
+		 * @param conn_id Connection ID.
+		 */
+		void remove_interest( ConnectionID conn_id );
+
+		/** Find planet of a connection's interest.
+		 * @param conn_id Connection ID.
+		 * @return Planet or nullptr if the connection has no interest.
+		 */
+		const Planet* find_planet( ConnectionID conn_id ) const;
+
+		/** Get view of a connection's interest.
+		 * Undefined behaviour if the connection has no interest.
+		 * @param conn_id Connection ID.
+		 * @return View.
+		 */
+		const ChunkCuboid& get_view( ConnectionID conn_id ) const;
+
+		/** Find connections seeing a chunk.
+		 * @param planet Planet.
+		 * @param chunk_position Chunk position.
+		 * @param connections Array receiving the connection IDs (cleared before).
+		 */
+		void find_interested( const Planet& planet, const Planet::Vector& chunk_position, ConnectionIDArray& connections ) const;
+
+	private:
+		struct Interest {
+			const Planet* planet;
+			ChunkCuboid view;
+		};
+
+		typedef std::vector<Interest> InterestArray;
+		typedef std::unordered_map<uint64_t, ConnectionIDArray> CellMap;
+		typedef std::map<const Planet*, CellMap> PlanetCellMap;
+
+		void update_cells( ConnectionID conn_id, const Interest& interest, bool add );
+
+		InterestArray m_interests;
+		PlanetCellMap m_cells;
+		std::size_t m_num_interests;
+		Planet::ScalarType m_cell_size;
+};
+
+}
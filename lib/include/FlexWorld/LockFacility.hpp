@@ -12,6 +12,10 @@ class Planet;
  *
  * Uses RefLock objects internally, i.e. it's safe to do multiple locks from
  * the same thread. Do not forget to unlock! ;-)
+ *
+ * When holding several locks, acquire them in this order to avoid deadlocks:
+ * script manager, account manager, world, planet, player list. The player
+ * list lock is only held briefly and nothing else is locked while holding it.
  */
 class LockFacility {
 	public:
@@ -23,6 +27,16 @@ class LockFacility {
 		 */
 		~LockFacility();
 
+		/** Lock or unlock script manager.
+		 * @param do_lock true to lock, false to unlock.
+		 */
+		void lock_script_manager( bool do_lock );
+
+		/** Check if script manager is locked.
+		 * @return true when locked.
+		 */
+		bool is_script_manager_locked() const;
+
 		/** Lock or unlock account manager.
 		 * @param do_lock true to lock, false to unlock.
 		 */
@@ -57,6 +71,16 @@ class LockFacility {
 		 */
 		bool is_planet_locked( const Planet& planet ) const;
 
+		/** Lock or unlock player list.
+		 * @param do_lock true to lock, false to unlock.
+		 */
+		void lock_player_list( bool do_lock );
+
+		/** Check if player list is locked.
+		 * @return true when locked.
+		 */
+		bool is_player_list_locked() const;
+
 		/** Get number of planet locks.
 		 * @return Number of planet locks.
 		 */
@@ -82,8 +106,10 @@ class LockFacility {
 
 		PlanetLockMap m_planet_locks;
 
+		RefLock m_script_manager_lock;
 		RefLock m_account_manager_lock;
 		RefLock m_world_lock;
+		RefLock m_player_list_lock;
 
 		mutable boost::mutex m_internal_lock;
 
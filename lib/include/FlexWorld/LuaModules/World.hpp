@@ -43,6 +43,12 @@ class World {
 		 */
 		Diluculum::LuaValueList set_block( const Diluculum::LuaValueList& args );
 
+		/** Get surface height of a block column (Lua function).
+		 * @param args column_position:table(x,z) planet:string
+		 * @return height:number (Y position of topmost block + 1, 0 if column is empty)
+		 */
+		Diluculum::LuaValueList get_surface_height( const Diluculum::LuaValueList& args );
+
 		/** Create entity (Lua function).
 		 * This function has 3 signatures:
 		 * 
@@ -36,6 +36,15 @@ class WorldGate {
 		 */
 		virtual void set_block( const BlockPosition& block_position, const std::string& planet, const FlexID& cls ) = 0;
 
+		/** Get surface height of a block column.
+		 * @param x X position of column.
+		 * @param z Z position of column.
+		 * @param planet Planet ID.
+		 * @return Y position of the topmost block + 1, 0 if column is empty.
+		 * @throws std::runtime_error in case of any error.
+		 */
+		virtual uint32_t get_surface_height( uint32_t x, uint32_t z, const std::string& planet ) = 0;
+
 		/** Create entity at specific position.
 		 * @param cls_id Class ID.
 		 * @param position Block position.
@@ -11,6 +11,9 @@ namespace fw {
 namespace msg {
 
 /** Chunk network message.
+ *
+ * A message with exactly one block describes a uniform chunk, i.e. all
+ * blocks of the chunk are set to that block.
  */
 class Chunk : public Message {
 	public:
@@ -37,6 +40,7 @@ class Chunk : public Message {
 		const Planet::Vector& get_position() const;
 
 		/** Set blocks.
+		 * Uniform (and empty) chunks are stored as a single block.
 		 * @param chunk Chunk to extract blocks from.
 		 */
 		void set_blocks( const fw::Chunk& chunk );
@@ -47,6 +51,11 @@ class Chunk : public Message {
 		 */
 		fw::Chunk::Block get_block( std::size_t index ) const;
 
+		/** Check if message describes a uniform chunk.
+		 * @return true if uniform (exactly one block).
+		 */
+		bool is_uniform() const;
+
 	private:
 		typedef std::vector<fw::Chunk::Block> BlockVector;
 		typedef uint16_t NumBlocksType;
@@ -1,14 +1,31 @@
 #pragma once
 
 #include <FlexWorld/ServerProtocol.hpp>
+#include <FlexWorld/ReceiveBuffer.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/thread.hpp>
 #include <vector>
 #include <memory>
 
 namespace fw {
 
 /** The Peer class holds some basic information for server<->client connections.
+ *
+ * Outgoing messages are queued in pending buffers. Messages sent in a row are
+ * serialized into the same buffer (open_buffer), broadcast messages are
+ * queued as buffers shared with other peers. All pending buffers are written
+ * with a single gathering write. Only one write is in flight at a
+ * time, messages queued meanwhile go out with the next one.
+ *
+ * Incoming data is read directly into receive_buffer and dispatched from
+ * there.
+ *
+ * All handlers of a peer (reading, dispatching, writing) run in its strand, so
+ * they never run concurrently and keep their order, even if the IO service is
+ * run by several threads. The write queue is also filled from other threads
+ * and therefore guarded by write_mutex.
  */
 class Peer {
 	public:
@@ -27,16 +44,25 @@ class Peer {
 		Peer& operator=( const Peer& other ) = delete;
 
 		enum {
-			READ_BUFFER_SIZE = 1024
+			MIN_READ_SIZE = 4096 ///< Min. free space for reading.
 		};
 
 		typedef ServerProtocol::ConnectionID ConnectionID; ///< Connection ID.
+		typedef std::shared_ptr<const ServerProtocol::Buffer> SharedBuffer; ///< Shared, immutable buffer.
+		typedef std::vector<SharedBuffer> SharedBufferArray; ///< Array of shared buffers.
 
-		char read_buffer[READ_BUFFER_SIZE]; ///< Temporary read buffer.
-		ServerProtocol::Buffer buffer; ///< Buffer.
+		ReceiveBuffer receive_buffer; ///< Received, not yet dispatched data.
 		std::string ip; ///< IP.
 		ConnectionID id; ///< Connection ID.
 		std::unique_ptr<boost::asio::ip::tcp::socket> socket; ///< Socket.
+		std::unique_ptr<boost::asio::io_service::strand> strand; ///< Strand for all handlers of the peer.
+
+		boost::mutex write_mutex; ///< Guards pending_buffers, open_buffer and write_scheduled.
+
+		SharedBufferArray pending_buffers; ///< Buffers waiting for the next write.
+		SharedBufferArray writing_buffers; ///< Buffers of the write in flight.
+		std::shared_ptr<ServerProtocol::Buffer> open_buffer; ///< Last pending buffer, still taking messages (or nullptr).
+		bool write_scheduled; ///< true if a write is in flight or about to be started.
 };
 
 }
@@ -1,24 +1,42 @@
 #pragma once
 
 #include <FlexWorld/Chunk.hpp>
+#include <FlexWorld/ChunkAllocator.hpp>
+#include <FlexWorld/ChunkDirectory.hpp>
 #include <FlexWorld/ClassCache.hpp>
 #include <FlexWorld/Entity.hpp>
+#include <FlexWorld/Facing.hpp>
 
 #include <FWU/Cuboid.hpp>
 #include <FWU/LooseOctree.hpp>
 #include <SFML/System/Vector3.hpp>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 namespace fw {
 
+class PlanetImage;
+
 /** Planet.
  * 
  * A planet in FlexWorld is a fixed-size map. It contains chunks of block data
  * and entities.
  *
  * Block data is stored as cached class IDs to lower the memory footprint.
+ * Chunks are looked up through a ChunkDirectory in constant time. Chunks
+ * changed through the planet are remembered as dirty until a consumer (e.g.
+ * network sync or saving) drains them.
+ *
+ * A read-only PlanetImage can be attached as backing store. Its chunks are
+ * paged in on first access through the planet, also by const methods, so
+ * only visited chunks take memory. Chunks in memory shadow the image's.
+ *
+ * A heightmap holds the topmost set block of every x/z column. It's updated
+ * with every block change made through the planet, so surface heights can be
+ * queried in constant time. It's stored in tiles of one chunk column each,
+ * which are allocated with the column's first block.
  *
  * The planet also keeps track of entities and manages a loose octree to
  * provide fast searches (e.g. for collision detection). When an entity's
@@ -31,6 +49,11 @@ class Planet {
 		typedef sf::Vector3<ScalarType> Vector; ///< Vector for planet size/chunk positions.
 		typedef sf::Vector3<float> Coordinate; ///< Vector for positions in absolute planet coordinates.
 		typedef std::vector<Entity::ID> EntityIDArray; ///< Array of entity IDs.
+		typedef std::vector<Vector> ChunkPositionArray; ///< Array of chunk positions.
+		typedef sf::Vector3<uint32_t> BlockPosition; ///< Block position in absolute planet coordinates.
+		typedef util::Cuboid<uint32_t> BlockCuboid; ///< Cuboid in absolute block coordinates.
+		typedef util::Cuboid<ScalarType> ChunkCuboid; ///< Cuboid in chunk positions.
+		typedef std::vector<const Class*> ClassArray; ///< Array of classes.
 
 		/** Ctor.
 		 * @param id ID.
@@ -54,7 +77,8 @@ class Planet {
 		Planet& operator=( const Planet& other ) = delete;
 
 		/** Clear.
-		 * Removes all chunks and entities. The planet's properties are kept.
+		 * Removes all chunks and entities and detaches the image. The planet's
+		 * properties are kept.
 		 */
 		void clear();
 
@@ -73,6 +97,19 @@ class Planet {
 		 */
 		const Chunk::Vector& get_chunk_size() const;
 
+		/** Set terrain seed.
+		 * Seed of the generator that creates the planet's terrain. It's saved
+		 * with the planet, so terrain generated after loading a save matches the
+		 * saved chunks.
+		 * @param seed Seed.
+		 */
+		void set_seed( int seed );
+
+		/** Get terrain seed.
+		 * @return Seed (default: 0).
+		 */
+		int get_seed() const;
+
 		/** Transform planet coordinate into chunk and block positions.
 		 * The transformation will always succeed in terms of setting the chunk and
 		 * block position. However make sure to check for the return value to see
@@ -84,7 +121,42 @@ class Planet {
 		 */
 		bool transform( const Coordinate& coord, Vector& chunk_pos, Chunk::Vector& block_pos ) const;
 
+		/** Get cuboid of chunks around a chunk.
+		 * The cuboid reaches radius chunks into every direction. At the planet's
+		 * borders it's moved inside the planet, and it's clamped to the planet's
+		 * size on every axis.
+		 * @param chunk_pos Center chunk position (must be inside the planet).
+		 * @param radius Radius in chunks.
+		 * @return Cuboid.
+		 */
+		ChunkCuboid get_chunk_cuboid( const Vector& chunk_pos, ScalarType radius ) const;
+
+		/** Attach image.
+		 * Chunks of the image that aren't in memory yet are paged in when
+		 * they're accessed. Paged in chunks keep the image's revisions and
+		 * aren't marked dirty. A previously attached image is detached.
+		 * @param image Image (reference is stored!, must have the planet's size and chunk size).
+		 * @param classes Classes of the image's class table.
+		 */
+		void attach_image( const PlanetImage& image, const ClassArray& classes );
+
+		/** Detach image.
+		 * Chunks paged in already stay in memory.
+		 */
+		void detach_image();
+
+		/** Get attached image.
+		 * @return Image or nullptr if none is attached.
+		 */
+		const PlanetImage* get_image() const;
+
+		/** Get number of chunks paged in from the image.
+		 * @return Number of chunks.
+		 */
+		std::size_t get_num_paged_chunks() const;
+
 		/** Check if chunk exists.
+		 * Pages the chunk in if it's in the attached image.
 		 * @param position Chunk position.
 		 * @return true if it exists, false otherwise.
 		 */
@@ -97,10 +169,50 @@ class Planet {
 		void create_chunk( const Vector& position );
 
 		/** Get number of chunks currently in memory.
+		 * Chunks of the attached image only count once they're paged in.
 		 * @return Number of chunks.
 		 */
 		std::size_t get_num_chunks() const;
 
+		/** Get number of uniform chunks.
+		 * Uniform chunks (empty or filled with one class) don't allocate block
+		 * storage. This iterates all chunks.
+		 * @return Number of uniform chunks.
+		 */
+		std::size_t get_num_uniform_chunks() const;
+
+		/** Find chunk.
+		 * @param position Position (must be valid).
+		 * @return Chunk or nullptr if not existing.
+		 */
+		const Chunk* find_chunk( const Vector& position ) const;
+
+		/** Get number of dirty chunks.
+		 * Chunks become dirty when they're created or their blocks are changed
+		 * through the planet.
+		 * @return Number of dirty chunks.
+		 */
+		std::size_t get_num_dirty_chunks() const;
+
+		/** Check if a chunk is dirty.
+		 * @param position Position (must be valid).
+		 * @return true if dirty.
+		 */
+		bool is_chunk_dirty( const Vector& position ) const;
+
+		/** Drain dirty chunks.
+		 * Appends the positions of all dirty chunks in the order they became
+		 * dirty and resets their dirty state.
+		 * @param positions Array receiving the positions (not cleared!).
+		 */
+		void drain_dirty_chunks( ChunkPositionArray& positions );
+
+		/** Get chunk directory mode.
+		 * Selected at construction depending on the planet's size.
+		 * @return Mode.
+		 */
+		ChunkDirectory::Mode get_chunk_directory_mode() const;
+
 		/** Set block.
 		 * @param chunk_pos Chunk position (must be valid).
 		 * @param block_pos Block position (must be valid).
@@ -123,6 +235,101 @@ class Planet {
 		 */
 		void reset_block( const Vector& chunk_pos, const Chunk::Vector& block_pos );
 
+		/** Fill region.
+		 * Sets all blocks in the cuboid to the given class. Missing chunks are
+		 * created. Chunks completely covered by the cuboid are filled without
+		 * touching their blocks one by one.
+		 * @param cuboid Cuboid in blocks (must be inside the planet).
+		 * @param cls Class.
+		 */
+		void fill_region( const BlockCuboid& cuboid, const Class& cls );
+
+		/** Fill columns.
+		 * Sets the blocks of every x/z column of the cuboid from the cuboid's
+		 * bottom up to the column's top. Only chunks receiving blocks are
+		 * created. Chunks completely covered are filled without touching their
+		 * blocks one by one, and the class is referenced once per chunk.
+		 * @param cuboid Cuboid in blocks (must be inside the planet).
+		 * @param tops Top Y position (exclusive, clipped to the cuboid) of every column, indexed by (z - cuboid.z) * cuboid.width + (x - cuboid.x).
+		 * @param cls Class.
+		 */
+		void fill_columns( const BlockCuboid& cuboid, const std::vector<uint32_t>& tops, const Class& cls );
+
+		/** Reset region.
+		 * Unsets all blocks in the cuboid. Missing chunks are skipped.
+		 * @param cuboid Cuboid in blocks (must be inside the planet).
+		 */
+		void reset_region( const BlockCuboid& cuboid );
+
+		/** Copy region.
+		 * Copies blocks from a cuboid of a planet, unset blocks included. Source
+		 * and destination may overlap, also if source is this planet. Chunks are
+		 * only created when needed to hold set blocks. The region is buffered
+		 * temporarily, which needs 2 bytes per block.
+		 * @param source Source planet.
+		 * @param cuboid Source cuboid in blocks (must be inside source planet).
+		 * @param destination Destination position of the cuboid's origin (the whole region must fit into the planet).
+		 */
+		void copy_region( const Planet& source, const BlockCuboid& cuboid, const BlockPosition& destination );
+
+		/** Set all blocks of a chunk.
+		 * Replaces the chunk's blocks in one step, creating the chunk if it's
+		 * missing. Blocks are given as indices into a class array, so they can be
+		 * prepared without access to the planet's class cache.
+		 * @param position Chunk position (must be valid).
+		 * @param blocks Blocks ordered by z, y, x like raw chunk data, each an index into classes or Chunk::INVALID_BLOCK for unset blocks.
+		 * @param classes Classes referenced by the blocks.
+		 */
+		void set_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes );
+
+		/** Load all blocks of a chunk.
+		 * Like set_chunk_blocks(), but for chunks read from disk: the chunk gets
+		 * the given revision and isn't marked dirty.
+		 * @param position Chunk position (must be valid).
+		 * @param blocks Blocks ordered by z, y, x, each an index into classes or Chunk::INVALID_BLOCK.
+		 * @param classes Classes referenced by the blocks.
+		 * @param revision Revision of the stored chunk (must not be 0).
+		 */
+		void load_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes, Chunk::Revision revision );
+
+		/** Set revision of a chunk.
+		 * Used to restore revisions of replayed edits, doesn't change the dirty
+		 * state.
+		 * @param position Chunk position (chunk must exist).
+		 * @param revision Revision (must not be 0).
+		 */
+		void set_chunk_revision( const Vector& position, Chunk::Revision revision );
+
+		/** Get all blocks of a chunk.
+		 * Counterpart of set_chunk_blocks(): blocks are returned as indices into
+		 * classes, in order of first appearance.
+		 * @param position Chunk position (chunk must exist).
+		 * @param blocks Buffer receiving the chunk's blocks, ordered by z, y, x (Chunk::INVALID_BLOCK for unset blocks).
+		 * @param classes Array receiving the referenced classes (cleared).
+		 */
+		void get_chunk_blocks( const Vector& position, Chunk::Block* blocks, ClassArray& classes ) const;
+
+		/** Get surface height of a column.
+		 * Constant time, looked up in the planet's heightmap.
+		 * @param x X position in blocks (must be valid).
+		 * @param z Z position in blocks (must be valid).
+		 * @return Y position of the topmost set block + 1, 0 if the column has no blocks.
+		 */
+		uint16_t get_surface_height( uint32_t x, uint32_t z ) const;
+
+		/** Cast a ray and find the first set block it hits.
+		 * Blocks are traversed in ray order (3D DDA). Missing and empty chunks
+		 * are skipped in one step, uniform chunks are hit without looking at
+		 * single blocks. If the origin is inside a set block, that block is hit.
+		 * @param origin Ray origin in planet coordinates (may be outside the planet).
+		 * @param direction Ray direction (doesn't need to be normalized, must not be zero).
+		 * @param max_distance Maximum distance from the origin.
+		 * @param block_position Filled with the position of the hit block.
+		 * @param facing Filled with the face of the hit block the ray entered through.
+		 * @return true if a block was hit within max_distance.
+		 */
+		bool raycast( const Coordinate& origin, const Coordinate& direction, float max_distance, BlockPosition& block_position, Facing& facing ) const;
+
 		/** Add entity.
 		 * Only the entity's ID is stored. Undefined behaviour if ID has already
 		 * been added. Use has_entity() to check.
@@ -157,9 +364,9 @@ class Planet {
 
 		/** Get raw chunk data.
 		 * @param position Position (must be valid).
-		 * @return Raw chunk data.
+		 * @param buffer Buffer receiving the chunk's blocks (see Chunk::get_raw_data()).
 		 */
-		const Chunk::Block* get_raw_chunk_data( const Planet::Vector& position ) const;
+		void get_raw_chunk_data( const Planet::Vector& position, Chunk::Block* buffer ) const;
 
 		/** Search for entities in a cuboid.
 		 * @param cuboid Cuboid.
@@ -168,18 +375,40 @@ class Planet {
 		void search_entities( const util::FloatCuboid& cuboid, EntityIDArray& results ) const;
 
 	private:
-		typedef std::map<const Vector, Chunk*> ChunkMap;
 		typedef util::LooseOctree<Entity::ID, float> EntityOctree;
 		typedef std::map<Entity::ID, EntityOctree*> EntityNodeMap;
 
+		typedef std::vector<uint16_t> HeightVector;
+		typedef std::unordered_map<uint32_t, HeightVector> HeightTileMap;
+
+		Chunk* find_or_page_chunk( const Vector& position ) const;
+		Chunk* page_chunk( const Vector& position );
+		void page_column( ScalarType x, ScalarType z );
+		void mark_chunk_dirty( const Vector& position, Chunk& chunk );
+		Chunk& store_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes );
+		uint16_t* find_height( uint32_t x, uint32_t z );
+		uint16_t& get_height( uint32_t x, uint32_t z );
+		void raise_surface_height( uint32_t x, uint32_t z, uint32_t height );
+		uint16_t scan_surface_height( uint32_t x, uint32_t z, uint32_t end_y ) const;
+
 		Vector m_size;
 		Chunk::Vector m_chunk_size;
 		std::string m_id;
+		int m_seed;
 
-		ChunkMap m_chunks;
+		ChunkAllocator m_chunk_allocator;
+		ChunkDirectory m_chunks;
+		ChunkDirectory m_dirty_chunks;
+		HeightTileMap m_heightmap;
 		EntityIDArray m_entities;
 		ClassCache m_class_cache;
 
+		const PlanetImage* m_image;
+		ClassArray m_image_classes;
+		std::vector<bool> m_paged_columns;
+		std::vector<Chunk::Block> m_page_buffer;
+		std::size_t m_num_paged_chunks;
+
 		EntityNodeMap m_entity_nodes;
 		util::LooseOctree<Entity::ID, float> m_octree;
 };
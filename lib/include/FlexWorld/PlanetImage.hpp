@@ -0,0 +1,162 @@
+#pragma once
+
+#include <FlexWorld/FlexID.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+/** Read-only, memory-mapped planet image.
+ *
+ * An image holds a whole planet in one file that's mapped into memory
+ * instead of being read. The file starts with a header (magic "FWPI", format
+ * version, planet properties and ID), followed by an index with one entry per
+ * chunk position, ordered by z, y, x. Chunk bodies follow the index, each
+ * starting at a page boundary, and the class table comes last. All numbers
+ * are little-endian.
+ *
+ * An index entry tells if a chunk is missing, uniform or stored. Uniform
+ * chunks (empty or filled with one class) carry their block in the entry and
+ * have no body. Stored chunks have a body of raw blocks, as indices into the
+ * class table, like the records of a RegionFile but uncompressed, so that a
+ * chunk maps to its own pages.
+ *
+ * Opening validates header and index, so it takes time proportional to the
+ * index size. Chunk bodies are only touched when read. Attach an image to a
+ * planet to page its chunks in on first access (see Planet::attach_image()).
+ */
+class PlanetImage {
+	public:
+		/** Thrown when an image can't be opened or is invalid.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( ReadException );
+
+		/** Thrown when an image can't be written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( WriteException );
+
+		static const std::string FILENAME; ///< Filename of images in a planet's save directory.
+		static const std::size_t PAGE_SIZE; ///< Alignment of chunk bodies in written images.
+
+		/** Write image of a planet.
+		 * The file is written to a temporary file first and then renamed.
+		 * @param path Path.
+		 * @param planet Planet.
+		 * @return Number of written chunks.
+		 * @throws WriteException if writing fails or the class table is full.
+		 */
+		static std::size_t write( const std::string& path, const Planet& planet );
+
+		/** Ctor.
+		 */
+		PlanetImage();
+
+		/** Copy ctor.
+		 * @param other Other.
+		 */
+		PlanetImage( const PlanetImage& other ) = delete;
+
+		/** Assignment.
+		 * @param other Other.
+		 */
+		PlanetImage& operator=( const PlanetImage& other ) = delete;
+
+		/** Open and map image.
+		 * A previously opened image is closed.
+		 * @param path Path.
+		 * @throws ReadException if the file can't be mapped or is invalid.
+		 */
+		void open( const std::string& path );
+
+		/** Close image.
+		 * Planets mustn't reference the image anymore.
+		 */
+		void close();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get mapped file size.
+		 * @return Size in bytes.
+		 */
+		std::size_t get_file_size() const;
+
+		/** Get planet ID.
+		 * @return ID.
+		 */
+		const std::string& get_id() const;
+
+		/** Get planet size.
+		 * @return Size.
+		 */
+		const Planet::Vector& get_size() const;
+
+		/** Get chunk size.
+		 * @return Chunk size.
+		 */
+		const Chunk::Vector& get_chunk_size() const;
+
+		/** Get number of classes in the class table.
+		 * @return Number of classes.
+		 */
+		std::size_t get_num_classes() const;
+
+		/** Get class ID.
+		 * @param index Index (< get_num_classes()).
+		 * @return Class ID.
+		 */
+		const FlexID& get_class_id( std::size_t index ) const;
+
+		/** Get number of chunks with a body.
+		 * @return Number of chunks.
+		 */
+		std::size_t get_num_stored_chunks() const;
+
+		/** Check if a chunk exists.
+		 * Only reads the index.
+		 * @param position Chunk position (must be valid).
+		 * @return true if it exists.
+		 */
+		bool has_chunk( const Planet::Vector& position ) const;
+
+		/** Check if a chunk is uniform.
+		 * Only reads the index.
+		 * @param position Chunk position (must be valid).
+		 * @return true if the chunk exists and is uniform.
+		 */
+		bool is_chunk_uniform( const Planet::Vector& position ) const;
+
+		/** Read chunk.
+		 * The body is only read for chunks that aren't uniform. Blocks of a
+		 * damaged body that reference missing classes are read as unset.
+		 * @param position Chunk position (must be valid).
+		 * @param blocks Buffer receiving the chunk's blocks, ordered by z, y, x, each an index into the class table or Chunk::INVALID_BLOCK.
+		 * @param revision Set to the chunk's revision.
+		 * @return false if the chunk doesn't exist.
+		 */
+		bool read_chunk( const Planet::Vector& position, Chunk::Block* blocks, Chunk::Revision& revision ) const;
+
+	private:
+		const char* get_entry( const Planet::Vector& position ) const;
+
+		boost::interprocess::mapped_region m_region;
+		const char* m_data;
+		std::size_t m_file_size;
+
+		std::string m_id;
+		Planet::Vector m_size;
+		Chunk::Vector m_chunk_size;
+		std::size_t m_num_blocks;
+		std::size_t m_page_size;
+		std::size_t m_index_offset;
+		std::size_t m_num_stored_chunks;
+		std::vector<FlexID> m_class_ids;
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <FlexWorld/RegionFile.hpp>
+#include <FlexWorld/FlexID.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+/** Reader for planets saved by PlanetWriter.
+ *
+ * A saved planet is a directory with an info file (planet ID, size, chunk
+ * size, terrain seed and the class table) and region files (see
+ * RegionFile). Blocks are stored as indices into the class table, which maps
+ * them to class IDs.
+ *
+ * Chunks are read on demand: the index of a region file is read and cached
+ * the first time one of its chunks is accessed, after that only the chunk's
+ * record is read. Region files replaced after they have been indexed are
+ * picked up after calling reset().
+ */
+class PlanetReader {
+	public:
+		/** Thrown when the planet can't be read.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( ReadException );
+
+		static const std::string INFO_FILENAME; ///< Filename of the info file.
+
+		/** Check if a directory contains a saved planet.
+		 * @param directory Directory.
+		 * @return true if the info file exists.
+		 */
+		static bool is_saved_planet( const std::string& directory );
+
+		/** Ctor.
+		 * @param directory Directory of the saved planet.
+		 */
+		PlanetReader( const std::string& directory );
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Open planet.
+		 * Reads the info file. Must be called before reading chunks.
+		 * @throws ReadException if the info file is missing or invalid.
+		 */
+		void open();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get planet ID.
+		 * @return ID.
+		 */
+		const std::string& get_id() const;
+
+		/** Get planet size.
+		 * @return Size (in chunks).
+		 */
+		const Planet::Vector& get_size() const;
+
+		/** Get chunk size.
+		 * @return Chunk size (in blocks).
+		 */
+		const Chunk::Vector& get_chunk_size() const;
+
+		/** Get terrain seed.
+		 * @return Seed (0 for saves that don't store one).
+		 */
+		int get_seed() const;
+
+		/** Get number of classes in the class table.
+		 * @return Number of classes.
+		 */
+		std::size_t get_num_classes() const;
+
+		/** Get class ID of a class table entry.
+		 * @param index Index (< get_num_classes()).
+		 * @return Class ID.
+		 */
+		const FlexID& get_class_id( std::size_t index ) const;
+
+		/** Check if a chunk is stored.
+		 * @param position Chunk position (must be valid).
+		 * @return true if stored.
+		 * @throws ReadException if the region file is invalid.
+		 */
+		bool has_chunk( const Planet::Vector& position );
+
+		/** Read a chunk's blocks.
+		 * @param position Chunk position (must be valid).
+		 * @param blocks Buffer receiving the chunk's blocks as class table indices (Chunk::INVALID_BLOCK for unset blocks).
+		 * @param revision Receives the chunk's revision.
+		 * @return false if the chunk isn't stored.
+		 * @throws ReadException if the chunk can't be read.
+		 */
+		bool read_chunk( const Planet::Vector& position, Chunk::Block* blocks, Chunk::Revision& revision );
+
+		/** Load a chunk into a planet.
+		 * The chunk is created or replaced and keeps its stored revision (see
+		 * Planet::load_chunk_blocks()).
+		 * @param planet Planet (must have the saved size and chunk size).
+		 * @param position Chunk position (must be valid).
+		 * @param classes Classes for the class table, indexed like it (unused entries may be nullptr).
+		 * @return false if the chunk isn't stored.
+		 * @throws ReadException if the chunk can't be read or references a missing class.
+		 */
+		bool load_chunk( Planet& planet, const Planet::Vector& position, const Planet::ClassArray& classes );
+
+		/** Load all stored chunks into a planet.
+		 * @param planet Planet (must have the saved size and chunk size).
+		 * @param classes Classes for the class table (see load_chunk()).
+		 * @return Number of loaded chunks.
+		 * @throws ReadException if a chunk can't be read.
+		 */
+		std::size_t load_planet( Planet& planet, const Planet::ClassArray& classes );
+
+		/** Drop cached region indices.
+		 */
+		void reset();
+
+	private:
+		typedef std::vector<RegionFile::Entry> EntryArray;
+		typedef std::map<uint64_t, EntryArray> RegionMap;
+
+		const EntryArray& get_region_entries( const Planet::Vector& region_position );
+		std::ifstream& open_region( const Planet::Vector& region_position );
+
+		std::string m_directory;
+		std::string m_id;
+		Planet::Vector m_size;
+		Chunk::Vector m_chunk_size;
+		int m_seed;
+		std::vector<FlexID> m_class_ids;
+		bool m_open;
+
+		RegionMap m_regions;
+		std::ifstream m_region_stream;
+		uint64_t m_region_stream_key;
+};
+
+}
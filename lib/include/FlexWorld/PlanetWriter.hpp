@@ -0,0 +1,129 @@
+#pragma once
+
+#include <FlexWorld/RegionFile.hpp>
+#include <FlexWorld/FlexID.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+/** Writer for saving planets to region files.
+ *
+ * Written chunks are encoded immediately and kept in memory until flush(),
+ * which rewrites the info file and every region file that received chunks.
+ * Chunks of a region that weren't written are kept from the existing file,
+ * so saving only the chunks that changed is enough.
+ *
+ * Blocks are stored as indices into the planet's class table, which maps
+ * them to class IDs (see PlanetReader). The table is only ever appended to,
+ * so region files written earlier stay valid.
+ */
+class PlanetWriter {
+	public:
+		/** Thrown when the planet can't be written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( WriteException );
+
+		/** Ctor.
+		 * @param directory Directory of the saved planet.
+		 * @param planet Planet (ID, size, chunk size and seed are copied).
+		 */
+		PlanetWriter( const std::string& directory, const Planet& planet );
+
+		/** Get directory.
+		 * @return Directory.
+		 */
+		const std::string& get_directory() const;
+
+		/** Open.
+		 * Creates the directory if needed and reads the class table of an
+		 * existing save. Must be called before writing chunks.
+		 * @throws WriteException if the directory can't be created or contains an incompatible planet.
+		 */
+		void open();
+
+		/** Check if opened.
+		 * @return true if opened.
+		 */
+		bool is_open() const;
+
+		/** Get number of classes in the class table.
+		 * @return Number of classes.
+		 */
+		std::size_t get_num_classes() const;
+
+		/** Get number of chunks waiting for flush().
+		 * @return Number of chunks.
+		 */
+		std::size_t get_num_pending_chunks() const;
+
+		/** Write chunk.
+		 * @param position Chunk position (must be valid).
+		 * @param blocks Blocks ordered by z, y, x, each an index into classes or Chunk::INVALID_BLOCK (see Planet::get_chunk_blocks()).
+		 * @param classes Classes referenced by the blocks.
+		 * @param revision Revision of the chunk (must not be 0).
+		 * @throws WriteException if the class table is full.
+		 */
+		void write_chunk( const Planet::Vector& position, const Chunk::Block* blocks, const Planet::ClassArray& classes, Chunk::Revision revision );
+
+		/** Write chunk of a planet.
+		 * @param planet Planet (must have the writer's size and chunk size).
+		 * @param position Chunk position (chunk must exist).
+		 * @throws WriteException if the class table is full.
+		 */
+		void write_chunk( const Planet& planet, const Planet::Vector& position );
+
+		/** Write all chunks of a planet.
+		 * @param planet Planet (must have the writer's size and chunk size).
+		 * @return Number of written chunks.
+		 * @throws WriteException if the class table is full.
+		 */
+		std::size_t write_planet( const Planet& planet );
+
+		/** Write pending chunks to disk.
+		 * Written files are synced, so they survive a crash once flush() returns.
+		 * @throws WriteException if writing fails.
+		 */
+		void flush();
+
+	private:
+		struct PendingChunk {
+			RegionFile::Buffer record;
+			Chunk::Revision revision;
+		};
+
+		typedef std::map<std::size_t, PendingChunk> PendingChunkMap;
+
+		struct PendingRegion {
+			Planet::Vector position;
+			PendingChunkMap chunks;
+		};
+
+		typedef std::map<uint64_t, PendingRegion> PendingRegionMap;
+		typedef std::map<std::string, Chunk::Block> ClassIdIndexMap;
+
+		Chunk::Block get_class_index( const Class& cls );
+		void write_info();
+
+		std::string m_directory;
+		std::string m_id;
+		Planet::Vector m_size;
+		Chunk::Vector m_chunk_size;
+		int m_seed;
+		bool m_open;
+
+		std::vector<FlexID> m_class_ids;
+		ClassIdIndexMap m_class_id_indices;
+		bool m_info_changed;
+
+		PendingRegionMap m_pending_regions;
+		std::size_t m_num_pending_chunks;
+
+		std::vector<Chunk::Block> m_blocks;
+};
+
+}
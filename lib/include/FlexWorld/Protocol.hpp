@@ -49,6 +49,10 @@ class ProtocolImpl : public ProtocolImpl<typename MessageTypelist::Tail, Org> {
  * messages. It also defines some crucial properties of the underlying protocol
  * like message ID type and buffer type.
  *
+ * Every message is framed: a length (MessageLength, size of message ID and
+ * data) followed by the message ID and data. Incomplete messages are detected
+ * by the length without parsing anything.
+ *
  * MessageTypelist specifies the typelist that's being used for deserializing
  * and dispatching messages.
  */
@@ -58,7 +62,9 @@ class Protocol : public fw::ProtocolImpl<MessageTypelist, MessageTypelist> {
 		typedef typename std::vector<char> Buffer; ///< Buffer.
 		typedef uint8_t MessageID; ///< Message ID.
 		typedef uint16_t ConnectionID; ///< Connection ID.
+		typedef uint32_t MessageLength; ///< Message length (frame header).
 		static const MessageID INVALID_MESSAGE_ID; ///< Invalid message ID.
+		static const MessageLength MAX_MESSAGE_LENGTH; ///< Max. message length (ID and data).
 
 		/** Thrown when message is invalid (too small, missing ID and/or data).
 		 */
@@ -70,16 +76,29 @@ class Protocol : public fw::ProtocolImpl<MessageTypelist, MessageTypelist> {
 		 * @param buffer Buffer.
 		 * @param handler Handler.
 		 * @param sender Sender.
-		 * @return Processed bytes (useful for shrinking the buffer).
+		 * @return Processed bytes (useful for shrinking the buffer), 0 if message incomplete.
 		 * @throws UnknownMessageIDException when no message is registered for the given ID.
 		 * @throws BogusMessageDataException when buffer contains invalid data for the given message ID or invalid message ID.
 		 */
 		template <class Handler>
 		static std::size_t dispatch( const Buffer& buffer, Handler& handler, ConnectionID sender );
 
+		/** Dispatch message from raw data.
+		 * Same as above, but works on any contiguous data, e.g. a ReceiveBuffer.
+		 * @param data Data.
+		 * @param size Size of data.
+		 * @param handler Handler.
+		 * @param sender Sender.
+		 * @return Processed bytes, 0 if message incomplete.
+		 * @throws UnknownMessageIDException when no message is registered for the given ID.
+		 * @throws BogusMessageDataException when data contains an invalid frame, invalid data for the given message ID or invalid message ID.
+		 */
+		template <class Handler>
+		static std::size_t dispatch( const char* data, std::size_t size, Handler& handler, ConnectionID sender );
+
 		/** Serialize message.
-		 * The buffer will be appended with both the message ID and serialized
-		 * message data. Exceptions will not be catched.
+		 * The buffer will be appended with the message length, message ID and
+		 * serialized message data. Exceptions will not be catched.
 		 * @param message Message.
 		 * @param buffer Buffer.
 		 */
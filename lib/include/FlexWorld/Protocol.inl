@@ -8,6 +8,9 @@ namespace fw {
 template <class MessageTypelist>
 const typename Protocol<MessageTypelist>::MessageID Protocol<MessageTypelist>::INVALID_MESSAGE_ID = std::numeric_limits<uint8_t>::max();
 
+template <class MessageTypelist>
+const typename Protocol<MessageTypelist>::MessageLength Protocol<MessageTypelist>::MAX_MESSAGE_LENGTH = 16 * 1024 * 1024;
+
 // Impl for end of typelist dispatch.
 template <class Org>
 template <class Handler>
@@ -40,47 +43,80 @@ inline std::size_t ProtocolImpl<MessageTypelist, Org>::dispatch( MessageID id, c
 template <class MessageTypelist>
 template <class Handler>
 std::size_t Protocol<MessageTypelist>::dispatch( const Buffer& buffer, Handler& handler, ConnectionID sender ) {
-	// Peek message ID.
-	assert( buffer.size() > 0 );
+	if( buffer.empty() ) {
+		return 0;
+	}
+
+	return dispatch( &buffer[0], buffer.size(), handler, sender );
+}
 
-	// If no message ID present, cancel.
-	if( buffer.size() < sizeof( MessageID ) ) {
-		throw BogusMessageDataException( "Missing message ID." );
+template <class MessageTypelist>
+template <class Handler>
+std::size_t Protocol<MessageTypelist>::dispatch( const char* data, std::size_t size, Handler& handler, ConnectionID sender ) {
+	// Peek message length.
+	if( size < sizeof( MessageLength ) ) {
+		return 0;
 	}
 
-	// If no message data present, cancel.
-	if( buffer.size() < sizeof( MessageID ) + 1 ) {
+	MessageLength length;
+	std::memcpy( &length, data, sizeof( MessageLength ) );
+
+	// Message ID and at least one byte of data.
+	if( length < sizeof( MessageID ) + 1 ) {
 		throw BogusMessageDataException( "Missing message data." );
 	}
 
+	if( length > MAX_MESSAGE_LENGTH ) {
+		throw BogusMessageDataException( "Message too large." );
+	}
+
+	// If message incomplete, cancel.
+	if( size - sizeof( MessageLength ) < length ) {
+		return 0;
+	}
+
 	MessageID id;
-	std::memcpy( &id, &buffer[0], sizeof( MessageID ) );
+	std::memcpy( &id, data + sizeof( MessageLength ), sizeof( MessageID ) );
 
 	if( id == INVALID_MESSAGE_ID ) {
 		throw BogusMessageDataException( "Invalid message ID." );
 	}
 
-	std::size_t eaten = ProtocolImpl<MessageTypelist, MessageTypelist>::dispatch( id, &buffer.front() + 1, buffer.size() - 1, handler, sender );
-
-	// If message got parsed add size of message ID to eaten bytes count.
-	if( eaten > 0 ) {
-		eaten += sizeof( MessageID );
+	std::size_t eaten = ProtocolImpl<MessageTypelist, MessageTypelist>::dispatch(
+		id,
+		data + sizeof( MessageLength ) + sizeof( MessageID ),
+		length - sizeof( MessageID ),
+		handler,
+		sender
+	);
+
+	// The message must fill the frame exactly.
+	if( eaten != length - sizeof( MessageID ) ) {
+		throw BogusMessageDataException( "Message length mismatch." );
 	}
 
-	return eaten;
+	return sizeof( MessageLength ) + length;
 }
 
 template <class MessageTypelist>
 template <class MsgType>
 void Protocol<MessageTypelist>::serialize_message( const MsgType& message, Buffer& buffer ) {
-	// Pack ID.
+	std::size_t frame_begin = buffer.size();
+
+	// Reserve length, pack ID.
 	MessageID id = tpl::IndexOf<MsgType, MessageTypelist>::RESULT;
 
-	buffer.resize( buffer.size() + sizeof( MessageID ) );
+	buffer.resize( buffer.size() + sizeof( MessageLength ) + sizeof( MessageID ) );
 	std::memcpy( &buffer[buffer.size() - sizeof( MessageID )], reinterpret_cast<char*>( &id ), sizeof( MessageID ) );
 
 	// Serialize message.
 	message.serialize( buffer );
+
+	// Patch length.
+	assert( buffer.size() - frame_begin - sizeof( MessageLength ) <= MAX_MESSAGE_LENGTH );
+
+	MessageLength length = static_cast<MessageLength>( buffer.size() - frame_begin - sizeof( MessageLength ) );
+	std::memcpy( &buffer[frame_begin], reinterpret_cast<char*>( &length ), sizeof( MessageLength ) );
 }
 
 }
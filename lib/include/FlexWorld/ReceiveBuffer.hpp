@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace fw {
+
+/** Growable buffer for received data.
+ *
+ * Data is read directly into the free space at the end (prepare(), commit())
+ * and consumed from the front (consume()) without moving anything, so every
+ * message stays contiguous. Once everything is consumed, the buffer starts
+ * over at the front. Unconsumed data (usually the beginning of a message) is
+ * only moved to the front when the free space doesn't suffice otherwise, and
+ * the buffer only grows for messages larger than itself.
+ */
+class ReceiveBuffer {
+	public:
+		static const std::size_t DEFAULT_CAPACITY; ///< Default initial capacity.
+
+		/** Ctor.
+		 * @param capacity Initial capacity (> 0).
+		 */
+		ReceiveBuffer( std::size_t capacity = DEFAULT_CAPACITY );
+
+		/** Get capacity.
+		 * @return Capacity.
+		 */
+		std::size_t get_capacity() const;
+
+		/** Get number of unconsumed bytes.
+		 * @return Size.
+		 */
+		std::size_t get_size() const;
+
+		/** Get unconsumed data.
+		 * Only valid until the next call to prepare().
+		 * @return Data (get_size() bytes).
+		 */
+		const char* get_data() const;
+
+		/** Get free space at the end.
+		 * @return Free space.
+		 */
+		std::size_t get_free_size() const;
+
+		/** Prepare free space at the end.
+		 * Moves unconsumed data to the front or grows the buffer if needed.
+		 * @param min_free_size Minimum free space.
+		 * @return Free space to write to (get_free_size() bytes).
+		 */
+		char* prepare( std::size_t min_free_size );
+
+		/** Commit written data.
+		 * @param num_bytes Number of bytes written to the free space (<= get_free_size()).
+		 */
+		void commit( std::size_t num_bytes );
+
+		/** Consume data.
+		 * @param num_bytes Number of bytes (<= get_size()).
+		 */
+		void consume( std::size_t num_bytes );
+
+		/** Drop all data.
+		 */
+		void clear();
+
+	private:
+		std::vector<char> m_data;
+		std::size_t m_begin;
+		std::size_t m_end;
+};
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Exception.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace fw {
+
+/** Region file of a saved planet.
+ *
+ * A region groups SIZE x SIZE x SIZE chunks. The file starts with a header
+ * (magic "FWRG" and format version), followed by an index with one entry per
+ * chunk: offset and length of the chunk's record, and the chunk's revision.
+ * An offset of 0 means that the chunk isn't stored. Records follow the index.
+ *
+ * A record holds a chunk's blocks, ordered like raw chunk data, as indices
+ * into the planet's class table (see PlanetWriter). The first byte selects
+ * the encoding: a single value for uniform chunks, runs of equal values, or
+ * plain values when runs don't pay off. All numbers are little-endian.
+ *
+ * The index can be read on its own, so single chunks can be loaded without
+ * reading the whole file (see PlanetReader).
+ */
+class RegionFile {
+	public:
+		/** Thrown when reading a damaged or incompatible file.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( FormatException );
+
+		/** Thrown when a file can't be read or written.
+		 */
+		FLEX_MAKE_RUNTIME_ERROR_EXCEPTION( IOException );
+
+		typedef std::vector<char> Buffer; ///< Byte buffer.
+
+		/** Index entry.
+		 */
+		struct Entry {
+			uint32_t offset; ///< Offset of the record in the file (0 if the chunk isn't stored).
+			uint32_t length; ///< Length of the record in bytes.
+			Chunk::Revision revision; ///< Revision of the chunk.
+		};
+
+		static const Planet::ScalarType SIZE; ///< Chunks per axis.
+		static const std::size_t NUM_ENTRIES; ///< Number of index entries (chunks per region).
+		static const std::size_t HEADER_SIZE; ///< Size of header and index in bytes.
+
+		/** Get position of the region containing a chunk.
+		 * @param chunk_position Chunk position.
+		 * @return Region position.
+		 */
+		static Planet::Vector get_region_position( const Planet::Vector& chunk_position );
+
+		/** Get key of a region, e.g. for maps.
+		 * @param region_position Region position.
+		 * @return Key (unique per region position).
+		 */
+		static uint64_t get_region_key( const Planet::Vector& region_position );
+
+		/** Get index entry of a chunk in its region.
+		 * @param chunk_position Chunk position.
+		 * @return Entry index.
+		 */
+		static std::size_t get_entry_index( const Planet::Vector& chunk_position );
+
+		/** Make filename of a region.
+		 * @param region_position Region position.
+		 * @return Filename (without directory).
+		 */
+		static std::string make_filename( const Planet::Vector& region_position );
+
+		/** Read header and index.
+		 * @param in Stream positioned at the file's start.
+		 * @param entries Array receiving NUM_ENTRIES entries.
+		 * @throws FormatException if the header or index is invalid.
+		 */
+		static void read_index( std::istream& in, Entry* entries );
+
+		/** Encode chunk blocks to a record.
+		 * @param blocks Blocks (class table indices or Chunk::INVALID_BLOCK).
+		 * @param num_blocks Number of blocks (> 0).
+		 * @param record Buffer receiving the record (cleared).
+		 */
+		static void encode_chunk( const Chunk::Block* blocks, std::size_t num_blocks, Buffer& record );
+
+		/** Decode chunk blocks from a record.
+		 * @param record Record.
+		 * @param length Length of the record in bytes.
+		 * @param blocks Buffer receiving num_blocks blocks.
+		 * @param num_blocks Number of blocks.
+		 * @throws FormatException if the record is invalid.
+		 */
+		static void decode_chunk( const char* record, std::size_t length, Chunk::Block* blocks, std::size_t num_blocks );
+
+		/** Ctor.
+		 * Creates an empty region.
+		 */
+		RegionFile();
+
+		/** Load whole file.
+		 * @param path Path.
+		 * @throws IOException if the file can't be read, FormatException if it's invalid.
+		 */
+		void load( const std::string& path );
+
+		/** Save whole file.
+		 * The file is written to a temporary file first and then renamed, so
+		 * readers never see partially written files. The temporary file is
+		 * synced before and the directory after the rename, so the file is on
+		 * disk when save() returns.
+		 * @param path Path.
+		 * @throws IOException if the file can't be written.
+		 */
+		void save( const std::string& path ) const;
+
+		/** Get number of stored chunks.
+		 * @return Number of stored chunks.
+		 */
+		std::size_t get_num_chunks() const;
+
+		/** Check if a chunk is stored.
+		 * @param index Entry index (< NUM_ENTRIES).
+		 * @return true if stored.
+		 */
+		bool has_chunk( std::size_t index ) const;
+
+		/** Get record of a chunk.
+		 * @param index Entry index (< NUM_ENTRIES).
+		 * @return Record (empty if the chunk isn't stored).
+		 */
+		const Buffer& get_record( std::size_t index ) const;
+
+		/** Get revision of a chunk.
+		 * @param index Entry index (< NUM_ENTRIES).
+		 * @return Revision (0 if the chunk isn't stored).
+		 */
+		Chunk::Revision get_revision( std::size_t index ) const;
+
+		/** Set record of a chunk.
+		 * @param index Entry index (< NUM_ENTRIES).
+		 * @param record Record (see encode_chunk(), must not be empty).
+		 * @param revision Revision (must not be 0).
+		 */
+		void set_record( std::size_t index, const Buffer& record, Chunk::Revision revision );
+
+	private:
+		std::vector<Buffer> m_records;
+		std::vector<Chunk::Revision> m_revisions;
+		std::size_t m_num_chunks;
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+namespace fw {
+
+class LockFacility;
+class Planet;
+
+/** Scoped lock of an object of a lock facility.
+ *
+ * Locks on construction and unlocks on destruction, so neither an early return
+ * nor an exception can leave the object locked. unlock() releases the lock
+ * before, e.g. to keep the lock order when handing over to another lock.
+ */
+class ScopedLock {
+	public:
+		/** Lockable object.
+		 */
+		enum Object {
+			SCRIPT_MANAGER = 0, ///< Script manager.
+			ACCOUNT_MANAGER, ///< Account manager.
+			WORLD, ///< World.
+			PLANET, ///< Planet.
+			PLAYER_LIST ///< Player list.
+		};
+
+		/** Ctor.
+		 * Locks the object.
+		 * @param facility Lock facility.
+		 * @param object Object (not PLANET).
+		 */
+		ScopedLock( LockFacility& facility, Object object );
+
+		/** Ctor.
+		 * Locks the planet.
+		 * @param facility Lock facility.
+		 * @param planet Planet (lock must have been created before).
+		 */
+		ScopedLock( LockFacility& facility, const Planet& planet );
+
+		/** Dtor.
+		 * Unlocks the object if it's still locked.
+		 */
+		~ScopedLock();
+
+		/** Copy ctor.
+		 */
+		ScopedLock( const ScopedLock& other ) = delete;
+
+		/** Assignment.
+		 */
+		ScopedLock& operator=( const ScopedLock& other ) = delete;
+
+		/** Check if the object is still locked by this lock.
+		 * @return true when locked.
+		 */
+		bool is_locked() const;
+
+		/** Unlock the object before the lock goes out of scope.
+		 * Undefined behaviour if already unlocked.
+		 */
+		void unlock();
+
+	private:
+		void lock_object( bool do_lock );
+
+		LockFacility& m_facility;
+		const Planet* m_planet;
+		Object m_object;
+		bool m_locked;
+};
+
+}
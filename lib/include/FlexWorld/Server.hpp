@@ -7,6 +7,7 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
 #include <vector>
 #include <string>
 #include <memory>
@@ -16,8 +17,14 @@ namespace fw {
 
 /** Server for handling peers and traffic.
  *
- * Default IP is 0.0.0.0, port 2593 and 1 dispatch thread.
- * 
+ * Default IP is 0.0.0.0 and port 2593.
+ *
+ * The IO service may be run by several threads. All handler calls for the same
+ * connection (connect, messages, disconnect) run in the connection's strand:
+ * never concurrently and in order. Calls for different connections may run
+ * concurrently, so the handler must be thread-safe then. Messages can be sent
+ * from any thread.
+ *
  * Destructing a Server object will wait until all connections are closed. Make
  * sure to always wait for run() to return so that all connections are shutdown
  * gracefully.
@@ -25,6 +32,7 @@ namespace fw {
 class Server {
 	public:
 		typedef ServerProtocol::ConnectionID ConnectionID; ///< Connection ID.
+		typedef std::vector<ConnectionID> ConnectionIDArray; ///< Array of connection IDs.
 
 		/** Handler interface.
 		 */
@@ -105,34 +113,90 @@ class Server {
 		void stop();
 
 		/** Get IP of client.
+		 * The reference is valid until the disconnect handler of the client
+		 * returned.
 		 * @param conn_id Connection ID.
 		 * @return IP.
 		 */
 		const std::string& get_client_ip( ConnectionID conn_id ) const;
 
 		/** Disconnect client.
+		 * The connection is closed in the client's strand. The disconnect handler
+		 * is called once pending handlers finished.
 		 * @param conn_id Connection ID.
 		 */
 		void disconnect_client( ConnectionID conn_id );
 
+		/** Run function in the strand of a client.
+		 * The function will not run concurrently to the client's handlers.
+		 * @param conn_id Connection ID.
+		 * @param function Function (copied).
+		 * @return false if client isn't connected (function isn't called).
+		 */
+		template <class Function>
+		bool post( ConnectionID conn_id, Function function );
+
 		/** Send message to single client.
-		 * Exceptions by MsgType::serialize() are not catched.
+		 * The message is queued and written together with other queued
+		 * messages once the IO service runs. Exceptions by MsgType::serialize()
+		 * are not catched.
 		 * @param message Message.
 		 * @param conn_id Client connection ID (must be valid).
 		 */
 		template <class MsgType>
 		void send_message( const MsgType& message, ConnectionID conn_id );
 
+		/** Send message to all clients.
+		 * The message is serialized once, all clients share the buffer.
+		 * Exceptions by MsgType::serialize() are not catched.
+		 * @param message Message.
+		 * @return Number of recipients.
+		 */
+		template <class MsgType>
+		std::size_t broadcast( const MsgType& message );
+
+		/** Send message to several clients.
+		 * The message is serialized once, all clients share the buffer.
+		 * Exceptions by MsgType::serialize() are not catched.
+		 * @param message Message.
+		 * @param recipients Client connection IDs (must be valid and unique).
+		 * @return Number of recipients.
+		 */
+		template <class MsgType>
+		std::size_t broadcast( const MsgType& message, const ConnectionIDArray& recipients );
+
+		/** Send message to all clients matching a predicate.
+		 * The message is serialized once (and only if there's a recipient), all
+		 * clients share the buffer. Exceptions by MsgType::serialize() are not
+		 * catched.
+		 * @param message Message.
+		 * @param predicate Predicate, called with each connection ID, returns true for recipients.
+		 * @return Number of recipients.
+		 */
+		template <class MsgType, class Predicate>
+		std::size_t broadcast_if( const MsgType& message, Predicate predicate );
+
 	private:
 		typedef std::vector<std::shared_ptr<Peer> > PeerPtrVector;
 
+		std::shared_ptr<Peer> find_peer( ConnectionID conn_id ) const;
+
 		void start_accept();
 		void handle_accept( std::shared_ptr<Peer> peer, const boost::system::error_code& error );
+		void start_peer( std::shared_ptr<Peer> peer );
+		void close_peer( std::shared_ptr<Peer> peer );
 		void start_read( std::shared_ptr<Peer> peer );
 		void handle_read( std::shared_ptr<Peer> peer, const boost::system::error_code& error, std::size_t num_bytes_read );
-		void handle_write( const boost::system::error_code& error, std::shared_ptr<ServerProtocol::Buffer> buffer, ConnectionID conn_id );
+		template <class MsgType>
+		static Peer::SharedBuffer serialize_shared( const MsgType& message );
+
+		void queue_buffer( std::shared_ptr<Peer> peer, const Peer::SharedBuffer& buffer );
+		void schedule_write( std::shared_ptr<Peer> peer );
+		void start_write( std::shared_ptr<Peer> peer );
+		void handle_write( std::shared_ptr<Peer> peer, const boost::system::error_code& error );
 
 		PeerPtrVector m_peers;
+		mutable boost::mutex m_peers_mutex; // Guards m_peers, m_num_peers and m_acceptor.
 
 		std::string m_ip;
 
@@ -2,25 +2,115 @@ namespace fw {
 
 template <class MsgType>
 void Server::send_message( const MsgType& message, ConnectionID conn_id ) {
-	assert( conn_id < m_peers.size() );
-	assert( m_peers[conn_id] != nullptr );
+	std::shared_ptr<Peer> peer = find_peer( conn_id );
+	assert( peer != nullptr );
 
+	boost::lock_guard<boost::mutex> lock( peer->write_mutex );
+
+	// Append to the last pending buffer if possible.
+	if( !peer->open_buffer ) {
+		peer->open_buffer.reset( new ServerProtocol::Buffer );
+		peer->pending_buffers.push_back( peer->open_buffer );
+	}
+
+	std::size_t old_size = peer->open_buffer->size();
+
+	try {
+		ServerProtocol::serialize_message( message, *peer->open_buffer );
+	}
+	catch( ... ) {
+		// Drop the partially serialized message.
+		peer->open_buffer->resize( old_size );
+		throw;
+	}
+
+	schedule_write( peer );
+}
+
+template <class MsgType>
+std::size_t Server::broadcast( const MsgType& message ) {
+	Peer::SharedBuffer buffer;
+	std::size_t num_recipients = 0;
+
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
+	for( std::size_t conn_id = 0; conn_id < m_peers.size(); ++conn_id ) {
+		if( m_peers[conn_id] == nullptr ) {
+			continue;
+		}
+
+		if( !buffer ) {
+			buffer = serialize_shared( message );
+		}
+
+		queue_buffer( m_peers[conn_id], buffer );
+		++num_recipients;
+	}
+
+	return num_recipients;
+}
+
+template <class MsgType>
+std::size_t Server::broadcast( const MsgType& message, const ConnectionIDArray& recipients ) {
+	if( recipients.empty() ) {
+		return 0;
+	}
+
+	Peer::SharedBuffer buffer = serialize_shared( message );
+
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
+	for( std::size_t recipient_idx = 0; recipient_idx < recipients.size(); ++recipient_idx ) {
+		assert( recipients[recipient_idx] < m_peers.size() );
+		assert( m_peers[recipients[recipient_idx]] != nullptr );
+
+		queue_buffer( m_peers[recipients[recipient_idx]], buffer );
+	}
+
+	return recipients.size();
+}
+
+template <class MsgType, class Predicate>
+std::size_t Server::broadcast_if( const MsgType& message, Predicate predicate ) {
+	Peer::SharedBuffer buffer;
+	std::size_t num_recipients = 0;
+
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
+	for( std::size_t conn_id = 0; conn_id < m_peers.size(); ++conn_id ) {
+		if( m_peers[conn_id] == nullptr || !predicate( static_cast<ConnectionID>( conn_id ) ) ) {
+			continue;
+		}
+
+		if( !buffer ) {
+			buffer = serialize_shared( message );
+		}
+
+		queue_buffer( m_peers[conn_id], buffer );
+		++num_recipients;
+	}
+
+	return num_recipients;
+}
+
+template <class Function>
+bool Server::post( ConnectionID conn_id, Function function ) {
+	std::shared_ptr<Peer> peer = find_peer( conn_id );
+
+	if( peer == nullptr ) {
+		return false;
+	}
+
+	peer->strand->post( function );
+	return true;
+}
+
+template <class MsgType>
+Peer::SharedBuffer Server::serialize_shared( const MsgType& message ) {
 	std::shared_ptr<ServerProtocol::Buffer> buffer( new ServerProtocol::Buffer );
-	ServerProtocol::serialize_message( message, *buffer );
 
-	m_peers[conn_id]->socket->async_send(
-		boost::asio::buffer(
-			&buffer->front(),
-			buffer->size()
-		),
-		boost::bind(
-			&Server::handle_write,
-			this,
-			boost::asio::placeholders::error,
-			buffer,
-			conn_id
-		)
-	);
+	ServerProtocol::serialize_message( message, *buffer );
+	return buffer;
 }
 
 }
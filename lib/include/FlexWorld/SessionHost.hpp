@@ -5,25 +5,46 @@
 #include <FlexWorld/ClassLoader.hpp>
 #include <FlexWorld/GameMode.hpp>
 #include <FlexWorld/ScriptManager.hpp>
+#include <FlexWorld/GeneratorQueue.hpp>
+#include <FlexWorld/AutosaveService.hpp>
+#include <FlexWorld/InterestManager.hpp>
 #include <FlexWorld/LuaModules/ServerGate.hpp>
 #include <FlexWorld/LuaModules/WorldGate.hpp>
 
 #include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+#include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 namespace fw {
 
 class LockFacility;
 class AccountManager;
 class World;
+class PlanetImage;
+class BlockJournal;
+class EntityStore;
 
 /** SessionHost.
  *
  * Represents a gaming session and implements logics, server-side protocol handlers, scripting engine etc.
+ *
+ * Terrain of the construct planet is generated lazily in the background when
+ * chunks are requested by clients, accessed by scripts or players come near.
+ *
+ * The IO service may be run by several threads. Messages of a connection are
+ * handled in order (in the connection's strand), handlers of different
+ * connections run concurrently and synchronize through the lock facility:
+ * scripts are executed under the script manager lock, player infos and
+ * interests are written under the player list lock.
  */
 class SessionHost :
 	private Server::Handler,
+	private GeneratorQueue::Handler,
+	private AutosaveService::Handler,
 	public lua::ServerGate,
 	public lua::WorldGate
 {
@@ -99,6 +120,40 @@ class SessionHost :
 		 */
 		unsigned short get_port() const;
 
+		/** Set directory for saved planets.
+		 * Planets are loaded from there on start and saved periodically. A
+		 * planet image (see PlanetImage) found in a planet's directory is
+		 * mapped and paged in lazily, saved chunks take precedence. Block edits
+		 * are journaled (see BlockJournal) and replayed on top of the save after
+		 * a crash. An empty path (default) disables saving.
+		 * @param path Path.
+		 */
+		void set_planets_path( const std::string& path );
+
+		/** Get directory for saved planets.
+		 * @return Path.
+		 */
+		const std::string& get_planets_path() const;
+
+		/** Set directory for saved entities.
+		 * Entities are loaded from an EntityStore there on start, after the
+		 * planets. Changed entities are saved with every autosave (see
+		 * set_planets_path()) and on stop, new player entities right away. An
+		 * empty path (default) disables saving.
+		 * @param path Path.
+		 */
+		void set_entities_path( const std::string& path );
+
+		/** Get directory for saved entities.
+		 * @return Path.
+		 */
+		const std::string& get_entities_path() const;
+
+		/** Set interval between autosaves.
+		 * @param seconds Seconds (> 0).
+		 */
+		void set_autosave_interval( uint32_t seconds );
+
 		/** Start.
 		 * Make sure to add search paths and set the game mode before.
 		 * @return true on success.
@@ -169,6 +224,15 @@ class SessionHost :
 		 */
 		void set_block( const WorldGate::BlockPosition& block_position, const std::string& planet_id, const FlexID& cls_id );
 
+		/** Get surface height of a block column.
+		 * @param x X position of column.
+		 * @param z Z position of column.
+		 * @param planet_id Planet ID.
+		 * @return Y position of the topmost block + 1, 0 if column is empty.
+		 * @throws std::runtime_error in case of any error.
+		 */
+		uint32_t get_surface_height( uint32_t x, uint32_t z, const std::string& planet_id );
+
 		/** Create entity.
 		 * @param cls_id Class ID.
 		 * @param position Block position.
@@ -211,8 +275,17 @@ class SessionHost :
 		std::string get_entity_class_id( uint32_t entity_id );
 
 	private:
-		typedef std::vector<PlayerInfo> PlayerInfoVector;
+		struct PendingChunkRequest {
+			Server::ConnectionID conn_id;
+			const Planet* planet;
+			msg::RequestChunk message;
+		};
+
+		typedef std::deque<PlayerInfo> PlayerInfoVector; // Deque: references stay valid when connections are added.
 		typedef std::set<std::string> StringSet;
+		typedef std::map<std::string, PlanetImage*> PlanetImageMap;
+		typedef std::map<std::string, BlockJournal*> BlockJournalMap;
+		typedef std::vector<PendingChunkRequest> PendingChunkRequestArray;
 
 		const Class* get_or_load_class( const FlexID& id );
 
@@ -227,7 +300,23 @@ class SessionHost :
 		void handle_message( const msg::BlockAction& ba_msg, Server::ConnectionID conn_id );
 		void handle_message( const msg::Use& use_msg, Server::ConnectionID conn_id );
 
+		void handle_generated_column( const Planet& planet, Planet::ScalarType x, Planet::ScalarType z );
+		void answer_pending_chunk_requests( const Planet* planet, Planet::ScalarType x, Planet::ScalarType z );
+		void answer_chunk_request( const PendingChunkRequest& request );
+		void generate_block_column( const Planet& planet, uint32_t x, uint32_t z );
+		bool load_saved_planet( Planet& planet );
+		bool attach_planet_image( Planet& planet );
+		bool replay_block_journal( Planet& planet );
+		bool load_saved_entities();
+		void save_entities();
+		void save_entity( const Entity& entity );
+		void handle_autosave();
+		void journal_block( const Planet& planet, const WorldGate::BlockPosition& block_position, const Class* cls );
+
+		PlayerInfo& get_player_info( Server::ConnectionID conn_id );
+		Planet* get_player_planet( Server::ConnectionID conn_id );
 		void beam_player( Server::ConnectionID conn_id, const std::string& planet_id, const sf::Vector3f& position, float heading );
+		bool find_entity_chunk( const Entity& entity, const Planet*& planet, Planet::Vector& chunk_pos ) const;
 
 		GameMode m_game_mode;
 		ClassLoader m_class_loader;
@@ -235,7 +324,8 @@ class SessionHost :
 		ScriptManager* m_script_manager;
 		std::size_t m_num_loaded_scripts;
 
-		PlayerInfoVector m_player_infos;
+		PlayerInfoVector m_player_infos; // Written under the player list lock.
+		InterestManager m_interest_manager; // Guarded by the player list lock.
 
 		boost::asio::io_service& m_io_service;
 		LockFacility& m_lock_facility;
@@ -245,6 +335,19 @@ class SessionHost :
 
 		std::unique_ptr<Server> m_server;
 
+		PendingChunkRequestArray m_pending_chunk_requests;
+		boost::mutex m_pending_chunk_requests_mutex;
+		GeneratorQueue m_generator_queue;
+
+		std::string m_planets_path;
+		uint32_t m_autosave_interval;
+		std::unique_ptr<AutosaveService> m_autosave_service;
+		PlanetImageMap m_planet_images;
+		BlockJournalMap m_journals;
+
+		std::string m_entities_path;
+		std::unique_ptr<EntityStore> m_entity_store;
+
 		AuthMode m_auth_mode;
 		std::size_t m_player_limit;
 		Planet::ScalarType m_max_view_radius;
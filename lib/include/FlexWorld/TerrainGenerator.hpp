@@ -1,20 +1,32 @@
 #pragma once
 
+#include <FlexWorld/Planet.hpp>
+
 #include <FWU/Cuboid.hpp>
 #include <vector>
 #include <cstdint>
 
 namespace fw {
 
-class Planet;
 class Class;
 
 /** Terrain generator.
  *
- * Terrain generator using Perlin noise.
+ * Terrain generator using Perlin noise (see HeightmapGenerator).
  *
  * The generator fills the space up to base height with blocks completely. Set
  * base height to 0.0 to allow "holes".
+ *
+ * Layers assign classes to absolute Y ranges of the terrain. Where layers
+ * overlap, the one added last wins; blocks above base height not covered by a
+ * layer get the default class. Below base height, only blocks covered by
+ * layers are written. Layers are resolved into Y spans once per generation,
+ * so every block is written exactly once.
+ *
+ * Surface heights are sampled in jobs of one chunk column each, which can be
+ * run by multiple threads. A column's height only depends on the seed and its
+ * position, and blocks are always written in the same order afterwards, so the
+ * result is identical for any number of threads.
  */
 class TerrainGenerator {
 	public:
@@ -25,8 +37,8 @@ class TerrainGenerator {
 			 */
 			Layer();
 
-			uint32_t min_height; ///< Min height.
-			uint32_t max_height; ///< Max height.
+			uint32_t min_height; ///< Min height (inclusive).
+			uint32_t max_height; ///< Max height (exclusive).
 			const Class* cls; ///< Class.
 		};
 
@@ -46,7 +58,7 @@ class TerrainGenerator {
 		std::size_t get_num_layers() const;
 
 		/** Add layer.
-		 * @param layer Layer (is copied).
+		 * @param layer Layer (is copied, min_height < max_height, class must be set).
 		 */
 		void add_layer( const Layer& layer );
 
@@ -87,21 +99,55 @@ class TerrainGenerator {
 		 */
 		void set_maximum_height( uint32_t height );
 
+		/** Get number of threads.
+		 * @return Number of threads.
+		 */
+		std::size_t get_num_threads() const;
+
+		/** Set number of threads used for generating.
+		 * @param num_threads Number of threads (1 to generate in the calling thread only).
+		 */
+		void set_num_threads( std::size_t num_threads );
+
 		/** Generate terrain.
 		 * Previously set data on the planet is overwritten. Data is NOT cleared.
 		 * @param planet Planet to store generated terrain at.
 		 * @param cuboid Cuboid to generate (must be valid).
 		 */
-		void generate( Planet& planet, const util::Cuboid<uint32_t>& cuboid );
+		void generate( Planet& planet, const util::Cuboid<uint32_t>& cuboid ) const;
+
+		/** Generate terrain of a single chunk.
+		 * The chunk's blocks are prepared in a local buffer and handed to the
+		 * planet in one step, replacing all previous blocks of the chunk. A
+		 * missing chunk is only created if it receives blocks. Produces the same
+		 * blocks as generate() does for the chunk's space.
+		 * @param planet Planet to store generated terrain at.
+		 * @param chunk_pos Chunk position (must be valid).
+		 */
+		void generate_chunk( Planet& planet, const Planet::Vector& chunk_pos ) const;
 
 	private:
 		typedef std::vector<Layer> LayerArray;
+		typedef std::vector<uint32_t> HeightArray;
+
+		struct Span {
+			uint32_t min_y;
+			uint32_t max_y;
+			const Class* cls; // nullptr if no blocks.
+		};
+
+		typedef std::vector<Span> SpanArray;
+
+		void resolve_spans( SpanArray& spans ) const;
+
+		void sample_heights( const util::Cuboid<uint32_t>& cuboid, uint32_t job_width, uint32_t job_depth, std::size_t first_job, std::size_t job_step, HeightArray& tops ) const;
 
 		const Class* m_default_cls;
 		LayerArray m_layers;
 		int m_seed;
 		uint32_t m_base_height;
 		uint32_t m_max_height;
+		std::size_t m_num_threads;
 };
 
 bool operator==( const TerrainGenerator::Layer& first, const TerrainGenerator::Layer& second );
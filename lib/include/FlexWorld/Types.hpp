@@ -17,4 +17,6 @@ typedef sf::Vector3<ChunkSizeType> BlockVector; ///< Block position type.
 
 typedef uint32_t EntityID;
 
+static const PlanetSizeType VIEW_RADIUS = 15; ///< Number of chunks clients see around the player in every direction.
+
 }
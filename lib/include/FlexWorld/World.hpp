@@ -26,6 +26,7 @@ namespace fw {
 class World {
 	public:
 		typedef std::map<const std::string, Planet*>::const_iterator PlanetConstIterator; ///< Planet iterator (const).
+		typedef std::map<const Entity::ID, Entity*>::const_iterator EntityConstIterator; ///< Entity iterator (const), ordered by ID.
 
 		/** Ctor.
 		 */
@@ -90,6 +91,16 @@ class World {
 		 */
 		Entity& create_entity( const FlexID& class_id );
 
+		/** Create entity with a given ID.
+		 * Used to restore saved entities. Entities created afterwards get
+		 * greater IDs. Creating entities in ascending ID order takes constant
+		 * time per entity.
+		 * @param id ID (must not be used).
+		 * @param cls Class (must have been added, see find_class()).
+		 * @return Newly created entity, will be managed by world.
+		 */
+		Entity& create_entity( Entity::ID id, const Class& cls );
+
 		/** Find entity by ID.
 		 * @param id ID.
 		 * @return Entity or nullptr if not found.
@@ -121,6 +132,12 @@ class World {
 		 */
 		Planet* find_linked_planet( Entity::ID entity_id );
 
+		/** Find an entity's linked planet.
+		 * @param entity_id Entity ID (must exist).
+		 * @return Linked planet or nullptr if not linked.
+		 */
+		const Planet* find_linked_planet( Entity::ID entity_id ) const;
+
 		/** Unlink entity from planet.
 		 * Undefined behaviour if link doesn't exist or entity is in an attached
 		 * state.
@@ -162,6 +179,17 @@ class World {
 		 */
 		PlanetConstIterator planets_end() const;
 
+		/** Get iterator to entity with the lowest ID.
+		 * If there's no entity, this iterator is equal to entities_end().
+		 * @return Iterator.
+		 */
+		EntityConstIterator entities_begin() const;
+
+		/** Get iterator to field behind last entity.
+		 * @return Iterator.
+		 */
+		EntityConstIterator entities_end() const;
+
 	private:
 		typedef std::map<const std::string, Planet*> PlanetMap;
 		typedef std::map<const Entity::ID, Entity*> EntityMap;
@@ -1,21 +1,60 @@
 #include <FlexWorld/AccountManager.hpp>
 #include <FlexWorld/AccountDriver.hpp>
+#include <FlexWorld/AccountStore.hpp>
+#include <FWU/Log.hpp>
 
 #include <boost/filesystem.hpp>
 #include <fstream>
 #include <sstream>
 #include <cassert>
 
+using util::Log;
+
 namespace fw {
 
-AccountManager::AccountManager() {
+AccountManager::AccountManager() :
+	m_store( nullptr )
+{
+}
+
+void AccountManager::set_store( AccountStore* store ) {
+	assert( store == nullptr || store->is_open() );
+
+	m_accounts.clear();
+	m_store = store;
+}
+
+AccountStore* AccountManager::get_store() const {
+	return m_store;
 }
 
 const Account* AccountManager::find_account( const std::string& username ) const {
 	assert( !username.empty() && "Invalid username." );
 
 	AccountMap::const_iterator acc_iter( m_accounts.find( username ) );
-	return acc_iter == m_accounts.end() ? nullptr : &acc_iter->second;
+
+	if( acc_iter != m_accounts.end() ) {
+		return &acc_iter->second;
+	}
+
+	if( m_store == nullptr ) {
+		return nullptr;
+	}
+
+	// Load on demand.
+	Account account;
+
+	try {
+		if( !m_store->find_account( username, account ) ) {
+			return nullptr;
+		}
+	}
+	catch( const AccountStore::ReadException& e ) {
+		Log::Logger( Log::ERR ) << "Failed to load account " << username << ": " << e.what() << Log::endl;
+		return nullptr;
+	}
+
+	return &(m_accounts[username] = account);
 }
 
 void AccountManager::add_account( const Account& account ) {
@@ -24,19 +63,27 @@ void AccountManager::add_account( const Account& account ) {
 	assert( find_account( account.get_username() ) == nullptr && "Account already exists." );
 
 	m_accounts[account.get_username()] = account;
+	store_account( account );
 }
 
 std::size_t AccountManager::get_num_accounts() const {
-	return m_accounts.size();
+	return m_store == nullptr ? m_accounts.size() : m_store->get_num_accounts();
 }
 
 void AccountManager::remove_account( const std::string& username ) {
 	assert( !username.empty() );
+	assert( find_account( username ) != nullptr );
 
-	AccountMap::iterator iter( m_accounts.find( username ) );
-	assert( iter != m_accounts.end() );
+	m_accounts.erase( username );
 
-	m_accounts.erase( iter );
+	if( m_store != nullptr ) {
+		try {
+			m_store->remove_account( username );
+		}
+		catch( const AccountStore::WriteException& e ) {
+			Log::Logger( Log::ERR ) << "Failed to remove stored account " << username << ": " << e.what() << Log::endl;
+		}
+	}
 }
 
 void AccountManager::update_account( const Account& account ) {
@@ -45,11 +92,27 @@ void AccountManager::update_account( const Account& account ) {
 	assert( find_account( account.get_username() ) != nullptr );
 
 	m_accounts[account.get_username()] = account;
+	store_account( account );
+}
+
+void AccountManager::store_account( const Account& account ) {
+	if( m_store == nullptr ) {
+		return;
+	}
+
+	// The account stays usable for this session even if writing fails.
+	try {
+		m_store->put_account( account );
+	}
+	catch( const AccountStore::WriteException& e ) {
+		Log::Logger( Log::ERR ) << "Failed to store account " << account.get_username() << ": " << e.what() << Log::endl;
+	}
 }
 
 std::size_t AccountManager::load_accounts_from_directory( const std::string& path_, LoadStrategy strategy ) {
 	using namespace boost::filesystem;
 
+	assert( m_store == nullptr );
 	assert( exists( path_ ) );
 	assert( is_directory( path_ ) );
 
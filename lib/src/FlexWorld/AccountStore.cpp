@@ -0,0 +1,663 @@
+#include <FlexWorld/AccountStore.hpp>
+#include <FlexWorld/AccountDriver.hpp>
+#include <FWU/Log.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
+#include <sstream>
+#include <cstring>
+#include <cassert>
+
+using util::Log;
+
+namespace fw {
+
+static const char DATA_MAGIC[4] = { 'F', 'W', 'A', 'C' };
+static const char INDEX_MAGIC[4] = { 'F', 'W', 'A', 'I' };
+static const uint16_t VERSION = 1;
+static const std::size_t HEADER_SIZE = 8;
+static const std::size_t INDEX_HEADER_SIZE = HEADER_SIZE + 4 * 8;
+static const char PUT_RECORD = 1;
+static const char REMOVE_RECORD = 2;
+static const std::size_t RECORD_HEAD_SIZE = 5;
+static const std::size_t CRC_SIZE = 4;
+static const std::size_t SLOT_SIZE = 16;
+static const std::size_t MIN_NUM_SLOTS = 64;
+
+// Two strings with 16 bit lengths and the entity ID.
+static const std::size_t MAX_PAYLOAD_SIZE = 4 + 2 * (2 + 0xffff);
+
+// Hashes 0 and 1 mark empty and deleted slots.
+static const uint64_t EMPTY_SLOT = 0;
+static const uint64_t DELETED_SLOT = 1;
+
+const std::string AccountStore::DATA_FILENAME = "accounts.fwa";
+const std::string AccountStore::INDEX_FILENAME = "accounts.fwi";
+
+static void append_uint16( std::vector<char>& buffer, uint16_t value ) {
+	buffer.push_back( static_cast<char>( value & 0xff ) );
+	buffer.push_back( static_cast<char>( value >> 8 ) );
+}
+
+static void append_uint32( std::vector<char>& buffer, uint32_t value ) {
+	append_uint16( buffer, static_cast<uint16_t>( value & 0xffff ) );
+	append_uint16( buffer, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static void append_uint64( std::vector<char>& buffer, uint64_t value ) {
+	append_uint32( buffer, static_cast<uint32_t>( value & 0xffffffff ) );
+	append_uint32( buffer, static_cast<uint32_t>( value >> 32 ) );
+}
+
+static void append_string( std::vector<char>& buffer, const std::string& string ) {
+	assert( string.size() <= 0xffff );
+
+	append_uint16( buffer, static_cast<uint16_t>( string.size() ) );
+	buffer.insert( buffer.end(), string.begin(), string.end() );
+}
+
+static uint16_t read_uint16( const char* data ) {
+	return static_cast<uint16_t>( static_cast<uint8_t>( data[0] ) | static_cast<uint8_t>( data[1] ) << 8 );
+}
+
+static uint32_t read_uint32( const char* data ) {
+	return read_uint16( data ) | static_cast<uint32_t>( read_uint16( data + 2 ) ) << 16;
+}
+
+static uint64_t read_uint64( const char* data ) {
+	return read_uint32( data ) | static_cast<uint64_t>( read_uint32( data + 4 ) ) << 32;
+}
+
+static uint32_t calculate_crc( const char* data, std::size_t size ) {
+	boost::crc_32_type crc;
+
+	crc.process_bytes( data, size );
+	return crc.checksum();
+}
+
+static void append_header( std::vector<char>& buffer, const char* magic ) {
+	buffer.insert( buffer.end(), magic, magic + 4 );
+	append_uint16( buffer, VERSION );
+	append_uint16( buffer, 0 );
+}
+
+static bool check_header( const char* data, const char* magic ) {
+	return std::memcmp( data, magic, 4 ) == 0 && read_uint16( data + 4 ) == VERSION;
+}
+
+// FNV-1a.
+static uint64_t hash_username( const std::string& username ) {
+	uint64_t hash = 14695981039346656037ULL;
+
+	for( std::size_t char_idx = 0; char_idx < username.size(); ++char_idx ) {
+		hash ^= static_cast<uint8_t>( username[char_idx] );
+		hash *= 1099511628211ULL;
+	}
+
+	return hash > DELETED_SLOT ? hash : hash + 2;
+}
+
+static void encode_record( std::vector<char>& buffer, char type, const std::vector<char>& payload ) {
+	buffer.clear();
+	buffer.push_back( type );
+	append_uint32( buffer, static_cast<uint32_t>( payload.size() ) );
+	buffer.insert( buffer.end(), payload.begin(), payload.end() );
+	append_uint32( buffer, calculate_crc( &buffer[0], buffer.size() ) );
+}
+
+// Username of a put or remove record, which both start with it (after the
+// entity ID for puts).
+static bool parse_username( const std::vector<char>& record, std::string& username ) {
+	std::size_t offset = RECORD_HEAD_SIZE + (record[0] == PUT_RECORD ? 4 : 0);
+	std::size_t end = record.size() - CRC_SIZE;
+
+	if( offset + 2 > end ) {
+		return false;
+	}
+
+	std::size_t length = read_uint16( &record[offset] );
+
+	if( offset + 2 + length > end ) {
+		return false;
+	}
+
+	username.assign( &record[offset + 2], length );
+	return !username.empty();
+}
+
+static bool parse_account( const std::vector<char>& record, Account& account ) {
+	std::string username;
+
+	if( record[0] != PUT_RECORD || !parse_username( record, username ) ) {
+		return false;
+	}
+
+	std::size_t offset = RECORD_HEAD_SIZE + 4 + 2 + username.size();
+	std::size_t end = record.size() - CRC_SIZE;
+
+	if( offset + 2 > end ) {
+		return false;
+	}
+
+	std::size_t length = read_uint16( &record[offset] );
+
+	if( offset + 2 + length != end || length == 0 ) {
+		return false;
+	}
+
+	account.set_username( username );
+	account.set_password( std::string( &record[offset + 2], length ) );
+	account.set_entity_id( read_uint32( &record[RECORD_HEAD_SIZE] ) );
+
+	return true;
+}
+
+AccountStore::AccountStore( const std::string& directory ) :
+	m_directory( directory ),
+	m_num_accounts( 0 ),
+	m_num_used_slots( 0 ),
+	m_data_size( 0 ),
+	m_open( false ),
+	m_index_changed( false )
+{
+}
+
+AccountStore::~AccountStore() {
+	if( !m_open || !m_index_changed ) {
+		return;
+	}
+
+	try {
+		flush();
+	}
+	catch( const WriteException& e ) {
+		// The index is rebuilt from the data file with the next open.
+		Log::Logger( Log::ERR ) << "Failed to write account index: " << e.what() << Log::endl;
+	}
+}
+
+const std::string& AccountStore::get_directory() const {
+	return m_directory;
+}
+
+std::string AccountStore::make_path( const std::string& filename ) const {
+	return (boost::filesystem::path( m_directory ) / filename).string();
+}
+
+bool AccountStore::is_open() const {
+	return m_open;
+}
+
+std::size_t AccountStore::get_num_accounts() const {
+	return m_num_accounts;
+}
+
+void AccountStore::open() {
+	std::string path = make_path( DATA_FILENAME );
+	boost::system::error_code error;
+
+	m_in.close();
+	m_in.clear();
+	m_out.close();
+	m_out.clear();
+	m_slots.clear();
+	m_num_accounts = 0;
+	m_num_used_slots = 0;
+	m_data_size = 0;
+	m_open = false;
+	m_index_changed = false;
+
+	if( !boost::filesystem::exists( path ) ) {
+		boost::filesystem::create_directories( m_directory, error );
+
+		if( error ) {
+			throw ReadException( "Failed to create " + m_directory + ": " + error.message() );
+		}
+
+		Buffer header;
+		std::ofstream out( path.c_str(), std::ios::binary | std::ios::trunc );
+
+		append_header( header, DATA_MAGIC );
+		out.write( &header[0], static_cast<std::streamsize>( header.size() ) );
+		out.close();
+
+		if( !out ) {
+			throw ReadException( "Failed to create " + path + "." );
+		}
+	}
+
+	m_in.open( path.c_str(), std::ios::binary );
+
+	if( !m_in.is_open() ) {
+		throw ReadException( "Failed to open " + path + "." );
+	}
+
+	char header[HEADER_SIZE];
+
+	m_in.seekg( 0, std::ios::end );
+	std::streamoff size = m_in.tellg();
+	m_in.seekg( 0, std::ios::beg );
+
+	if( size < static_cast<std::streamoff>( HEADER_SIZE ) || !m_in.read( header, HEADER_SIZE ) || !check_header( header, DATA_MAGIC ) ) {
+		m_in.close();
+		throw ReadException( "Invalid account store " + path + "." );
+	}
+
+	uint64_t data_size = static_cast<uint64_t>( size );
+	uint64_t offset = HEADER_SIZE;
+
+	if( read_index( data_size ) ) {
+		offset = m_data_size;
+	}
+	else {
+		m_slots.assign( MIN_NUM_SLOTS, Slot() );
+		m_num_accounts = 0;
+		m_num_used_slots = 0;
+		m_index_changed = true;
+	}
+
+	// Records written after the index.
+	m_data_size = scan_records( offset, data_size );
+
+	if( offset != data_size ) {
+		m_index_changed = true;
+	}
+
+	if( m_data_size < data_size ) {
+		Log::Logger( Log::WARNING ) << "Dropping damaged tail of " << path << "." << Log::endl;
+
+		m_in.close();
+		boost::filesystem::resize_file( path, m_data_size, error );
+
+		if( error ) {
+			throw ReadException( "Failed to truncate " + path + ": " + error.message() );
+		}
+
+		m_in.clear();
+		m_in.open( path.c_str(), std::ios::binary );
+	}
+
+	m_out.open( path.c_str(), std::ios::binary | std::ios::app );
+
+	if( !m_in.is_open() || !m_out.is_open() ) {
+		m_in.close();
+		m_out.close();
+		throw ReadException( "Failed to open " + path + "." );
+	}
+
+	m_open = true;
+}
+
+bool AccountStore::read_index( uint64_t data_size ) {
+	std::string path = make_path( INDEX_FILENAME );
+	std::ifstream in( path.c_str(), std::ios::binary );
+
+	if( !in.is_open() ) {
+		return false;
+	}
+
+	char header[INDEX_HEADER_SIZE];
+
+	if( !in.read( header, INDEX_HEADER_SIZE ) || !check_header( header, INDEX_MAGIC ) ) {
+		return false;
+	}
+
+	uint64_t covered_size = read_uint64( header + HEADER_SIZE );
+	uint64_t num_accounts = read_uint64( header + HEADER_SIZE + 8 );
+	uint64_t num_used_slots = read_uint64( header + HEADER_SIZE + 16 );
+	uint64_t num_slots = read_uint64( header + HEADER_SIZE + 24 );
+
+	if(
+		covered_size < HEADER_SIZE || covered_size > data_size ||
+		num_slots < MIN_NUM_SLOTS || (num_slots & (num_slots - 1)) != 0 ||
+		num_used_slots * 2 > num_slots || num_accounts > num_used_slots
+	) {
+		return false;
+	}
+
+	Buffer data( static_cast<std::size_t>( num_slots * SLOT_SIZE + CRC_SIZE ) );
+
+	if( !in.read( &data[0], static_cast<std::streamsize>( data.size() ) ) ) {
+		return false;
+	}
+
+	boost::crc_32_type crc;
+
+	crc.process_bytes( header, INDEX_HEADER_SIZE );
+	crc.process_bytes( &data[0], data.size() - CRC_SIZE );
+
+	if( crc.checksum() != read_uint32( &data[data.size() - CRC_SIZE] ) ) {
+		return false;
+	}
+
+	m_slots.resize( static_cast<std::size_t>( num_slots ) );
+
+	for( std::size_t slot_idx = 0; slot_idx < m_slots.size(); ++slot_idx ) {
+		m_slots[slot_idx].hash = read_uint64( &data[slot_idx * SLOT_SIZE] );
+		m_slots[slot_idx].offset = read_uint64( &data[slot_idx * SLOT_SIZE + 8] );
+	}
+
+	m_num_accounts = static_cast<std::size_t>( num_accounts );
+	m_num_used_slots = static_cast<std::size_t>( num_used_slots );
+	m_data_size = covered_size;
+
+	return true;
+}
+
+uint64_t AccountStore::scan_records( uint64_t offset, uint64_t data_size ) {
+	Buffer record;
+	std::string username;
+
+	while( offset < data_size ) {
+		if( !read_record( offset, record ) || !parse_username( record, username ) ) {
+			break;
+		}
+
+		uint64_t hash = hash_username( username );
+		std::size_t slot_idx = find_slot( username, hash );
+
+		if( record[0] == PUT_RECORD ) {
+			Account account;
+
+			if( !parse_account( record, account ) ) {
+				break;
+			}
+
+			if( slot_idx < m_slots.size() ) {
+				m_slots[slot_idx].offset = offset;
+			}
+			else {
+				insert_slot( hash, offset );
+				++m_num_accounts;
+			}
+		}
+		else if( record[0] == REMOVE_RECORD ) {
+			if( slot_idx < m_slots.size() ) {
+				m_slots[slot_idx].hash = DELETED_SLOT;
+				--m_num_accounts;
+			}
+		}
+		else {
+			break;
+		}
+
+		offset += record.size();
+	}
+
+	return offset;
+}
+
+bool AccountStore::read_record( uint64_t offset, Buffer& record ) const {
+	m_in.clear();
+	m_in.seekg( static_cast<std::streamoff>( offset ), std::ios::beg );
+
+	record.resize( RECORD_HEAD_SIZE );
+
+	if( !m_in.read( &record[0], RECORD_HEAD_SIZE ) ) {
+		return false;
+	}
+
+	std::size_t length = read_uint32( &record[1] );
+
+	if( length > MAX_PAYLOAD_SIZE ) {
+		return false;
+	}
+
+	record.resize( RECORD_HEAD_SIZE + length + CRC_SIZE );
+
+	if( !m_in.read( &record[RECORD_HEAD_SIZE], static_cast<std::streamsize>( length + CRC_SIZE ) ) ) {
+		return false;
+	}
+
+	return read_uint32( &record[RECORD_HEAD_SIZE + length] ) == calculate_crc( &record[0], RECORD_HEAD_SIZE + length );
+}
+
+std::size_t AccountStore::find_slot( const std::string& username, uint64_t hash ) const {
+	std::size_t mask = m_slots.size() - 1;
+	std::size_t slot_idx = static_cast<std::size_t>( hash ) & mask;
+	Buffer record;
+	std::string stored_username;
+
+	while( m_slots[slot_idx].hash != EMPTY_SLOT ) {
+		// Hashes rarely collide, the record tells for sure.
+		if( m_slots[slot_idx].hash == hash ) {
+			if( !read_record( m_slots[slot_idx].offset, record ) || !parse_username( record, stored_username ) ) {
+				throw ReadException( "Failed to read account record from " + make_path( DATA_FILENAME ) + "." );
+			}
+
+			if( stored_username == username ) {
+				return slot_idx;
+			}
+		}
+
+		slot_idx = (slot_idx + 1) & mask;
+	}
+
+	return m_slots.size();
+}
+
+void AccountStore::insert_slot( uint64_t hash, uint64_t offset ) {
+	if( (m_num_used_slots + 1) * 2 > m_slots.size() ) {
+		grow();
+	}
+
+	std::size_t mask = m_slots.size() - 1;
+	std::size_t slot_idx = static_cast<std::size_t>( hash ) & mask;
+
+	while( m_slots[slot_idx].hash != EMPTY_SLOT && m_slots[slot_idx].hash != DELETED_SLOT ) {
+		slot_idx = (slot_idx + 1) & mask;
+	}
+
+	if( m_slots[slot_idx].hash == EMPTY_SLOT ) {
+		++m_num_used_slots;
+	}
+
+	m_slots[slot_idx].hash = hash;
+	m_slots[slot_idx].offset = offset;
+}
+
+void AccountStore::grow() {
+	SlotArray old_slots;
+	std::size_t num_slots = m_slots.size();
+
+	// Only double when deleted slots don't make up for the space.
+	if( (m_num_accounts + 1) * 4 > num_slots ) {
+		num_slots *= 2;
+	}
+
+	old_slots.swap( m_slots );
+	m_slots.assign( num_slots, Slot() );
+	m_num_used_slots = 0;
+
+	std::size_t mask = m_slots.size() - 1;
+
+	for( std::size_t old_idx = 0; old_idx < old_slots.size(); ++old_idx ) {
+		if( old_slots[old_idx].hash == EMPTY_SLOT || old_slots[old_idx].hash == DELETED_SLOT ) {
+			continue;
+		}
+
+		std::size_t slot_idx = static_cast<std::size_t>( old_slots[old_idx].hash ) & mask;
+
+		while( m_slots[slot_idx].hash != EMPTY_SLOT ) {
+			slot_idx = (slot_idx + 1) & mask;
+		}
+
+		m_slots[slot_idx] = old_slots[old_idx];
+		++m_num_used_slots;
+	}
+}
+
+bool AccountStore::find_account( const std::string& username, Account& account ) const {
+	assert( m_open );
+
+	std::size_t slot_idx = find_slot( username, hash_username( username ) );
+
+	if( slot_idx == m_slots.size() ) {
+		return false;
+	}
+
+	Buffer record;
+
+	if( !read_record( m_slots[slot_idx].offset, record ) || !parse_account( record, account ) ) {
+		throw ReadException( "Failed to read account record from " + make_path( DATA_FILENAME ) + "." );
+	}
+
+	return true;
+}
+
+void AccountStore::append( const Buffer& record ) {
+	m_out.write( &record[0], static_cast<std::streamsize>( record.size() ) );
+	m_out.flush();
+
+	if( !m_out ) {
+		m_out.clear();
+		throw WriteException( "Failed to write " + make_path( DATA_FILENAME ) + "." );
+	}
+
+	m_data_size += record.size();
+	m_index_changed = true;
+}
+
+void AccountStore::put_account( const Account& account ) {
+	assert( m_open );
+	assert( !account.get_username().empty() && account.get_username().size() <= 0xffff );
+	assert( !account.get_password().empty() && account.get_password().size() <= 0xffff );
+
+	uint64_t hash = hash_username( account.get_username() );
+	std::size_t slot_idx = find_slot( account.get_username(), hash );
+	uint64_t offset = m_data_size;
+	Buffer payload;
+	Buffer record;
+
+	append_uint32( payload, account.get_entity_id() );
+	append_string( payload, account.get_username() );
+	append_string( payload, account.get_password() );
+	encode_record( record, PUT_RECORD, payload );
+
+	append( record );
+
+	if( slot_idx < m_slots.size() ) {
+		m_slots[slot_idx].offset = offset;
+	}
+	else {
+		insert_slot( hash, offset );
+		++m_num_accounts;
+	}
+}
+
+bool AccountStore::remove_account( const std::string& username ) {
+	assert( m_open );
+
+	std::size_t slot_idx = find_slot( username, hash_username( username ) );
+
+	if( slot_idx == m_slots.size() ) {
+		return false;
+	}
+
+	Buffer payload;
+	Buffer record;
+
+	append_string( payload, username );
+	encode_record( record, REMOVE_RECORD, payload );
+
+	append( record );
+
+	m_slots[slot_idx].hash = DELETED_SLOT;
+	--m_num_accounts;
+
+	return true;
+}
+
+void AccountStore::flush() {
+	assert( m_open );
+
+	std::string path = make_path( INDEX_FILENAME );
+	std::string temp_path = path + ".tmp";
+	boost::system::error_code error;
+	Buffer buffer;
+
+	buffer.reserve( INDEX_HEADER_SIZE + m_slots.size() * SLOT_SIZE + CRC_SIZE );
+	append_header( buffer, INDEX_MAGIC );
+	append_uint64( buffer, m_data_size );
+	append_uint64( buffer, m_num_accounts );
+	append_uint64( buffer, m_num_used_slots );
+	append_uint64( buffer, m_slots.size() );
+
+	for( std::size_t slot_idx = 0; slot_idx < m_slots.size(); ++slot_idx ) {
+		append_uint64( buffer, m_slots[slot_idx].hash );
+		append_uint64( buffer, m_slots[slot_idx].offset );
+	}
+
+	append_uint32( buffer, calculate_crc( &buffer[0], buffer.size() ) );
+
+	{
+		std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+
+		if( !out.is_open() ) {
+			throw WriteException( "Failed to open " + temp_path + "." );
+		}
+
+		out.write( &buffer[0], static_cast<std::streamsize>( buffer.size() ) );
+		out.close();
+
+		if( !out ) {
+			throw WriteException( "Failed to write " + temp_path + "." );
+		}
+	}
+
+	boost::filesystem::rename( temp_path, path, error );
+
+	if( error ) {
+		throw WriteException( "Failed to replace " + path + ": " + error.message() );
+	}
+
+	m_index_changed = false;
+}
+
+std::size_t AccountStore::import_directory( const std::string& path, std::size_t& num_failed ) {
+	using namespace boost::filesystem;
+
+	assert( m_open );
+
+	boost::system::error_code error;
+	directory_iterator dir_iter( path, error );
+	directory_iterator dir_iter_end;
+	std::size_t num_imported = 0;
+
+	num_failed = 0;
+
+	if( error ) {
+		return 0;
+	}
+
+	for( ; dir_iter != dir_iter_end; ++dir_iter ) {
+		const boost::filesystem::path& file_path = dir_iter->path();
+
+		if( !is_regular_file( file_path ) || file_path.extension() != ".yml" ) {
+			continue;
+		}
+
+		std::ifstream in( file_path.string().c_str() );
+		std::stringstream sstr;
+
+		sstr << in.rdbuf();
+
+		if( !in.is_open() || !sstr ) {
+			++num_failed;
+			continue;
+		}
+
+		try {
+			put_account( AccountDriver::deserialize( sstr.str() ) );
+			++num_imported;
+		}
+		catch( const AccountDriver::DeserializeException& e ) {
+			Log::Logger( Log::WARNING ) << "Skipping account " << file_path.string() << ": " << e.what() << Log::endl;
+			++num_failed;
+		}
+	}
+
+	return num_imported;
+}
+
+}
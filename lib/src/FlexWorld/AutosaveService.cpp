@@ -0,0 +1,331 @@
+#include <FlexWorld/AutosaveService.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/BlockJournal.hpp>
+
+#include <FWU/Log.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <cassert>
+
+using util::Log;
+
+namespace fw {
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t get_elapsed_us( const Clock::time_point& start ) {
+	return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - start ).count() );
+}
+
+AutosaveService::Handler::~Handler() {
+}
+
+AutosaveService::Statistics::Statistics() :
+	num_saves( 0 ),
+	num_failed_saves( 0 ),
+	num_saved_chunks( 0 ),
+	last_num_chunks( 0 ),
+	last_save_time( 0 ),
+	last_max_lock_time( 0 ),
+	max_lock_time( 0 ),
+	total_lock_time( 0 )
+{
+}
+
+AutosaveService::PlanetEntry::PlanetEntry( Planet& planet_, BlockJournal* journal_, const std::string& directory ) :
+	planet( &planet_ ),
+	journal( journal_ ),
+	writer( directory, planet_ ),
+	keep_journal( false )
+{
+}
+
+AutosaveService::AutosaveService( LockFacility& lock_facility, const std::string& directory ) :
+	m_directory( directory ),
+	m_interval( 300 ),
+	m_handler( nullptr ),
+	m_num_pending_chunks( 0 ),
+	m_saving( false ),
+	m_lock_facility( lock_facility ),
+	m_stop( false )
+{
+}
+
+AutosaveService::~AutosaveService() {
+	if( is_running() ) {
+		stop();
+	}
+
+	PlanetEntryMap::iterator entry_iter( m_planets.begin() );
+	PlanetEntryMap::iterator entry_iter_end( m_planets.end() );
+
+	for( ; entry_iter != entry_iter_end; ++entry_iter ) {
+		delete entry_iter->second;
+	}
+}
+
+void AutosaveService::set_handler( Handler& handler ) {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	m_handler = &handler;
+}
+
+const std::string& AutosaveService::get_directory() const {
+	return m_directory;
+}
+
+std::string AutosaveService::get_planet_directory( const std::string& planet_id ) const {
+	return (boost::filesystem::path( m_directory ) / planet_id).string();
+}
+
+void AutosaveService::set_interval( uint32_t seconds ) {
+	assert( seconds > 0 );
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	m_interval = seconds;
+}
+
+uint32_t AutosaveService::get_interval() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_interval;
+}
+
+void AutosaveService::add_planet( Planet& planet, BlockJournal* journal ) {
+	PlanetEntry* entry = new PlanetEntry( planet, journal, get_planet_directory( planet.get_id() ) );
+
+	try {
+		entry->writer.open();
+	}
+	catch( const PlanetWriter::WriteException& ) {
+		delete entry;
+		throw;
+	}
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	assert( m_planets.find( &planet ) == m_planets.end() );
+	m_planets[&planet] = entry;
+}
+
+bool AutosaveService::has_planet( const Planet& planet ) const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_planets.find( &planet ) != m_planets.end();
+}
+
+void AutosaveService::remove_planet( const Planet& planet ) {
+	// Wait for a running save.
+	boost::lock_guard<boost::mutex> save_lock( m_save_lock );
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+	if( entry_iter != m_planets.end() ) {
+		delete entry_iter->second;
+		m_planets.erase( entry_iter );
+	}
+}
+
+std::size_t AutosaveService::save_planet( PlanetEntry& entry, uint64_t& max_lock_time, uint64_t& total_lock_time ) {
+	Planet& planet = *entry.planet;
+	Planet::ChunkPositionArray positions;
+	Clock::time_point lock_start = Clock::now();
+	uint32_t last_segment = 0;
+
+	// Edits journaled from now on aren't covered by this save.
+	m_lock_facility.lock_planet( planet, true );
+	planet.drain_dirty_chunks( positions );
+
+	if( entry.journal != nullptr ) {
+		last_segment = entry.journal->rotate();
+	}
+
+	m_lock_facility.lock_planet( planet, false );
+
+	uint64_t lock_time = get_elapsed_us( lock_start );
+	max_lock_time = std::max( max_lock_time, lock_time );
+	total_lock_time += lock_time;
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		m_num_pending_chunks += positions.size();
+	}
+
+	const Chunk::Vector& chunk_size = planet.get_chunk_size();
+	std::vector<Chunk::Block> blocks( static_cast<std::size_t>( chunk_size.x ) * chunk_size.y * chunk_size.z );
+	Planet::ClassArray classes;
+	std::size_t num_saved = 0;
+
+	for( std::size_t position_idx = 0; position_idx < positions.size(); ++position_idx ) {
+		const Planet::Vector& position = positions[position_idx];
+		Chunk::Revision revision = 0;
+
+		// Only copy the blocks while locked, encoding happens afterwards.
+		lock_start = Clock::now();
+		m_lock_facility.lock_planet( planet, true );
+
+		const Chunk* chunk = planet.find_chunk( position );
+
+		if( chunk != nullptr ) {
+			planet.get_chunk_blocks( position, &blocks[0], classes );
+			revision = chunk->get_revision();
+		}
+
+		m_lock_facility.lock_planet( planet, false );
+
+		lock_time = get_elapsed_us( lock_start );
+		max_lock_time = std::max( max_lock_time, lock_time );
+		total_lock_time += lock_time;
+
+		if( revision != 0 ) {
+			entry.writer.write_chunk( position, &blocks[0], classes, revision );
+			++num_saved;
+		}
+
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		--m_num_pending_chunks;
+	}
+
+	// The flushed files are synced, only then the journal may go.
+	entry.writer.flush();
+
+	if( entry.journal != nullptr && !entry.keep_journal ) {
+		try {
+			entry.journal->remove_segments( last_segment );
+		}
+		catch( const BlockJournal::IOException& e ) {
+			Log::Logger( Log::WARNING ) << "Failed to truncate journal of planet " << planet.get_id() << ": " << e.what() << Log::endl;
+		}
+	}
+
+	return num_saved;
+}
+
+std::size_t AutosaveService::save() {
+	boost::lock_guard<boost::mutex> save_lock( m_save_lock );
+
+	Clock::time_point start = Clock::now();
+	std::vector<PlanetEntry*> entries;
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		PlanetEntryMap::iterator entry_iter( m_planets.begin() );
+		PlanetEntryMap::iterator entry_iter_end( m_planets.end() );
+
+		for( ; entry_iter != entry_iter_end; ++entry_iter ) {
+			entries.push_back( entry_iter->second );
+		}
+
+		m_saving = true;
+	}
+
+	// Entries can't be removed while the save lock is held.
+	std::size_t num_saved = 0;
+	uint64_t max_lock_time = 0;
+	uint64_t total_lock_time = 0;
+	bool failed = false;
+
+	for( std::size_t entry_idx = 0; entry_idx < entries.size(); ++entry_idx ) {
+		try {
+			num_saved += save_planet( *entries[entry_idx], max_lock_time, total_lock_time );
+
+			// Chunks of a failed save were written as well, so the journal can be
+			// truncated again by the next save.
+			entries[entry_idx]->keep_journal = false;
+		}
+		catch( const PlanetWriter::WriteException& e ) {
+			// Unwritten chunks stay pending in the writer for the next save.
+			Log::Logger( Log::ERR ) << "Failed to save planet " << entries[entry_idx]->planet->get_id() << ": " << e.what() << Log::endl;
+			entries[entry_idx]->keep_journal = true;
+			failed = true;
+		}
+	}
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	if( failed ) {
+		++m_statistics.num_failed_saves;
+	}
+	else {
+		++m_statistics.num_saves;
+	}
+
+	m_statistics.num_saved_chunks += num_saved;
+	m_statistics.last_num_chunks = num_saved;
+	m_statistics.last_save_time = get_elapsed_us( start );
+	m_statistics.last_max_lock_time = max_lock_time;
+	m_statistics.max_lock_time = std::max( m_statistics.max_lock_time, max_lock_time );
+	m_statistics.total_lock_time += total_lock_time;
+
+	m_num_pending_chunks = 0;
+	m_saving = false;
+
+	return num_saved;
+}
+
+bool AutosaveService::is_saving() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_saving;
+}
+
+std::size_t AutosaveService::get_num_pending_chunks() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_num_pending_chunks;
+}
+
+AutosaveService::Statistics AutosaveService::get_statistics() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_statistics;
+}
+
+void AutosaveService::start() {
+	assert( !is_running() );
+
+	m_stop = false;
+	m_thread = boost::thread( &AutosaveService::run, this );
+}
+
+void AutosaveService::stop() {
+	assert( is_running() );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		m_stop = true;
+		m_condition.notify_one();
+	}
+
+	m_thread.join();
+}
+
+bool AutosaveService::is_running() const {
+	return m_thread.joinable();
+}
+
+void AutosaveService::run() {
+	boost::unique_lock<boost::mutex> lock( m_internal_lock );
+
+	while( !m_stop ) {
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds( m_interval );
+
+		// timed_wait() returns false on timeout.
+		while( !m_stop && m_condition.timed_wait( lock, deadline ) ) {
+		}
+
+		if( m_stop ) {
+			break;
+		}
+
+		Handler* handler = m_handler;
+
+		lock.unlock();
+		save();
+
+		if( handler != nullptr ) {
+			handler->handle_autosave();
+		}
+
+		lock.lock();
+	}
+}
+
+}
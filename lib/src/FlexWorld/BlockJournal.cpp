@@ -0,0 +1,655 @@
+#include <FlexWorld/BlockJournal.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <FWU/Log.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+
+#if defined( WINDOWS )
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+using util::Log;
+
+namespace fw {
+
+typedef std::chrono::steady_clock Clock;
+
+static const char MAGIC[4] = { 'F', 'W', 'J', 'L' };
+static const uint16_t VERSION = 1;
+static const std::size_t HEADER_SIZE = 12;
+static const char CLASS_RECORD = 1;
+static const char EDIT_RECORD = 2;
+static const std::size_t EDIT_RECORD_SIZE = 1 + 8 + 2 + 4 + 4;
+static const std::size_t WAKE_UP_SIZE = 64 * 1024;
+static const std::string FILENAME_PREFIX = "journal.";
+static const std::string FILENAME_SUFFIX = ".fwj";
+
+static void append_uint16( std::vector<char>& buffer, uint16_t value ) {
+	buffer.push_back( static_cast<char>( value & 0xff ) );
+	buffer.push_back( static_cast<char>( value >> 8 ) );
+}
+
+static void append_uint32( std::vector<char>& buffer, uint32_t value ) {
+	append_uint16( buffer, static_cast<uint16_t>( value & 0xffff ) );
+	append_uint16( buffer, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static void append_uint64( std::vector<char>& buffer, uint64_t value ) {
+	append_uint32( buffer, static_cast<uint32_t>( value & 0xffffffff ) );
+	append_uint32( buffer, static_cast<uint32_t>( value >> 32 ) );
+}
+
+static uint16_t read_uint16( const char* data ) {
+	return static_cast<uint16_t>( static_cast<uint8_t>( data[0] ) | static_cast<uint8_t>( data[1] ) << 8 );
+}
+
+static uint32_t read_uint32( const char* data ) {
+	return read_uint16( data ) | static_cast<uint32_t>( read_uint16( data + 2 ) ) << 16;
+}
+
+static uint64_t read_uint64( const char* data ) {
+	return read_uint32( data ) | static_cast<uint64_t>( read_uint32( data + 4 ) ) << 32;
+}
+
+static uint32_t calculate_crc( const char* data, std::size_t size ) {
+	boost::crc_32_type crc;
+
+	crc.process_bytes( data, size );
+	return crc.checksum();
+}
+
+// Finish a record by appending the CRC of everything from its start.
+static void append_crc( std::vector<char>& buffer, std::size_t record_start ) {
+	append_uint32( buffer, calculate_crc( &buffer[record_start], buffer.size() - record_start ) );
+}
+
+static void append_header( std::vector<char>& buffer, uint32_t segment ) {
+	buffer.insert( buffer.end(), MAGIC, MAGIC + sizeof( MAGIC ) );
+	append_uint16( buffer, VERSION );
+	append_uint16( buffer, 0 );
+	append_uint32( buffer, segment );
+}
+
+// X and Z take 24 bits, Y 16 bits (see Planet's heightmap).
+static uint64_t pack_position( const Planet::BlockPosition& position ) {
+	assert( position.x < (1u << 24) && position.y <= 0xffff && position.z < (1u << 24) );
+
+	return static_cast<uint64_t>( position.x ) | static_cast<uint64_t>( position.y ) << 24 | static_cast<uint64_t>( position.z ) << 40;
+}
+
+static Planet::BlockPosition unpack_position( uint64_t packed ) {
+	return Planet::BlockPosition(
+		static_cast<uint32_t>( packed & 0xffffff ),
+		static_cast<uint32_t>( (packed >> 24) & 0xffff ),
+		static_cast<uint32_t>( (packed >> 40) & 0xffffff )
+	);
+}
+
+static bool sync_file( std::FILE* file ) {
+	if( std::fflush( file ) != 0 ) {
+		return false;
+	}
+
+#if defined( WINDOWS )
+	return _commit( _fileno( file ) ) == 0;
+#else
+	return fsync( fileno( file ) ) == 0;
+#endif
+}
+
+static long get_file_size( std::FILE* file ) {
+	// Flushes buffered data, so the end is the file's size.
+	if( std::fseek( file, 0, SEEK_END ) != 0 ) {
+		return -1;
+	}
+
+	return std::ftell( file );
+}
+
+static void list_segments( const std::string& directory, std::vector<uint32_t>& segments ) {
+	segments.clear();
+
+	if( !boost::filesystem::is_directory( directory ) ) {
+		return;
+	}
+
+	boost::filesystem::directory_iterator dir_iter( directory );
+	boost::filesystem::directory_iterator dir_iter_end;
+
+	for( ; dir_iter != dir_iter_end; ++dir_iter ) {
+		std::string filename = dir_iter->path().filename().string();
+
+		if(
+			filename.size() <= FILENAME_PREFIX.size() + FILENAME_SUFFIX.size() ||
+			filename.compare( 0, FILENAME_PREFIX.size(), FILENAME_PREFIX ) != 0 ||
+			filename.compare( filename.size() - FILENAME_SUFFIX.size(), FILENAME_SUFFIX.size(), FILENAME_SUFFIX ) != 0
+		) {
+			continue;
+		}
+
+		std::string number = filename.substr( FILENAME_PREFIX.size(), filename.size() - FILENAME_PREFIX.size() - FILENAME_SUFFIX.size() );
+
+		if( number.find_first_not_of( "0123456789" ) != std::string::npos ) {
+			continue;
+		}
+
+		segments.push_back( static_cast<uint32_t>( std::strtoul( number.c_str(), nullptr, 10 ) ) );
+	}
+
+	std::sort( segments.begin(), segments.end() );
+}
+
+BlockJournal::Statistics::Statistics() :
+	num_edits( 0 ),
+	num_commits( 0 ),
+	num_failed_commits( 0 ),
+	num_bytes( 0 ),
+	last_commit_time( 0 ),
+	max_commit_time( 0 )
+{
+}
+
+std::size_t BlockJournal::read( const std::string& directory, std::vector<FlexID>& class_ids, EditArray& edits ) {
+	std::vector<uint32_t> segments;
+	std::map<std::string, Chunk::Block> class_id_indices;
+	std::size_t num_read = 0;
+	bool damaged = false;
+
+	class_ids.clear();
+	edits.clear();
+	list_segments( directory, segments );
+
+	for( std::size_t segment_idx = 0; segment_idx < segments.size() && !damaged; ++segment_idx ) {
+		std::string path = (boost::filesystem::path( directory ) / (FILENAME_PREFIX + std::to_string( segments[segment_idx] ) + FILENAME_SUFFIX)).string();
+		std::ifstream in( path.c_str(), std::ios::binary );
+
+		if( !in.is_open() ) {
+			throw IOException( "Failed to open " + path + "." );
+		}
+
+		std::vector<char> data( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+
+		if(
+			data.size() < HEADER_SIZE ||
+			std::memcmp( &data[0], MAGIC, sizeof( MAGIC ) ) != 0 ||
+			read_uint16( &data[4] ) != VERSION ||
+			read_uint32( &data[8] ) != segments[segment_idx]
+		) {
+			throw IOException( "Invalid journal segment " + path + "." );
+		}
+
+		// Class indices are local to segments.
+		std::vector<Chunk::Block> class_indices;
+		std::size_t offset = HEADER_SIZE;
+
+		while( offset < data.size() && !damaged ) {
+			const char* record = &data[offset];
+			std::size_t left = data.size() - offset;
+
+			if( record[0] == CLASS_RECORD && left >= 5 && left >= 5 + read_uint16( record + 3 ) + 4u ) {
+				std::size_t length = read_uint16( record + 3 );
+				std::size_t index = read_uint16( record + 1 );
+				FlexID id;
+
+				if( read_uint32( record + 5 + length ) != calculate_crc( record, 5 + length ) || !id.parse( std::string( record + 5, length ) ) ) {
+					damaged = true;
+					break;
+				}
+
+				std::map<std::string, Chunk::Block>::iterator index_iter = class_id_indices.find( id.get() );
+
+				if( index_iter == class_id_indices.end() ) {
+					index_iter = class_id_indices.insert( std::make_pair( id.get(), static_cast<Chunk::Block>( class_ids.size() ) ) ).first;
+					class_ids.push_back( id );
+				}
+
+				if( index >= class_indices.size() ) {
+					class_indices.resize( index + 1, Chunk::INVALID_BLOCK );
+				}
+
+				class_indices[index] = index_iter->second;
+				offset += 5 + length + 4;
+			}
+			else if( record[0] == EDIT_RECORD && left >= EDIT_RECORD_SIZE ) {
+				Edit edit;
+				Chunk::Block cls = read_uint16( record + 9 );
+
+				if( read_uint32( record + 15 ) != calculate_crc( record, 15 ) ) {
+					damaged = true;
+					break;
+				}
+
+				if( cls != Chunk::INVALID_BLOCK && (cls >= class_indices.size() || class_indices[cls] == Chunk::INVALID_BLOCK) ) {
+					damaged = true;
+					break;
+				}
+
+				edit.position = unpack_position( read_uint64( record + 1 ) );
+				edit.cls = cls == Chunk::INVALID_BLOCK ? Chunk::INVALID_BLOCK : class_indices[cls];
+				edit.revision = read_uint32( record + 11 );
+				edits.push_back( edit );
+
+				offset += EDIT_RECORD_SIZE;
+			}
+			else {
+				// Torn write, later records and segments can't be trusted.
+				damaged = true;
+			}
+		}
+
+		++num_read;
+	}
+
+	return num_read;
+}
+
+std::size_t BlockJournal::apply( Planet& planet, const EditArray& edits, const Planet::ClassArray& classes ) {
+	const Chunk::Vector& chunk_size = planet.get_chunk_size();
+	const Planet::Vector& size = planet.get_size();
+	std::size_t num_applied = 0;
+
+	for( std::size_t edit_idx = 0; edit_idx < edits.size(); ++edit_idx ) {
+		const Edit& edit = edits[edit_idx];
+		Planet::Vector chunk_pos(
+			static_cast<Planet::ScalarType>( edit.position.x / chunk_size.x ),
+			static_cast<Planet::ScalarType>( edit.position.y / chunk_size.y ),
+			static_cast<Planet::ScalarType>( edit.position.z / chunk_size.z )
+		);
+
+		if(
+			edit.position.x / chunk_size.x >= size.x ||
+			edit.position.y / chunk_size.y >= size.y ||
+			edit.position.z / chunk_size.z >= size.z ||
+			(edit.cls != Chunk::INVALID_BLOCK && (edit.cls >= classes.size() || classes[edit.cls] == nullptr))
+		) {
+			continue;
+		}
+
+		Chunk::Vector block_pos(
+			static_cast<Chunk::ScalarType>( edit.position.x % chunk_size.x ),
+			static_cast<Chunk::ScalarType>( edit.position.y % chunk_size.y ),
+			static_cast<Chunk::ScalarType>( edit.position.z % chunk_size.z )
+		);
+		const Chunk* chunk = planet.find_chunk( chunk_pos );
+
+		// Already contained in the planet.
+		if( chunk != nullptr && chunk->get_revision() >= edit.revision ) {
+			continue;
+		}
+
+		if( edit.cls == Chunk::INVALID_BLOCK ) {
+			if( chunk == nullptr ) {
+				continue;
+			}
+
+			planet.reset_block( chunk_pos, block_pos );
+		}
+		else {
+			if( chunk == nullptr ) {
+				planet.create_chunk( chunk_pos );
+			}
+
+			planet.set_block( chunk_pos, block_pos, *classes[edit.cls] );
+		}
+
+		planet.set_chunk_revision( chunk_pos, edit.revision );
+		++num_applied;
+	}
+
+	return num_applied;
+}
+
+BlockJournal::BlockJournal( const std::string& directory ) :
+	m_directory( directory ),
+	m_commit_interval( 10 ),
+	m_segment( 0 ),
+	m_open( false ),
+	m_stop( false ),
+	m_file( nullptr ),
+	m_file_segment( 0 )
+{
+}
+
+BlockJournal::~BlockJournal() {
+	if( is_running() ) {
+		stop();
+	}
+	else if( is_open() ) {
+		try {
+			commit();
+		}
+		catch( const IOException& e ) {
+			Log::Logger( Log::ERR ) << "Failed to commit journal: " << e.what() << Log::endl;
+		}
+	}
+
+	if( m_file != nullptr ) {
+		std::fclose( m_file );
+	}
+}
+
+const std::string& BlockJournal::get_directory() const {
+	return m_directory;
+}
+
+std::string BlockJournal::make_path( uint32_t segment ) const {
+	return (boost::filesystem::path( m_directory ) / (FILENAME_PREFIX + std::to_string( segment ) + FILENAME_SUFFIX)).string();
+}
+
+void BlockJournal::open() {
+	assert( !is_running() );
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories( m_directory, error );
+
+	if( error ) {
+		throw IOException( "Failed to create " + m_directory + ": " + error.message() );
+	}
+
+	std::vector<uint32_t> segments;
+	list_segments( m_directory, segments );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		m_segment = segments.empty() ? 1 : segments.back() + 1;
+		m_pending_segments.clear();
+		m_pending_segments.push_back( PendingSegment() );
+		m_pending_segments.back().segment = m_segment;
+		append_header( m_pending_segments.back().buffer, m_segment );
+		m_class_indices.clear();
+		m_open = true;
+	}
+
+	// Create the segment right away, so that problems show up early.
+	commit();
+}
+
+bool BlockJournal::is_open() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_open;
+}
+
+uint32_t BlockJournal::get_segment() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_segment;
+}
+
+void BlockJournal::append( const Planet::BlockPosition& position, const Class* cls, Chunk::Revision revision ) {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	assert( m_open );
+
+	if( m_pending_segments.empty() || m_pending_segments.back().segment != m_segment ) {
+		m_pending_segments.push_back( PendingSegment() );
+		m_pending_segments.back().segment = m_segment;
+	}
+
+	Buffer& buffer = m_pending_segments.back().buffer;
+	Chunk::Block cls_index = Chunk::INVALID_BLOCK;
+
+	if( cls != nullptr ) {
+		ClassIndexMap::iterator index_iter = m_class_indices.find( cls );
+
+		if( index_iter == m_class_indices.end() ) {
+			std::string id = cls->get_id().get();
+			std::size_t record_start = buffer.size();
+
+			assert( m_class_indices.size() < Chunk::INVALID_BLOCK );
+			assert( id.size() <= 0xffff );
+
+			index_iter = m_class_indices.insert( std::make_pair( cls, static_cast<Chunk::Block>( m_class_indices.size() ) ) ).first;
+
+			buffer.push_back( CLASS_RECORD );
+			append_uint16( buffer, index_iter->second );
+			append_uint16( buffer, static_cast<uint16_t>( id.size() ) );
+			buffer.insert( buffer.end(), id.begin(), id.end() );
+			append_crc( buffer, record_start );
+		}
+
+		cls_index = index_iter->second;
+	}
+
+	std::size_t record_start = buffer.size();
+
+	buffer.push_back( EDIT_RECORD );
+	append_uint64( buffer, pack_position( position ) );
+	append_uint16( buffer, cls_index );
+	append_uint32( buffer, revision );
+	append_crc( buffer, record_start );
+
+	++m_statistics.num_edits;
+
+	if( buffer.size() >= WAKE_UP_SIZE ) {
+		m_condition.notify_one();
+	}
+}
+
+std::size_t BlockJournal::get_num_buffered_bytes() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	std::size_t num_bytes = 0;
+
+	for( std::size_t pending_idx = 0; pending_idx < m_pending_segments.size(); ++pending_idx ) {
+		num_bytes += m_pending_segments[pending_idx].buffer.size();
+	}
+
+	return num_bytes;
+}
+
+void BlockJournal::commit() {
+	// Commits are serialized, everything buffered so far goes into one
+	// write and sync per segment.
+	boost::lock_guard<boost::mutex> commit_lock( m_commit_lock );
+	PendingSegmentArray pending_segments;
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		pending_segments.swap( m_pending_segments );
+	}
+
+	if( pending_segments.empty() ) {
+		return;
+	}
+
+	Clock::time_point start = Clock::now();
+	std::size_t num_bytes = 0;
+
+	// First pending segment written to the current file and the file's size
+	// before, to undo the commit's writes to it if they fail.
+	std::size_t file_first_idx = 0;
+	long file_start_size = m_file != nullptr ? get_file_size( m_file ) : 0;
+
+	try {
+		for( std::size_t pending_idx = 0; pending_idx < pending_segments.size(); ++pending_idx ) {
+			const PendingSegment& pending = pending_segments[pending_idx];
+
+			if( m_file != nullptr && m_file_segment != pending.segment ) {
+				if( !sync_file( m_file ) ) {
+					throw IOException( "Failed to sync " + make_path( m_file_segment ) + "." );
+				}
+
+				std::fclose( m_file );
+				m_file = nullptr;
+			}
+
+			if( m_file == nullptr ) {
+				std::string path = make_path( pending.segment );
+
+				file_first_idx = pending_idx;
+				m_file = std::fopen( path.c_str(), "ab" );
+
+				if( m_file == nullptr ) {
+					throw IOException( "Failed to open " + path + "." );
+				}
+
+				m_file_segment = pending.segment;
+				file_start_size = get_file_size( m_file );
+			}
+
+			if( !pending.buffer.empty() && std::fwrite( &pending.buffer[0], 1, pending.buffer.size(), m_file ) != pending.buffer.size() ) {
+				throw IOException( "Failed to write " + make_path( pending.segment ) + "." );
+			}
+
+			num_bytes += pending.buffer.size();
+		}
+
+		if( !sync_file( m_file ) ) {
+			throw IOException( "Failed to sync " + make_path( m_file_segment ) + "." );
+		}
+	}
+	catch( const IOException& ) {
+		// Cut off what was written to the failed file, so it doesn't end in a
+		// torn record, and keep its records for the next commit. Segments
+		// before were synced already.
+		if( m_file != nullptr ) {
+			std::fclose( m_file );
+			m_file = nullptr;
+
+			if( file_start_size >= 0 ) {
+				boost::system::error_code error;
+				boost::filesystem::resize_file( make_path( m_file_segment ), static_cast<uintmax_t>( file_start_size ), error );
+			}
+		}
+
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		m_pending_segments.insert( m_pending_segments.begin(), pending_segments.begin() + static_cast<std::ptrdiff_t>( file_first_idx ), pending_segments.end() );
+		++m_statistics.num_failed_commits;
+
+		throw;
+	}
+
+	uint64_t commit_time = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - start ).count() );
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	++m_statistics.num_commits;
+	m_statistics.num_bytes += num_bytes;
+	m_statistics.last_commit_time = commit_time;
+	m_statistics.max_commit_time = std::max( m_statistics.max_commit_time, commit_time );
+}
+
+void BlockJournal::sync() {
+	assert( is_open() );
+	commit();
+}
+
+uint32_t BlockJournal::rotate() {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	assert( m_open );
+
+	++m_segment;
+	m_pending_segments.push_back( PendingSegment() );
+	m_pending_segments.back().segment = m_segment;
+	append_header( m_pending_segments.back().buffer, m_segment );
+	m_class_indices.clear();
+
+	return m_segment - 1;
+}
+
+void BlockJournal::remove_segments( uint32_t last ) {
+	// Make sure the segments aren't written to anymore.
+	sync();
+
+	std::vector<uint32_t> segments;
+	list_segments( m_directory, segments );
+
+	for( std::size_t segment_idx = 0; segment_idx < segments.size() && segments[segment_idx] <= last; ++segment_idx ) {
+		boost::system::error_code error;
+		std::string path = make_path( segments[segment_idx] );
+
+		assert( segments[segment_idx] != m_file_segment );
+		boost::filesystem::remove( path, error );
+
+		if( error ) {
+			throw IOException( "Failed to remove " + path + ": " + error.message() );
+		}
+	}
+}
+
+void BlockJournal::set_commit_interval( uint32_t milliseconds ) {
+	assert( milliseconds > 0 );
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	m_commit_interval = milliseconds;
+}
+
+uint32_t BlockJournal::get_commit_interval() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_commit_interval;
+}
+
+BlockJournal::Statistics BlockJournal::get_statistics() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_statistics;
+}
+
+void BlockJournal::start() {
+	assert( is_open() );
+	assert( !is_running() );
+
+	m_stop = false;
+	m_thread = boost::thread( &BlockJournal::run, this );
+}
+
+void BlockJournal::stop() {
+	assert( is_running() );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		m_stop = true;
+		m_condition.notify_one();
+	}
+
+	m_thread.join();
+
+	try {
+		commit();
+	}
+	catch( const IOException& e ) {
+		Log::Logger( Log::ERR ) << "Failed to commit journal: " << e.what() << Log::endl;
+	}
+}
+
+bool BlockJournal::is_running() const {
+	return m_thread.joinable();
+}
+
+void BlockJournal::run() {
+	boost::unique_lock<boost::mutex> lock( m_internal_lock );
+
+	while( !m_stop ) {
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds( m_commit_interval );
+
+		// Woken up early when the buffer grows large.
+		m_condition.timed_wait( lock, deadline );
+
+		if( m_pending_segments.empty() ) {
+			continue;
+		}
+
+		lock.unlock();
+
+		try {
+			commit();
+		}
+		catch( const IOException& e ) {
+			Log::Logger( Log::ERR ) << "Failed to commit journal: " << e.what() << Log::endl;
+		}
+
+		lock.lock();
+	}
+}
+
+}
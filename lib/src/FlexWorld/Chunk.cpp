@@ -1,6 +1,7 @@
 #include <FlexWorld/Chunk.hpp>
+#include <FlexWorld/ChunkAllocator.hpp>
 
-#include <cstring>
+#include <algorithm>
 #include <limits>
 #include <cassert>
 
@@ -9,55 +10,473 @@ namespace fw {
 const Chunk::Block Chunk::MAX_BLOCK_ID = static_cast<Block>( std::numeric_limits<Block>::max() - 1 );
 const Chunk::Block Chunk::INVALID_BLOCK = std::numeric_limits<Block>::max();
 
+static const uint8_t WORD_BITS_SHIFT = 5; // log2 of bits per word.
+static const uint8_t DIRECT_BITS_SHIFT = 4; // 16 bits per block, values stored directly.
+
+static std::size_t calc_num_words( std::size_t num_blocks, uint8_t bits_shift ) {
+	std::size_t values_per_word = std::size_t( 1 ) << (WORD_BITS_SHIFT - bits_shift);
+	return (num_blocks + values_per_word - 1) / values_per_word;
+}
+
+static std::size_t calc_num_palette_entries( uint8_t bits_shift ) {
+	return std::size_t( 1 ) << (1 << bits_shift);
+}
+
+// Buffer layout: reference counts (1 word per entry), palette (2 entries per
+// word), packed indices. Direct storage only has the values.
+static std::size_t calc_num_buffer_words( std::size_t num_blocks, uint8_t bits_shift ) {
+	if( bits_shift == DIRECT_BITS_SHIFT ) {
+		return calc_num_words( num_blocks, bits_shift );
+	}
+
+	std::size_t num_entries = calc_num_palette_entries( bits_shift );
+	return num_entries + num_entries / 2 + calc_num_words( num_blocks, bits_shift );
+}
+
+static inline uint32_t read_packed( const uint32_t* data, uint8_t bits_shift, std::size_t index ) {
+	uint8_t index_shift = static_cast<uint8_t>( WORD_BITS_SHIFT - bits_shift );
+	uint32_t bit = static_cast<uint32_t>( (index & ((std::size_t( 1 ) << index_shift) - 1)) << bits_shift );
+	uint32_t mask = (uint32_t( 1 ) << (1 << bits_shift)) - 1;
+
+	return (data[index >> index_shift] >> bit) & mask;
+}
+
+static inline void write_packed( uint32_t* data, uint8_t bits_shift, std::size_t index, uint32_t value ) {
+	uint8_t index_shift = static_cast<uint8_t>( WORD_BITS_SHIFT - bits_shift );
+	uint32_t bit = static_cast<uint32_t>( (index & ((std::size_t( 1 ) << index_shift) - 1)) << bits_shift );
+	uint32_t mask = (uint32_t( 1 ) << (1 << bits_shift)) - 1;
+	uint32_t& word = data[index >> index_shift];
+
+	word = (word & ~(mask << bit)) | (value << bit);
+}
+
 Chunk::Chunk( const Vector& size ) :
 	m_size( size ),
-	m_blocks( new Block[size.x * size.y * size.z] )
+	m_num_blocks( static_cast<std::size_t>( size.x ) * size.y * size.z ),
+	m_allocator( nullptr ),
+	m_buffer( nullptr ),
+	m_data( nullptr ),
+	m_palette_counts( nullptr ),
+	m_palette( nullptr ),
+	m_palette_size( 0 ),
+	m_uniform_block( INVALID_BLOCK ),
+	m_bits_shift( 0 ),
+	m_revision( 1 )
 {
 	assert( size.x > 0 && size.y > 0 && size.z > 0 );
-	clear();
+	collapse( INVALID_BLOCK );
+}
+
+Chunk::Chunk( const Vector& size, ChunkAllocator& allocator ) :
+	m_size( size ),
+	m_num_blocks( static_cast<std::size_t>( size.x ) * size.y * size.z ),
+	m_allocator( &allocator ),
+	m_buffer( nullptr ),
+	m_data( nullptr ),
+	m_palette_counts( nullptr ),
+	m_palette( nullptr ),
+	m_palette_size( 0 ),
+	m_uniform_block( INVALID_BLOCK ),
+	m_bits_shift( 0 ),
+	m_revision( 1 )
+{
+	assert( size.x > 0 && size.y > 0 && size.z > 0 );
+	collapse( INVALID_BLOCK );
 }
 
 Chunk::~Chunk() {
-	delete[] m_blocks;
+	if( m_buffer != nullptr ) {
+		release_buffer( m_buffer, m_bits_shift );
+	}
+}
+
+Chunk::Word* Chunk::allocate_buffer( uint8_t bits_shift ) {
+	std::size_t num_words = calc_num_buffer_words( m_num_blocks, bits_shift );
+	Word* buffer = nullptr;
+
+	if( m_allocator != nullptr ) {
+		buffer = static_cast<Word*>( m_allocator->allocate( sizeof( Word ) * num_words ) );
+	}
+	else {
+		buffer = new Word[num_words];
+	}
+
+	std::fill( buffer, buffer + num_words, 0 );
+	return buffer;
+}
+
+void Chunk::release_buffer( Word* buffer, uint8_t bits_shift ) {
+	if( m_allocator != nullptr ) {
+		m_allocator->release( buffer, sizeof( Word ) * calc_num_buffer_words( m_num_blocks, bits_shift ) );
+	}
+	else {
+		delete[] buffer;
+	}
+}
+
+void Chunk::attach_buffer( Word* buffer, uint8_t bits_shift ) {
+	m_buffer = buffer;
+	m_bits_shift = bits_shift;
+
+	if( bits_shift == DIRECT_BITS_SHIFT ) {
+		m_palette_counts = nullptr;
+		m_palette = nullptr;
+		m_data = buffer;
+	}
+	else {
+		std::size_t num_entries = calc_num_palette_entries( bits_shift );
+
+		m_palette_counts = buffer;
+		m_palette = reinterpret_cast<Block*>( buffer + num_entries );
+		m_data = buffer + num_entries + num_entries / 2;
+	}
 }
 
 void Chunk::clear() {
-	memset( m_blocks, INVALID_BLOCK, sizeof( Block ) * m_size.x * m_size.y * m_size.z );
+	if( !is_empty() ) {
+		bump_revision();
+	}
+
+	collapse( INVALID_BLOCK );
+}
+
+void Chunk::fill( Block id ) {
+	assert( id != INVALID_BLOCK );
+	assert( id <= MAX_BLOCK_ID );
+
+	if( m_buffer != nullptr || m_uniform_block != id ) {
+		bump_revision();
+	}
+
+	collapse( id );
+}
+
+void Chunk::collapse( Block id ) {
+	if( m_buffer != nullptr ) {
+		release_buffer( m_buffer, m_bits_shift );
+	}
+
+	// Single palette entry referenced by all blocks, no storage.
+	m_buffer = nullptr;
+	m_data = nullptr;
+	m_palette_counts = nullptr;
+	m_bits_shift = 0;
+	m_uniform_block = id;
+	m_palette = &m_uniform_block;
+	m_palette_size = 1;
+}
+
+void Chunk::expand() {
+	assert( m_buffer == nullptr );
+
+	// All blocks reference the uniform block's palette entry 0.
+	attach_buffer( allocate_buffer( 0 ), 0 );
+
+	m_palette[0] = m_uniform_block;
+	m_palette_counts[0] = static_cast<uint32_t>( m_num_blocks );
+	m_palette_size = 1;
+}
+
+bool Chunk::is_uniform() const {
+	return m_buffer == nullptr;
+}
+
+bool Chunk::is_empty() const {
+	return m_buffer == nullptr && m_uniform_block == INVALID_BLOCK;
+}
+
+Chunk::Block Chunk::get_uniform_block() const {
+	assert( is_uniform() && !is_empty() );
+	return m_uniform_block;
 }
 
 const Chunk::Vector& Chunk::get_size() const {
 	return m_size;
 }
 
+std::size_t Chunk::get_num_blocks() const {
+	return m_num_blocks;
+}
+
+uint8_t Chunk::get_bits_per_block() const {
+	if( m_buffer == nullptr ) {
+		return 0;
+	}
+
+	return static_cast<uint8_t>( 1 << m_bits_shift );
+}
+
+Chunk::Revision Chunk::get_revision() const {
+	return m_revision;
+}
+
+void Chunk::set_revision( Revision revision ) {
+	assert( revision != 0 );
+	m_revision = revision;
+}
+
+void Chunk::bump_revision() {
+	// 0 is never used, it means "no data".
+	if( ++m_revision == 0 ) {
+		m_revision = 1;
+	}
+}
+
+std::size_t Chunk::get_index( const Vector& pos ) const {
+	assert( pos.x < m_size.x && pos.y < m_size.y && pos.z < m_size.z );
+	return (static_cast<std::size_t>( pos.z ) * m_size.y + pos.y) * m_size.x + pos.x;
+}
+
+Chunk::Word Chunk::get_value( std::size_t index ) const {
+	if( m_data == nullptr ) {
+		return 0;
+	}
+
+	return read_packed( m_data, m_bits_shift, index );
+}
+
+void Chunk::set_value( std::size_t index, Word value ) {
+	write_packed( m_data, m_bits_shift, index, value );
+}
+
 Chunk::Block Chunk::get_block( const Vector& pos ) const {
-	assert( pos.x < m_size.x || pos.y < m_size.y || pos.z < m_size.z );
-	assert( m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x] != INVALID_BLOCK );
+	assert( is_block_set( pos ) );
+
+	Word value = get_value( get_index( pos ) );
+
+	if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+		return static_cast<Block>( value );
+	}
+
+	return m_palette[value];
+}
+
+bool Chunk::is_block_set( const Vector& pos ) const {
+	Word value = get_value( get_index( pos ) );
+
+	if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+		return value != INVALID_BLOCK;
+	}
 
-	return m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x];
+	return m_palette[value] != INVALID_BLOCK;
 }
 
 void Chunk::set_block( const Vector& pos, Block id ) {
-	assert( pos.x < m_size.x || pos.y < m_size.y || pos.z < m_size.z );
 	assert( id != INVALID_BLOCK );
 	assert( id <= MAX_BLOCK_ID );
 
-	m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x] = id;
+	store( get_index( pos ), id );
 }
 
-bool Chunk::is_block_set( const Vector& pos ) const {
-	assert( pos.x < m_size.x && pos.y < m_size.y && pos.z < m_size.z );
-	return m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x] != INVALID_BLOCK;
+void Chunk::reset_block( const Vector& pos ) {
+	assert( is_block_set( pos ) );
+
+	store( get_index( pos ), INVALID_BLOCK );
 }
 
-void Chunk::reset_block( const Vector& pos ) {
-	assert( pos.x < m_size.x || pos.y < m_size.y || pos.z < m_size.z );
-	assert( m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x] != INVALID_BLOCK );
+void Chunk::store( std::size_t index, Block id ) {
+	if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+		if( get_value( index ) != id ) {
+			set_value( index, id );
+			bump_revision();
+		}
+
+		return;
+	}
+
+	if( m_buffer == nullptr ) {
+		if( m_uniform_block == id ) {
+			return;
+		}
+
+		expand();
+	}
+
+	Word old_entry = get_value( index );
+
+	if( m_palette[old_entry] == id ) {
+		return;
+	}
+
+	Word entry = find_or_add_palette_entry( id );
+	bump_revision();
+
+	// Adding the entry may have switched to direct storage.
+	if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+		set_value( index, id );
+		return;
+	}
+
+	--m_palette_counts[old_entry];
+	++m_palette_counts[entry];
+	set_value( index, entry );
+
+	// Release storage if the chunk became uniform.
+	if( m_palette_counts[entry] == m_num_blocks ) {
+		collapse( id );
+	}
+}
+
+Chunk::Word Chunk::find_or_add_palette_entry( Block id ) {
+	std::size_t free_entry = m_palette_size;
+
+	for( std::size_t entry = 0; entry < m_palette_size; ++entry ) {
+		if( m_palette[entry] == id ) {
+			return static_cast<Word>( entry );
+		}
+
+		if( m_palette_counts[entry] == 0 && free_entry == m_palette_size ) {
+			free_entry = entry;
+		}
+	}
+
+	// Reuse entries that aren't referenced anymore.
+	if( free_entry < m_palette_size ) {
+		m_palette[free_entry] = id;
+		return static_cast<Word>( free_entry );
+	}
+
+	if( m_palette_size >= calc_num_palette_entries( m_bits_shift ) ) {
+		grow();
+
+		if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+			return id;
+		}
+	}
+
+	m_palette[m_palette_size] = id;
+	m_palette_counts[m_palette_size] = 0;
 
-	m_blocks[pos.z * (m_size.y * m_size.x) + pos.y * m_size.x + pos.x] = INVALID_BLOCK;
+	return static_cast<Word>( m_palette_size++ );
 }
 
-const Chunk::Block* Chunk::get_raw_data() const {
-	return m_blocks;
+void Chunk::grow() {
+	assert( m_buffer != nullptr );
+	assert( m_bits_shift < DIRECT_BITS_SHIFT );
+
+	uint8_t new_bits_shift = static_cast<uint8_t>( m_bits_shift + 1 );
+	Word* new_buffer = allocate_buffer( new_bits_shift );
+
+	if( new_bits_shift == DIRECT_BITS_SHIFT ) {
+		for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+			write_packed( new_buffer, new_bits_shift, index, m_palette[get_value( index )] );
+		}
+
+		m_palette_size = 0;
+	}
+	else {
+		std::size_t num_entries = calc_num_palette_entries( new_bits_shift );
+		Block* new_palette = reinterpret_cast<Block*>( new_buffer + num_entries );
+		Word* new_data = new_buffer + num_entries + num_entries / 2;
+
+		std::copy( m_palette_counts, m_palette_counts + m_palette_size, new_buffer );
+		std::copy( m_palette, m_palette + m_palette_size, new_palette );
+
+		for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+			write_packed( new_data, new_bits_shift, index, get_value( index ) );
+		}
+	}
+
+	release_buffer( m_buffer, m_bits_shift );
+	attach_buffer( new_buffer, new_bits_shift );
+}
+
+void Chunk::set_raw_data( const Block* buffer ) {
+	// Collect distinct values, giving up when they don't fit into a palette.
+	static const std::size_t MAX_PALETTE_SIZE = std::size_t( 1 ) << (1 << (DIRECT_BITS_SHIFT - 1));
+	Block palette[MAX_PALETTE_SIZE];
+	std::size_t palette_size = 0;
+
+	for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+		if( index > 0 && buffer[index] == buffer[index - 1] ) {
+			continue;
+		}
+
+		assert( buffer[index] == INVALID_BLOCK || buffer[index] <= MAX_BLOCK_ID );
+
+		if( std::find( palette, palette + palette_size, buffer[index] ) == palette + palette_size ) {
+			if( palette_size == MAX_PALETTE_SIZE ) {
+				++palette_size;
+				break;
+			}
+
+			palette[palette_size++] = buffer[index];
+		}
+	}
+
+	bump_revision();
+
+	if( palette_size == 1 ) {
+		collapse( palette[0] );
+		return;
+	}
+
+	uint8_t bits_shift = 0;
+
+	while( bits_shift < DIRECT_BITS_SHIFT && calc_num_palette_entries( bits_shift ) < palette_size ) {
+		++bits_shift;
+	}
+
+	if( m_buffer != nullptr ) {
+		release_buffer( m_buffer, m_bits_shift );
+	}
+
+	attach_buffer( allocate_buffer( bits_shift ), bits_shift );
+
+	if( bits_shift == DIRECT_BITS_SHIFT ) {
+		m_palette_size = 0;
+
+		for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+			write_packed( m_data, bits_shift, index, buffer[index] );
+		}
+
+		return;
+	}
+
+	std::copy( palette, palette + palette_size, m_palette );
+	m_palette_size = palette_size;
+
+	// Runs of equal blocks share the entry lookup.
+	Word entry = 0;
+
+	for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+		if( index == 0 || buffer[index] != buffer[index - 1] ) {
+			entry = static_cast<Word>( std::find( palette, palette + palette_size, buffer[index] ) - palette );
+		}
+
+		++m_palette_counts[entry];
+		write_packed( m_data, bits_shift, index, entry );
+	}
+}
+
+void Chunk::get_raw_data( Block* buffer ) const {
+	if( m_buffer == nullptr ) {
+		std::fill( buffer, buffer + m_num_blocks, m_uniform_block );
+		return;
+	}
+
+	if( m_bits_shift == DIRECT_BITS_SHIFT ) {
+		for( std::size_t index = 0; index < m_num_blocks; ++index ) {
+			buffer[index] = static_cast<Block>( get_value( index ) );
+		}
+
+		return;
+	}
+
+	// Unpack word by word.
+	const uint8_t bits = static_cast<uint8_t>( 1 << m_bits_shift );
+	const std::size_t values_per_word = std::size_t( 1 ) << (WORD_BITS_SHIFT - m_bits_shift);
+	const Word mask = (Word( 1 ) << bits) - 1;
+	std::size_t index = 0;
+
+	for( std::size_t word_idx = 0; index < m_num_blocks; ++word_idx ) {
+		Word word = m_data[word_idx];
+
+		for( std::size_t value_idx = 0; value_idx < values_per_word && index < m_num_blocks; ++value_idx ) {
+			buffer[index++] = m_palette[word & mask];
+			word >>= bits;
+		}
+	}
 }
 
 }
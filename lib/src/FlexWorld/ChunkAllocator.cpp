@@ -0,0 +1,113 @@
+#include <FlexWorld/ChunkAllocator.hpp>
+
+#include <new>
+#include <cassert>
+
+namespace fw {
+
+static const std::size_t SLOT_ALIGNMENT = 16; // Must be a power of 2.
+
+const std::size_t ChunkAllocator::SLAB_SIZE = 64 * 1024;
+
+ChunkAllocator::ChunkAllocator() :
+	m_num_slab_bytes( 0 ),
+	m_num_allocations( 0 )
+{
+}
+
+ChunkAllocator::~ChunkAllocator() {
+	clear();
+}
+
+std::size_t ChunkAllocator::get_slot_size( std::size_t size ) {
+	return (size + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+}
+
+ChunkAllocator::Pool& ChunkAllocator::get_pool( std::size_t slot_size ) {
+	// Only a handful of slot sizes exist (chunk header and one per storage
+	// width), so a linear search is fine.
+	for( std::size_t pool_idx = 0; pool_idx < m_pools.size(); ++pool_idx ) {
+		if( m_pools[pool_idx].slot_size == slot_size ) {
+			return m_pools[pool_idx];
+		}
+	}
+
+	Pool pool;
+	pool.slot_size = slot_size;
+	pool.next = nullptr;
+	pool.end = nullptr;
+
+	m_pools.push_back( pool );
+	return m_pools.back();
+}
+
+void* ChunkAllocator::allocate( std::size_t size ) {
+	assert( size > 0 );
+
+	Pool& pool = get_pool( get_slot_size( size ) );
+	++m_num_allocations;
+
+	if( !pool.free_slots.empty() ) {
+		void* ptr = pool.free_slots.back();
+		pool.free_slots.pop_back();
+		return ptr;
+	}
+
+	if( static_cast<std::size_t>( pool.end - pool.next ) < pool.slot_size ) {
+		// Start a new slab. Slots bigger than a slab get a slab of their own.
+		std::size_t slab_size = pool.slot_size > SLAB_SIZE ? pool.slot_size : SLAB_SIZE - SLAB_SIZE % pool.slot_size;
+
+		m_slabs.push_back( ::operator new( slab_size ) );
+		m_num_slab_bytes += slab_size;
+
+		pool.next = static_cast<char*>( m_slabs.back() );
+		pool.end = pool.next + slab_size;
+	}
+
+	void* ptr = pool.next;
+	pool.next += pool.slot_size;
+
+	return ptr;
+}
+
+void ChunkAllocator::release( void* ptr, std::size_t size ) {
+	assert( ptr != nullptr );
+	assert( m_num_allocations > 0 );
+
+	get_pool( get_slot_size( size ) ).free_slots.push_back( ptr );
+	--m_num_allocations;
+}
+
+Chunk& ChunkAllocator::create_chunk( const Chunk::Vector& size ) {
+	return *new( allocate( sizeof( Chunk ) ) ) Chunk( size, *this );
+}
+
+void ChunkAllocator::destroy_chunk( Chunk& chunk ) {
+	chunk.~Chunk();
+	release( &chunk, sizeof( Chunk ) );
+}
+
+void ChunkAllocator::clear() {
+	for( std::size_t slab_idx = 0; slab_idx < m_slabs.size(); ++slab_idx ) {
+		::operator delete( m_slabs[slab_idx] );
+	}
+
+	m_slabs.clear();
+	m_pools.clear();
+	m_num_slab_bytes = 0;
+	m_num_allocations = 0;
+}
+
+std::size_t ChunkAllocator::get_num_slabs() const {
+	return m_slabs.size();
+}
+
+std::size_t ChunkAllocator::get_num_slab_bytes() const {
+	return m_num_slab_bytes;
+}
+
+std::size_t ChunkAllocator::get_num_allocations() const {
+	return m_num_allocations;
+}
+
+}
@@ -0,0 +1,169 @@
+#include <FlexWorld/ChunkDirectory.hpp>
+
+#include <limits>
+#include <cassert>
+
+namespace fw {
+
+static const std::size_t INITIAL_NUM_SLOTS = 64; // Must be a power of 2.
+static const unsigned int INITIAL_SLOT_SHIFT = 64 - 6;
+
+const std::size_t ChunkDirectory::MAX_DENSE_SLOTS = 1 << 21;
+const ChunkDirectory::Key ChunkDirectory::EMPTY_KEY = std::numeric_limits<Key>::max();
+
+ChunkDirectory::ChunkDirectory( const Vector& size ) :
+	m_size( size ),
+	m_mode( DENSE ),
+	m_slot_mask( 0 ),
+	m_slot_shift( 0 )
+{
+	std::size_t num_slots = static_cast<std::size_t>( size.x ) * size.y * size.z;
+
+	if( num_slots > MAX_DENSE_SLOTS ) {
+		m_mode = HASHED;
+	}
+
+	clear();
+}
+
+ChunkDirectory::ChunkDirectory( const Vector& size, Mode mode ) :
+	m_size( size ),
+	m_mode( mode ),
+	m_slot_mask( 0 ),
+	m_slot_shift( 0 )
+{
+	clear();
+}
+
+ChunkDirectory::Mode ChunkDirectory::get_mode() const {
+	return m_mode;
+}
+
+const ChunkDirectory::Vector& ChunkDirectory::get_size() const {
+	return m_size;
+}
+
+std::size_t ChunkDirectory::get_num_chunks() const {
+	return m_entries.size();
+}
+
+ChunkDirectory::Key ChunkDirectory::pack( const Vector& position ) {
+	return
+		static_cast<Key>( position.x ) |
+		(static_cast<Key>( position.y ) << 16) |
+		(static_cast<Key>( position.z ) << 32)
+	;
+}
+
+std::size_t ChunkDirectory::find_slot( Key key ) const {
+	// Fibonacci hashing, linear probing. The table is never full, so there's
+	// always an empty slot to stop at.
+	std::size_t index = static_cast<std::size_t>( (key * 0x9e3779b97f4a7c15ull) >> m_slot_shift );
+
+	while( m_slots[index].key != key && m_slots[index].key != EMPTY_KEY ) {
+		index = (index + 1) & m_slot_mask;
+	}
+
+	return index;
+}
+
+Chunk* ChunkDirectory::find( const Vector& position ) const {
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+
+	if( m_mode == DENSE ) {
+		return m_dense[
+			(static_cast<std::size_t>( position.z ) * m_size.y + position.y) * m_size.x + position.x
+		];
+	}
+
+	return m_slots[find_slot( pack( position ) )].chunk;
+}
+
+void ChunkDirectory::insert( const Vector& position, Chunk& chunk ) {
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+	assert( find( position ) == nullptr );
+
+	if( m_mode == DENSE ) {
+		m_dense[
+			(static_cast<std::size_t>( position.z ) * m_size.y + position.y) * m_size.x + position.x
+		] = &chunk;
+	}
+	else {
+		// Keep load factor <= 0.5.
+		if( (m_entries.size() + 1) * 2 > m_slots.size() ) {
+			grow();
+		}
+
+		Key key = pack( position );
+		Slot& slot = m_slots[find_slot( key )];
+
+		slot.key = key;
+		slot.chunk = &chunk;
+	}
+
+	Entry entry;
+	entry.position = position;
+	entry.chunk = &chunk;
+
+	m_entries.push_back( entry );
+}
+
+void ChunkDirectory::grow() {
+	Slot empty_slot;
+	empty_slot.key = EMPTY_KEY;
+	empty_slot.chunk = nullptr;
+
+	m_slots.assign( m_slots.size() * 2, empty_slot );
+	m_slot_mask = m_slots.size() - 1;
+	--m_slot_shift;
+
+	// Rehash from entries, they contain everything the table did.
+	for( std::size_t entry_idx = 0; entry_idx < m_entries.size(); ++entry_idx ) {
+		Key key = pack( m_entries[entry_idx].position );
+		Slot& slot = m_slots[find_slot( key )];
+
+		slot.key = key;
+		slot.chunk = m_entries[entry_idx].chunk;
+	}
+}
+
+const ChunkDirectory::Vector& ChunkDirectory::get_position( std::size_t index ) const {
+	assert( index < m_entries.size() );
+	return m_entries[index].position;
+}
+
+Chunk& ChunkDirectory::get_chunk( std::size_t index ) const {
+	assert( index < m_entries.size() );
+	return *m_entries[index].chunk;
+}
+
+void ChunkDirectory::clear() {
+	if( m_mode == DENSE ) {
+		std::size_t num_slots = static_cast<std::size_t>( m_size.x ) * m_size.y * m_size.z;
+
+		// Only reset used slots if the index exists already, so that clearing
+		// costs O(number of chunks).
+		if( m_dense.size() == num_slots ) {
+			for( std::size_t entry_idx = 0; entry_idx < m_entries.size(); ++entry_idx ) {
+				const Vector& position = m_entries[entry_idx].position;
+				m_dense[(static_cast<std::size_t>( position.z ) * m_size.y + position.y) * m_size.x + position.x] = nullptr;
+			}
+		}
+		else {
+			m_dense.assign( num_slots, nullptr );
+		}
+	}
+	else {
+		Slot empty_slot;
+		empty_slot.key = EMPTY_KEY;
+		empty_slot.chunk = nullptr;
+
+		m_slots.assign( INITIAL_NUM_SLOTS, empty_slot );
+		m_slot_mask = INITIAL_NUM_SLOTS - 1;
+		m_slot_shift = INITIAL_SLOT_SHIFT;
+	}
+
+	m_entries.clear();
+}
+
+}
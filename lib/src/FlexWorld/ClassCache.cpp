@@ -5,83 +5,202 @@
 
 namespace fw {
 
+static const std::size_t INITIAL_NUM_SLOTS = 16; // Must be a power of 2.
+static const unsigned int INITIAL_SLOT_SHIFT = 64 - 4;
+
 ClassCache::ClassCache() :
-	m_num_holes( 0 )
+	m_num_cached_classes( 0 ),
+	m_slot_mask( 0 ),
+	m_slot_shift( 0 )
 {
+	clear();
 }
 
 void ClassCache::clear() {
+	Slot empty_slot = { nullptr, 0 };
+
 	m_classes.clear();
-	m_ids.clear();
-	m_num_holes = 0;
+	m_free_ids.clear();
+	m_slots.assign( INITIAL_NUM_SLOTS, empty_slot );
+	m_num_cached_classes = 0;
+	m_slot_mask = INITIAL_NUM_SLOTS - 1;
+	m_slot_shift = INITIAL_SLOT_SHIFT;
 }
 
 std::size_t ClassCache::get_num_cached_classes() const {
-	return m_ids.size();
+	return m_num_cached_classes;
 }
 
 const Class& ClassCache::get_class( IdType id ) const {
 	assert( is_id_valid( id ) );
-	return *m_classes[id];
+	return *m_classes[id].cls;
+}
+
+std::size_t ClassCache::get_home_slot( const Class* cls ) const {
+	// Fibonacci hashing of the address.
+	uint64_t key = static_cast<uint64_t>( reinterpret_cast<uintptr_t>( cls ) );
+	return static_cast<std::size_t>( (key * 0x9e3779b97f4a7c15ull) >> m_slot_shift );
+}
+
+std::size_t ClassCache::find_slot( const Class* cls ) const {
+	// Linear probing. The table is never full, so there's always an empty slot
+	// to stop at.
+	std::size_t index = get_home_slot( cls );
+
+	while( m_slots[index].cls != cls && m_slots[index].cls != nullptr ) {
+		index = (index + 1) & m_slot_mask;
+	}
+
+	return index;
+}
+
+void ClassCache::insert_slot( const Class* cls, IdType id ) {
+	// Keep the load factor at or below 0.5.
+	if( (m_num_cached_classes + 1) * 2 > m_slots.size() ) {
+		rehash( m_slots.size() * 2 );
+	}
+
+	Slot& slot = m_slots[find_slot( cls )];
+
+	assert( slot.cls == nullptr );
+	slot.cls = cls;
+	slot.id = id;
+}
+
+void ClassCache::erase_slot( const Class* cls ) {
+	std::size_t index = find_slot( cls );
+	std::size_t next_index = index;
+
+	assert( m_slots[index].cls == cls );
+
+	// Backward shift deletion: move following entries of the probe sequence
+	// into the gap, so no tombstones are needed.
+	while( true ) {
+		next_index = (next_index + 1) & m_slot_mask;
+
+		if( m_slots[next_index].cls == nullptr ) {
+			break;
+		}
+
+		std::size_t home = get_home_slot( m_slots[next_index].cls );
+
+		// Move if the entry's home isn't cyclically inside (index, next_index].
+		bool inside = index <= next_index ?
+			(home > index && home <= next_index) :
+			(home > index || home <= next_index)
+		;
+
+		if( !inside ) {
+			m_slots[index] = m_slots[next_index];
+			index = next_index;
+		}
+	}
+
+	m_slots[index].cls = nullptr;
 }
 
-ClassCache::IdType ClassCache::cache( const Class& cls ) {
+void ClassCache::rehash( std::size_t num_slots ) {
+	SlotVector old_slots;
+	Slot empty_slot = { nullptr, 0 };
+
+	old_slots.swap( m_slots );
+	m_slots.assign( num_slots, empty_slot );
+	m_slot_mask = num_slots - 1;
+	--m_slot_shift;
+
+	assert( num_slots == old_slots.size() * 2 );
+
+	for( std::size_t slot_idx = 0; slot_idx < old_slots.size(); ++slot_idx ) {
+		if( old_slots[slot_idx].cls != nullptr ) {
+			m_slots[find_slot( old_slots[slot_idx].cls )] = old_slots[slot_idx];
+		}
+	}
+}
+
+ClassCache::IdType ClassCache::cache( const Class& cls, uint32_t num_refs ) {
+	assert( num_refs > 0 );
+
 	// Check if same class has already been cached.
-	IdUsePairMap::iterator iu_iter( m_ids.find( &cls ) );
+	const Slot& slot = m_slots[find_slot( &cls )];
 
-	if( iu_iter != m_ids.end() ) {
+	if( slot.cls != nullptr ) {
 		// Increase usage counter.
-		++iu_iter->second.second;
-		return iu_iter->second.first;
+		m_classes[slot.id].num_refs += num_refs;
+		return slot.id;
 	}
 
-	// If no holes, just cache.
-	if( !m_num_holes ) {
-		m_classes.push_back( &cls );
-		m_ids[&cls] = IdUsePair( m_classes.size() - 1, 1 );
-		return static_cast<IdType>( m_classes.size() - 1 );
+	Entry entry = { &cls, num_refs };
+	IdType id = 0;
+
+	if( m_free_ids.empty() ) {
+		// No holes, just cache.
+		assert( m_classes.size() <= std::numeric_limits<IdType>::max() );
+
+		id = static_cast<IdType>( m_classes.size() );
+		m_classes.push_back( entry );
 	}
+	else {
+		// Fill most recently created hole.
+		id = m_free_ids.back();
+		m_free_ids.pop_back();
 
-	// Hole exists, find it.
-	for( std::size_t index = 0; index < m_classes.size(); ++index ) {
-		if( m_classes[index] == nullptr ) {
-			--m_num_holes;
-			m_classes[index] = &cls;
-			m_ids[&cls] = IdUsePair( index, 1 );
-			return static_cast<IdType>( index );
-		}
+		assert( m_classes[id].cls == nullptr );
+		m_classes[id] = entry;
 	}
 
-	// Hole not found, this really shouldn't happen.
-	return 0;
+	insert_slot( &cls, id );
+	++m_num_cached_classes;
+
+	return id;
 }
 
-void ClassCache::forget( const Class& cls ) {
-	IdUsePairMap::iterator iu_iter( m_ids.find( &cls ) );
+void ClassCache::forget( const Class& cls, uint32_t num_refs ) {
+	assert( num_refs > 0 );
 
-	assert( iu_iter != m_ids.end() );
+	const Slot& slot = m_slots[find_slot( &cls )];
+	assert( slot.cls == &cls );
 
-	--iu_iter->second.second;
-	if( iu_iter->second.second > 0 ) {
+	release_refs( slot.id, num_refs );
+}
+
+void ClassCache::add_refs( IdType id, uint32_t num_refs ) {
+	assert( is_id_valid( id ) );
+	m_classes[id].num_refs += num_refs;
+}
+
+void ClassCache::release_refs( IdType id, uint32_t num_refs ) {
+	assert( is_id_valid( id ) );
+	assert( m_classes[id].num_refs >= num_refs );
+
+	Entry& entry = m_classes[id];
+
+	entry.num_refs -= num_refs;
+	if( entry.num_refs > 0 ) {
 		// Still in use, cancel removing.
 		return;
 	}
 
+	erase_slot( entry.cls );
+	--m_num_cached_classes;
+
 	// If last cached class, no hole.
-	if( iu_iter->second.first == m_classes.size() - 1 ) {
+	if( id == m_classes.size() - 1 ) {
 		m_classes.pop_back();
-		m_ids.erase( iu_iter );
 		return;
 	}
 
 	// Hole!
-	m_classes[iu_iter->second.first] = nullptr;
-	++m_num_holes;
-	m_ids.erase( iu_iter );
+	entry.cls = nullptr;
+	m_free_ids.push_back( id );
+}
+
+uint32_t ClassCache::get_num_refs( IdType id ) const {
+	assert( is_id_valid( id ) );
+	return m_classes[id].num_refs;
 }
 
 uint32_t ClassCache::get_num_holes() const {
-	return m_num_holes;
+	return static_cast<uint32_t>( m_free_ids.size() );
 }
 
 bool ClassCache::is_id_valid( IdType id ) const {
@@ -89,7 +208,7 @@ bool ClassCache::is_id_valid( IdType id ) const {
 		return false;
 	}
 
-	return m_classes[id] != nullptr;
+	return m_classes[id].cls != nullptr;
 }
 
 }
@@ -67,10 +67,12 @@ void Client::handle_connect( const boost::system::error_code& error ) {
 }
 
 void Client::start_read() {
+	char* free_space = m_receive_buffer.prepare( MIN_READ_SIZE );
+
 	m_socket->async_read_some(
 		boost::asio::buffer(
-			m_receive_buffer,
-			READ_BUFFER_SIZE
+			free_space,
+			m_receive_buffer.get_free_size()
 		),
 		boost::bind(
 			&Client::handle_read,
@@ -87,21 +89,37 @@ void Client::handle_read( const boost::system::error_code& error, std::size_t nu
 		return;
 	}
 
-	// Append to buffer.
-	m_buffer.insert( m_buffer.end(), m_receive_buffer, m_receive_buffer + num_bytes_read );
+	// Data has been read into the receive buffer directly.
+	m_receive_buffer.commit( num_bytes_read );
 
-	// Dispatch until buffer empty.
-	std::size_t consumed = 0;
+	// Dispatch all complete messages.
+	std::string violation;
 
-	while( m_buffer.size() > 1 && (consumed = ServerProtocol::dispatch( m_buffer, *m_handler, 0 )) > 0 ) {
-		if( consumed == m_buffer.size() ) {
-			m_buffer.clear();
-		}
-		else {
-			std::memmove( &m_buffer[0], &m_buffer[0] + consumed, m_buffer.size() - consumed );
-			m_buffer.resize( m_buffer.size() - consumed );
+	try {
+		std::size_t consumed = 0;
+
+		while( (consumed = ServerProtocol::dispatch( m_receive_buffer.get_data(), m_receive_buffer.get_size(), *m_handler, 0 )) > 0 ) {
+			m_receive_buffer.consume( consumed );
 		}
 	}
+	catch( const ServerProtocol::BogusMessageDataException& e ) {
+		violation = e.what();
+	}
+	catch( const ServerProtocol::UnknownMessageIDException& e ) {
+		violation = e.what();
+	}
+	catch( const Message::BogusDataException& e ) {
+		violation = e.what();
+	}
+
+	if( !violation.empty() ) {
+		// Protocol violation, drop connection. The pending read fails and
+		// notifies the handler.
+		std::cerr << "ERROR: Invalid data from server (" << violation << "), disconnecting." << std::endl;
+
+		m_receive_buffer.clear();
+		m_socket->close();
+	}
 
 	// Start another read.
 	start_read();
@@ -0,0 +1,775 @@
+#include <FlexWorld/EntityStore.hpp>
+#include <FlexWorld/World.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
+#include <fstream>
+#include <cstring>
+#include <cassert>
+
+namespace fw {
+
+static const char MAGIC[4] = { 'F', 'W', 'E', 'N' };
+static const uint16_t VERSION = 1;
+static const std::size_t HEADER_SIZE = 8;
+static const char CLASS_RECORD = 1;
+static const char PLANET_RECORD = 2;
+static const char ENTITY_RECORD = 3;
+static const char DELETE_RECORD = 4;
+static const std::size_t RECORD_HEAD_SIZE = 5;
+static const std::size_t CRC_SIZE = 4;
+static const std::size_t MIN_ENTITY_PAYLOAD_SIZE = 4 + 4 + 6 * 4 + 4 + 4 + 4 + 2 + 1;
+static const uint32_t NONE = 0xffffffff;
+
+// Compact when superseded records exceed the live ones by this many.
+static const std::size_t MIN_SUPERSEDED_RECORDS = 1024;
+
+const std::string EntityStore::FILENAME = "entities.fwe";
+
+static void append_uint16( std::vector<char>& buffer, uint16_t value ) {
+	buffer.push_back( static_cast<char>( value & 0xff ) );
+	buffer.push_back( static_cast<char>( value >> 8 ) );
+}
+
+static void append_uint32( std::vector<char>& buffer, uint32_t value ) {
+	append_uint16( buffer, static_cast<uint16_t>( value & 0xffff ) );
+	append_uint16( buffer, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static void append_float( std::vector<char>& buffer, float value ) {
+	uint32_t bits = 0;
+
+	std::memcpy( &bits, &value, sizeof( bits ) );
+	append_uint32( buffer, bits );
+}
+
+static void append_string( std::vector<char>& buffer, const std::string& string ) {
+	assert( string.size() <= 0xffff );
+
+	append_uint16( buffer, static_cast<uint16_t>( string.size() ) );
+	buffer.insert( buffer.end(), string.begin(), string.end() );
+}
+
+static uint16_t read_uint16( const char* data ) {
+	return static_cast<uint16_t>( static_cast<uint8_t>( data[0] ) | static_cast<uint8_t>( data[1] ) << 8 );
+}
+
+static uint32_t read_uint32( const char* data ) {
+	return read_uint16( data ) | static_cast<uint32_t>( read_uint16( data + 2 ) ) << 16;
+}
+
+static float read_float( const char* data ) {
+	uint32_t bits = read_uint32( data );
+	float value = 0.0f;
+
+	std::memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+static uint32_t calculate_crc( const char* data, std::size_t size ) {
+	boost::crc_32_type crc;
+
+	crc.process_bytes( data, size );
+	return crc.checksum();
+}
+
+static std::size_t begin_record( std::vector<char>& buffer, char type ) {
+	std::size_t record_start = buffer.size();
+
+	buffer.push_back( type );
+	append_uint32( buffer, 0 );
+
+	return record_start;
+}
+
+// Patch the payload length and append the CRC of the whole record.
+static uint32_t end_record( std::vector<char>& buffer, std::size_t record_start ) {
+	uint32_t length = static_cast<uint32_t>( buffer.size() - record_start - RECORD_HEAD_SIZE );
+
+	for( std::size_t byte_idx = 0; byte_idx < 4; ++byte_idx ) {
+		buffer[record_start + 1 + byte_idx] = static_cast<char>( (length >> (byte_idx * 8)) & 0xff );
+	}
+
+	uint32_t crc = calculate_crc( &buffer[record_start], buffer.size() - record_start );
+
+	append_uint32( buffer, crc );
+	return crc;
+}
+
+static void append_header( std::vector<char>& buffer ) {
+	buffer.insert( buffer.end(), MAGIC, MAGIC + sizeof( MAGIC ) );
+	append_uint16( buffer, VERSION );
+	append_uint16( buffer, 0 );
+}
+
+/** Fields of an entity record, pointing into the record's payload.
+ */
+struct EntityRecord {
+	bool parse( const char* payload, std::size_t size ) {
+		if( size < MIN_ENTITY_PAYLOAD_SIZE ) {
+			return false;
+		}
+
+		id = read_uint32( payload );
+		cls = read_uint32( payload + 4 );
+		position = sf::Vector3f( read_float( payload + 8 ), read_float( payload + 12 ), read_float( payload + 16 ) );
+		rotation = sf::Vector3f( read_float( payload + 20 ), read_float( payload + 24 ), read_float( payload + 28 ) );
+		amount = read_uint32( payload + 32 );
+		parent = read_uint32( payload + 36 );
+		planet = read_uint32( payload + 40 );
+		hook_length = read_uint16( payload + 44 );
+
+		std::size_t offset = 46 + hook_length;
+
+		if( offset + 1 > size ) {
+			return false;
+		}
+
+		hook = payload + 46;
+		has_name = payload[offset] != 0;
+		name_length = 0;
+		name = nullptr;
+		++offset;
+
+		if( has_name ) {
+			if( offset + 2 > size ) {
+				return false;
+			}
+
+			name_length = read_uint16( payload + offset );
+			name = payload + offset + 2;
+			offset += 2 + name_length;
+		}
+
+		return offset == size && amount > 0 && (parent == NONE || hook_length > 0);
+	}
+
+	Entity::ID id;
+	uint32_t cls;
+	sf::Vector3f position;
+	sf::Vector3f rotation;
+	Entity::AmountType amount;
+	Entity::ID parent;
+	uint32_t planet;
+	std::size_t hook_length;
+	const char* hook;
+	bool has_name;
+	std::size_t name_length;
+	const char* name;
+};
+
+EntityStore::EntityStore( const std::string& directory ) :
+	m_directory( directory ),
+	m_num_entities( 0 ),
+	m_num_records( 0 ),
+	m_open( false ),
+	m_needs_compaction( false )
+{
+}
+
+const std::string& EntityStore::get_directory() const {
+	return m_directory;
+}
+
+std::string EntityStore::get_path() const {
+	return (boost::filesystem::path( m_directory ) / FILENAME).string();
+}
+
+void EntityStore::open() {
+	std::string path = get_path();
+
+	m_class_ids.clear();
+	m_class_indices.clear();
+	m_planet_ids.clear();
+	m_planet_indices.clear();
+	m_record_crcs.clear();
+	m_stored.clear();
+	m_record_offsets.clear();
+	m_data.clear();
+	m_num_entities = 0;
+	m_num_records = 0;
+	m_open = false;
+
+	if( !boost::filesystem::exists( path ) ) {
+		// Written as a whole with the first save.
+		m_needs_compaction = true;
+		m_open = true;
+		return;
+	}
+
+	// One sequential read, records are parsed in place.
+	{
+		std::ifstream in( path.c_str(), std::ios::binary );
+
+		if( !in.is_open() ) {
+			throw ReadException( "Failed to open " + path + "." );
+		}
+
+		in.seekg( 0, std::ios::end );
+		std::streamoff size = in.tellg();
+		in.seekg( 0, std::ios::beg );
+
+		if( size < 0 ) {
+			throw ReadException( "Failed to read " + path + "." );
+		}
+
+		m_data.resize( static_cast<std::size_t>( size ) );
+
+		if( !m_data.empty() && !in.read( &m_data[0], static_cast<std::streamsize>( m_data.size() ) ) ) {
+			throw ReadException( "Failed to read " + path + "." );
+		}
+	}
+
+	if(
+		m_data.size() < HEADER_SIZE ||
+		std::memcmp( &m_data[0], MAGIC, sizeof( MAGIC ) ) != 0 ||
+		read_uint16( &m_data[4] ) != VERSION
+	) {
+		m_data.clear();
+		throw ReadException( "Invalid entity store " + path + "." );
+	}
+
+	read_records();
+	m_open = true;
+}
+
+void EntityStore::read_records() {
+	std::size_t offset = HEADER_SIZE;
+
+	m_needs_compaction = false;
+
+	while( offset < m_data.size() ) {
+		const char* record = &m_data[offset];
+		std::size_t left = m_data.size() - offset;
+
+		if( left < RECORD_HEAD_SIZE + CRC_SIZE ) {
+			m_needs_compaction = true;
+			break;
+		}
+
+		std::size_t length = read_uint32( record + 1 );
+
+		if( length > left - RECORD_HEAD_SIZE - CRC_SIZE || read_uint32( record + RECORD_HEAD_SIZE + length ) != calculate_crc( record, RECORD_HEAD_SIZE + length ) ) {
+			// Torn write, drop the rest.
+			m_needs_compaction = true;
+			break;
+		}
+
+		const char* payload = record + RECORD_HEAD_SIZE;
+		bool valid = true;
+
+		if( record[0] == CLASS_RECORD || record[0] == PLANET_RECORD ) {
+			FlexID id;
+
+			if(
+				length < 6 ||
+				length != 6u + read_uint16( payload + 4 ) ||
+				read_uint32( payload ) != (record[0] == CLASS_RECORD ? m_class_ids.size() : m_planet_ids.size())
+			) {
+				valid = false;
+			}
+			else if( record[0] == CLASS_RECORD ) {
+				valid = id.parse( std::string( payload + 6, length - 6 ) );
+
+				if( valid ) {
+					m_class_indices[id.get()] = static_cast<uint32_t>( m_class_ids.size() );
+					m_class_ids.push_back( id );
+				}
+			}
+			else {
+				std::string planet_id( payload + 6, length - 6 );
+
+				m_planet_indices[planet_id] = static_cast<uint32_t>( m_planet_ids.size() );
+				m_planet_ids.push_back( planet_id );
+			}
+		}
+		else if( record[0] == ENTITY_RECORD ) {
+			EntityRecord entity;
+
+			valid =
+				entity.parse( payload, length ) &&
+				entity.id != NONE &&
+				entity.cls < m_class_ids.size() &&
+				(entity.planet == NONE || entity.planet < m_planet_ids.size())
+			;
+
+			if( valid ) {
+				if( entity.id >= m_stored.size() ) {
+					m_stored.resize( entity.id + 1, false );
+					m_record_crcs.resize( entity.id + 1, 0 );
+					m_record_offsets.resize( entity.id + 1, 0 );
+				}
+
+				if( !m_stored[entity.id] ) {
+					m_stored[entity.id] = true;
+					++m_num_entities;
+				}
+
+				m_record_crcs[entity.id] = read_uint32( record + RECORD_HEAD_SIZE + length );
+				m_record_offsets[entity.id] = offset + RECORD_HEAD_SIZE;
+				++m_num_records;
+			}
+		}
+		else if( record[0] == DELETE_RECORD && length == 4 ) {
+			Entity::ID id = read_uint32( payload );
+
+			if( id < m_stored.size() && m_stored[id] ) {
+				m_stored[id] = false;
+				--m_num_entities;
+			}
+
+			++m_num_records;
+		}
+		else {
+			valid = false;
+		}
+
+		if( !valid ) {
+			m_needs_compaction = true;
+			break;
+		}
+
+		offset += RECORD_HEAD_SIZE + length + CRC_SIZE;
+	}
+}
+
+bool EntityStore::is_open() const {
+	return m_open;
+}
+
+std::size_t EntityStore::get_num_classes() const {
+	return m_class_ids.size();
+}
+
+const FlexID& EntityStore::get_class_id( std::size_t index ) const {
+	assert( index < m_class_ids.size() );
+	return m_class_ids[index];
+}
+
+std::size_t EntityStore::get_num_entities() const {
+	return m_num_entities;
+}
+
+std::size_t EntityStore::get_num_records() const {
+	return m_num_records;
+}
+
+std::size_t EntityStore::load_entities( World& world, const ClassArray& classes ) {
+	assert( m_open );
+	assert( classes.size() == m_class_ids.size() );
+
+	enum State {
+		UNKNOWN = 0,
+		VISITING,
+		VALID,
+		INVALID
+	};
+
+	std::size_t num_ids = m_stored.size();
+	std::vector<char> states( num_ids, UNKNOWN );
+	std::vector<Entity::ID> chain;
+	EntityRecord entity;
+
+	// Entities are valid if their class exists and their parents are valid.
+	for( Entity::ID id = 0; id < num_ids; ++id ) {
+		Entity::ID current = id;
+
+		while( states[current] == UNKNOWN ) {
+			if( !m_stored[current] ) {
+				states[current] = INVALID;
+				break;
+			}
+
+			entity.parse( &m_data[m_record_offsets[current]], read_uint32( &m_data[m_record_offsets[current] - 4] ) );
+
+			if( classes[entity.cls] == nullptr ) {
+				states[current] = INVALID;
+				break;
+			}
+
+			if( entity.parent == NONE ) {
+				states[current] = VALID;
+				break;
+			}
+
+			states[current] = VISITING;
+			chain.push_back( current );
+
+			if( entity.parent >= num_ids ) {
+				states[current] = INVALID;
+				break;
+			}
+
+			current = entity.parent;
+		}
+
+		// Cycles are invalid, too.
+		char state = states[current] == VALID ? VALID : INVALID;
+
+		for( std::size_t chain_idx = 0; chain_idx < chain.size(); ++chain_idx ) {
+			states[chain[chain_idx]] = state;
+		}
+
+		chain.clear();
+	}
+
+	// Create entities in ID order.
+	std::size_t num_loaded = 0;
+
+	for( Entity::ID id = 0; id < num_ids; ++id ) {
+		if( states[id] != VALID ) {
+			continue;
+		}
+
+		entity.parse( &m_data[m_record_offsets[id]], read_uint32( &m_data[m_record_offsets[id] - 4] ) );
+
+		Entity& created = world.create_entity( id, *classes[entity.cls] );
+
+		created.set_amount( entity.amount );
+		created.set_rotation( entity.rotation );
+
+		if( entity.has_name ) {
+			created.set_name( std::string( entity.name, entity.name_length ) );
+		}
+
+		++num_loaded;
+	}
+
+	// Restore hierarchy and planet links.
+	for( Entity::ID id = 0; id < num_ids; ++id ) {
+		if( states[id] != VALID ) {
+			continue;
+		}
+
+		entity.parse( &m_data[m_record_offsets[id]], read_uint32( &m_data[m_record_offsets[id] - 4] ) );
+
+		if( entity.parent != NONE ) {
+			world.attach_entity( id, entity.parent, std::string( entity.hook, entity.hook_length ) );
+		}
+		else if( entity.planet != NONE && world.find_planet( m_planet_ids[entity.planet] ) != nullptr ) {
+			world.link_entity_to_planet( id, m_planet_ids[entity.planet] );
+		}
+
+		world.find_entity( id )->set_position( entity.position );
+	}
+
+	// Invalid entities aren't loaded, so they count as removed.
+	for( Entity::ID id = 0; id < num_ids; ++id ) {
+		if( m_stored[id] && states[id] != VALID ) {
+			m_stored[id] = false;
+			--m_num_entities;
+		}
+	}
+
+	Buffer().swap( m_data );
+	std::vector<std::size_t>().swap( m_record_offsets );
+
+	return num_loaded;
+}
+
+uint32_t EntityStore::get_class_index( const Class& cls, Buffer& tables ) {
+	std::string id = cls.get_id().get();
+	IndexMap::iterator index_iter = m_class_indices.find( id );
+
+	if( index_iter != m_class_indices.end() ) {
+		return index_iter->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>( m_class_ids.size() );
+	std::size_t record_start = begin_record( tables, CLASS_RECORD );
+
+	append_uint32( tables, index );
+	append_string( tables, id );
+	end_record( tables, record_start );
+
+	m_class_indices[id] = index;
+	m_class_ids.push_back( cls.get_id() );
+
+	return index;
+}
+
+uint32_t EntityStore::get_planet_index( const std::string& planet_id, Buffer& tables ) {
+	IndexMap::iterator index_iter = m_planet_indices.find( planet_id );
+
+	if( index_iter != m_planet_indices.end() ) {
+		return index_iter->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>( m_planet_ids.size() );
+	std::size_t record_start = begin_record( tables, PLANET_RECORD );
+
+	append_uint32( tables, index );
+	append_string( tables, planet_id );
+	end_record( tables, record_start );
+
+	m_planet_indices[planet_id] = index;
+	m_planet_ids.push_back( planet_id );
+
+	return index;
+}
+
+uint32_t EntityStore::encode_entity( const World& world, const Entity& entity, Buffer& buffer, Buffer& tables ) {
+	const Entity* parent = entity.get_parent();
+	uint32_t planet_index = NONE;
+
+	if( parent == nullptr ) {
+		const Planet* planet = world.find_linked_planet( entity.get_id() );
+
+		if( planet != nullptr ) {
+			planet_index = get_planet_index( planet->get_id(), tables );
+		}
+	}
+
+	std::size_t record_start = begin_record( buffer, ENTITY_RECORD );
+
+	append_uint32( buffer, entity.get_id() );
+	append_uint32( buffer, get_class_index( entity.get_class(), tables ) );
+	append_float( buffer, entity.get_position().x );
+	append_float( buffer, entity.get_position().y );
+	append_float( buffer, entity.get_position().z );
+	append_float( buffer, entity.get_rotation().x );
+	append_float( buffer, entity.get_rotation().y );
+	append_float( buffer, entity.get_rotation().z );
+	append_uint32( buffer, entity.get_amount() );
+	append_uint32( buffer, parent != nullptr ? parent->get_id() : NONE );
+	append_uint32( buffer, planet_index );
+	append_string( buffer, parent != nullptr ? parent->get_child_hook( entity ) : std::string() );
+
+	// Names equal to the class' name aren't custom.
+	if( entity.get_name() != entity.get_class().get_name() ) {
+		buffer.push_back( 1 );
+		append_string( buffer, entity.get_name() );
+	}
+	else {
+		buffer.push_back( 0 );
+	}
+
+	return end_record( buffer, record_start );
+}
+
+std::size_t EntityStore::save( const World& world ) {
+	assert( m_open );
+
+	if( m_needs_compaction || m_num_records > 2 * m_num_entities + MIN_SUPERSEDED_RECORDS ) {
+		return compact( world );
+	}
+
+	typedef std::pair<Entity::ID, uint32_t> ChangedEntity;
+
+	Buffer buffer;
+	Buffer record;
+	std::vector<ChangedEntity> changed;
+	std::vector<Entity::ID> deleted;
+	Entity::ID next_id = 0;
+
+	World::EntityConstIterator ent_iter = world.entities_begin();
+	World::EntityConstIterator ent_iter_end = world.entities_end();
+
+	for( ; ent_iter != ent_iter_end; ++ent_iter ) {
+		Entity::ID id = ent_iter->first;
+
+		// Stored entities skipped in the world have been deleted.
+		for( ; next_id < id && next_id < m_stored.size(); ++next_id ) {
+			if( m_stored[next_id] ) {
+				deleted.push_back( next_id );
+			}
+		}
+
+		next_id = id + 1;
+
+		record.clear();
+		uint32_t crc = encode_entity( world, *ent_iter->second, record, buffer );
+
+		if( id < m_stored.size() && m_stored[id] && m_record_crcs[id] == crc ) {
+			continue;
+		}
+
+		buffer.insert( buffer.end(), record.begin(), record.end() );
+		changed.push_back( ChangedEntity( id, crc ) );
+	}
+
+	for( ; next_id < m_stored.size(); ++next_id ) {
+		if( m_stored[next_id] ) {
+			deleted.push_back( next_id );
+		}
+	}
+
+	for( std::size_t deleted_idx = 0; deleted_idx < deleted.size(); ++deleted_idx ) {
+		std::size_t record_start = begin_record( buffer, DELETE_RECORD );
+
+		append_uint32( buffer, deleted[deleted_idx] );
+		end_record( buffer, record_start );
+	}
+
+	if( !buffer.empty() ) {
+		append( buffer );
+	}
+
+	for( std::size_t deleted_idx = 0; deleted_idx < deleted.size(); ++deleted_idx ) {
+		m_stored[deleted[deleted_idx]] = false;
+		--m_num_entities;
+	}
+
+	for( std::size_t changed_idx = 0; changed_idx < changed.size(); ++changed_idx ) {
+		Entity::ID id = changed[changed_idx].first;
+
+		if( id >= m_stored.size() ) {
+			m_stored.resize( id + 1, false );
+			m_record_crcs.resize( id + 1, 0 );
+		}
+
+		if( !m_stored[id] ) {
+			m_stored[id] = true;
+			++m_num_entities;
+		}
+
+		m_record_crcs[id] = changed[changed_idx].second;
+	}
+
+	m_num_records += changed.size() + deleted.size();
+	return changed.size() + deleted.size();
+}
+
+bool EntityStore::save_entity( const World& world, const Entity& entity ) {
+	assert( m_open );
+	assert( world.find_entity( entity.get_id() ) == &entity );
+
+	// Appending to a missing or damaged file would get lost.
+	if( m_needs_compaction ) {
+		compact( world );
+		return true;
+	}
+
+	Entity::ID id = entity.get_id();
+	Buffer buffer;
+	Buffer record;
+	uint32_t crc = encode_entity( world, entity, record, buffer );
+
+	if( id < m_stored.size() && m_stored[id] && m_record_crcs[id] == crc ) {
+		return false;
+	}
+
+	buffer.insert( buffer.end(), record.begin(), record.end() );
+	append( buffer );
+
+	if( id >= m_stored.size() ) {
+		m_stored.resize( id + 1, false );
+		m_record_crcs.resize( id + 1, 0 );
+	}
+
+	if( !m_stored[id] ) {
+		m_stored[id] = true;
+		++m_num_entities;
+	}
+
+	m_record_crcs[id] = crc;
+	++m_num_records;
+
+	return true;
+}
+
+void EntityStore::append( const Buffer& buffer ) {
+	std::string path = get_path();
+	std::ofstream out( path.c_str(), std::ios::binary | std::ios::app );
+
+	if( out.is_open() ) {
+		out.write( &buffer[0], static_cast<std::streamsize>( buffer.size() ) );
+		out.close();
+	}
+
+	if( !out ) {
+		// Partially written records and new table entries are fixed by
+		// rewriting the whole file.
+		m_needs_compaction = true;
+		throw WriteException( "Failed to write " + path + "." );
+	}
+}
+
+void EntityStore::write_tables( Buffer& buffer ) const {
+	for( std::size_t cls_idx = 0; cls_idx < m_class_ids.size(); ++cls_idx ) {
+		std::size_t record_start = begin_record( buffer, CLASS_RECORD );
+
+		append_uint32( buffer, static_cast<uint32_t>( cls_idx ) );
+		append_string( buffer, m_class_ids[cls_idx].get() );
+		end_record( buffer, record_start );
+	}
+
+	for( std::size_t planet_idx = 0; planet_idx < m_planet_ids.size(); ++planet_idx ) {
+		std::size_t record_start = begin_record( buffer, PLANET_RECORD );
+
+		append_uint32( buffer, static_cast<uint32_t>( planet_idx ) );
+		append_string( buffer, m_planet_ids[planet_idx] );
+		end_record( buffer, record_start );
+	}
+}
+
+std::size_t EntityStore::compact( const World& world ) {
+	Buffer buffer;
+	Buffer record;
+	std::vector<uint32_t> record_crcs;
+	std::vector<bool> stored;
+
+	append_header( buffer );
+	write_tables( buffer );
+
+	World::EntityConstIterator ent_iter = world.entities_begin();
+	World::EntityConstIterator ent_iter_end = world.entities_end();
+
+	for( ; ent_iter != ent_iter_end; ++ent_iter ) {
+		Entity::ID id = ent_iter->first;
+
+		record.clear();
+		uint32_t crc = encode_entity( world, *ent_iter->second, record, buffer );
+		buffer.insert( buffer.end(), record.begin(), record.end() );
+
+		if( id >= stored.size() ) {
+			stored.resize( id + 1, false );
+			record_crcs.resize( id + 1, 0 );
+		}
+
+		stored[id] = true;
+		record_crcs[id] = crc;
+	}
+
+	std::string path = get_path();
+	std::string temp_path = path + ".tmp";
+	boost::system::error_code error;
+
+	boost::filesystem::create_directories( m_directory, error );
+
+	if( error ) {
+		throw WriteException( "Failed to create " + m_directory + ": " + error.message() );
+	}
+
+	{
+		std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+
+		if( !out.is_open() ) {
+			throw WriteException( "Failed to open " + temp_path + "." );
+		}
+
+		out.write( &buffer[0], static_cast<std::streamsize>( buffer.size() ) );
+		out.close();
+
+		if( !out ) {
+			throw WriteException( "Failed to write " + temp_path + "." );
+		}
+	}
+
+	boost::filesystem::rename( temp_path, path, error );
+
+	if( error ) {
+		throw WriteException( "Failed to replace " + path + ": " + error.message() );
+	}
+
+	m_record_crcs.swap( record_crcs );
+	m_stored.swap( stored );
+	m_num_entities = world.get_num_entities();
+	m_num_records = m_num_entities;
+	m_needs_compaction = false;
+
+	return m_num_entities;
+}
+
+}
@@ -0,0 +1,326 @@
+#include <FlexWorld/GeneratorQueue.hpp>
+#include <FlexWorld/LockFacility.hpp>
+
+#include <cassert>
+
+namespace fw {
+
+static uint32_t make_column_key( Planet::ScalarType x, Planet::ScalarType z ) {
+	return static_cast<uint32_t>( x ) << 16 | z;
+}
+
+GeneratorQueue::Handler::~Handler() {
+}
+
+GeneratorQueue::PlanetEntry::PlanetEntry( Planet& planet_, const TerrainGenerator& generator_ ) :
+	planet( &planet_ ),
+	generator( generator_ )
+{
+}
+
+GeneratorQueue::GeneratorQueue( LockFacility& lock_facility ) :
+	m_lock_facility( lock_facility ),
+	m_handler( nullptr ),
+	m_stop( false )
+{
+}
+
+GeneratorQueue::~GeneratorQueue() {
+	if( is_running() ) {
+		stop();
+	}
+
+	PlanetEntryMap::iterator entry_iter( m_planets.begin() );
+	PlanetEntryMap::iterator entry_iter_end( m_planets.end() );
+
+	for( ; entry_iter != entry_iter_end; ++entry_iter ) {
+		delete entry_iter->second;
+	}
+}
+
+void GeneratorQueue::set_handler( Handler& handler ) {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	m_handler = &handler;
+}
+
+void GeneratorQueue::add_planet( Planet& planet, const TerrainGenerator& generator ) {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+	assert( m_planets.find( &planet ) == m_planets.end() );
+	m_planets[&planet] = new PlanetEntry( planet, generator );
+}
+
+bool GeneratorQueue::has_planet( const Planet& planet ) const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_planets.find( &planet ) != m_planets.end();
+}
+
+void GeneratorQueue::remove_planet( const Planet& planet ) {
+	// Wait for a column being generated.
+	m_lock_facility.lock_planet( planet, true );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+		if( entry_iter != m_planets.end() ) {
+			delete entry_iter->second;
+			m_planets.erase( entry_iter );
+
+			// Drop pending requests.
+			RequestDeque requests;
+
+			for( std::size_t request_idx = 0; request_idx < m_requests.size(); ++request_idx ) {
+				if( m_requests[request_idx].planet != &planet ) {
+					requests.push_back( m_requests[request_idx] );
+				}
+			}
+
+			m_requests.swap( requests );
+		}
+	}
+
+	m_lock_facility.lock_planet( planet, false );
+}
+
+bool GeneratorQueue::is_generated( const Planet& planet, const Planet::Vector& position ) const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	PlanetEntryMap::const_iterator entry_iter = m_planets.find( &planet );
+
+	if( entry_iter == m_planets.end() ) {
+		return true;
+	}
+
+	const ColumnSet& generated = entry_iter->second->generated_columns;
+	return generated.find( make_column_key( position.x, position.z ) ) != generated.end();
+}
+
+void GeneratorQueue::set_generated( const Planet& planet, const Planet::Vector& position ) {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+	assert( entry_iter != m_planets.end() );
+
+	uint32_t key = make_column_key( position.x, position.z );
+
+	// Queued requests are skipped by the worker.
+	entry_iter->second->requested_columns.insert( key );
+	entry_iter->second->generated_columns.insert( key );
+}
+
+bool GeneratorQueue::request_column( PlanetEntry& entry, Planet::ScalarType x, Planet::ScalarType z ) {
+	uint32_t key = make_column_key( x, z );
+
+	if( entry.generated_columns.find( key ) != entry.generated_columns.end() ) {
+		return true;
+	}
+
+	if( entry.requested_columns.insert( key ).second ) {
+		Request request = { entry.planet, x, z };
+
+		m_requests.push_back( request );
+		m_condition.notify_one();
+	}
+
+	return false;
+}
+
+bool GeneratorQueue::request_chunk( const Planet& planet, const Planet::Vector& position ) {
+	assert( position.x < planet.get_size().x && position.z < planet.get_size().z );
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+	if( entry_iter == m_planets.end() ) {
+		return true;
+	}
+
+	return request_column( *entry_iter->second, position.x, position.z );
+}
+
+void GeneratorQueue::request_area( const Planet& planet, const Planet::Vector& center, Planet::ScalarType radius ) {
+	assert( center.x < planet.get_size().x && center.z < planet.get_size().z );
+
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+	if( entry_iter == m_planets.end() ) {
+		return;
+	}
+
+	// Walk rings of growing distance, so that the nearest columns come first.
+	int32_t size_x = static_cast<int32_t>( planet.get_size().x );
+	int32_t size_z = static_cast<int32_t>( planet.get_size().z );
+
+	for( int32_t distance = 0; distance <= static_cast<int32_t>( radius ); ++distance ) {
+		for( int32_t z = center.z - distance; z <= center.z + distance; ++z ) {
+			int32_t step = (z == center.z - distance || z == center.z + distance) ? 1 : 2 * distance;
+
+			for( int32_t x = center.x - distance; x <= center.x + distance; x += step ) {
+				if( x < 0 || z < 0 || x >= size_x || z >= size_z ) {
+					continue;
+				}
+
+				request_column( *entry_iter->second, static_cast<Planet::ScalarType>( x ), static_cast<Planet::ScalarType>( z ) );
+			}
+		}
+	}
+}
+
+void GeneratorQueue::generate_now( const Planet& planet, const Planet::Vector& position ) {
+	assert( m_lock_facility.is_planet_locked( planet ) );
+
+	Request request = { nullptr, position.x, position.z };
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		PlanetEntryMap::iterator entry_iter = m_planets.find( &planet );
+
+		if( entry_iter == m_planets.end() ) {
+			return;
+		}
+
+		request.planet = entry_iter->second->planet;
+		entry_iter->second->requested_columns.insert( make_column_key( position.x, position.z ) );
+	}
+
+	// An already queued request is skipped by the worker afterwards, so notify
+	// the handler here. The caller keeps the planet locked.
+	process_request( request, true );
+}
+
+std::size_t GeneratorQueue::get_num_queued_columns() const {
+	boost::lock_guard<boost::mutex> lock( m_internal_lock );
+	return m_requests.size();
+}
+
+bool GeneratorQueue::process_request( const Request& request, bool notify ) {
+	m_lock_facility.lock_planet( *request.planet, true );
+
+	PlanetEntry* entry = nullptr;
+	uint32_t key = make_column_key( request.x, request.z );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+		PlanetEntryMap::iterator entry_iter = m_planets.find( request.planet );
+
+		// The planet might have been removed or the column generated in the
+		// meantime.
+		if( entry_iter != m_planets.end() && entry_iter->second->generated_columns.find( key ) == entry_iter->second->generated_columns.end() ) {
+			entry = entry_iter->second;
+		}
+	}
+
+	if( entry == nullptr ) {
+		m_lock_facility.lock_planet( *request.planet, false );
+		return false;
+	}
+
+	// The entry can't be removed while the planet is locked.
+	const Chunk::Vector& chunk_size = request.planet->get_chunk_size();
+
+	entry->generator.generate(
+		*request.planet,
+		Planet::BlockCuboid(
+			static_cast<uint32_t>( request.x ) * chunk_size.x,
+			0,
+			static_cast<uint32_t>( request.z ) * chunk_size.z,
+			chunk_size.x,
+			static_cast<uint32_t>( request.planet->get_size().y ) * chunk_size.y,
+			chunk_size.z
+		)
+	);
+
+	Handler* handler = nullptr;
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		entry->generated_columns.insert( key );
+		handler = m_handler;
+	}
+
+	m_lock_facility.lock_planet( *request.planet, false );
+
+	if( notify && handler != nullptr ) {
+		handler->handle_generated_column( *request.planet, request.x, request.z );
+	}
+
+	return true;
+}
+
+void GeneratorQueue::start() {
+	assert( !is_running() );
+
+	m_stop = false;
+	m_thread = boost::thread( &GeneratorQueue::run, this );
+}
+
+void GeneratorQueue::stop() {
+	assert( is_running() );
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+		m_stop = true;
+		m_condition.notify_one();
+	}
+
+	m_thread.join();
+}
+
+bool GeneratorQueue::is_running() const {
+	return m_thread.joinable();
+}
+
+std::size_t GeneratorQueue::process_queue() {
+	assert( !is_running() );
+
+	std::size_t num_generated = 0;
+
+	while( true ) {
+		Request request;
+
+		{
+			boost::lock_guard<boost::mutex> lock( m_internal_lock );
+
+			if( m_requests.empty() ) {
+				break;
+			}
+
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		if( process_request( request, true ) ) {
+			++num_generated;
+		}
+	}
+
+	return num_generated;
+}
+
+void GeneratorQueue::run() {
+	while( true ) {
+		Request request;
+
+		{
+			boost::unique_lock<boost::mutex> lock( m_internal_lock );
+
+			while( !m_stop && m_requests.empty() ) {
+				m_condition.wait( lock );
+			}
+
+			if( m_stop ) {
+				break;
+			}
+
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		process_request( request, true );
+	}
+}
+
+}
@@ -0,0 +1,289 @@
+#include <FlexWorld/HeightmapGenerator.hpp>
+
+#if defined( __AVX__ )
+	#include <immintrin.h>
+	#define FW_HEIGHTMAP_BATCHES
+#elif defined( __SSE2__ )
+	#include <emmintrin.h>
+	#define FW_HEIGHTMAP_BATCHES
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+namespace fw {
+
+static const double LACUNARITY = 2.0;
+static const double VALUE_SCALE = 1.4142135623730951; // 2D gradient noise is within +-sqrt(0.5).
+
+// Unit gradients, picked by hashing the lattice position.
+static const double GRADIENTS[8][2] = {
+	{ 1.0, 0.0 },
+	{ -1.0, 0.0 },
+	{ 0.0, 1.0 },
+	{ 0.0, -1.0 },
+	{ 0.7071067811865476, 0.7071067811865476 },
+	{ -0.7071067811865476, 0.7071067811865476 },
+	{ 0.7071067811865476, -0.7071067811865476 },
+	{ -0.7071067811865476, -0.7071067811865476 }
+};
+
+namespace {
+
+// Gradients at the corners of a noise cell, and the Z parts of their dot
+// products (same for all samples of a row).
+struct Cell {
+	double x00;
+	double x10;
+	double x01;
+	double x11;
+	double z00;
+	double z10;
+	double z01;
+	double z11;
+};
+
+}
+
+static const double* get_gradient( int32_t x, int32_t z, int32_t seed ) {
+	uint32_t n = static_cast<uint32_t>( x ) * 1619u + static_cast<uint32_t>( z ) * 6971u + static_cast<uint32_t>( seed ) * 1013u;
+
+	n = (n >> 13) ^ n;
+	n = n * (n * n * 60493u + 19990303u) + 1376312589u;
+
+	return GRADIENTS[(n >> 8) & 7];
+}
+
+static inline double fade( double t ) {
+	return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+}
+
+static Cell prepare_cell( double cell_x, double cell_z, double fz, int32_t seed ) {
+	int32_t x = static_cast<int32_t>( cell_x );
+	int32_t z = static_cast<int32_t>( cell_z );
+	const double* g00 = get_gradient( x, z, seed );
+	const double* g10 = get_gradient( x + 1, z, seed );
+	const double* g01 = get_gradient( x, z + 1, seed );
+	const double* g11 = get_gradient( x + 1, z + 1, seed );
+	Cell cell = {
+		g00[0], g10[0], g01[0], g11[0],
+		g00[1] * fz, g10[1] * fz, g01[1] * (fz - 1.0), g11[1] * (fz - 1.0)
+	};
+
+	return cell;
+}
+
+static inline double interpolate( const Cell& cell, double fx, double w ) {
+	double u = fade( fx );
+	double n00 = cell.x00 * fx + cell.z00;
+	double n10 = cell.x10 * (fx - 1.0) + cell.z10;
+	double n01 = cell.x01 * fx + cell.z01;
+	double n11 = cell.x11 * (fx - 1.0) + cell.z11;
+	double nx0 = n00 + u * (n10 - n00);
+	double nx1 = n01 + u * (n11 - n01);
+
+	return nx0 + w * (nx1 - nx0);
+}
+
+#if defined( FW_HEIGHTMAP_BATCHES )
+
+#if defined( __AVX__ )
+	typedef __m256d Batch;
+	static const unsigned int BATCH_WIDTH = 4;
+
+	static inline Batch batch_set( double value ) { return _mm256_set1_pd( value ); }
+	static inline Batch batch_offsets() { return _mm256_set_pd( 3.0, 2.0, 1.0, 0.0 ); }
+	static inline Batch batch_load( const double* values ) { return _mm256_loadu_pd( values ); }
+	static inline void batch_store( double* values, Batch batch ) { _mm256_storeu_pd( values, batch ); }
+	static inline Batch batch_add( Batch first, Batch second ) { return _mm256_add_pd( first, second ); }
+	static inline Batch batch_sub( Batch first, Batch second ) { return _mm256_sub_pd( first, second ); }
+	static inline Batch batch_mul( Batch first, Batch second ) { return _mm256_mul_pd( first, second ); }
+#else
+	typedef __m128d Batch;
+	static const unsigned int BATCH_WIDTH = 2;
+
+	static inline Batch batch_set( double value ) { return _mm_set1_pd( value ); }
+	static inline Batch batch_offsets() { return _mm_set_pd( 1.0, 0.0 ); }
+	static inline Batch batch_load( const double* values ) { return _mm_loadu_pd( values ); }
+	static inline void batch_store( double* values, Batch batch ) { _mm_storeu_pd( values, batch ); }
+	static inline Batch batch_add( Batch first, Batch second ) { return _mm_add_pd( first, second ); }
+	static inline Batch batch_sub( Batch first, Batch second ) { return _mm_sub_pd( first, second ); }
+	static inline Batch batch_mul( Batch first, Batch second ) { return _mm_mul_pd( first, second ); }
+#endif
+
+#else
+	static const unsigned int BATCH_WIDTH = 1;
+#endif
+
+// Add the values of a run of samples inside the same cell. Same arithmetic as
+// interpolate(), so results only differ by rounding if the compiler fuses
+// operations differently.
+static void add_run( const Cell& cell, int32_t x, uint32_t num_samples, double frequency, double cell_x, double w, double amplitude, double* values ) {
+	uint32_t sample_idx = 0;
+
+#if defined( FW_HEIGHTMAP_BATCHES )
+	const Batch one = batch_set( 1.0 );
+	const Batch six = batch_set( 6.0 );
+	const Batch fifteen = batch_set( 15.0 );
+	const Batch ten = batch_set( 10.0 );
+	const Batch batch_frequency = batch_set( frequency );
+	const Batch batch_cell_x = batch_set( cell_x );
+	const Batch batch_w = batch_set( w );
+	const Batch batch_amplitude = batch_set( amplitude );
+	const Batch x00 = batch_set( cell.x00 );
+	const Batch x10 = batch_set( cell.x10 );
+	const Batch x01 = batch_set( cell.x01 );
+	const Batch x11 = batch_set( cell.x11 );
+	const Batch z00 = batch_set( cell.z00 );
+	const Batch z10 = batch_set( cell.z10 );
+	const Batch z01 = batch_set( cell.z01 );
+	const Batch z11 = batch_set( cell.z11 );
+	const Batch offsets = batch_offsets();
+
+	for( ; sample_idx + BATCH_WIDTH <= num_samples; sample_idx += BATCH_WIDTH ) {
+		Batch positions = batch_add( batch_set( static_cast<double>( x + static_cast<int32_t>( sample_idx ) ) ), offsets );
+		Batch fx = batch_sub( batch_mul( positions, batch_frequency ), batch_cell_x );
+		Batch fx1 = batch_sub( fx, one );
+		Batch u = batch_mul(
+			batch_mul( batch_mul( fx, fx ), fx ),
+			batch_add( batch_mul( fx, batch_sub( batch_mul( fx, six ), fifteen ) ), ten )
+		);
+		Batch n00 = batch_add( batch_mul( x00, fx ), z00 );
+		Batch n10 = batch_add( batch_mul( x10, fx1 ), z10 );
+		Batch n01 = batch_add( batch_mul( x01, fx ), z01 );
+		Batch n11 = batch_add( batch_mul( x11, fx1 ), z11 );
+		Batch nx0 = batch_add( n00, batch_mul( u, batch_sub( n10, n00 ) ) );
+		Batch nx1 = batch_add( n01, batch_mul( u, batch_sub( n11, n01 ) ) );
+		Batch signal = batch_add( nx0, batch_mul( batch_w, batch_sub( nx1, nx0 ) ) );
+
+		batch_store( values + sample_idx, batch_add( batch_load( values + sample_idx ), batch_mul( signal, batch_amplitude ) ) );
+	}
+#endif
+
+	for( ; sample_idx < num_samples; ++sample_idx ) {
+		double fx = static_cast<double>( x + static_cast<int32_t>( sample_idx ) ) * frequency - cell_x;
+		values[sample_idx] += interpolate( cell, fx, w ) * amplitude;
+	}
+}
+
+// Find the end of the run of samples starting at begin that are inside the
+// same cell.
+static uint32_t find_run_end( int32_t x, uint32_t begin, uint32_t width, double frequency, double cell_x ) {
+	double estimate = std::ceil( (cell_x + 1.0) / frequency ) - static_cast<double>( x );
+	uint32_t end = static_cast<uint32_t>( std::max( static_cast<double>( begin + 1 ), std::min( estimate, static_cast<double>( width ) ) ) );
+
+	// Correct rounding errors of the estimate.
+	while( end > begin + 1 && std::floor( static_cast<double>( x + static_cast<int32_t>( end - 1 ) ) * frequency ) > cell_x ) {
+		--end;
+	}
+
+	while( end < width && std::floor( static_cast<double>( x + static_cast<int32_t>( end ) ) * frequency ) == cell_x ) {
+		++end;
+	}
+
+	return end;
+}
+
+HeightmapGenerator::HeightmapGenerator() :
+	m_seed( 0 ),
+	m_num_octaves( 6 ),
+	m_persistence( 0.5 ),
+	m_frequency( 1.0 )
+{
+}
+
+int HeightmapGenerator::get_seed() const {
+	return m_seed;
+}
+
+void HeightmapGenerator::set_seed( int seed ) {
+	m_seed = seed;
+}
+
+unsigned int HeightmapGenerator::get_num_octaves() const {
+	return m_num_octaves;
+}
+
+void HeightmapGenerator::set_num_octaves( unsigned int num_octaves ) {
+	assert( num_octaves > 0 );
+	m_num_octaves = num_octaves;
+}
+
+double HeightmapGenerator::get_persistence() const {
+	return m_persistence;
+}
+
+void HeightmapGenerator::set_persistence( double persistence ) {
+	m_persistence = persistence;
+}
+
+double HeightmapGenerator::get_frequency() const {
+	return m_frequency;
+}
+
+void HeightmapGenerator::set_frequency( double frequency ) {
+	assert( frequency > 0.0 );
+	m_frequency = frequency;
+}
+
+unsigned int HeightmapGenerator::get_batch_width() {
+	return BATCH_WIDTH;
+}
+
+double HeightmapGenerator::get_value( double x, double z ) const {
+	double frequency = m_frequency;
+	double amplitude = VALUE_SCALE;
+	double value = 0.0;
+
+	for( unsigned int octave = 0; octave < m_num_octaves; ++octave ) {
+		double xf = x * frequency;
+		double zf = z * frequency;
+		double cell_x = std::floor( xf );
+		double cell_z = std::floor( zf );
+		double fz = zf - cell_z;
+		Cell cell = prepare_cell( cell_x, cell_z, fz, m_seed + static_cast<int>( octave ) );
+
+		value += interpolate( cell, xf - cell_x, fade( fz ) ) * amplitude;
+
+		frequency *= LACUNARITY;
+		amplitude *= m_persistence;
+	}
+
+	return value;
+}
+
+void HeightmapGenerator::generate( int32_t x, int32_t z, uint32_t width, uint32_t depth, double* values ) const {
+	std::fill( values, values + static_cast<std::size_t>( width ) * depth, 0.0 );
+
+	double frequency = m_frequency;
+	double amplitude = VALUE_SCALE;
+
+	for( unsigned int octave = 0; octave < m_num_octaves; ++octave ) {
+		int32_t seed = m_seed + static_cast<int32_t>( octave );
+
+		for( uint32_t row = 0; row < depth; ++row ) {
+			double zf = static_cast<double>( z + static_cast<int32_t>( row ) ) * frequency;
+			double cell_z = std::floor( zf );
+			double fz = zf - cell_z;
+			double w = fade( fz );
+			double* row_values = values + static_cast<std::size_t>( row ) * width;
+			uint32_t begin = 0;
+
+			// Gradients are looked up once per cell, samples are batched.
+			while( begin < width ) {
+				double cell_x = std::floor( static_cast<double>( x + static_cast<int32_t>( begin ) ) * frequency );
+				uint32_t end = find_run_end( x, begin, width, frequency, cell_x );
+				Cell cell = prepare_cell( cell_x, cell_z, fz, seed );
+
+				add_run( cell, x + static_cast<int32_t>( begin ), end - begin, frequency, cell_x, w, amplitude, row_values + begin );
+				begin = end;
+			}
+		}
+
+		frequency *= LACUNARITY;
+		amplitude *= m_persistence;
+	}
+}
+
+}
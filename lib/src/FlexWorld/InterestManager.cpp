@@ -0,0 +1,154 @@
+#include <FlexWorld/InterestManager.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace fw {
+
+const Planet::ScalarType InterestManager::DEFAULT_CELL_SIZE = 8;
+
+// Cell coordinates are chunk coordinates divided by the cell size, so they fit
+// into 16 bits each.
+static uint64_t make_cell_key( uint32_t x, uint32_t y, uint32_t z ) {
+	return static_cast<uint64_t>( x ) | static_cast<uint64_t>( y ) << 16 | static_cast<uint64_t>( z ) << 32;
+}
+
+InterestManager::InterestManager( Planet::ScalarType cell_size ) :
+	m_num_interests( 0 ),
+	m_cell_size( cell_size )
+{
+	assert( cell_size > 0 );
+}
+
+Planet::ScalarType InterestManager::get_cell_size() const {
+	return m_cell_size;
+}
+
+std::size_t InterestManager::get_num_interests() const {
+	return m_num_interests;
+}
+
+void InterestManager::set_interest( ConnectionID conn_id, const Planet& planet, const ChunkCuboid& view ) {
+	remove_interest( conn_id );
+
+	if( view.width == 0 || view.height == 0 || view.depth == 0 ) {
+		return;
+	}
+
+	if( conn_id >= m_interests.size() ) {
+		Interest none;
+		none.planet = nullptr;
+
+		m_interests.resize( conn_id + 1, none );
+	}
+
+	Interest& interest = m_interests[conn_id];
+
+	interest.planet = &planet;
+	interest.view = view;
+	++m_num_interests;
+
+	update_cells( conn_id, interest, true );
+}
+
+void InterestManager::remove_interest( ConnectionID conn_id ) {
+	if( conn_id >= m_interests.size() || m_interests[conn_id].planet == nullptr ) {
+		return;
+	}
+
+	update_cells( conn_id, m_interests[conn_id], false );
+
+	m_interests[conn_id].planet = nullptr;
+	--m_num_interests;
+}
+
+const Planet* InterestManager::find_planet( ConnectionID conn_id ) const {
+	return conn_id < m_interests.size() ? m_interests[conn_id].planet : nullptr;
+}
+
+const InterestManager::ChunkCuboid& InterestManager::get_view( ConnectionID conn_id ) const {
+	assert( find_planet( conn_id ) != nullptr );
+	return m_interests[conn_id].view;
+}
+
+void InterestManager::update_cells( ConnectionID conn_id, const Interest& interest, bool add ) {
+	CellMap& cells = m_cells[interest.planet];
+	const ChunkCuboid& view = interest.view;
+
+	uint32_t first_x = view.x / m_cell_size;
+	uint32_t first_y = view.y / m_cell_size;
+	uint32_t first_z = view.z / m_cell_size;
+	uint32_t last_x = (static_cast<uint32_t>( view.x ) + view.width - 1) / m_cell_size;
+	uint32_t last_y = (static_cast<uint32_t>( view.y ) + view.height - 1) / m_cell_size;
+	uint32_t last_z = (static_cast<uint32_t>( view.z ) + view.depth - 1) / m_cell_size;
+
+	for( uint32_t z = first_z; z <= last_z; ++z ) {
+		for( uint32_t y = first_y; y <= last_y; ++y ) {
+			for( uint32_t x = first_x; x <= last_x; ++x ) {
+				uint64_t key = make_cell_key( x, y, z );
+
+				if( add ) {
+					cells[key].push_back( conn_id );
+					continue;
+				}
+
+				CellMap::iterator cell_iter = cells.find( key );
+				assert( cell_iter != cells.end() );
+
+				ConnectionIDArray& connections = cell_iter->second;
+				ConnectionIDArray::iterator conn_iter = std::find( connections.begin(), connections.end(), conn_id );
+				assert( conn_iter != connections.end() );
+
+				*conn_iter = connections.back();
+				connections.pop_back();
+
+				if( connections.empty() ) {
+					cells.erase( cell_iter );
+				}
+			}
+		}
+	}
+
+	if( cells.empty() ) {
+		m_cells.erase( interest.planet );
+	}
+}
+
+void InterestManager::find_interested( const Planet& planet, const Planet::Vector& chunk_position, ConnectionIDArray& connections ) const {
+	connections.clear();
+
+	PlanetCellMap::const_iterator planet_iter = m_cells.find( &planet );
+
+	if( planet_iter == m_cells.end() ) {
+		return;
+	}
+
+	CellMap::const_iterator cell_iter = planet_iter->second.find(
+		make_cell_key(
+			chunk_position.x / m_cell_size,
+			chunk_position.y / m_cell_size,
+			chunk_position.z / m_cell_size
+		)
+	);
+
+	if( cell_iter == planet_iter->second.end() ) {
+		return;
+	}
+
+	const ConnectionIDArray& candidates = cell_iter->second;
+
+	// The cell only tells that views overlap it, check the chunk itself.
+	for( std::size_t candidate_idx = 0; candidate_idx < candidates.size(); ++candidate_idx ) {
+		const ChunkCuboid& view = m_interests[candidates[candidate_idx]].view;
+
+		if(
+			chunk_position.x >= view.x && chunk_position.x - view.x < view.width &&
+			chunk_position.y >= view.y && chunk_position.y - view.y < view.height &&
+			chunk_position.z >= view.z && chunk_position.z - view.z < view.depth
+		) {
+			connections.push_back( candidates[candidate_idx] );
+		}
+	}
+}
+
+}
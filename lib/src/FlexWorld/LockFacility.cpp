@@ -34,6 +34,20 @@ LockFacility::~LockFacility() {
 
 }
 
+void LockFacility::lock_script_manager( bool do_lock ) {
+	if( do_lock ) {
+		m_script_manager_lock.lock();
+	}
+	else {
+		assert( m_script_manager_lock.get_usage_count() > 0 );
+		m_script_manager_lock.unlock();
+	}
+}
+
+bool LockFacility::is_script_manager_locked() const {
+	return m_script_manager_lock.get_usage_count() > 0;
+}
+
 void LockFacility::lock_account_manager( bool do_lock ) {
 	if( do_lock ) {
 		m_account_manager_lock.lock();
@@ -62,6 +76,20 @@ bool LockFacility::is_world_locked() const {
 	return m_world_lock.get_usage_count() > 0;
 }
 
+void LockFacility::lock_player_list( bool do_lock ) {
+	if( do_lock ) {
+		m_player_list_lock.lock();
+	}
+	else {
+		assert( m_player_list_lock.get_usage_count() > 0 );
+		m_player_list_lock.unlock();
+	}
+}
+
+bool LockFacility::is_player_list_locked() const {
+	return m_player_list_lock.get_usage_count() > 0;
+}
+
 void LockFacility::lock_planet( const Planet& planet, bool do_lock ) {
 	RefLock* ref_lock = nullptr;
 
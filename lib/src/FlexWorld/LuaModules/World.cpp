@@ -15,6 +15,7 @@ DILUCULUM_BEGIN_CLASS( World )
 	DILUCULUM_CLASS_METHOD( World, destroy_block )
 	DILUCULUM_CLASS_METHOD( World, get_entity_class_id )
 	DILUCULUM_CLASS_METHOD( World, get_entity_position )
+	DILUCULUM_CLASS_METHOD( World, get_surface_height )
 	DILUCULUM_CLASS_METHOD( World, set_block )
 DILUCULUM_END_CLASS( World )
 
@@ -154,6 +155,50 @@ Diluculum::LuaValueList World::set_block( const Diluculum::LuaValueList& args )
 	return Diluculum::LuaValueList();
 }
 
+Diluculum::LuaValueList World::get_surface_height( const Diluculum::LuaValueList& args ) {
+	if( args.size() != 2 ) {
+		throw Diluculum::LuaError( "Wrong number of arguments." );
+	}
+
+	if( args[0].type() != LUA_TTABLE ) {
+		throw Diluculum::LuaError( "Expected table for position." );
+	}
+	else if( args[1].type() != LUA_TSTRING ) {
+		throw Diluculum::LuaError( "Expected string for planet." );
+	}
+
+	Diluculum::LuaValueMap position_table = args[0].asTable();
+
+	if( position_table.size() != 2 ) {
+		throw Diluculum::LuaError( "Wrong number of elements in position table." );
+	}
+	else if( position_table[1].type() != LUA_TNUMBER ) {
+		throw Diluculum::LuaError( "Expected number for x position." );
+	}
+	else if( position_table[2].type() != LUA_TNUMBER ) {
+		throw Diluculum::LuaError( "Expected number for z position." );
+	}
+
+	uint32_t x = static_cast<uint32_t>( position_table[1].asNumber() );
+	uint32_t z = static_cast<uint32_t>( position_table[2].asNumber() );
+	std::string planet = args[1].asString();
+
+	if( planet.empty() ) {
+		throw Diluculum::LuaError( "Invalid planet." );
+	}
+
+	Diluculum::LuaValueList ret;
+
+	try {
+		ret.push_back( m_gate->get_surface_height( x, z, planet ) );
+	}
+	catch( const std::runtime_error& e ) {
+		throw Diluculum::LuaError( e.what() );
+	}
+
+	return ret;
+}
+
 Diluculum::LuaValueList World::create_entity( const Diluculum::LuaValueList& args ) {
 	enum FunctionSignature {
 		INVALID_SIGNATURE = 0,
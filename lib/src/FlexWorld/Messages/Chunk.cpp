@@ -1,7 +1,7 @@
 #include <FlexWorld/Messages/Chunk.hpp>
 
 #include <algorithm>
-#include <cstring>
+#include <limits>
 #include <cassert>
 
 namespace fw {
@@ -83,8 +83,8 @@ std::size_t Chunk::deserialize( const char* buffer, std::size_t buffer_size ) {
 		blocks[block_idx] = *reinterpret_cast<const fw::Chunk::Block*>( &buffer[buf_ptr] );
 		buf_ptr += sizeof( fw::Chunk::Block );
 
-		// Check for valid ID.
-		if( blocks[block_idx] > fw::Chunk::MAX_BLOCK_ID ) {
+		// Check for valid ID (unset blocks are allowed).
+		if( blocks[block_idx] > fw::Chunk::MAX_BLOCK_ID && blocks[block_idx] != fw::Chunk::INVALID_BLOCK ) {
 			throw BogusDataException( "Invalid block." );
 		}
 	}
@@ -114,13 +114,17 @@ fw::Chunk::Block Chunk::get_block( std::size_t index ) const {
 }
 
 void Chunk::set_blocks( const fw::Chunk& chunk ) {
-	m_blocks.resize( chunk.get_size().x * chunk.get_size().y * chunk.get_size().z );
+	if( chunk.is_uniform() ) {
+		m_blocks.assign( 1, chunk.is_empty() ? fw::Chunk::INVALID_BLOCK : chunk.get_uniform_block() );
+		return;
+	}
 
-	std::memcpy(
-		reinterpret_cast<char*>( &m_blocks[0] ),
-		reinterpret_cast<const char*>( chunk.get_raw_data() ),
-		sizeof( fw::Chunk::Block ) * m_blocks.size()
-	);
+	m_blocks.resize( chunk.get_num_blocks() );
+	chunk.get_raw_data( &m_blocks[0] );
+}
+
+bool Chunk::is_uniform() const {
+	return m_blocks.size() == 1;
 }
 
 }
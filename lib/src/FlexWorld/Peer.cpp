@@ -4,7 +4,8 @@ namespace fw {
 
 Peer::Peer() :
 	ip( "" ),
-	id( 0 )
+	id( 0 ),
+	write_scheduled( false )
 {
 }
 
@@ -1,42 +1,200 @@
 #include <FlexWorld/Planet.hpp>
+#include <FlexWorld/PlanetImage.hpp>
 #include <FlexWorld/Class.hpp>
 
 #include <algorithm>
+#include <limits>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 
-namespace std {
-	bool operator<( const fw::Planet::Vector& first, const fw::Planet::Vector& second ) {
-		if( first.z < second.z ) {
-			return true;
+namespace fw {
+
+namespace {
+
+// Counts blocks per class ID, so that references can be updated once per ID.
+class BlockTally {
+	public:
+		void add( Chunk::Block id, uint32_t num_blocks ) {
+			if( id >= m_counts.size() ) {
+				m_counts.resize( id + 1, 0 );
+			}
+
+			if( m_counts[id] == 0 ) {
+				m_ids.push_back( id );
+			}
+
+			m_counts[id] += num_blocks;
 		}
-		else if( first.z > second.z ) {
-			return false;
+
+		std::size_t get_num_ids() const {
+			return m_ids.size();
 		}
 
-		if( first.y < second.y ) {
-			return true;
+		Chunk::Block get_id( std::size_t index ) const {
+			return m_ids[index];
 		}
-		else if( first.y > second.y ) {
-			return false;
+
+		uint32_t get_count( Chunk::Block id ) const {
+			return m_counts[id];
 		}
 
-		if( first.x < second.x ) {
-			return true;
+		std::size_t get_max_id() const {
+			return m_counts.size();
 		}
 
-		return false;
+		void release_all( ClassCache& class_cache ) {
+			for( std::size_t id_idx = 0; id_idx < m_ids.size(); ++id_idx ) {
+				class_cache.release_refs( m_ids[id_idx], m_counts[m_ids[id_idx]] );
+				m_counts[m_ids[id_idx]] = 0;
+			}
+
+			m_ids.clear();
+		}
+
+	private:
+		std::vector<uint32_t> m_counts;
+		std::vector<Chunk::Block> m_ids;
+};
+
+}
+
+static bool is_region_empty( const Planet::BlockCuboid& cuboid ) {
+	return cuboid.width == 0 || cuboid.height == 0 || cuboid.depth == 0;
+}
+
+static void get_chunk_range( const Planet::BlockCuboid& cuboid, const Chunk::Vector& chunk_size, Planet::Vector& first, Planet::Vector& last ) {
+	first.x = static_cast<Planet::ScalarType>( cuboid.x / chunk_size.x );
+	first.y = static_cast<Planet::ScalarType>( cuboid.y / chunk_size.y );
+	first.z = static_cast<Planet::ScalarType>( cuboid.z / chunk_size.z );
+	last.x = static_cast<Planet::ScalarType>( (cuboid.x + cuboid.width - 1) / chunk_size.x );
+	last.y = static_cast<Planet::ScalarType>( (cuboid.y + cuboid.height - 1) / chunk_size.y );
+	last.z = static_cast<Planet::ScalarType>( (cuboid.z + cuboid.depth - 1) / chunk_size.z );
+}
+
+static Chunk::ScalarType clamp_to_chunk( uint32_t value, uint32_t origin, Chunk::ScalarType size ) {
+	return static_cast<Chunk::ScalarType>( std::min( std::max( value, origin ) - origin, static_cast<uint32_t>( size ) ) );
+}
+
+// Get the part of a chunk overlapped by a cuboid (max is exclusive).
+static void get_local_region(
+	const Planet::BlockCuboid& cuboid,
+	const Chunk::Vector& chunk_size,
+	const Planet::Vector& chunk_pos,
+	Chunk::Vector& min,
+	Chunk::Vector& max
+) {
+	uint32_t origin_x = static_cast<uint32_t>( chunk_pos.x ) * chunk_size.x;
+	uint32_t origin_y = static_cast<uint32_t>( chunk_pos.y ) * chunk_size.y;
+	uint32_t origin_z = static_cast<uint32_t>( chunk_pos.z ) * chunk_size.z;
+
+	min.x = clamp_to_chunk( cuboid.x, origin_x, chunk_size.x );
+	min.y = clamp_to_chunk( cuboid.y, origin_y, chunk_size.y );
+	min.z = clamp_to_chunk( cuboid.z, origin_z, chunk_size.z );
+	max.x = clamp_to_chunk( cuboid.x + cuboid.width, origin_x, chunk_size.x );
+	max.y = clamp_to_chunk( cuboid.y + cuboid.height, origin_y, chunk_size.y );
+	max.z = clamp_to_chunk( cuboid.z + cuboid.depth, origin_z, chunk_size.z );
+}
+
+static bool covers_chunk( const Chunk::Vector& min, const Chunk::Vector& max, const Chunk::Vector& chunk_size ) {
+	return min.x == 0 && min.y == 0 && min.z == 0 && max == chunk_size;
+}
+
+static uint32_t get_volume( const Chunk::Vector& min, const Chunk::Vector& max ) {
+	return static_cast<uint32_t>( max.x - min.x ) * static_cast<uint32_t>( max.y - min.y ) * static_cast<uint32_t>( max.z - min.z );
+}
+
+// Count the set blocks of a chunk's region. Runs of equal blocks are counted
+// at once.
+static void tally_region(
+	const Chunk& chunk,
+	const Chunk::Vector& min,
+	const Chunk::Vector& max,
+	std::vector<Chunk::Block>& raw_data,
+	BlockTally& tally
+) {
+	if( chunk.is_uniform() ) {
+		if( !chunk.is_empty() ) {
+			tally.add( chunk.get_uniform_block(), get_volume( min, max ) );
+		}
+
+		return;
+	}
+
+	chunk.get_raw_data( &raw_data[0] );
+
+	const Chunk::Vector& size = chunk.get_size();
+	Chunk::Block run_id = Chunk::INVALID_BLOCK;
+	uint32_t run_length = 0;
+
+	for( std::size_t z = min.z; z < max.z; ++z ) {
+		for( std::size_t y = min.y; y < max.y; ++y ) {
+			const Chunk::Block* row = &raw_data[(z * size.y + y) * size.x];
+
+			for( std::size_t x = min.x; x < max.x; ++x ) {
+				if( row[x] != run_id ) {
+					if( run_id != Chunk::INVALID_BLOCK ) {
+						tally.add( run_id, run_length );
+					}
+
+					run_id = row[x];
+					run_length = 0;
+				}
+
+				++run_length;
+			}
+		}
+	}
+
+	if( run_id != Chunk::INVALID_BLOCK ) {
+		tally.add( run_id, run_length );
 	}
 }
 
-namespace fw {
+// Find the axis whose boundary the ray reaches first. Boundaries are given
+// per axis.
+static std::size_t find_nearest_boundary( const float* origin, const float* direction, const uint32_t* boundaries, float& distance ) {
+	std::size_t nearest_axis = 0;
+
+	distance = std::numeric_limits<float>::infinity();
+
+	for( std::size_t axis = 0; axis < 3; ++axis ) {
+		if( direction[axis] == 0.0f ) {
+			continue;
+		}
+
+		float axis_distance = (static_cast<float>( boundaries[axis] ) - origin[axis]) / direction[axis];
+
+		if( axis_distance < distance ) {
+			distance = axis_distance;
+			nearest_axis = axis;
+		}
+	}
+
+	return nearest_axis;
+}
+
+static uint32_t clamp_to_cell( float value, uint32_t min, uint32_t max ) {
+	if( value <= static_cast<float>( min ) ) {
+		return min;
+	}
+
+	return std::min( static_cast<uint32_t>( value ), max );
+}
 
 Planet::Planet( const std::string& id, const Vector& size, const Chunk::Vector& chunk_size ) :
 	m_size( size ),
 	m_chunk_size( chunk_size ),
 	m_id( id ),
+	m_seed( 0 ),
+	m_chunks( size ),
+	m_dirty_chunks( size ),
+	m_image( nullptr ),
+	m_num_paged_chunks( 0 ),
 	m_octree( std::max( size.x, std::max( size.y, size.z ) ) * std::max( chunk_size.x, std::max( chunk_size.y, chunk_size.z ) ) )
 {
+	// Surface heights must fit into the heightmap.
+	assert( static_cast<uint32_t>( size.y ) * chunk_size.y <= 0xffff );
 }
 
 Planet::~Planet() {
@@ -44,16 +202,16 @@ Planet::~Planet() {
 }
 
 void Planet::clear() {
-	ChunkMap::iterator chunk_iter( m_chunks.begin() );
-	ChunkMap::iterator chunk_iter_end( m_chunks.end() );
-	
-	for( ; chunk_iter != chunk_iter_end; ++chunk_iter ) {
-		delete chunk_iter->second;
-	}
-
+	// Chunks live in the allocator's slabs, release them all at once.
+	m_dirty_chunks.clear();
+	m_heightmap.clear();
 	m_chunks.clear();
+	m_chunk_allocator.clear();
 	m_entities.clear();
 	m_class_cache.clear();
+
+	detach_image();
+	m_num_paged_chunks = 0;
 }
 
 const std::string& Planet::get_id() const {
@@ -68,6 +226,14 @@ const Chunk::Vector& Planet::get_chunk_size() const {
 	return m_chunk_size;
 }
 
+void Planet::set_seed( int seed ) {
+	m_seed = seed;
+}
+
+int Planet::get_seed() const {
+	return m_seed;
+}
+
 bool Planet::transform( const sf::Vector3f& coord, Vector& chunk_pos, Chunk::Vector& block_pos ) const {
 	sf::Vector3<uint32_t> i_coord(
 		static_cast<uint32_t>( coord.x ),
@@ -90,26 +256,255 @@ bool Planet::transform( const sf::Vector3f& coord, Vector& chunk_pos, Chunk::Vec
 	return true;
 }
 
+Planet::ChunkCuboid Planet::get_chunk_cuboid( const Vector& chunk_pos, ScalarType radius ) const {
+	assert( chunk_pos.x < m_size.x && chunk_pos.y < m_size.y && chunk_pos.z < m_size.z );
+
+	uint32_t size = 2u * radius + 1u;
+	ChunkCuboid cuboid;
+
+	cuboid.width = static_cast<ScalarType>( std::min<uint32_t>( size, m_size.x ) );
+	cuboid.height = static_cast<ScalarType>( std::min<uint32_t>( size, m_size.y ) );
+	cuboid.depth = static_cast<ScalarType>( std::min<uint32_t>( size, m_size.z ) );
+	cuboid.x = static_cast<ScalarType>( std::min( chunk_pos.x - std::min( chunk_pos.x, radius ), m_size.x - cuboid.width ) );
+	cuboid.y = static_cast<ScalarType>( std::min( chunk_pos.y - std::min( chunk_pos.y, radius ), m_size.y - cuboid.height ) );
+	cuboid.z = static_cast<ScalarType>( std::min( chunk_pos.z - std::min( chunk_pos.z, radius ), m_size.z - cuboid.depth ) );
+
+	return cuboid;
+}
+
+void Planet::attach_image( const PlanetImage& image, const ClassArray& classes ) {
+	assert( image.get_size() == m_size );
+	assert( image.get_chunk_size() == m_chunk_size );
+	assert( classes.size() == image.get_num_classes() );
+
+	m_image = &image;
+	m_image_classes = classes;
+	m_paged_columns.assign( static_cast<std::size_t>( m_size.x ) * m_size.z, false );
+	m_page_buffer.resize( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+}
+
+void Planet::detach_image() {
+	m_image = nullptr;
+	m_image_classes.clear();
+	m_paged_columns.clear();
+	m_page_buffer.clear();
+}
+
+const PlanetImage* Planet::get_image() const {
+	return m_image;
+}
+
+std::size_t Planet::get_num_paged_chunks() const {
+	return m_num_paged_chunks;
+}
+
+Chunk* Planet::find_or_page_chunk( const Vector& position ) const {
+	Chunk* chunk( m_chunks.find( position ) );
+
+	if( chunk == nullptr && m_image != nullptr ) {
+		// Paging in doesn't change the planet's contents as seen from outside.
+		chunk = const_cast<Planet*>( this )->page_chunk( position );
+	}
+
+	return chunk;
+}
+
+Chunk* Planet::page_chunk( const Vector& position ) {
+	Chunk::Revision revision = 0;
+
+	if( !m_image->read_chunk( position, &m_page_buffer[0], revision ) ) {
+		return nullptr;
+	}
+
+	Chunk& chunk = store_chunk_blocks( position, &m_page_buffer[0], m_image_classes );
+
+	chunk.set_revision( revision );
+	++m_num_paged_chunks;
+
+	return &chunk;
+}
+
+void Planet::page_column( ScalarType x, ScalarType z ) {
+	std::size_t column_idx = static_cast<std::size_t>( z ) * m_size.x + x;
+
+	if( m_paged_columns[column_idx] ) {
+		return;
+	}
+
+	m_paged_columns[column_idx] = true;
+
+	// Surface heights depend on all chunks of the column.
+	for( Vector position( x, m_size.y, z ); position.y > 0; ) {
+		--position.y;
+
+		if( m_chunks.find( position ) == nullptr ) {
+			page_chunk( position );
+		}
+	}
+}
+
 bool Planet::has_chunk( const Vector& position ) const {
 	assert( position.x < m_size.x );
 	assert( position.y < m_size.y );
 	assert( position.z < m_size.z );
 
-	ChunkMap::const_iterator iter( m_chunks.find( position ) );
-	return iter != m_chunks.end();
+	return find_or_page_chunk( position ) != nullptr;
 }
 
 void Planet::create_chunk( const Vector& pos ) {
 	assert( pos.x < m_size.x );
 	assert( pos.y < m_size.y );
 	assert( pos.z < m_size.z );
-	assert( m_chunks.find( pos ) == m_chunks.end() ); // TODO: Turn this into an exception?
+	assert( m_chunks.find( pos ) == nullptr ); // TODO: Turn this into an exception?
 
-	m_chunks[pos] = new Chunk( m_chunk_size );
+	Chunk& chunk = m_chunk_allocator.create_chunk( m_chunk_size );
+
+	m_chunks.insert( pos, chunk );
+	mark_chunk_dirty( pos, chunk );
 }
 
 std::size_t Planet::get_num_chunks() const {
-	return m_chunks.size();
+	return m_chunks.get_num_chunks();
+}
+
+std::size_t Planet::get_num_uniform_chunks() const {
+	std::size_t num_uniform = 0;
+
+	for( std::size_t chunk_idx = 0; chunk_idx < m_chunks.get_num_chunks(); ++chunk_idx ) {
+		if( m_chunks.get_chunk( chunk_idx ).is_uniform() ) {
+			++num_uniform;
+		}
+	}
+
+	return num_uniform;
+}
+
+const Chunk* Planet::find_chunk( const Vector& position ) const {
+	assert( position.x < m_size.x );
+	assert( position.y < m_size.y );
+	assert( position.z < m_size.z );
+
+	return find_or_page_chunk( position );
+}
+
+std::size_t Planet::get_num_dirty_chunks() const {
+	return m_dirty_chunks.get_num_chunks();
+}
+
+bool Planet::is_chunk_dirty( const Vector& position ) const {
+	assert( position.x < m_size.x );
+	assert( position.y < m_size.y );
+	assert( position.z < m_size.z );
+
+	return m_dirty_chunks.find( position ) != nullptr;
+}
+
+void Planet::drain_dirty_chunks( ChunkPositionArray& positions ) {
+	for( std::size_t chunk_idx = 0; chunk_idx < m_dirty_chunks.get_num_chunks(); ++chunk_idx ) {
+		positions.push_back( m_dirty_chunks.get_position( chunk_idx ) );
+	}
+
+	m_dirty_chunks.clear();
+}
+
+void Planet::mark_chunk_dirty( const Vector& position, Chunk& chunk ) {
+	if( m_dirty_chunks.find( position ) == nullptr ) {
+		m_dirty_chunks.insert( position, chunk );
+	}
+}
+
+uint16_t* Planet::find_height( uint32_t x, uint32_t z ) {
+	uint32_t key = (x / m_chunk_size.x) << 16 | (z / m_chunk_size.z);
+	HeightTileMap::iterator tile_iter = m_heightmap.find( key );
+
+	if( tile_iter == m_heightmap.end() ) {
+		return nullptr;
+	}
+
+	return &tile_iter->second[(z % m_chunk_size.z) * m_chunk_size.x + (x % m_chunk_size.x)];
+}
+
+uint16_t& Planet::get_height( uint32_t x, uint32_t z ) {
+	uint32_t key = (x / m_chunk_size.x) << 16 | (z / m_chunk_size.z);
+	HeightVector& tile = m_heightmap[key];
+
+	if( tile.empty() ) {
+		tile.resize( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.z, 0 );
+	}
+
+	return tile[(z % m_chunk_size.z) * m_chunk_size.x + (x % m_chunk_size.x)];
+}
+
+void Planet::raise_surface_height( uint32_t x, uint32_t z, uint32_t height ) {
+	uint16_t& surface_height = get_height( x, z );
+
+	if( height > surface_height ) {
+		surface_height = static_cast<uint16_t>( height );
+	}
+}
+
+uint16_t Planet::scan_surface_height( uint32_t x, uint32_t z, uint32_t end_y ) const {
+	Vector chunk_pos(
+		static_cast<ScalarType>( x / m_chunk_size.x ),
+		0,
+		static_cast<ScalarType>( z / m_chunk_size.z )
+	);
+	Chunk::Vector block_pos(
+		static_cast<Chunk::ScalarType>( x % m_chunk_size.x ),
+		0,
+		static_cast<Chunk::ScalarType>( z % m_chunk_size.z )
+	);
+	uint32_t y = end_y;
+
+	// Walk down the column below end_y, skipping missing and empty chunks.
+	while( y > 0 ) {
+		chunk_pos.y = static_cast<ScalarType>( (y - 1) / m_chunk_size.y );
+
+		uint32_t origin_y = static_cast<uint32_t>( chunk_pos.y ) * m_chunk_size.y;
+		const Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+		if( chunk != nullptr && !chunk->is_empty() ) {
+			if( chunk->is_uniform() ) {
+				return static_cast<uint16_t>( y );
+			}
+
+			for( ; y > origin_y; --y ) {
+				block_pos.y = static_cast<Chunk::ScalarType>( y - 1 - origin_y );
+
+				if( chunk->is_block_set( block_pos ) ) {
+					return static_cast<uint16_t>( y );
+				}
+			}
+		}
+
+		y = origin_y;
+	}
+
+	return 0;
+}
+
+uint16_t Planet::get_surface_height( uint32_t x, uint32_t z ) const {
+	assert( x < static_cast<uint32_t>( m_size.x ) * m_chunk_size.x );
+	assert( z < static_cast<uint32_t>( m_size.z ) * m_chunk_size.z );
+
+	if( m_image != nullptr ) {
+		const_cast<Planet*>( this )->page_column(
+			static_cast<ScalarType>( x / m_chunk_size.x ),
+			static_cast<ScalarType>( z / m_chunk_size.z )
+		);
+	}
+
+	HeightTileMap::const_iterator tile_iter = m_heightmap.find( (x / m_chunk_size.x) << 16 | (z / m_chunk_size.z) );
+
+	if( tile_iter == m_heightmap.end() ) {
+		return 0;
+	}
+
+	return tile_iter->second[(z % m_chunk_size.z) * m_chunk_size.x + (x % m_chunk_size.x)];
+}
+
+ChunkDirectory::Mode Planet::get_chunk_directory_mode() const {
+	return m_chunks.get_mode();
 }
 
 void Planet::set_block( const Vector& chunk_pos, const Chunk::Vector& block_pos, const Class& cls ) {
@@ -117,19 +512,26 @@ void Planet::set_block( const Vector& chunk_pos, const Chunk::Vector& block_pos,
 	assert( block_pos.x < m_chunk_size.x && block_pos.y < m_chunk_size.y && block_pos.z < m_chunk_size.z );
 
 	// Get chunk.
-	assert( has_chunk( chunk_pos ) );
-	Chunk* chunk( m_chunks[chunk_pos] );
+	Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+	assert( chunk != nullptr );
 
 	// Cache class.
 	ClassCache::IdType internal_id( m_class_cache.cache( cls ) );
 
 	// If block was set before, forget old class.
 	if( chunk->is_block_set( block_pos ) ) {
-		m_class_cache.forget( m_class_cache.get_class( chunk->get_block( block_pos ) ) );
+		m_class_cache.release_refs( chunk->get_block( block_pos ), 1 );
 	}
 
 	// Set block.
 	chunk->set_block( block_pos, internal_id );
+	mark_chunk_dirty( chunk_pos, *chunk );
+
+	raise_surface_height(
+		static_cast<uint32_t>( chunk_pos.x ) * m_chunk_size.x + block_pos.x,
+		static_cast<uint32_t>( chunk_pos.z ) * m_chunk_size.z + block_pos.z,
+		static_cast<uint32_t>( chunk_pos.y ) * m_chunk_size.y + block_pos.y + 1
+	);
 }
 
 const Class* Planet::find_block( const Vector& chunk_pos, const Chunk::Vector& block_pos ) const {
@@ -137,15 +539,15 @@ const Class* Planet::find_block( const Vector& chunk_pos, const Chunk::Vector& b
 	assert( block_pos.x < m_chunk_size.x && block_pos.y < m_chunk_size.y && block_pos.z < m_chunk_size.z );
 
 	// Get chunk.
-	ChunkMap::const_iterator chunk_iter( m_chunks.find( chunk_pos ) );
-	assert( chunk_iter != m_chunks.end() );
+	const Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+	assert( chunk != nullptr );
 
-	if( !chunk_iter->second->is_block_set( block_pos ) ) {
+	if( !chunk->is_block_set( block_pos ) ) {
 		return nullptr;
 	}
 
 	// Get class.
-	return &m_class_cache.get_class( chunk_iter->second->get_block( block_pos ) );
+	return &m_class_cache.get_class( chunk->get_block( block_pos ) );
 }
 
 void Planet::reset_block( const Vector& chunk_pos, const Chunk::Vector& block_pos ) {
@@ -153,18 +555,741 @@ void Planet::reset_block( const Vector& chunk_pos, const Chunk::Vector& block_po
 	assert( block_pos.x < m_chunk_size.x && block_pos.y < m_chunk_size.y && block_pos.z < m_chunk_size.z );
 
 	// Get chunk.
-	assert( has_chunk( chunk_pos ) );
-	Chunk* chunk( m_chunks[chunk_pos] );
+	Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+	assert( chunk != nullptr );
 
 	if( !chunk->is_block_set( block_pos ) ) {
 		return;
 	}
 
 	// Forget class.
-	m_class_cache.forget( m_class_cache.get_class( chunk->get_block( block_pos ) ) );
+	m_class_cache.release_refs( chunk->get_block( block_pos ), 1 );
 
 	// Reset block.
 	chunk->reset_block( block_pos );
+	mark_chunk_dirty( chunk_pos, *chunk );
+
+	// Search the next block below if the topmost one was removed.
+	uint32_t x = static_cast<uint32_t>( chunk_pos.x ) * m_chunk_size.x + block_pos.x;
+	uint32_t y = static_cast<uint32_t>( chunk_pos.y ) * m_chunk_size.y + block_pos.y;
+	uint32_t z = static_cast<uint32_t>( chunk_pos.z ) * m_chunk_size.z + block_pos.z;
+
+	uint16_t* surface_height = find_height( x, z );
+	assert( surface_height != nullptr );
+
+	if( *surface_height == y + 1 ) {
+		*surface_height = scan_surface_height( x, z, y );
+	}
+}
+
+void Planet::fill_region( const BlockCuboid& cuboid, const Class& cls ) {
+	assert( cuboid.x + cuboid.width <= static_cast<uint32_t>( m_size.x ) * m_chunk_size.x );
+	assert( cuboid.y + cuboid.height <= static_cast<uint32_t>( m_size.y ) * m_chunk_size.y );
+	assert( cuboid.z + cuboid.depth <= static_cast<uint32_t>( m_size.z ) * m_chunk_size.z );
+
+	if( is_region_empty( cuboid ) ) {
+		return;
+	}
+
+	Vector first_chunk_pos( 0, 0, 0 );
+	Vector last_chunk_pos( 0, 0, 0 );
+	Vector chunk_pos( 0, 0, 0 );
+	Chunk::Vector min( 0, 0, 0 );
+	Chunk::Vector max( 0, 0, 0 );
+	Chunk::Vector block_pos( 0, 0, 0 );
+	std::vector<Chunk::Block> raw_data( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	BlockTally tally;
+
+	get_chunk_range( cuboid, m_chunk_size, first_chunk_pos, last_chunk_pos );
+
+	for( chunk_pos.z = first_chunk_pos.z; chunk_pos.z <= last_chunk_pos.z; ++chunk_pos.z ) {
+		for( chunk_pos.y = first_chunk_pos.y; chunk_pos.y <= last_chunk_pos.y; ++chunk_pos.y ) {
+			for( chunk_pos.x = first_chunk_pos.x; chunk_pos.x <= last_chunk_pos.x; ++chunk_pos.x ) {
+				Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+				if( chunk == nullptr ) {
+					create_chunk( chunk_pos );
+					chunk = m_chunks.find( chunk_pos );
+				}
+
+				get_local_region( cuboid, m_chunk_size, chunk_pos, min, max );
+
+				// Reference the class before releasing the old blocks, so that its
+				// ID stays the same if it's already used in the region.
+				ClassCache::IdType id( m_class_cache.cache( cls, get_volume( min, max ) ) );
+
+				tally_region( *chunk, min, max, raw_data, tally );
+
+				if( covers_chunk( min, max, m_chunk_size ) ) {
+					chunk->fill( id );
+				}
+				else {
+					for( block_pos.z = min.z; block_pos.z < max.z; ++block_pos.z ) {
+						for( block_pos.y = min.y; block_pos.y < max.y; ++block_pos.y ) {
+							for( block_pos.x = min.x; block_pos.x < max.x; ++block_pos.x ) {
+								chunk->set_block( block_pos, id );
+							}
+						}
+					}
+				}
+
+				tally.release_all( m_class_cache );
+				mark_chunk_dirty( chunk_pos, *chunk );
+			}
+		}
+	}
+
+	for( uint32_t z = cuboid.z; z < cuboid.z + cuboid.depth; ++z ) {
+		for( uint32_t x = cuboid.x; x < cuboid.x + cuboid.width; ++x ) {
+			raise_surface_height( x, z, cuboid.y + cuboid.height );
+		}
+	}
+}
+
+void Planet::fill_columns( const BlockCuboid& cuboid, const std::vector<uint32_t>& tops, const Class& cls ) {
+	assert( cuboid.x + cuboid.width <= static_cast<uint32_t>( m_size.x ) * m_chunk_size.x );
+	assert( cuboid.y + cuboid.height <= static_cast<uint32_t>( m_size.y ) * m_chunk_size.y );
+	assert( cuboid.z + cuboid.depth <= static_cast<uint32_t>( m_size.z ) * m_chunk_size.z );
+	assert( tops.size() == static_cast<std::size_t>( cuboid.width ) * cuboid.depth );
+
+	if( is_region_empty( cuboid ) ) {
+		return;
+	}
+
+	Vector first_chunk_pos( 0, 0, 0 );
+	Vector last_chunk_pos( 0, 0, 0 );
+	Vector chunk_pos( 0, 0, 0 );
+	Chunk::Vector min( 0, 0, 0 );
+	Chunk::Vector max( 0, 0, 0 );
+	Chunk::Vector block_pos( 0, 0, 0 );
+	std::vector<Chunk::ScalarType> local_tops( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.z );
+	std::vector<Chunk::Block> raw_data( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	BlockTally tally;
+
+	get_chunk_range( cuboid, m_chunk_size, first_chunk_pos, last_chunk_pos );
+
+	for( chunk_pos.z = first_chunk_pos.z; chunk_pos.z <= last_chunk_pos.z; ++chunk_pos.z ) {
+		for( chunk_pos.y = first_chunk_pos.y; chunk_pos.y <= last_chunk_pos.y; ++chunk_pos.y ) {
+			for( chunk_pos.x = first_chunk_pos.x; chunk_pos.x <= last_chunk_pos.x; ++chunk_pos.x ) {
+				get_local_region( cuboid, m_chunk_size, chunk_pos, min, max );
+
+				uint32_t origin_x = static_cast<uint32_t>( chunk_pos.x ) * m_chunk_size.x;
+				uint32_t origin_y = static_cast<uint32_t>( chunk_pos.y ) * m_chunk_size.y;
+				uint32_t origin_z = static_cast<uint32_t>( chunk_pos.z ) * m_chunk_size.z;
+				uint32_t num_blocks = 0;
+				bool full = true;
+
+				// Clip the columns' tops to the chunk.
+				for( block_pos.z = min.z; block_pos.z < max.z; ++block_pos.z ) {
+					for( block_pos.x = min.x; block_pos.x < max.x; ++block_pos.x ) {
+						uint32_t top = tops[(origin_z + block_pos.z - cuboid.z) * cuboid.width + (origin_x + block_pos.x - cuboid.x)];
+						Chunk::ScalarType local_top = std::max( min.y, std::min( max.y, clamp_to_chunk( top, origin_y, m_chunk_size.y ) ) );
+
+						local_tops[block_pos.z * m_chunk_size.x + block_pos.x] = local_top;
+						num_blocks += static_cast<uint32_t>( local_top - min.y );
+						full = full && local_top == max.y;
+					}
+				}
+
+				if( num_blocks == 0 ) {
+					continue;
+				}
+
+				Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+				if( chunk == nullptr ) {
+					create_chunk( chunk_pos );
+					chunk = m_chunks.find( chunk_pos );
+				}
+
+				// Reference the class before releasing the old blocks, so that its
+				// ID stays the same if it's already used in the region.
+				ClassCache::IdType id( m_class_cache.cache( cls, num_blocks ) );
+
+				if( full && covers_chunk( min, max, m_chunk_size ) ) {
+					tally_region( *chunk, min, max, raw_data, tally );
+					chunk->fill( id );
+				}
+				else {
+					// Count the overwritten blocks.
+					bool uniform = chunk->is_uniform();
+
+					if( uniform ) {
+						if( !chunk->is_empty() ) {
+							tally.add( chunk->get_uniform_block(), num_blocks );
+						}
+					}
+					else {
+						chunk->get_raw_data( &raw_data[0] );
+					}
+
+					for( block_pos.z = min.z; block_pos.z < max.z; ++block_pos.z ) {
+						for( block_pos.x = min.x; block_pos.x < max.x; ++block_pos.x ) {
+							Chunk::ScalarType local_top = local_tops[block_pos.z * m_chunk_size.x + block_pos.x];
+
+							if( !uniform ) {
+								for( std::size_t y = min.y; y < local_top; ++y ) {
+									Chunk::Block old_id = raw_data[(block_pos.z * m_chunk_size.y + y) * m_chunk_size.x + block_pos.x];
+
+									if( old_id != Chunk::INVALID_BLOCK ) {
+										tally.add( old_id, 1 );
+									}
+								}
+							}
+
+							for( block_pos.y = min.y; block_pos.y < local_top; ++block_pos.y ) {
+								chunk->set_block( block_pos, id );
+							}
+						}
+					}
+				}
+
+				tally.release_all( m_class_cache );
+				mark_chunk_dirty( chunk_pos, *chunk );
+			}
+		}
+	}
+
+	for( uint32_t z = cuboid.z; z < cuboid.z + cuboid.depth; ++z ) {
+		for( uint32_t x = cuboid.x; x < cuboid.x + cuboid.width; ++x ) {
+			uint32_t top = std::min( tops[(z - cuboid.z) * cuboid.width + (x - cuboid.x)], cuboid.y + cuboid.height );
+
+			if( top > cuboid.y ) {
+				raise_surface_height( x, z, top );
+			}
+		}
+	}
+}
+
+void Planet::reset_region( const BlockCuboid& cuboid ) {
+	assert( cuboid.x + cuboid.width <= static_cast<uint32_t>( m_size.x ) * m_chunk_size.x );
+	assert( cuboid.y + cuboid.height <= static_cast<uint32_t>( m_size.y ) * m_chunk_size.y );
+	assert( cuboid.z + cuboid.depth <= static_cast<uint32_t>( m_size.z ) * m_chunk_size.z );
+
+	if( is_region_empty( cuboid ) ) {
+		return;
+	}
+
+	Vector first_chunk_pos( 0, 0, 0 );
+	Vector last_chunk_pos( 0, 0, 0 );
+	Vector chunk_pos( 0, 0, 0 );
+	Chunk::Vector min( 0, 0, 0 );
+	Chunk::Vector max( 0, 0, 0 );
+	Chunk::Vector block_pos( 0, 0, 0 );
+	std::vector<Chunk::Block> raw_data( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	BlockTally tally;
+
+	get_chunk_range( cuboid, m_chunk_size, first_chunk_pos, last_chunk_pos );
+
+	for( chunk_pos.z = first_chunk_pos.z; chunk_pos.z <= last_chunk_pos.z; ++chunk_pos.z ) {
+		for( chunk_pos.y = first_chunk_pos.y; chunk_pos.y <= last_chunk_pos.y; ++chunk_pos.y ) {
+			for( chunk_pos.x = first_chunk_pos.x; chunk_pos.x <= last_chunk_pos.x; ++chunk_pos.x ) {
+				Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+				if( chunk == nullptr || chunk->is_empty() ) {
+					continue;
+				}
+
+				get_local_region( cuboid, m_chunk_size, chunk_pos, min, max );
+				tally_region( *chunk, min, max, raw_data, tally );
+
+				if( covers_chunk( min, max, m_chunk_size ) ) {
+					chunk->clear();
+				}
+				else {
+					for( block_pos.z = min.z; block_pos.z < max.z; ++block_pos.z ) {
+						for( block_pos.y = min.y; block_pos.y < max.y; ++block_pos.y ) {
+							for( block_pos.x = min.x; block_pos.x < max.x; ++block_pos.x ) {
+								if( chunk->is_block_set( block_pos ) ) {
+									chunk->reset_block( block_pos );
+								}
+							}
+						}
+					}
+				}
+
+				tally.release_all( m_class_cache );
+				mark_chunk_dirty( chunk_pos, *chunk );
+			}
+		}
+	}
+
+	// Columns whose topmost block was inside the region continue below it.
+	for( uint32_t z = cuboid.z; z < cuboid.z + cuboid.depth; ++z ) {
+		for( uint32_t x = cuboid.x; x < cuboid.x + cuboid.width; ++x ) {
+			uint16_t* surface_height = find_height( x, z );
+
+			if( surface_height != nullptr && *surface_height > cuboid.y && *surface_height <= cuboid.y + cuboid.height ) {
+				*surface_height = scan_surface_height( x, z, cuboid.y );
+			}
+		}
+	}
+}
+
+void Planet::copy_region( const Planet& source, const BlockCuboid& cuboid, const BlockPosition& destination ) {
+	assert( cuboid.x + cuboid.width <= static_cast<uint32_t>( source.m_size.x ) * source.m_chunk_size.x );
+	assert( cuboid.y + cuboid.height <= static_cast<uint32_t>( source.m_size.y ) * source.m_chunk_size.y );
+	assert( cuboid.z + cuboid.depth <= static_cast<uint32_t>( source.m_size.z ) * source.m_chunk_size.z );
+	assert( destination.x + cuboid.width <= static_cast<uint32_t>( m_size.x ) * m_chunk_size.x );
+	assert( destination.y + cuboid.height <= static_cast<uint32_t>( m_size.y ) * m_chunk_size.y );
+	assert( destination.z + cuboid.depth <= static_cast<uint32_t>( m_size.z ) * m_chunk_size.z );
+
+	if( is_region_empty( cuboid ) ) {
+		return;
+	}
+
+	Vector first_chunk_pos( 0, 0, 0 );
+	Vector last_chunk_pos( 0, 0, 0 );
+	Vector chunk_pos( 0, 0, 0 );
+	Chunk::Vector min( 0, 0, 0 );
+	Chunk::Vector max( 0, 0, 0 );
+	std::vector<Chunk::Block> region( static_cast<std::size_t>( cuboid.width ) * cuboid.height * cuboid.depth, Chunk::INVALID_BLOCK );
+	BlockTally tally;
+
+	// Gather the source blocks. This decouples reading from writing in case
+	// both regions overlap.
+	{
+		std::vector<Chunk::Block> raw_data( static_cast<std::size_t>( source.m_chunk_size.x ) * source.m_chunk_size.y * source.m_chunk_size.z );
+
+		get_chunk_range( cuboid, source.m_chunk_size, first_chunk_pos, last_chunk_pos );
+
+		for( chunk_pos.z = first_chunk_pos.z; chunk_pos.z <= last_chunk_pos.z; ++chunk_pos.z ) {
+			for( chunk_pos.y = first_chunk_pos.y; chunk_pos.y <= last_chunk_pos.y; ++chunk_pos.y ) {
+				for( chunk_pos.x = first_chunk_pos.x; chunk_pos.x <= last_chunk_pos.x; ++chunk_pos.x ) {
+					const Chunk* chunk( source.find_or_page_chunk( chunk_pos ) );
+
+					if( chunk == nullptr || chunk->is_empty() ) {
+						continue;
+					}
+
+					get_local_region( cuboid, source.m_chunk_size, chunk_pos, min, max );
+
+					if( !chunk->is_uniform() ) {
+						chunk->get_raw_data( &raw_data[0] );
+					}
+
+					// Position of min inside the region.
+					std::size_t region_x = static_cast<std::size_t>( chunk_pos.x ) * source.m_chunk_size.x + min.x - cuboid.x;
+					std::size_t region_y = static_cast<std::size_t>( chunk_pos.y ) * source.m_chunk_size.y + min.y - cuboid.y;
+					std::size_t region_z = static_cast<std::size_t>( chunk_pos.z ) * source.m_chunk_size.z + min.z - cuboid.z;
+
+					for( std::size_t z = min.z; z < max.z; ++z ) {
+						for( std::size_t y = min.y; y < max.y; ++y ) {
+							Chunk::Block* target = &region[((region_z + z - min.z) * cuboid.height + region_y + y - min.y) * cuboid.width + region_x];
+
+							if( chunk->is_uniform() ) {
+								std::fill( target, target + (max.x - min.x), chunk->get_uniform_block() );
+							}
+							else {
+								const Chunk::Block* row = &raw_data[(z * source.m_chunk_size.y + y) * source.m_chunk_size.x];
+								std::copy( row + min.x, row + max.x, target );
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Translate to own class IDs. All references are added before any old
+	// block is released, so no ID in use can be recycled in between, which
+	// matters when copying inside the same planet.
+	for( std::size_t block_idx = 0; block_idx < region.size(); ++block_idx ) {
+		if( region[block_idx] != Chunk::INVALID_BLOCK ) {
+			tally.add( region[block_idx], 1 );
+		}
+	}
+
+	std::vector<Chunk::Block> translation( tally.get_max_id(), Chunk::INVALID_BLOCK );
+
+	for( std::size_t id_idx = 0; id_idx < tally.get_num_ids(); ++id_idx ) {
+		Chunk::Block id = tally.get_id( id_idx );
+		translation[id] = m_class_cache.cache( source.m_class_cache.get_class( id ), tally.get_count( id ) );
+	}
+
+	for( std::size_t block_idx = 0; block_idx < region.size(); ++block_idx ) {
+		if( region[block_idx] != Chunk::INVALID_BLOCK ) {
+			region[block_idx] = translation[region[block_idx]];
+		}
+	}
+
+	// Write.
+	BlockCuboid target_cuboid( destination.x, destination.y, destination.z, cuboid.width, cuboid.height, cuboid.depth );
+	std::vector<Chunk::Block> raw_data( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	Chunk::Vector block_pos( 0, 0, 0 );
+
+	tally = BlockTally();
+	get_chunk_range( target_cuboid, m_chunk_size, first_chunk_pos, last_chunk_pos );
+
+	for( chunk_pos.z = first_chunk_pos.z; chunk_pos.z <= last_chunk_pos.z; ++chunk_pos.z ) {
+		for( chunk_pos.y = first_chunk_pos.y; chunk_pos.y <= last_chunk_pos.y; ++chunk_pos.y ) {
+			for( chunk_pos.x = first_chunk_pos.x; chunk_pos.x <= last_chunk_pos.x; ++chunk_pos.x ) {
+				get_local_region( target_cuboid, m_chunk_size, chunk_pos, min, max );
+
+				// Position of min inside the region.
+				std::size_t region_x = static_cast<std::size_t>( chunk_pos.x ) * m_chunk_size.x + min.x - destination.x;
+				std::size_t region_y = static_cast<std::size_t>( chunk_pos.y ) * m_chunk_size.y + min.y - destination.y;
+				std::size_t region_z = static_cast<std::size_t>( chunk_pos.z ) * m_chunk_size.z + min.z - destination.z;
+				Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+				if( chunk == nullptr ) {
+					// Only create the chunk if any block has to be set.
+					bool needed = false;
+
+					for( std::size_t z = min.z; z < max.z && !needed; ++z ) {
+						for( std::size_t y = min.y; y < max.y && !needed; ++y ) {
+							const Chunk::Block* row = &region[((region_z + z - min.z) * cuboid.height + region_y + y - min.y) * cuboid.width + region_x];
+
+							for( std::size_t x = min.x; x < max.x && !needed; ++x ) {
+								needed = row[x - min.x] != Chunk::INVALID_BLOCK;
+							}
+						}
+					}
+
+					if( !needed ) {
+						continue;
+					}
+
+					create_chunk( chunk_pos );
+					chunk = m_chunks.find( chunk_pos );
+				}
+
+				tally_region( *chunk, min, max, raw_data, tally );
+
+				for( block_pos.z = min.z; block_pos.z < max.z; ++block_pos.z ) {
+					for( block_pos.y = min.y; block_pos.y < max.y; ++block_pos.y ) {
+						const Chunk::Block* row = &region[((region_z + block_pos.z - min.z) * cuboid.height + region_y + block_pos.y - min.y) * cuboid.width + region_x];
+
+						for( block_pos.x = min.x; block_pos.x < max.x; ++block_pos.x ) {
+							Chunk::Block id = row[block_pos.x - min.x];
+
+							if( id != Chunk::INVALID_BLOCK ) {
+								chunk->set_block( block_pos, id );
+							}
+							else if( chunk->is_block_set( block_pos ) ) {
+								chunk->reset_block( block_pos );
+							}
+						}
+					}
+				}
+
+				tally.release_all( m_class_cache );
+				mark_chunk_dirty( chunk_pos, *chunk );
+			}
+		}
+	}
+
+	// Update heightmap. The region's columns are searched top-down first,
+	// columns with blocks above the region keep their height.
+	for( std::size_t region_z = 0; region_z < cuboid.depth; ++region_z ) {
+		for( std::size_t region_x = 0; region_x < cuboid.width; ++region_x ) {
+			uint32_t x = destination.x + static_cast<uint32_t>( region_x );
+			uint32_t z = destination.z + static_cast<uint32_t>( region_z );
+			std::size_t region_y = cuboid.height;
+
+			while( region_y > 0 && region[((region_z * cuboid.height) + region_y - 1) * cuboid.width + region_x] == Chunk::INVALID_BLOCK ) {
+				--region_y;
+			}
+
+			if( region_y > 0 ) {
+				uint16_t& surface_height = get_height( x, z );
+
+				if( surface_height <= destination.y + cuboid.height ) {
+					surface_height = static_cast<uint16_t>( destination.y + region_y );
+				}
+
+				continue;
+			}
+
+			uint16_t* surface_height = find_height( x, z );
+
+			if( surface_height != nullptr && *surface_height > destination.y && *surface_height <= destination.y + cuboid.height ) {
+				*surface_height = scan_surface_height( x, z, destination.y );
+			}
+		}
+	}
+}
+
+Chunk& Planet::store_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes ) {
+	assert( position.x < m_size.x );
+	assert( position.y < m_size.y );
+	assert( position.z < m_size.z );
+
+	std::size_t num_blocks = static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z;
+	std::vector<uint32_t> counts( classes.size(), 0 );
+	std::vector<Chunk::Block> ids( classes.size(), Chunk::INVALID_BLOCK );
+	std::vector<Chunk::Block> raw_data( num_blocks );
+	BlockTally tally;
+
+	for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+		if( blocks[block_idx] != Chunk::INVALID_BLOCK ) {
+			assert( blocks[block_idx] < classes.size() );
+			++counts[blocks[block_idx]];
+		}
+	}
+
+	// Blocks replace the image's chunk, so it's not paged in.
+	Chunk* chunk( m_chunks.find( position ) );
+
+	// Not created through create_chunk(), callers decide about marking dirty.
+	if( chunk == nullptr ) {
+		chunk = &m_chunk_allocator.create_chunk( m_chunk_size );
+		m_chunks.insert( position, *chunk );
+	}
+
+	// Reference the new classes before releasing the old blocks, so that IDs
+	// of classes used before stay the same.
+	for( std::size_t cls_idx = 0; cls_idx < classes.size(); ++cls_idx ) {
+		if( counts[cls_idx] > 0 ) {
+			ids[cls_idx] = m_class_cache.cache( *classes[cls_idx], counts[cls_idx] );
+		}
+	}
+
+	tally_region( *chunk, Chunk::Vector( 0, 0, 0 ), m_chunk_size, raw_data, tally );
+
+	for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+		raw_data[block_idx] = blocks[block_idx] == Chunk::INVALID_BLOCK ? Chunk::INVALID_BLOCK : ids[blocks[block_idx]];
+	}
+
+	chunk->set_raw_data( &raw_data[0] );
+	tally.release_all( m_class_cache );
+
+	// Update the heightmap for the columns passing the chunk.
+	uint32_t origin_y = static_cast<uint32_t>( position.y ) * m_chunk_size.y;
+
+	for( Chunk::ScalarType block_z = 0; block_z < m_chunk_size.z; ++block_z ) {
+		for( Chunk::ScalarType block_x = 0; block_x < m_chunk_size.x; ++block_x ) {
+			uint32_t x = static_cast<uint32_t>( position.x ) * m_chunk_size.x + block_x;
+			uint32_t z = static_cast<uint32_t>( position.z ) * m_chunk_size.z + block_z;
+			std::size_t block_y = m_chunk_size.y;
+
+			while( block_y > 0 && raw_data[(static_cast<std::size_t>( block_z ) * m_chunk_size.y + block_y - 1) * m_chunk_size.x + block_x] == Chunk::INVALID_BLOCK ) {
+				--block_y;
+			}
+
+			if( block_y > 0 ) {
+				uint16_t& surface_height = get_height( x, z );
+
+				if( surface_height <= origin_y + m_chunk_size.y ) {
+					surface_height = static_cast<uint16_t>( origin_y + block_y );
+				}
+
+				continue;
+			}
+
+			uint16_t* surface_height = find_height( x, z );
+
+			if( surface_height != nullptr && *surface_height > origin_y && *surface_height <= origin_y + m_chunk_size.y ) {
+				*surface_height = scan_surface_height( x, z, origin_y );
+			}
+		}
+	}
+	return *chunk;
+}
+
+void Planet::set_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes ) {
+	mark_chunk_dirty( position, store_chunk_blocks( position, blocks, classes ) );
+}
+
+void Planet::load_chunk_blocks( const Vector& position, const Chunk::Block* blocks, const ClassArray& classes, Chunk::Revision revision ) {
+	store_chunk_blocks( position, blocks, classes ).set_revision( revision );
+}
+
+void Planet::set_chunk_revision( const Vector& position, Chunk::Revision revision ) {
+	assert( position.x < m_size.x );
+	assert( position.y < m_size.y );
+	assert( position.z < m_size.z );
+
+	Chunk* chunk( find_or_page_chunk( position ) );
+	assert( chunk != nullptr );
+
+	chunk->set_revision( revision );
+}
+
+void Planet::get_chunk_blocks( const Vector& position, Chunk::Block* blocks, ClassArray& classes ) const {
+	assert( position.x < m_size.x );
+	assert( position.y < m_size.y );
+	assert( position.z < m_size.z );
+
+	const Chunk* chunk( find_or_page_chunk( position ) );
+	assert( chunk != nullptr );
+
+	std::size_t num_blocks = chunk->get_num_blocks();
+	std::vector<Chunk::Block> indices( m_class_cache.get_num_cached_classes() + m_class_cache.get_num_holes(), Chunk::INVALID_BLOCK );
+
+	classes.clear();
+	chunk->get_raw_data( blocks );
+
+	// Translate cache IDs to indices in order of appearance.
+	for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+		Chunk::Block id = blocks[block_idx];
+
+		if( id == Chunk::INVALID_BLOCK ) {
+			continue;
+		}
+
+		if( indices[id] == Chunk::INVALID_BLOCK ) {
+			indices[id] = static_cast<Chunk::Block>( classes.size() );
+			classes.push_back( &m_class_cache.get_class( id ) );
+		}
+
+		blocks[block_idx] = indices[id];
+	}
+}
+
+bool Planet::raycast( const Coordinate& origin, const Coordinate& direction, float max_distance, BlockPosition& block_position, Facing& facing ) const {
+	// Facing of a block entered along an axis, in positive and negative
+	// direction.
+	static const Facing POSITIVE_ENTRY_FACINGS[3] = { WEST, DOWN, NORTH };
+	static const Facing NEGATIVE_ENTRY_FACINGS[3] = { EAST, UP, SOUTH };
+
+	float length = std::sqrt( direction.x * direction.x + direction.y * direction.y + direction.z * direction.z );
+
+	if( length == 0.0f || max_distance < 0.0f ) {
+		return false;
+	}
+
+	// Work on arrays so that all axes are handled by the same code.
+	const float ray_origin[3] = { origin.x, origin.y, origin.z };
+	const float ray_direction[3] = { direction.x / length, direction.y / length, direction.z / length };
+	const uint32_t chunk_size[3] = { m_chunk_size.x, m_chunk_size.y, m_chunk_size.z };
+	const uint32_t extent[3] = {
+		static_cast<uint32_t>( m_size.x ) * m_chunk_size.x,
+		static_cast<uint32_t>( m_size.y ) * m_chunk_size.y,
+		static_cast<uint32_t>( m_size.z ) * m_chunk_size.z
+	};
+
+	// Clip the ray to the planet's bounds.
+	float enter_distance = 0.0f;
+	float exit_distance = max_distance;
+	std::size_t entry_axis = 3;
+
+	for( std::size_t axis = 0; axis < 3; ++axis ) {
+		if( ray_direction[axis] == 0.0f ) {
+			if( ray_origin[axis] < 0.0f || ray_origin[axis] >= static_cast<float>( extent[axis] ) ) {
+				return false;
+			}
+
+			continue;
+		}
+
+		float near_distance = (0.0f - ray_origin[axis]) / ray_direction[axis];
+		float far_distance = (static_cast<float>( extent[axis] ) - ray_origin[axis]) / ray_direction[axis];
+
+		if( near_distance > far_distance ) {
+			std::swap( near_distance, far_distance );
+		}
+
+		if( near_distance > enter_distance ) {
+			enter_distance = near_distance;
+			entry_axis = axis;
+		}
+
+		exit_distance = std::min( exit_distance, far_distance );
+	}
+
+	if( enter_distance > exit_distance ) {
+		return false;
+	}
+
+	// First cell.
+	uint32_t cell[3] = { 0, 0, 0 };
+
+	for( std::size_t axis = 0; axis < 3; ++axis ) {
+		if( axis == entry_axis ) {
+			cell[axis] = ray_direction[axis] > 0.0f ? 0 : extent[axis] - 1;
+		}
+		else {
+			cell[axis] = clamp_to_cell( ray_origin[axis] + ray_direction[axis] * enter_distance, 0, extent[axis] - 1 );
+		}
+	}
+
+	// If the origin is inside the planet, pretend the first cell has been
+	// entered along the dominant axis.
+	if( entry_axis == 3 ) {
+		entry_axis = 0;
+
+		for( std::size_t axis = 1; axis < 3; ++axis ) {
+			if( std::abs( ray_direction[axis] ) > std::abs( ray_direction[entry_axis] ) ) {
+				entry_axis = axis;
+			}
+		}
+	}
+
+	uint32_t boundaries[3] = { 0, 0, 0 };
+	uint32_t chunk_min[3] = { 0, 0, 0 };
+	uint32_t chunk_max[3] = { 0, 0, 0 };
+	float distance = 0.0f;
+
+	while( true ) {
+		Vector chunk_pos(
+			static_cast<ScalarType>( cell[0] / chunk_size[0] ),
+			static_cast<ScalarType>( cell[1] / chunk_size[1] ),
+			static_cast<ScalarType>( cell[2] / chunk_size[2] )
+		);
+
+		for( std::size_t axis = 0; axis < 3; ++axis ) {
+			chunk_min[axis] = (cell[axis] / chunk_size[axis]) * chunk_size[axis];
+			chunk_max[axis] = chunk_min[axis] + chunk_size[axis];
+		}
+
+		const Chunk* chunk( find_or_page_chunk( chunk_pos ) );
+
+		if( chunk == nullptr || chunk->is_empty() ) {
+			// Skip the whole chunk.
+			for( std::size_t axis = 0; axis < 3; ++axis ) {
+				boundaries[axis] = ray_direction[axis] > 0.0f ? chunk_max[axis] : chunk_min[axis];
+			}
+
+			std::size_t axis = find_nearest_boundary( ray_origin, ray_direction, boundaries, distance );
+
+			if( distance > exit_distance || boundaries[axis] == 0 || boundaries[axis] == extent[axis] ) {
+				return false;
+			}
+
+			for( std::size_t other_axis = 0; other_axis < 3; ++other_axis ) {
+				if( other_axis != axis ) {
+					cell[other_axis] = clamp_to_cell( ray_origin[other_axis] + ray_direction[other_axis] * distance, chunk_min[other_axis], chunk_max[other_axis] - 1 );
+				}
+			}
+
+			cell[axis] = ray_direction[axis] > 0.0f ? boundaries[axis] : boundaries[axis] - 1;
+			entry_axis = axis;
+			continue;
+		}
+
+		// Walk the chunk's blocks. Uniform chunks are hit right away.
+		while( true ) {
+			Chunk::Vector block_pos(
+				static_cast<Chunk::ScalarType>( cell[0] - chunk_min[0] ),
+				static_cast<Chunk::ScalarType>( cell[1] - chunk_min[1] ),
+				static_cast<Chunk::ScalarType>( cell[2] - chunk_min[2] )
+			);
+
+			if( chunk->is_uniform() || chunk->is_block_set( block_pos ) ) {
+				block_position = BlockPosition( cell[0], cell[1], cell[2] );
+				facing = ray_direction[entry_axis] > 0.0f ? POSITIVE_ENTRY_FACINGS[entry_axis] : NEGATIVE_ENTRY_FACINGS[entry_axis];
+				return true;
+			}
+
+			for( std::size_t axis = 0; axis < 3; ++axis ) {
+				boundaries[axis] = ray_direction[axis] > 0.0f ? cell[axis] + 1 : cell[axis];
+			}
+
+			std::size_t axis = find_nearest_boundary( ray_origin, ray_direction, boundaries, distance );
+
+			if( distance > exit_distance || boundaries[axis] == 0 || boundaries[axis] == extent[axis] ) {
+				return false;
+			}
+
+			cell[axis] = ray_direction[axis] > 0.0f ? boundaries[axis] : boundaries[axis] - 1;
+			entry_axis = axis;
+
+			if( cell[axis] < chunk_min[axis] || cell[axis] >= chunk_max[axis] ) {
+				break;
+			}
+		}
+	}
 }
 
 std::size_t Planet::get_num_entities() const {
@@ -174,10 +1299,9 @@ std::size_t Planet::get_num_entities() const {
 void Planet::add_entity( const Entity& entity ) {
 	assert( has_entity( entity ) == false );
 
-	m_entities.push_back( entity.get_id() );
-
-	// Sort to make searches with lower_bound possible.
-	std::sort( m_entities.begin(), m_entities.end() );
+	// Keep sorted to make searches with lower_bound possible. Entities are
+	// usually added in ascending ID order, which makes this an append.
+	m_entities.insert( std::upper_bound( m_entities.begin(), m_entities.end(), entity.get_id() ), entity.get_id() );
 
 	// Calculate the absolute bounding box.
 	const Class& cls = entity.get_class();
@@ -243,14 +1367,14 @@ void Planet::remove_entity( const Entity& entity ) {
 	m_entity_nodes.erase( node_iter );
 }
 
-const Chunk::Block* Planet::get_raw_chunk_data( const Planet::Vector& position ) const {
+void Planet::get_raw_chunk_data( const Planet::Vector& position, Chunk::Block* buffer ) const {
 	assert( position.x < m_size.x );
 	assert( position.y < m_size.y );
 	assert( position.z < m_size.z );
-	assert( has_chunk( position ) );
+	const Chunk* chunk( find_or_page_chunk( position ) );
+	assert( chunk != nullptr );
 
-	ChunkMap::const_iterator iter( m_chunks.find( position ) );
-	return iter->second->get_raw_data();
+	chunk->get_raw_data( buffer );
 }
 
 Entity::ID Planet::get_entity_id( std::size_t index ) const {
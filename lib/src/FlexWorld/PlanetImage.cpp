@@ -0,0 +1,425 @@
+#include <FlexWorld/PlanetImage.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <cstring>
+#include <cassert>
+
+namespace fw {
+
+static const char MAGIC[4] = { 'F', 'W', 'P', 'I' };
+static const uint16_t VERSION = 1;
+static const std::size_t HEADER_SIZE = 48;
+static const std::size_t ENTRY_SIZE = 12;
+
+enum EntryKind {
+	MISSING_CHUNK = 0,
+	UNIFORM_CHUNK = 1,
+	STORED_CHUNK = 2
+};
+
+const std::string PlanetImage::FILENAME = "planet.fwi";
+const std::size_t PlanetImage::PAGE_SIZE = 4096;
+
+static uint16_t read_uint16( const char* data ) {
+	return static_cast<uint16_t>( static_cast<uint8_t>( data[0] ) | static_cast<uint8_t>( data[1] ) << 8 );
+}
+
+static uint32_t read_uint32( const char* data ) {
+	return read_uint16( data ) | static_cast<uint32_t>( read_uint16( data + 2 ) ) << 16;
+}
+
+static uint64_t read_uint64( const char* data ) {
+	return read_uint32( data ) | static_cast<uint64_t>( read_uint32( data + 4 ) ) << 32;
+}
+
+static void write_uint16( char* data, uint16_t value ) {
+	data[0] = static_cast<char>( value & 0xff );
+	data[1] = static_cast<char>( value >> 8 );
+}
+
+static void write_uint32( char* data, uint32_t value ) {
+	write_uint16( data, static_cast<uint16_t>( value & 0xffff ) );
+	write_uint16( data + 2, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static void write_uint64( char* data, uint64_t value ) {
+	write_uint32( data, static_cast<uint32_t>( value & 0xffffffff ) );
+	write_uint32( data + 4, static_cast<uint32_t>( value >> 32 ) );
+}
+
+static uint64_t align( uint64_t offset, uint64_t alignment ) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+std::size_t PlanetImage::write( const std::string& path, const Planet& planet ) {
+	const Planet::Vector& size = planet.get_size();
+	const Chunk::Vector& chunk_size = planet.get_chunk_size();
+	const std::string& id = planet.get_id();
+
+	assert( id.size() <= 0xffff );
+
+	std::size_t num_blocks = static_cast<std::size_t>( chunk_size.x ) * chunk_size.y * chunk_size.z;
+	std::size_t num_entries = static_cast<std::size_t>( size.x ) * size.y * size.z;
+	uint64_t index_offset = align( HEADER_SIZE + id.size(), 16 );
+	uint64_t offset = align( index_offset + num_entries * ENTRY_SIZE, PAGE_SIZE );
+
+	std::vector<char> header( static_cast<std::size_t>( offset ), 0 );
+	std::vector<char> body( static_cast<std::size_t>( align( num_blocks * 2, PAGE_SIZE ) ), 0 );
+	std::vector<Chunk::Block> blocks( num_blocks );
+	std::vector<Chunk::Block> indices;
+	Planet::ClassArray classes;
+	std::vector<FlexID> class_ids;
+	std::map<std::string, Chunk::Block> class_id_indices;
+	std::size_t num_written = 0;
+
+	std::string temp_path = path + ".tmp";
+	std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+
+	if( !out.is_open() ) {
+		throw WriteException( "Failed to open " + temp_path + "." );
+	}
+
+	// Reserve header and index, they're written when the bodies are done.
+	out.write( &header[0], static_cast<std::streamsize>( header.size() ) );
+
+	Planet::Vector position( 0, 0, 0 );
+	char* entry = &header[static_cast<std::size_t>( index_offset )];
+
+	for( position.z = 0; position.z < size.z; ++position.z ) {
+		for( position.y = 0; position.y < size.y; ++position.y ) {
+			for( position.x = 0; position.x < size.x; ++position.x ) {
+				const Chunk* chunk = planet.find_chunk( position );
+
+				if( chunk == nullptr ) {
+					entry += ENTRY_SIZE;
+					continue;
+				}
+
+				planet.get_chunk_blocks( position, &blocks[0], classes );
+				indices.resize( classes.size() );
+
+				for( std::size_t cls_idx = 0; cls_idx < classes.size(); ++cls_idx ) {
+					std::string cls_id = classes[cls_idx]->get_id().get();
+					std::map<std::string, Chunk::Block>::iterator index_iter = class_id_indices.find( cls_id );
+
+					if( index_iter == class_id_indices.end() ) {
+						if( class_ids.size() >= Chunk::INVALID_BLOCK ) {
+							throw WriteException( "Class table is full." );
+						}
+
+						index_iter = class_id_indices.insert( std::make_pair( cls_id, static_cast<Chunk::Block>( class_ids.size() ) ) ).first;
+						class_ids.push_back( classes[cls_idx]->get_id() );
+					}
+
+					indices[cls_idx] = index_iter->second;
+				}
+
+				write_uint32( entry + 8, chunk->get_revision() );
+
+				if( chunk->is_uniform() ) {
+					entry[6] = static_cast<char>( UNIFORM_CHUNK );
+					write_uint16( entry + 4, chunk->is_empty() ? Chunk::INVALID_BLOCK : indices[blocks[0]] );
+				}
+				else {
+					if( offset / PAGE_SIZE > 0xffffffff ) {
+						throw WriteException( "Image too large." );
+					}
+
+					entry[6] = static_cast<char>( STORED_CHUNK );
+					write_uint32( entry, static_cast<uint32_t>( offset / PAGE_SIZE ) );
+
+					for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+						write_uint16( &body[block_idx * 2], blocks[block_idx] == Chunk::INVALID_BLOCK ? Chunk::INVALID_BLOCK : indices[blocks[block_idx]] );
+					}
+
+					out.write( &body[0], static_cast<std::streamsize>( body.size() ) );
+					offset += body.size();
+				}
+
+				entry += ENTRY_SIZE;
+				++num_written;
+			}
+		}
+	}
+
+	// Class table.
+	uint64_t class_table_offset = offset;
+
+	for( std::size_t cls_idx = 0; cls_idx < class_ids.size(); ++cls_idx ) {
+		std::string cls_id = class_ids[cls_idx].get();
+		char length[2];
+
+		assert( cls_id.size() <= 0xffff );
+
+		write_uint16( length, static_cast<uint16_t>( cls_id.size() ) );
+		out.write( length, sizeof( length ) );
+		out.write( cls_id.data(), static_cast<std::streamsize>( cls_id.size() ) );
+	}
+
+	std::memcpy( &header[0], MAGIC, sizeof( MAGIC ) );
+	write_uint16( &header[4], VERSION );
+	write_uint16( &header[8], size.x );
+	write_uint16( &header[10], size.y );
+	write_uint16( &header[12], size.z );
+	header[14] = static_cast<char>( chunk_size.x );
+	header[15] = static_cast<char>( chunk_size.y );
+	header[16] = static_cast<char>( chunk_size.z );
+	write_uint32( &header[20], static_cast<uint32_t>( PAGE_SIZE ) );
+	write_uint64( &header[24], index_offset );
+	write_uint64( &header[32], class_table_offset );
+	write_uint32( &header[40], static_cast<uint32_t>( class_ids.size() ) );
+	write_uint16( &header[44], static_cast<uint16_t>( id.size() ) );
+	std::memcpy( &header[HEADER_SIZE], id.data(), id.size() );
+
+	out.seekp( 0 );
+	out.write( &header[0], static_cast<std::streamsize>( header.size() ) );
+	out.close();
+
+	if( !out ) {
+		throw WriteException( "Failed to write " + temp_path + "." );
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::rename( temp_path, path, error );
+
+	if( error ) {
+		throw WriteException( "Failed to replace " + path + ": " + error.message() );
+	}
+
+	return num_written;
+}
+
+PlanetImage::PlanetImage() :
+	m_data( nullptr ),
+	m_file_size( 0 ),
+	m_size( 0, 0, 0 ),
+	m_chunk_size( 0, 0, 0 ),
+	m_num_blocks( 0 ),
+	m_page_size( 0 ),
+	m_index_offset( 0 ),
+	m_num_stored_chunks( 0 )
+{
+}
+
+void PlanetImage::open( const std::string& path ) {
+	close();
+
+	boost::interprocess::mapped_region region;
+
+	try {
+		boost::interprocess::file_mapping mapping( path.c_str(), boost::interprocess::read_only );
+		boost::interprocess::mapped_region mapped( mapping, boost::interprocess::read_only );
+
+		region.swap( mapped );
+	}
+	catch( const boost::interprocess::interprocess_exception& e ) {
+		throw ReadException( "Failed to map " + path + ": " + e.what() );
+	}
+
+	// Chunks are paged in when they're visited, read-ahead would only blow
+	// up memory usage.
+	region.advise( boost::interprocess::mapped_region::advice_random );
+
+	const char* data = static_cast<const char*>( region.get_address() );
+	std::size_t file_size = region.get_size();
+
+	if( file_size < HEADER_SIZE || std::memcmp( data, MAGIC, sizeof( MAGIC ) ) != 0 ) {
+		throw ReadException( "Not a planet image." );
+	}
+
+	if( read_uint16( data + 4 ) != VERSION ) {
+		throw ReadException( "Unsupported version." );
+	}
+
+	Planet::Vector size( read_uint16( data + 8 ), read_uint16( data + 10 ), read_uint16( data + 12 ) );
+	Chunk::Vector chunk_size(
+		static_cast<Chunk::ScalarType>( data[14] ),
+		static_cast<Chunk::ScalarType>( data[15] ),
+		static_cast<Chunk::ScalarType>( data[16] )
+	);
+
+	if( size.x == 0 || size.y == 0 || size.z == 0 || chunk_size.x == 0 || chunk_size.y == 0 || chunk_size.z == 0 ) {
+		throw ReadException( "Invalid planet size." );
+	}
+
+	std::size_t page_size = read_uint32( data + 20 );
+	uint64_t index_offset = read_uint64( data + 24 );
+	uint64_t class_table_offset = read_uint64( data + 32 );
+	std::size_t num_classes = read_uint32( data + 40 );
+	std::size_t id_length = read_uint16( data + 44 );
+	std::size_t num_blocks = static_cast<std::size_t>( chunk_size.x ) * chunk_size.y * chunk_size.z;
+	uint64_t num_entries = static_cast<uint64_t>( size.x ) * size.y * size.z;
+
+	if( page_size == 0 || (page_size & (page_size - 1)) != 0 ) {
+		throw ReadException( "Invalid page size." );
+	}
+
+	if(
+		id_length == 0 ||
+		index_offset < HEADER_SIZE + id_length ||
+		index_offset + num_entries * ENTRY_SIZE > class_table_offset ||
+		class_table_offset > file_size
+	) {
+		throw ReadException( "Invalid offsets." );
+	}
+
+	// Class table.
+	std::vector<FlexID> class_ids( num_classes );
+	std::size_t offset = static_cast<std::size_t>( class_table_offset );
+
+	for( std::size_t cls_idx = 0; cls_idx < num_classes; ++cls_idx ) {
+		if( offset + 2 > file_size || offset + 2 + read_uint16( data + offset ) > file_size ) {
+			throw ReadException( "Truncated class table." );
+		}
+
+		std::size_t length = read_uint16( data + offset );
+
+		if( !class_ids[cls_idx].parse( std::string( data + offset + 2, length ) ) ) {
+			throw ReadException( "Invalid class ID." );
+		}
+
+		offset += 2 + length;
+	}
+
+	// Validate the index once, so that reading chunks can't fail later.
+	const char* entry = data + index_offset;
+	uint64_t max_body_offset = class_table_offset - std::min<uint64_t>( class_table_offset, num_blocks * 2 );
+	std::size_t num_stored_chunks = 0;
+
+	for( uint64_t entry_idx = 0; entry_idx < num_entries; ++entry_idx, entry += ENTRY_SIZE ) {
+		uint16_t value = read_uint16( entry + 4 );
+
+		if( entry[6] == static_cast<char>( MISSING_CHUNK ) ) {
+			continue;
+		}
+
+		if( read_uint32( entry + 8 ) == 0 ) {
+			throw ReadException( "Invalid chunk revision." );
+		}
+
+		if( entry[6] == static_cast<char>( UNIFORM_CHUNK ) ) {
+			if( value != Chunk::INVALID_BLOCK && value >= num_classes ) {
+				throw ReadException( "Chunk references a missing class." );
+			}
+		}
+		else if( entry[6] == static_cast<char>( STORED_CHUNK ) ) {
+			uint64_t body_offset = static_cast<uint64_t>( read_uint32( entry ) ) * page_size;
+
+			if( body_offset < index_offset + num_entries * ENTRY_SIZE || body_offset > max_body_offset ) {
+				throw ReadException( "Invalid chunk offset." );
+			}
+
+			++num_stored_chunks;
+		}
+		else {
+			throw ReadException( "Invalid chunk kind." );
+		}
+	}
+
+	m_region.swap( region );
+	m_data = data;
+	m_file_size = file_size;
+	m_id.assign( data + HEADER_SIZE, id_length );
+	m_size = size;
+	m_chunk_size = chunk_size;
+	m_num_blocks = num_blocks;
+	m_page_size = page_size;
+	m_index_offset = static_cast<std::size_t>( index_offset );
+	m_num_stored_chunks = num_stored_chunks;
+	m_class_ids.swap( class_ids );
+}
+
+void PlanetImage::close() {
+	boost::interprocess::mapped_region region;
+
+	m_region.swap( region );
+	m_data = nullptr;
+	m_file_size = 0;
+	m_id.clear();
+	m_size = Planet::Vector( 0, 0, 0 );
+	m_chunk_size = Chunk::Vector( 0, 0, 0 );
+	m_num_blocks = 0;
+	m_num_stored_chunks = 0;
+	m_class_ids.clear();
+}
+
+bool PlanetImage::is_open() const {
+	return m_data != nullptr;
+}
+
+std::size_t PlanetImage::get_file_size() const {
+	return m_file_size;
+}
+
+const std::string& PlanetImage::get_id() const {
+	return m_id;
+}
+
+const Planet::Vector& PlanetImage::get_size() const {
+	return m_size;
+}
+
+const Chunk::Vector& PlanetImage::get_chunk_size() const {
+	return m_chunk_size;
+}
+
+std::size_t PlanetImage::get_num_classes() const {
+	return m_class_ids.size();
+}
+
+const FlexID& PlanetImage::get_class_id( std::size_t index ) const {
+	assert( index < m_class_ids.size() );
+	return m_class_ids[index];
+}
+
+std::size_t PlanetImage::get_num_stored_chunks() const {
+	return m_num_stored_chunks;
+}
+
+const char* PlanetImage::get_entry( const Planet::Vector& position ) const {
+	assert( m_data != nullptr );
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+
+	std::size_t index = (static_cast<std::size_t>( position.z ) * m_size.y + position.y) * m_size.x + position.x;
+	return m_data + m_index_offset + index * ENTRY_SIZE;
+}
+
+bool PlanetImage::has_chunk( const Planet::Vector& position ) const {
+	return get_entry( position )[6] != static_cast<char>( MISSING_CHUNK );
+}
+
+bool PlanetImage::is_chunk_uniform( const Planet::Vector& position ) const {
+	return get_entry( position )[6] == static_cast<char>( UNIFORM_CHUNK );
+}
+
+bool PlanetImage::read_chunk( const Planet::Vector& position, Chunk::Block* blocks, Chunk::Revision& revision ) const {
+	const char* entry = get_entry( position );
+
+	if( entry[6] == static_cast<char>( MISSING_CHUNK ) ) {
+		return false;
+	}
+
+	if( entry[6] == static_cast<char>( UNIFORM_CHUNK ) ) {
+		std::fill( blocks, blocks + m_num_blocks, read_uint16( entry + 4 ) );
+	}
+	else {
+		const char* body = m_data + static_cast<std::size_t>( read_uint32( entry ) ) * m_page_size;
+
+		// Bodies aren't validated when opening, damaged blocks are read as
+		// unset.
+		for( std::size_t block_idx = 0; block_idx < m_num_blocks; ++block_idx ) {
+			Chunk::Block block = read_uint16( body + block_idx * 2 );
+			blocks[block_idx] = block < m_class_ids.size() ? block : Chunk::INVALID_BLOCK;
+		}
+	}
+
+	revision = read_uint32( entry + 8 );
+	return true;
+}
+
+}
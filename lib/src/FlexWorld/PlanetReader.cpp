@@ -0,0 +1,324 @@
+#include <FlexWorld/PlanetReader.hpp>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+namespace fw {
+
+static const char INFO_MAGIC[4] = { 'F', 'W', 'P', 'L' };
+static const uint16_t INFO_VERSION = 2;
+static const uint64_t NO_REGION = ~static_cast<uint64_t>( 0 );
+
+const std::string PlanetReader::INFO_FILENAME = "planet.fwp";
+
+static uint8_t read_uint8( std::istream& in ) {
+	char data = 0;
+
+	if( !in.get( data ) ) {
+		throw PlanetReader::ReadException( "Truncated info file." );
+	}
+
+	return static_cast<uint8_t>( data );
+}
+
+static uint16_t read_uint16( std::istream& in ) {
+	uint16_t low = read_uint8( in );
+	return static_cast<uint16_t>( low | read_uint8( in ) << 8 );
+}
+
+static uint32_t read_uint32( std::istream& in ) {
+	uint32_t low = read_uint16( in );
+	return low | static_cast<uint32_t>( read_uint16( in ) ) << 16;
+}
+
+static std::string read_string( std::istream& in ) {
+	std::string string( read_uint16( in ), '\0' );
+
+	if( !string.empty() && !in.read( &string[0], static_cast<std::streamsize>( string.size() ) ) ) {
+		throw PlanetReader::ReadException( "Truncated info file." );
+	}
+
+	return string;
+}
+
+bool PlanetReader::is_saved_planet( const std::string& directory ) {
+	return boost::filesystem::is_regular_file( boost::filesystem::path( directory ) / INFO_FILENAME );
+}
+
+PlanetReader::PlanetReader( const std::string& directory ) :
+	m_directory( directory ),
+	m_size( 0, 0, 0 ),
+	m_chunk_size( 0, 0, 0 ),
+	m_seed( 0 ),
+	m_open( false ),
+	m_region_stream_key( NO_REGION )
+{
+}
+
+const std::string& PlanetReader::get_directory() const {
+	return m_directory;
+}
+
+void PlanetReader::open() {
+	std::string path = (boost::filesystem::path( m_directory ) / INFO_FILENAME).string();
+	std::ifstream in( path.c_str(), std::ios::binary );
+
+	if( !in.is_open() ) {
+		throw ReadException( "Failed to open " + path + "." );
+	}
+
+	char magic[sizeof( INFO_MAGIC )];
+
+	if( !in.read( magic, sizeof( magic ) ) || std::memcmp( magic, INFO_MAGIC, sizeof( magic ) ) != 0 ) {
+		throw ReadException( "Not a planet info file." );
+	}
+
+	// Version 1 didn't store the terrain seed.
+	uint16_t version = read_uint16( in );
+
+	if( version == 0 || version > INFO_VERSION ) {
+		throw ReadException( "Unsupported version." );
+	}
+
+	Planet::Vector size( 0, 0, 0 );
+	Chunk::Vector chunk_size( 0, 0, 0 );
+
+	size.x = read_uint16( in );
+	size.y = read_uint16( in );
+	size.z = read_uint16( in );
+	chunk_size.x = read_uint8( in );
+	chunk_size.y = read_uint8( in );
+	chunk_size.z = read_uint8( in );
+
+	if( size.x == 0 || size.y == 0 || size.z == 0 || chunk_size.x == 0 || chunk_size.y == 0 || chunk_size.z == 0 ) {
+		throw ReadException( "Invalid planet size." );
+	}
+
+	if( read_uint8( in ) != RegionFile::SIZE ) {
+		throw ReadException( "Region size mismatch." );
+	}
+
+	int seed = version >= 2 ? static_cast<int>( read_uint32( in ) ) : 0;
+
+	std::string id = read_string( in );
+
+	if( id.empty() ) {
+		throw ReadException( "Empty planet ID." );
+	}
+
+	std::vector<FlexID> class_ids( read_uint32( in ) );
+
+	for( std::size_t cls_idx = 0; cls_idx < class_ids.size(); ++cls_idx ) {
+		if( !class_ids[cls_idx].parse( read_string( in ) ) ) {
+			throw ReadException( "Invalid class ID." );
+		}
+	}
+
+	m_id = id;
+	m_size = size;
+	m_chunk_size = chunk_size;
+	m_seed = seed;
+	m_class_ids.swap( class_ids );
+	m_open = true;
+
+	reset();
+}
+
+bool PlanetReader::is_open() const {
+	return m_open;
+}
+
+const std::string& PlanetReader::get_id() const {
+	return m_id;
+}
+
+const Planet::Vector& PlanetReader::get_size() const {
+	return m_size;
+}
+
+const Chunk::Vector& PlanetReader::get_chunk_size() const {
+	return m_chunk_size;
+}
+
+int PlanetReader::get_seed() const {
+	return m_seed;
+}
+
+std::size_t PlanetReader::get_num_classes() const {
+	return m_class_ids.size();
+}
+
+const FlexID& PlanetReader::get_class_id( std::size_t index ) const {
+	assert( index < m_class_ids.size() );
+	return m_class_ids[index];
+}
+
+const PlanetReader::EntryArray& PlanetReader::get_region_entries( const Planet::Vector& region_position ) {
+	uint64_t key = RegionFile::get_region_key( region_position );
+	RegionMap::iterator region_iter = m_regions.find( key );
+
+	if( region_iter != m_regions.end() ) {
+		return region_iter->second;
+	}
+
+	// Missing region files are cached as empty indices.
+	EntryArray entries;
+	boost::filesystem::path path = boost::filesystem::path( m_directory ) / RegionFile::make_filename( region_position );
+
+	if( boost::filesystem::exists( path ) ) {
+		entries.resize( RegionFile::NUM_ENTRIES );
+
+		try {
+			RegionFile::read_index( open_region( region_position ), &entries[0] );
+		}
+		catch( const RegionFile::FormatException& e ) {
+			throw ReadException( path.string() + ": " + e.what() );
+		}
+	}
+
+	return m_regions[key] = entries;
+}
+
+std::ifstream& PlanetReader::open_region( const Planet::Vector& region_position ) {
+	uint64_t key = RegionFile::get_region_key( region_position );
+
+	if( m_region_stream_key != key ) {
+		std::string path = (boost::filesystem::path( m_directory ) / RegionFile::make_filename( region_position )).string();
+
+		m_region_stream.close();
+		m_region_stream_key = NO_REGION;
+		m_region_stream.open( path.c_str(), std::ios::binary );
+
+		if( !m_region_stream.is_open() ) {
+			throw ReadException( "Failed to open " + path + "." );
+		}
+
+		m_region_stream_key = key;
+	}
+
+	m_region_stream.clear();
+	m_region_stream.seekg( 0 );
+
+	return m_region_stream;
+}
+
+bool PlanetReader::has_chunk( const Planet::Vector& position ) {
+	assert( m_open );
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+
+	const EntryArray& entries = get_region_entries( RegionFile::get_region_position( position ) );
+	return !entries.empty() && entries[RegionFile::get_entry_index( position )].offset != 0;
+}
+
+bool PlanetReader::read_chunk( const Planet::Vector& position, Chunk::Block* blocks, Chunk::Revision& revision ) {
+	assert( m_open );
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+
+	Planet::Vector region_position = RegionFile::get_region_position( position );
+	const EntryArray& entries = get_region_entries( region_position );
+
+	if( entries.empty() || entries[RegionFile::get_entry_index( position )].offset == 0 ) {
+		return false;
+	}
+
+	const RegionFile::Entry& entry = entries[RegionFile::get_entry_index( position )];
+	std::ifstream& in = open_region( region_position );
+	RegionFile::Buffer record( entry.length );
+
+	in.seekg( entry.offset );
+
+	if( !in.read( &record[0], static_cast<std::streamsize>( record.size() ) ) ) {
+		throw ReadException( "Truncated record in " + RegionFile::make_filename( region_position ) + "." );
+	}
+
+	try {
+		RegionFile::decode_chunk( &record[0], record.size(), blocks, static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	}
+	catch( const RegionFile::FormatException& e ) {
+		throw ReadException( RegionFile::make_filename( region_position ) + ": " + e.what() );
+	}
+
+	revision = entry.revision;
+	return true;
+}
+
+bool PlanetReader::load_chunk( Planet& planet, const Planet::Vector& position, const Planet::ClassArray& classes ) {
+	assert( planet.get_size() == m_size );
+	assert( planet.get_chunk_size() == m_chunk_size );
+	assert( classes.size() == m_class_ids.size() );
+
+	std::vector<Chunk::Block> blocks( static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z );
+	Chunk::Revision revision = 0;
+
+	if( !read_chunk( position, &blocks[0], revision ) ) {
+		return false;
+	}
+
+	for( std::size_t block_idx = 0; block_idx < blocks.size(); ++block_idx ) {
+		Chunk::Block block = blocks[block_idx];
+
+		if( block != Chunk::INVALID_BLOCK && (block >= classes.size() || classes[block] == nullptr) ) {
+			throw ReadException( "Chunk references a missing class." );
+		}
+	}
+
+	planet.load_chunk_blocks( position, &blocks[0], classes, revision );
+	return true;
+}
+
+std::size_t PlanetReader::load_planet( Planet& planet, const Planet::ClassArray& classes ) {
+	assert( m_open );
+
+	std::size_t num_loaded = 0;
+	Planet::Vector region_position( 0, 0, 0 );
+	Planet::Vector num_regions(
+		static_cast<Planet::ScalarType>( (m_size.x + RegionFile::SIZE - 1) / RegionFile::SIZE ),
+		static_cast<Planet::ScalarType>( (m_size.y + RegionFile::SIZE - 1) / RegionFile::SIZE ),
+		static_cast<Planet::ScalarType>( (m_size.z + RegionFile::SIZE - 1) / RegionFile::SIZE )
+	);
+
+	// Go region by region, so that every file is opened once.
+	for( region_position.z = 0; region_position.z < num_regions.z; ++region_position.z ) {
+		for( region_position.y = 0; region_position.y < num_regions.y; ++region_position.y ) {
+			for( region_position.x = 0; region_position.x < num_regions.x; ++region_position.x ) {
+				if( get_region_entries( region_position ).empty() ) {
+					continue;
+				}
+
+				Planet::Vector min(
+					static_cast<Planet::ScalarType>( region_position.x * RegionFile::SIZE ),
+					static_cast<Planet::ScalarType>( region_position.y * RegionFile::SIZE ),
+					static_cast<Planet::ScalarType>( region_position.z * RegionFile::SIZE )
+				);
+				Planet::Vector max(
+					static_cast<Planet::ScalarType>( std::min( min.x + RegionFile::SIZE, static_cast<int>( m_size.x ) ) ),
+					static_cast<Planet::ScalarType>( std::min( min.y + RegionFile::SIZE, static_cast<int>( m_size.y ) ) ),
+					static_cast<Planet::ScalarType>( std::min( min.z + RegionFile::SIZE, static_cast<int>( m_size.z ) ) )
+				);
+				Planet::Vector position( min );
+
+				for( position.z = min.z; position.z < max.z; ++position.z ) {
+					for( position.y = min.y; position.y < max.y; ++position.y ) {
+						for( position.x = min.x; position.x < max.x; ++position.x ) {
+							if( load_chunk( planet, position, classes ) ) {
+								++num_loaded;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return num_loaded;
+}
+
+void PlanetReader::reset() {
+	m_regions.clear();
+	m_region_stream.close();
+	m_region_stream_key = NO_REGION;
+}
+
+}
@@ -0,0 +1,328 @@
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <cassert>
+
+#if defined( WINDOWS )
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace fw {
+
+static const char INFO_MAGIC[4] = { 'F', 'W', 'P', 'L' };
+static const uint16_t INFO_VERSION = 2;
+
+// Sync a file or directory to disk by its path.
+static bool sync_path( const std::string& path ) {
+#if defined( WINDOWS )
+	// Directories can't be synced on Windows, renames are flushed by the
+	// file system.
+	if( boost::filesystem::is_directory( path ) ) {
+		return true;
+	}
+
+	int file = _open( path.c_str(), _O_RDWR | _O_BINARY );
+
+	if( file == -1 ) {
+		return false;
+	}
+
+	bool synced = _commit( file ) == 0;
+	_close( file );
+#else
+	int file = open( path.c_str(), O_RDONLY );
+
+	if( file == -1 ) {
+		return false;
+	}
+
+	bool synced = fsync( file ) == 0;
+	close( file );
+#endif
+
+	return synced;
+}
+
+static void write_uint8( std::ostream& out, uint8_t value ) {
+	out.put( static_cast<char>( value ) );
+}
+
+static void write_uint16( std::ostream& out, uint16_t value ) {
+	write_uint8( out, static_cast<uint8_t>( value & 0xff ) );
+	write_uint8( out, static_cast<uint8_t>( value >> 8 ) );
+}
+
+static void write_uint32( std::ostream& out, uint32_t value ) {
+	write_uint16( out, static_cast<uint16_t>( value & 0xffff ) );
+	write_uint16( out, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static void write_string( std::ostream& out, const std::string& string ) {
+	assert( string.size() <= 0xffff );
+
+	write_uint16( out, static_cast<uint16_t>( string.size() ) );
+	out.write( string.data(), static_cast<std::streamsize>( string.size() ) );
+}
+
+PlanetWriter::PlanetWriter( const std::string& directory, const Planet& planet ) :
+	m_directory( directory ),
+	m_id( planet.get_id() ),
+	m_size( planet.get_size() ),
+	m_chunk_size( planet.get_chunk_size() ),
+	m_seed( planet.get_seed() ),
+	m_open( false ),
+	m_info_changed( false ),
+	m_num_pending_chunks( 0 )
+{
+}
+
+const std::string& PlanetWriter::get_directory() const {
+	return m_directory;
+}
+
+void PlanetWriter::open() {
+	std::vector<FlexID> class_ids;
+
+	if( PlanetReader::is_saved_planet( m_directory ) ) {
+		PlanetReader reader( m_directory );
+
+		try {
+			reader.open();
+		}
+		catch( const PlanetReader::ReadException& e ) {
+			throw WriteException( std::string( "Existing planet can't be read: " ) + e.what() );
+		}
+
+		if( reader.get_size() != m_size || reader.get_chunk_size() != m_chunk_size ) {
+			throw WriteException( "Existing planet has a different size." );
+		}
+
+		for( std::size_t cls_idx = 0; cls_idx < reader.get_num_classes(); ++cls_idx ) {
+			class_ids.push_back( reader.get_class_id( cls_idx ) );
+		}
+
+		m_info_changed = reader.get_id() != m_id || reader.get_seed() != m_seed;
+	}
+	else {
+		boost::system::error_code error;
+		boost::filesystem::create_directories( m_directory, error );
+
+		if( error ) {
+			throw WriteException( "Failed to create " + m_directory + ": " + error.message() );
+		}
+
+		m_info_changed = true;
+	}
+
+	m_class_ids.swap( class_ids );
+	m_class_id_indices.clear();
+
+	for( std::size_t cls_idx = 0; cls_idx < m_class_ids.size(); ++cls_idx ) {
+		m_class_id_indices[m_class_ids[cls_idx].get()] = static_cast<Chunk::Block>( cls_idx );
+	}
+
+	m_pending_regions.clear();
+	m_num_pending_chunks = 0;
+	m_open = true;
+}
+
+bool PlanetWriter::is_open() const {
+	return m_open;
+}
+
+std::size_t PlanetWriter::get_num_classes() const {
+	return m_class_ids.size();
+}
+
+std::size_t PlanetWriter::get_num_pending_chunks() const {
+	return m_num_pending_chunks;
+}
+
+Chunk::Block PlanetWriter::get_class_index( const Class& cls ) {
+	std::string id = cls.get_id().get();
+	ClassIdIndexMap::iterator id_index_iter = m_class_id_indices.find( id );
+
+	if( id_index_iter != m_class_id_indices.end() ) {
+		return id_index_iter->second;
+	}
+
+	if( m_class_ids.size() >= Chunk::INVALID_BLOCK ) {
+		throw WriteException( "Class table is full." );
+	}
+
+	Chunk::Block index = static_cast<Chunk::Block>( m_class_ids.size() );
+
+	m_class_ids.push_back( cls.get_id() );
+	m_class_id_indices[id] = index;
+	m_info_changed = true;
+
+	return index;
+}
+
+void PlanetWriter::write_chunk( const Planet::Vector& position, const Chunk::Block* blocks, const Planet::ClassArray& classes, Chunk::Revision revision ) {
+	assert( m_open );
+	assert( position.x < m_size.x && position.y < m_size.y && position.z < m_size.z );
+	assert( revision != 0 );
+
+	std::size_t num_blocks = static_cast<std::size_t>( m_chunk_size.x ) * m_chunk_size.y * m_chunk_size.z;
+	std::vector<Chunk::Block> indices( classes.size() );
+
+	for( std::size_t cls_idx = 0; cls_idx < classes.size(); ++cls_idx ) {
+		indices[cls_idx] = get_class_index( *classes[cls_idx] );
+	}
+
+	m_blocks.resize( num_blocks );
+
+	for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+		assert( blocks[block_idx] == Chunk::INVALID_BLOCK || blocks[block_idx] < classes.size() );
+		m_blocks[block_idx] = blocks[block_idx] == Chunk::INVALID_BLOCK ? Chunk::INVALID_BLOCK : indices[blocks[block_idx]];
+	}
+
+	Planet::Vector region_position = RegionFile::get_region_position( position );
+	PendingRegion& region = m_pending_regions[RegionFile::get_region_key( region_position )];
+	std::size_t entry_idx = RegionFile::get_entry_index( position );
+
+	if( region.chunks.find( entry_idx ) == region.chunks.end() ) {
+		++m_num_pending_chunks;
+	}
+
+	PendingChunk& chunk = region.chunks[entry_idx];
+
+	region.position = region_position;
+	chunk.revision = revision;
+	RegionFile::encode_chunk( &m_blocks[0], num_blocks, chunk.record );
+}
+
+void PlanetWriter::write_chunk( const Planet& planet, const Planet::Vector& position ) {
+	assert( planet.get_size() == m_size );
+	assert( planet.get_chunk_size() == m_chunk_size );
+
+	const Chunk* chunk = planet.find_chunk( position );
+	assert( chunk != nullptr );
+
+	std::vector<Chunk::Block> blocks( chunk->get_num_blocks() );
+	Planet::ClassArray classes;
+
+	planet.get_chunk_blocks( position, &blocks[0], classes );
+	write_chunk( position, &blocks[0], classes, chunk->get_revision() );
+}
+
+std::size_t PlanetWriter::write_planet( const Planet& planet ) {
+	std::size_t num_written = 0;
+	Planet::Vector position( 0, 0, 0 );
+
+	for( position.z = 0; position.z < m_size.z; ++position.z ) {
+		for( position.y = 0; position.y < m_size.y; ++position.y ) {
+			for( position.x = 0; position.x < m_size.x; ++position.x ) {
+				if( planet.has_chunk( position ) ) {
+					write_chunk( planet, position );
+					++num_written;
+				}
+			}
+		}
+	}
+
+	return num_written;
+}
+
+void PlanetWriter::write_info() {
+	boost::filesystem::path path = boost::filesystem::path( m_directory ) / PlanetReader::INFO_FILENAME;
+	std::string temp_path = path.string() + ".tmp";
+
+	{
+		std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+
+		if( !out.is_open() ) {
+			throw WriteException( "Failed to open " + temp_path + "." );
+		}
+
+		out.write( INFO_MAGIC, sizeof( INFO_MAGIC ) );
+		write_uint16( out, INFO_VERSION );
+		write_uint16( out, m_size.x );
+		write_uint16( out, m_size.y );
+		write_uint16( out, m_size.z );
+		write_uint8( out, m_chunk_size.x );
+		write_uint8( out, m_chunk_size.y );
+		write_uint8( out, m_chunk_size.z );
+		write_uint8( out, static_cast<uint8_t>( RegionFile::SIZE ) );
+		write_uint32( out, static_cast<uint32_t>( m_seed ) );
+		write_string( out, m_id );
+		write_uint32( out, static_cast<uint32_t>( m_class_ids.size() ) );
+
+		for( std::size_t cls_idx = 0; cls_idx < m_class_ids.size(); ++cls_idx ) {
+			write_string( out, m_class_ids[cls_idx].get() );
+		}
+
+		out.close();
+
+		if( !out ) {
+			throw WriteException( "Failed to write " + temp_path + "." );
+		}
+	}
+
+	if( !sync_path( temp_path ) ) {
+		throw WriteException( "Failed to sync " + temp_path + "." );
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::rename( temp_path, path, error );
+
+	if( error ) {
+		throw WriteException( "Failed to replace " + path.string() + ": " + error.message() );
+	}
+
+	if( !sync_path( m_directory ) ) {
+		throw WriteException( "Failed to sync " + m_directory + "." );
+	}
+
+	m_info_changed = false;
+}
+
+void PlanetWriter::flush() {
+	assert( m_open );
+
+	// The class table goes first, so region files never reference missing
+	// entries.
+	if( m_info_changed ) {
+		write_info();
+	}
+
+	while( !m_pending_regions.empty() ) {
+		const PendingRegion& pending = m_pending_regions.begin()->second;
+		std::string path = (boost::filesystem::path( m_directory ) / RegionFile::make_filename( pending.position )).string();
+		RegionFile region;
+
+		try {
+			if( boost::filesystem::exists( path ) ) {
+				region.load( path );
+			}
+
+			PendingChunkMap::const_iterator chunk_iter( pending.chunks.begin() );
+			PendingChunkMap::const_iterator chunk_iter_end( pending.chunks.end() );
+
+			for( ; chunk_iter != chunk_iter_end; ++chunk_iter ) {
+				region.set_record( chunk_iter->first, chunk_iter->second.record, chunk_iter->second.revision );
+			}
+
+			region.save( path );
+		}
+		catch( const RegionFile::FormatException& e ) {
+			throw WriteException( path + ": " + e.what() );
+		}
+		catch( const RegionFile::IOException& e ) {
+			throw WriteException( e.what() );
+		}
+
+		m_num_pending_chunks -= pending.chunks.size();
+		m_pending_regions.erase( m_pending_regions.begin() );
+	}
+}
+
+}
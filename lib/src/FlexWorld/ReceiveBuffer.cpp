@@ -0,0 +1,79 @@
+#include <FlexWorld/ReceiveBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+namespace fw {
+
+const std::size_t ReceiveBuffer::DEFAULT_CAPACITY = 16 * 1024;
+
+ReceiveBuffer::ReceiveBuffer( std::size_t capacity ) :
+	m_data( capacity ),
+	m_begin( 0 ),
+	m_end( 0 )
+{
+	assert( capacity > 0 );
+}
+
+std::size_t ReceiveBuffer::get_capacity() const {
+	return m_data.size();
+}
+
+std::size_t ReceiveBuffer::get_size() const {
+	return m_end - m_begin;
+}
+
+const char* ReceiveBuffer::get_data() const {
+	return &m_data[0] + m_begin;
+}
+
+std::size_t ReceiveBuffer::get_free_size() const {
+	return m_data.size() - m_end;
+}
+
+char* ReceiveBuffer::prepare( std::size_t min_free_size ) {
+	if( get_free_size() < min_free_size ) {
+		std::size_t size = get_size();
+
+		if( m_data.size() - size < min_free_size ) {
+			std::vector<char> data( std::max( m_data.size() * 2, size + min_free_size ) );
+
+			if( size > 0 ) {
+				std::memcpy( &data[0], &m_data[m_begin], size );
+			}
+
+			m_data.swap( data );
+		}
+		else if( size > 0 ) {
+			std::memmove( &m_data[0], &m_data[m_begin], size );
+		}
+
+		m_begin = 0;
+		m_end = size;
+	}
+
+	return &m_data[0] + m_end;
+}
+
+void ReceiveBuffer::commit( std::size_t num_bytes ) {
+	assert( num_bytes <= get_free_size() );
+	m_end += num_bytes;
+}
+
+void ReceiveBuffer::consume( std::size_t num_bytes ) {
+	assert( num_bytes <= get_size() );
+	m_begin += num_bytes;
+
+	if( m_begin == m_end ) {
+		m_begin = 0;
+		m_end = 0;
+	}
+}
+
+void ReceiveBuffer::clear() {
+	m_begin = 0;
+	m_end = 0;
+}
+
+}
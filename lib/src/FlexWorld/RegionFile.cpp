@@ -0,0 +1,402 @@
+#include <FlexWorld/RegionFile.hpp>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cassert>
+
+#if defined( WINDOWS )
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace fw {
+
+static const char MAGIC[4] = { 'F', 'W', 'R', 'G' };
+static const uint16_t VERSION = 1;
+static const std::size_t PREAMBLE_SIZE = 8; // Magic, version, region size, reserved byte.
+static const std::size_t ENTRY_SIZE = 12;
+
+// Record encodings.
+static const uint8_t UNIFORM_ENCODING = 0;
+static const uint8_t RUNS_ENCODING = 1;
+static const uint8_t PLAIN_ENCODING = 2;
+
+const Planet::ScalarType RegionFile::SIZE = 8;
+const std::size_t RegionFile::NUM_ENTRIES = 8 * 8 * 8;
+const std::size_t RegionFile::HEADER_SIZE = PREAMBLE_SIZE + RegionFile::NUM_ENTRIES * ENTRY_SIZE;
+
+// Sync a file or directory to disk by its path.
+static bool sync_path( const std::string& path ) {
+#if defined( WINDOWS )
+	// Directories can't be synced on Windows, renames are flushed by the
+	// file system.
+	if( boost::filesystem::is_directory( path ) ) {
+		return true;
+	}
+
+	int file = _open( path.c_str(), _O_RDWR | _O_BINARY );
+
+	if( file == -1 ) {
+		return false;
+	}
+
+	bool synced = _commit( file ) == 0;
+	_close( file );
+#else
+	int file = open( path.c_str(), O_RDONLY );
+
+	if( file == -1 ) {
+		return false;
+	}
+
+	bool synced = fsync( file ) == 0;
+	close( file );
+#endif
+
+	return synced;
+}
+
+static inline void put_uint16( char* data, uint16_t value ) {
+	data[0] = static_cast<char>( value & 0xff );
+	data[1] = static_cast<char>( value >> 8 );
+}
+
+static inline void put_uint32( char* data, uint32_t value ) {
+	put_uint16( data, static_cast<uint16_t>( value & 0xffff ) );
+	put_uint16( data + 2, static_cast<uint16_t>( value >> 16 ) );
+}
+
+static inline uint16_t get_uint16( const char* data ) {
+	return static_cast<uint16_t>( static_cast<uint8_t>( data[0] ) | static_cast<uint8_t>( data[1] ) << 8 );
+}
+
+static inline uint32_t get_uint32( const char* data ) {
+	return static_cast<uint32_t>( get_uint16( data ) ) | static_cast<uint32_t>( get_uint16( data + 2 ) ) << 16;
+}
+
+Planet::Vector RegionFile::get_region_position( const Planet::Vector& chunk_position ) {
+	return Planet::Vector(
+		static_cast<Planet::ScalarType>( chunk_position.x / SIZE ),
+		static_cast<Planet::ScalarType>( chunk_position.y / SIZE ),
+		static_cast<Planet::ScalarType>( chunk_position.z / SIZE )
+	);
+}
+
+uint64_t RegionFile::get_region_key( const Planet::Vector& region_position ) {
+	return static_cast<uint64_t>( region_position.x ) << 32 | static_cast<uint64_t>( region_position.y ) << 16 | region_position.z;
+}
+
+std::size_t RegionFile::get_entry_index( const Planet::Vector& chunk_position ) {
+	return
+		(static_cast<std::size_t>( chunk_position.z % SIZE ) * SIZE + chunk_position.y % SIZE) * SIZE +
+		chunk_position.x % SIZE
+	;
+}
+
+std::string RegionFile::make_filename( const Planet::Vector& region_position ) {
+	std::stringstream sstr;
+
+	sstr << region_position.x << "." << region_position.y << "." << region_position.z << ".fwr";
+	return sstr.str();
+}
+
+void RegionFile::read_index( std::istream& in, Entry* entries ) {
+	std::vector<char> header( HEADER_SIZE );
+
+	if( !in.read( &header[0], static_cast<std::streamsize>( HEADER_SIZE ) ) ) {
+		throw FormatException( "Truncated header." );
+	}
+
+	if( std::memcmp( &header[0], MAGIC, sizeof( MAGIC ) ) != 0 ) {
+		throw FormatException( "Not a region file." );
+	}
+
+	if( get_uint16( &header[4] ) != VERSION ) {
+		throw FormatException( "Unsupported version." );
+	}
+
+	if( static_cast<uint8_t>( header[6] ) != SIZE ) {
+		throw FormatException( "Region size mismatch." );
+	}
+
+	for( std::size_t entry_idx = 0; entry_idx < NUM_ENTRIES; ++entry_idx ) {
+		const char* data = &header[PREAMBLE_SIZE + entry_idx * ENTRY_SIZE];
+		Entry& entry = entries[entry_idx];
+
+		entry.offset = get_uint32( data );
+		entry.length = get_uint32( data + 4 );
+		entry.revision = get_uint32( data + 8 );
+
+		if( entry.offset == 0 ) {
+			if( entry.length != 0 || entry.revision != 0 ) {
+				throw FormatException( "Invalid index entry." );
+			}
+		}
+		else if( entry.offset < HEADER_SIZE || entry.length == 0 || entry.revision == 0 ) {
+			throw FormatException( "Invalid index entry." );
+		}
+	}
+}
+
+void RegionFile::encode_chunk( const Chunk::Block* blocks, std::size_t num_blocks, Buffer& record ) {
+	assert( num_blocks > 0 );
+
+	std::size_t num_runs = 1;
+
+	for( std::size_t block_idx = 1; block_idx < num_blocks; ++block_idx ) {
+		if( blocks[block_idx] != blocks[block_idx - 1] ) {
+			++num_runs;
+		}
+	}
+
+	if( num_runs == 1 && num_blocks <= 0xffff ) {
+		record.resize( 3 );
+		record[0] = static_cast<char>( UNIFORM_ENCODING );
+		put_uint16( &record[1], blocks[0] );
+		return;
+	}
+
+	// Runs are limited to 0xffff blocks, so there might be a few more.
+	num_runs += num_blocks / 0xffff;
+
+	if( num_runs * 4 >= num_blocks * 2 ) {
+		record.resize( 1 + num_blocks * 2 );
+		record[0] = static_cast<char>( PLAIN_ENCODING );
+
+		for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+			put_uint16( &record[1 + block_idx * 2], blocks[block_idx] );
+		}
+
+		return;
+	}
+
+	record.resize( 1 + num_runs * 4 );
+	record[0] = static_cast<char>( RUNS_ENCODING );
+
+	std::size_t offset = 1;
+	std::size_t begin = 0;
+
+	while( begin < num_blocks ) {
+		std::size_t end = begin + 1;
+
+		while( end < num_blocks && end - begin < 0xffff && blocks[end] == blocks[begin] ) {
+			++end;
+		}
+
+		put_uint16( &record[offset], static_cast<uint16_t>( end - begin ) );
+		put_uint16( &record[offset + 2], blocks[begin] );
+		offset += 4;
+		begin = end;
+	}
+
+	record.resize( offset );
+}
+
+void RegionFile::decode_chunk( const char* record, std::size_t length, Chunk::Block* blocks, std::size_t num_blocks ) {
+	if( length == 0 ) {
+		throw FormatException( "Empty record." );
+	}
+
+	uint8_t encoding = static_cast<uint8_t>( record[0] );
+
+	if( encoding == UNIFORM_ENCODING ) {
+		if( length != 3 ) {
+			throw FormatException( "Invalid uniform record." );
+		}
+
+		std::fill( blocks, blocks + num_blocks, get_uint16( record + 1 ) );
+	}
+	else if( encoding == PLAIN_ENCODING ) {
+		if( length != 1 + num_blocks * 2 ) {
+			throw FormatException( "Invalid plain record." );
+		}
+
+		for( std::size_t block_idx = 0; block_idx < num_blocks; ++block_idx ) {
+			blocks[block_idx] = get_uint16( record + 1 + block_idx * 2 );
+		}
+	}
+	else if( encoding == RUNS_ENCODING ) {
+		if( (length - 1) % 4 != 0 ) {
+			throw FormatException( "Invalid run record." );
+		}
+
+		std::size_t block_idx = 0;
+
+		for( std::size_t offset = 1; offset < length; offset += 4 ) {
+			std::size_t num_run_blocks = get_uint16( record + offset );
+
+			if( num_run_blocks == 0 || num_run_blocks > num_blocks - block_idx ) {
+				throw FormatException( "Invalid run." );
+			}
+
+			std::fill( blocks + block_idx, blocks + block_idx + num_run_blocks, get_uint16( record + offset + 2 ) );
+			block_idx += num_run_blocks;
+		}
+
+		if( block_idx != num_blocks ) {
+			throw FormatException( "Runs don't cover the chunk." );
+		}
+	}
+	else {
+		throw FormatException( "Unknown record encoding." );
+	}
+}
+
+RegionFile::RegionFile() :
+	m_records( NUM_ENTRIES ),
+	m_revisions( NUM_ENTRIES, 0 ),
+	m_num_chunks( 0 )
+{
+}
+
+void RegionFile::load( const std::string& path ) {
+	std::ifstream in( path.c_str(), std::ios::binary );
+
+	if( !in.is_open() ) {
+		throw IOException( "Failed to open " + path + "." );
+	}
+
+	std::vector<Entry> entries( NUM_ENTRIES );
+	read_index( in, &entries[0] );
+
+	std::vector<Buffer> records( NUM_ENTRIES );
+	std::vector<Chunk::Revision> revisions( NUM_ENTRIES, 0 );
+	std::size_t num_chunks = 0;
+
+	for( std::size_t entry_idx = 0; entry_idx < NUM_ENTRIES; ++entry_idx ) {
+		const Entry& entry = entries[entry_idx];
+
+		if( entry.offset == 0 ) {
+			continue;
+		}
+
+		records[entry_idx].resize( entry.length );
+		in.seekg( entry.offset );
+
+		if( !in.read( &records[entry_idx][0], static_cast<std::streamsize>( entry.length ) ) ) {
+			throw FormatException( "Truncated record in " + path + "." );
+		}
+
+		revisions[entry_idx] = entry.revision;
+		++num_chunks;
+	}
+
+	m_records.swap( records );
+	m_revisions.swap( revisions );
+	m_num_chunks = num_chunks;
+}
+
+void RegionFile::save( const std::string& path ) const {
+	// Build the whole file in memory, it's written with a single call.
+	std::size_t size = HEADER_SIZE;
+
+	for( std::size_t entry_idx = 0; entry_idx < NUM_ENTRIES; ++entry_idx ) {
+		size += m_records[entry_idx].size();
+	}
+
+	if( size > 0xffffffff ) {
+		throw IOException( "Region too large for " + path + "." );
+	}
+
+	Buffer data( size, 0 );
+	uint32_t offset = static_cast<uint32_t>( HEADER_SIZE );
+
+	std::memcpy( &data[0], MAGIC, sizeof( MAGIC ) );
+	put_uint16( &data[4], VERSION );
+	data[6] = static_cast<char>( SIZE );
+
+	for( std::size_t entry_idx = 0; entry_idx < NUM_ENTRIES; ++entry_idx ) {
+		const Buffer& record = m_records[entry_idx];
+
+		if( record.empty() ) {
+			continue;
+		}
+
+		char* entry_data = &data[PREAMBLE_SIZE + entry_idx * ENTRY_SIZE];
+		uint32_t length = static_cast<uint32_t>( record.size() );
+
+		put_uint32( entry_data, offset );
+		put_uint32( entry_data + 4, length );
+		put_uint32( entry_data + 8, m_revisions[entry_idx] );
+
+		std::memcpy( &data[offset], &record[0], length );
+		offset += length;
+	}
+
+	std::string temp_path = path + ".tmp";
+
+	{
+		std::ofstream out( temp_path.c_str(), std::ios::binary | std::ios::trunc );
+
+		if( !out.is_open() ) {
+			throw IOException( "Failed to open " + temp_path + "." );
+		}
+
+		out.write( &data[0], static_cast<std::streamsize>( data.size() ) );
+		out.close();
+
+		if( !out ) {
+			throw IOException( "Failed to write " + temp_path + "." );
+		}
+	}
+
+	// The data must be on disk before it replaces the old file, and the rename
+	// before the caller drops anything the old file depended on (e.g. the
+	// block journal).
+	if( !sync_path( temp_path ) ) {
+		throw IOException( "Failed to sync " + temp_path + "." );
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::rename( temp_path, path, error );
+
+	if( error ) {
+		throw IOException( "Failed to replace " + path + ": " + error.message() );
+	}
+
+	std::string directory = boost::filesystem::path( path ).parent_path().string();
+
+	if( !sync_path( directory.empty() ? "." : directory ) ) {
+		throw IOException( "Failed to sync directory of " + path + "." );
+	}
+}
+
+std::size_t RegionFile::get_num_chunks() const {
+	return m_num_chunks;
+}
+
+bool RegionFile::has_chunk( std::size_t index ) const {
+	assert( index < NUM_ENTRIES );
+	return !m_records[index].empty();
+}
+
+const RegionFile::Buffer& RegionFile::get_record( std::size_t index ) const {
+	assert( index < NUM_ENTRIES );
+	return m_records[index];
+}
+
+Chunk::Revision RegionFile::get_revision( std::size_t index ) const {
+	assert( index < NUM_ENTRIES );
+	return m_revisions[index];
+}
+
+void RegionFile::set_record( std::size_t index, const Buffer& record, Chunk::Revision revision ) {
+	assert( index < NUM_ENTRIES );
+	assert( !record.empty() );
+	assert( revision != 0 );
+
+	if( m_records[index].empty() ) {
+		++m_num_chunks;
+	}
+
+	m_records[index] = record;
+	m_revisions[index] = revision;
+}
+
+}
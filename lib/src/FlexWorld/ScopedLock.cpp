@@ -0,0 +1,75 @@
+#include <FlexWorld/ScopedLock.hpp>
+#include <FlexWorld/LockFacility.hpp>
+
+#include <cassert>
+
+namespace fw {
+
+ScopedLock::ScopedLock( LockFacility& facility, Object object ) :
+	m_facility( facility ),
+	m_planet( nullptr ),
+	m_object( object ),
+	m_locked( false )
+{
+	assert( object != PLANET );
+
+	lock_object( true );
+	m_locked = true;
+}
+
+ScopedLock::ScopedLock( LockFacility& facility, const Planet& planet ) :
+	m_facility( facility ),
+	m_planet( &planet ),
+	m_object( PLANET ),
+	m_locked( false )
+{
+	lock_object( true );
+	m_locked = true;
+}
+
+ScopedLock::~ScopedLock() {
+	if( m_locked ) {
+		lock_object( false );
+	}
+}
+
+bool ScopedLock::is_locked() const {
+	return m_locked;
+}
+
+void ScopedLock::unlock() {
+	assert( m_locked );
+
+	lock_object( false );
+	m_locked = false;
+}
+
+void ScopedLock::lock_object( bool do_lock ) {
+	switch( m_object ) {
+		case SCRIPT_MANAGER:
+			m_facility.lock_script_manager( do_lock );
+			break;
+
+		case ACCOUNT_MANAGER:
+			m_facility.lock_account_manager( do_lock );
+			break;
+
+		case WORLD:
+			m_facility.lock_world( do_lock );
+			break;
+
+		case PLANET:
+			m_facility.lock_planet( *m_planet, do_lock );
+			break;
+
+		case PLAYER_LIST:
+			m_facility.lock_player_list( do_lock );
+			break;
+
+		default:
+			assert( 0 && "Invalid object." );
+			break;
+	}
+}
+
+}
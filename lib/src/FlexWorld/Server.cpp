@@ -57,6 +57,7 @@ uint16_t Server::get_port() const {
 }
 
 std::size_t Server::get_num_peers() const {
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
 	return m_num_peers;
 }
 
@@ -73,6 +74,8 @@ bool Server::start() {
 		return false;
 	}
 
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
 	// Setup the listener.
 	m_acceptor.reset( new ip::tcp::acceptor( m_io_service ) );
 	m_acceptor->open( ip::tcp::v4() );
@@ -115,10 +118,21 @@ bool Server::start() {
 	return true;
 }
 
+std::shared_ptr<Peer> Server::find_peer( ConnectionID conn_id ) const {
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
+	if( conn_id >= m_peers.size() ) {
+		return std::shared_ptr<Peer>();
+	}
+
+	return m_peers[conn_id];
+}
+
 void Server::start_accept() {
 	// Prepare the new peer.
 	std::shared_ptr<Peer> peer( new Peer );
 	peer->socket.reset( new boost::asio::ip::tcp::socket( m_acceptor->get_io_service() ) );
+	peer->strand.reset( new boost::asio::io_service::strand( m_io_service ) );
 
 	m_acceptor->async_accept(
 		*peer->socket,
@@ -133,45 +147,70 @@ void Server::handle_accept( std::shared_ptr<Peer> peer, const boost::system::err
 		return;
 	}
 
-	++m_num_peers;
+	{
+		boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
+		// Stopped meanwhile?
+		if( !m_acceptor ) {
+			return;
+		}
 
-	// Get next free connection ID.
-	std::size_t conn_id = 0;
+		++m_num_peers;
 
-	for( conn_id = 0; conn_id < m_peers.size(); ++conn_id ) {
-		// Found a free slot, use it.
-		if( m_peers[conn_id] == nullptr ) {
-			break;
+		// Get next free connection ID.
+		std::size_t conn_id = 0;
+
+		for( conn_id = 0; conn_id < m_peers.size(); ++conn_id ) {
+			// Found a free slot, use it.
+			if( m_peers[conn_id] == nullptr ) {
+				break;
+			}
 		}
-	}
 
-	if( conn_id >= m_peers.size() ) {
-		m_peers.push_back( peer );
-	}
-	else {
-		m_peers[conn_id] = peer;
+		if( conn_id >= m_peers.size() ) {
+			m_peers.push_back( peer );
+		}
+		else {
+			m_peers[conn_id] = peer;
+		}
+
+		// Save ID and IP.
+		peer->id = static_cast<Peer::ConnectionID>( conn_id );
+		peer->ip = peer->socket->remote_endpoint().address().to_string();
+
+		start_accept();
 	}
 
-	// Save ID and IP.
-	peer->id = static_cast<Peer::ConnectionID>( conn_id );
-	peer->ip = peer->socket->remote_endpoint().address().to_string();
+	// Everything else happens in the peer's strand.
+	peer->strand->post( boost::bind( &Server::start_peer, this, peer ) );
+}
 
+void Server::start_peer( std::shared_ptr<Peer> peer ) {
 	// Notify observer.
 	m_handler.handle_connect( peer->id );
 
 	start_read( peer );
-	start_accept();
+}
+
+void Server::close_peer( std::shared_ptr<Peer> peer ) {
+	if( peer->socket->is_open() ) {
+		peer->socket->close();
+	}
 }
 
 void Server::start_read( std::shared_ptr<Peer> peer ) {
+	char* free_space = peer->receive_buffer.prepare( Peer::MIN_READ_SIZE );
+
 	peer->socket->async_read_some(
-		boost::asio::buffer( peer->read_buffer, Peer::READ_BUFFER_SIZE ),
-		boost::bind(
-			&Server::handle_read,
-			this,
-			peer,
-			boost::asio::placeholders::error,
-			boost::asio::placeholders::bytes_transferred
+		boost::asio::buffer( free_space, peer->receive_buffer.get_free_size() ),
+		peer->strand->wrap(
+			boost::bind(
+				&Server::handle_read,
+				this,
+				peer,
+				boost::asio::placeholders::error,
+				boost::asio::placeholders::bytes_transferred
+			)
 		)
 	);
 }
@@ -179,11 +218,13 @@ void Server::start_read( std::shared_ptr<Peer> peer ) {
 void Server::handle_read( std::shared_ptr<Peer> peer, const boost::system::error_code& error, std::size_t num_bytes_read ) {
 	// Client disconnected?
 	if( error ) {
+		m_handler.handle_disconnect( peer->id );
+
+		boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
 		assert( peer->id < m_peers.size() );
 		assert( m_peers[peer->id] == peer );
 
-		m_handler.handle_disconnect( peer->id );
-
 		if( static_cast<std::size_t>( peer->id + 1 ) == m_peers.size() ) {
 			m_peers.pop_back();
 		}
@@ -195,53 +236,139 @@ void Server::handle_read( std::shared_ptr<Peer> peer, const boost::system::error
 		return;
 	}
 
-	// Add to peer's buffer.
-	peer->buffer.insert( peer->buffer.end(), peer->read_buffer, peer->read_buffer + num_bytes_read );
+	// Data has been read into the receive buffer directly.
+	ReceiveBuffer& buffer = peer->receive_buffer;
+	buffer.commit( num_bytes_read );
 
-	// Try to dispatch.
-	std::size_t consumed = 0;
+	// Dispatch all complete messages.
+	std::string violation;
 
-	while( peer->buffer.size() > 1 && (consumed = ServerProtocol::dispatch( peer->buffer, m_handler, peer->id )) > 0 ) {
-		if( consumed == peer->buffer.size() ) {
-			peer->buffer.clear();
-		}
-		else {
-			std::memmove( &peer->buffer[0], &peer->buffer[consumed], peer->buffer.size() - consumed );
-			peer->buffer.resize( peer->buffer.size() - consumed );
+	try {
+		std::size_t consumed = 0;
+
+		while( (consumed = ServerProtocol::dispatch( buffer.get_data(), buffer.get_size(), m_handler, peer->id )) > 0 ) {
+			buffer.consume( consumed );
 		}
 	}
+	catch( const ServerProtocol::BogusMessageDataException& e ) {
+		violation = e.what();
+	}
+	catch( const ServerProtocol::UnknownMessageIDException& e ) {
+		violation = e.what();
+	}
+	catch( const Message::BogusDataException& e ) {
+		violation = e.what();
+	}
+
+	if( !violation.empty() ) {
+		// Protocol violation, disconnect peer. The pending read fails and
+		// cleans up.
+		std::cerr << "ERROR: Invalid data from client #" << peer->id << " (" << violation << "), disconnecting." << std::endl;
+
+		buffer.clear();
+		close_peer( peer );
+	}
 
 	start_read( peer );
 }
 
-void Server::handle_write( const boost::system::error_code& error, std::shared_ptr<ServerProtocol::Buffer> /*buffer*/, ConnectionID conn_id ) {
+void Server::queue_buffer( std::shared_ptr<Peer> peer, const Peer::SharedBuffer& buffer ) {
+	boost::lock_guard<boost::mutex> lock( peer->write_mutex );
+
+	peer->pending_buffers.push_back( buffer );
+
+	// The shared buffer is immutable, following messages need a new one.
+	peer->open_buffer.reset();
+
+	schedule_write( peer );
+}
+
+void Server::schedule_write( std::shared_ptr<Peer> peer ) {
+	// Write mutex must be locked.
+	if( peer->write_scheduled ) {
+		return;
+	}
+
+	// Deferred, so that messages sent in a row are written together.
+	peer->write_scheduled = true;
+	peer->strand->post( boost::bind( &Server::start_write, this, peer ) );
+}
+
+void Server::start_write( std::shared_ptr<Peer> peer ) {
+	boost::lock_guard<boost::mutex> lock( peer->write_mutex );
+
+	assert( peer->write_scheduled );
+	assert( peer->writing_buffers.empty() );
+
+	if( peer->pending_buffers.empty() || !peer->socket->is_open() ) {
+		peer->pending_buffers.clear();
+		peer->open_buffer.reset();
+		peer->write_scheduled = false;
+		return;
+	}
+
+	peer->writing_buffers.swap( peer->pending_buffers );
+	peer->open_buffer.reset();
+
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve( peer->writing_buffers.size() );
+
+	for( std::size_t buffer_idx = 0; buffer_idx < peer->writing_buffers.size(); ++buffer_idx ) {
+		const ServerProtocol::Buffer& buffer = *peer->writing_buffers[buffer_idx];
+
+		if( !buffer.empty() ) {
+			buffers.push_back( boost::asio::buffer( &buffer.front(), buffer.size() ) );
+		}
+	}
+
+	// async_write() continues short writes until everything is sent.
+	boost::asio::async_write(
+		*peer->socket,
+		buffers,
+		peer->strand->wrap( boost::bind( &Server::handle_write, this, peer, boost::asio::placeholders::error ) )
+	);
+}
+
+void Server::handle_write( std::shared_ptr<Peer> peer, const boost::system::error_code& error ) {
+	peer->writing_buffers.clear();
+
 	// If failed to write, disconnect peer.
 	if( error ) {
-		std::cerr << "ERROR: Failed to send data to client #" << conn_id << ", disconnecting." << std::endl;
+		std::cerr << "ERROR: Failed to send data to client #" << peer->id << ", disconnecting." << std::endl;
+
+		{
+			boost::lock_guard<boost::mutex> lock( peer->write_mutex );
 
-		if( conn_id < m_peers.size() && m_peers[conn_id] != nullptr ) {
-			m_peers[conn_id]->socket->close();
+			peer->pending_buffers.clear();
+			peer->open_buffer.reset();
+			peer->write_scheduled = false;
 		}
 
+		close_peer( peer );
 		return;
 	}
+
+	// Write what has been queued meanwhile.
+	start_write( peer );
 }
 
 const std::string& Server::get_client_ip( ConnectionID conn_id ) const {
-	assert( conn_id < m_peers.size() );
-	assert( m_peers[conn_id] != nullptr );
+	std::shared_ptr<Peer> peer = find_peer( conn_id );
+	assert( peer != nullptr );
 
-	return m_peers[conn_id]->ip;
+	return peer->ip;
 }
 
 void Server::disconnect_client( ConnectionID conn_id ) {
-	assert( conn_id < m_peers.size() );
-	assert( m_peers[conn_id] != nullptr );
+	std::shared_ptr<Peer> peer = find_peer( conn_id );
+	assert( peer != nullptr );
 
-	m_peers[conn_id]->socket->close();
+	peer->strand->dispatch( boost::bind( &Server::close_peer, this, peer ) );
 }
 
 void Server::stop() {
+	boost::lock_guard<boost::mutex> lock( m_peers_mutex );
+
 	// Close listener.
 	if( m_acceptor && m_acceptor->is_open() ) {
 		m_acceptor->close();
@@ -249,8 +376,8 @@ void Server::stop() {
 
 	// Close peer connections.
 	for( std::size_t peer_idx = 0; peer_idx < m_peers.size(); ++peer_idx ) {
-		if( m_peers[peer_idx] && m_peers[peer_idx]->socket && m_peers[peer_idx]->socket->is_open() ) {
-			m_peers[peer_idx]->socket->close();
+		if( m_peers[peer_idx] ) {
+			m_peers[peer_idx]->strand->dispatch( boost::bind( &Server::close_peer, this, m_peers[peer_idx] ) );
 		}
 	}
 
@@ -6,23 +6,50 @@
 #include <FlexWorld/Messages/CreateEntity.hpp>
 #include <FlexWorld/Messages/DestroyBlock.hpp>
 #include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/ScopedLock.hpp>
 #include <FlexWorld/AccountManager.hpp>
 #include <FlexWorld/Account.hpp>
 #include <FlexWorld/World.hpp>
 #include <FlexWorld/GameMode.hpp>
 #include <FlexWorld/PackageEnumerator.hpp>
 #include <FlexWorld/TerrainGenerator.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/PlanetImage.hpp>
+#include <FlexWorld/BlockJournal.hpp>
+#include <FlexWorld/EntityStore.hpp>
+#include <FlexWorld/Types.hpp>
 
 #include <FWU/Log.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 #include <set>
+#include <cassert>
 
 using util::Log;
 
 namespace fw {
 
 static const Chunk::Vector DEFAULT_CHUNK_SIZE = Chunk::Vector( 16, 16, 16 );
-static const Planet::Vector DEFAULT_CONSTRUCT_SIZE = Planet::Vector( 16, 16, 16 );
+static const Planet::Vector DEFAULT_CONSTRUCT_SIZE = Planet::Vector( 256, 16, 256 );
+
+namespace {
+
+// Broadcast predicate matching connections of logged in players. Use with the
+// player list locked.
+struct ConnectedPlayerPredicate {
+	ConnectedPlayerPredicate( const std::deque<PlayerInfo>& player_infos_ ) :
+		player_infos( player_infos_ )
+	{
+	}
+
+	bool operator()( Server::ConnectionID conn_id ) const {
+		return conn_id < player_infos.size() && player_infos[conn_id].connected;
+	}
+
+	const std::deque<PlayerInfo>& player_infos;
+};
+
+}
 
 SessionHost::SessionHost(
 	boost::asio::io_service& io_service,
@@ -32,6 +59,8 @@ SessionHost::SessionHost(
 	const GameMode& game_mode
 ) :
 	Server::Handler(),
+	GeneratorQueue::Handler(),
+	AutosaveService::Handler(),
 	lua::ServerGate(),
 	lua::WorldGate(),
 	m_game_mode( game_mode ),
@@ -41,12 +70,15 @@ SessionHost::SessionHost(
 	m_lock_facility( lock_facility ),
 	m_account_manager( account_manager ),
 	m_world( world ),
+	m_generator_queue( lock_facility ),
+	m_autosave_interval( 300 ),
 	m_auth_mode( OPEN_AUTH ),
 	m_player_limit( 1 ),
-	m_max_view_radius( 10 )
+	m_max_view_radius( VIEW_RADIUS )
 {
 	m_script_manager = new ScriptManager( *this, *this );
 	m_server.reset( new Server( m_io_service, *this ) );
+	m_generator_queue.set_handler( *this );
 }
 
 SessionHost::~SessionHost() {
@@ -69,10 +101,33 @@ SessionHost::~SessionHost() {
 #endif
 		}
 		else {
+			// Planets must not reference the images after they're closed.
+			PlanetImageMap::iterator image_iter = m_planet_images.find( planet->get_id() );
+
+			if( image_iter != m_planet_images.end() ) {
+				m_lock_facility.lock_planet( *planet, true );
+				m_world.find_planet( *planet_iter )->detach_image();
+				m_lock_facility.lock_planet( *planet, false );
+			}
+
 			m_lock_facility.destroy_planet_lock( *planet );
 		}
 	}
 
+	PlanetImageMap::iterator image_iter( m_planet_images.begin() );
+	PlanetImageMap::iterator image_iter_end( m_planet_images.end() );
+
+	for( ; image_iter != image_iter_end; ++image_iter ) {
+		delete image_iter->second;
+	}
+
+	BlockJournalMap::iterator journal_iter( m_journals.begin() );
+	BlockJournalMap::iterator journal_iter_end( m_journals.end() );
+
+	for( ; journal_iter != journal_iter_end; ++journal_iter ) {
+		delete journal_iter->second;
+	}
+
 	m_lock_facility.lock_world( false );
 }
 
@@ -100,6 +155,31 @@ unsigned short SessionHost::get_port() const {
 	return m_server->get_port();
 }
 
+void SessionHost::set_planets_path( const std::string& path ) {
+	m_planets_path = path;
+}
+
+const std::string& SessionHost::get_planets_path() const {
+	return m_planets_path;
+}
+
+void SessionHost::set_entities_path( const std::string& path ) {
+	m_entities_path = path;
+}
+
+const std::string& SessionHost::get_entities_path() const {
+	return m_entities_path;
+}
+
+void SessionHost::set_autosave_interval( uint32_t seconds ) {
+	assert( seconds > 0 );
+	m_autosave_interval = seconds;
+
+	if( m_autosave_service ) {
+		m_autosave_service->set_interval( seconds );
+	}
+}
+
 bool SessionHost::start() {
 	// Check that we have search paths.
 	if( m_class_loader.get_num_search_paths() < 1 ) {
@@ -172,20 +252,74 @@ bool SessionHost::start() {
 	}
 	*/
 
-	// Initialize random number generator.
+	// New planets get a random terrain seed, saved planets bring their own.
 	std::srand( static_cast<unsigned int>( std::time( 0 ) ) );
+	planet->set_seed( std::rand() );
+
+	if( !m_planets_path.empty() ) {
+		m_autosave_service.reset( new AutosaveService( m_lock_facility, m_planets_path ) );
+		m_autosave_service->set_interval( m_autosave_interval );
+		m_autosave_service->set_handler( *this );
+
+		if( !load_saved_planet( *planet ) ) {
+			m_lock_facility.lock_world( false );
+			return false;
+		}
+	}
 
 	TerrainGenerator generator( *grass_cls );
 
-	generator.set_seed( std::rand() );
+	generator.set_seed( planet->get_seed() );
 	generator.set_base_height( 50 );
 	generator.set_maximum_height( 10 );
 
-	generator.generate( *planet, util::Cuboid<uint32_t>( 0, 0, 0, 256, 128, 256 ) );
+	// Terrain is generated lazily, column by column, when it's needed.
+	m_generator_queue.add_planet( *planet, generator );
+
+	if( m_autosave_service ) {
+		// Don't generate terrain over loaded columns.
+		Planet::Vector position( 0, 0, 0 );
+
+		for( position.z = 0; position.z < planet->get_size().z; ++position.z ) {
+			for( position.x = 0; position.x < planet->get_size().x; ++position.x ) {
+				for( position.y = 0; position.y < planet->get_size().y; ++position.y ) {
+					if( planet->has_chunk( position ) ) {
+						m_generator_queue.set_generated( *planet, position );
+						break;
+					}
+				}
+			}
+		}
+
+		if( !attach_planet_image( *planet ) || !replay_block_journal( *planet ) ) {
+			m_lock_facility.lock_world( false );
+			return false;
+		}
+
+		try {
+			BlockJournalMap::iterator journal_iter = m_journals.find( planet->get_id() );
+			m_autosave_service->add_planet( *planet, journal_iter != m_journals.end() ? journal_iter->second : nullptr );
+		}
+		catch( const PlanetWriter::WriteException& e ) {
+			Log::Logger( Log::ERR ) << "Planet \"" << planet->get_id() << "\" won't be saved: " << e.what() << Log::endl;
+		}
+	}
+
+	// Entities are linked to planets, so they come last.
+	if( !m_entities_path.empty() && !load_saved_entities() ) {
+		m_lock_facility.lock_world( false );
+		return false;
+	}
 
 	// Release lock again.
 	m_lock_facility.lock_world( false );
 
+	m_generator_queue.start();
+
+	if( m_autosave_service ) {
+		m_autosave_service->start();
+	}
+
 	// Load scripts.
 	rehash_scripts();
 
@@ -200,6 +334,8 @@ void SessionHost::handle_connect( Server::ConnectionID conn_id ) {
 	Log::Logger( Log::INFO ) << "Client #" << conn_id << " connected from " << m_server->get_client_ip( conn_id ) << "." << Log::endl;
 
 	// Prepare player info.
+	m_lock_facility.lock_player_list( true );
+
 	if( conn_id >= m_player_infos.size() ) {
 		m_player_infos.resize( conn_id + 1 );
 	}
@@ -207,6 +343,8 @@ void SessionHost::handle_connect( Server::ConnectionID conn_id ) {
 	assert( m_player_infos[conn_id].connected == false );
 	m_player_infos[conn_id].connected = true;
 
+	m_lock_facility.lock_player_list( false );
+
 	// Check limit (important: player info must be created before, because handle_disconnect checks it).
 	if( m_server->get_num_peers() > m_player_limit ) {
 		Log::Logger( Log::WARNING ) << "Server full, disconnecting " << m_server->get_client_ip( conn_id ) << "." << Log::endl;
@@ -223,11 +361,31 @@ void SessionHost::handle_connect( Server::ConnectionID conn_id ) {
 }
 
 void SessionHost::handle_disconnect( Server::ConnectionID conn_id ) {
+	// Reset player info.
+	m_lock_facility.lock_player_list( true );
+
 	assert( conn_id < m_player_infos.size() );
 	assert( m_player_infos[conn_id].connected == true );
 
-	// Reset player info.
 	m_player_infos[conn_id] = PlayerInfo();
+	m_interest_manager.remove_interest( conn_id );
+
+	m_lock_facility.lock_player_list( false );
+
+	// Drop chunk requests waiting for terrain generation.
+	{
+		boost::lock_guard<boost::mutex> lock( m_pending_chunk_requests_mutex );
+		PendingChunkRequestArray::iterator request_iter = m_pending_chunk_requests.begin();
+
+		while( request_iter != m_pending_chunk_requests.end() ) {
+			if( request_iter->conn_id == conn_id ) {
+				request_iter = m_pending_chunk_requests.erase( request_iter );
+			}
+			else {
+				++request_iter;
+			}
+		}
+	}
 
 	Log::Logger( Log::INFO ) << "Client " << m_server->get_client_ip( conn_id ) << " disconnected." << Log::endl;
 }
@@ -256,9 +414,13 @@ void SessionHost::handle_message( const msg::OpenLogin& login_msg, Server::Conne
 		Log::Logger( Log::INFO ) << "Client " << login_msg.get_username() << " is connecting from this machine, authenticated." << Log::endl;
 	}
 
-	m_player_infos[conn_id].local = is_local;
+	PlayerInfo& info = get_player_info( conn_id );
+
+	m_lock_facility.lock_player_list( true );
+	info.local = is_local;
+	m_lock_facility.lock_player_list( false );
 
-	m_lock_facility.lock_account_manager( true );
+	ScopedLock account_manager_lock( m_lock_facility, ScopedLock::ACCOUNT_MANAGER );
 
 	// Check if an account for that username exists.
 	const fw::Account* account = m_account_manager.find_account( login_msg.get_username() );
@@ -266,19 +428,22 @@ void SessionHost::handle_message( const msg::OpenLogin& login_msg, Server::Conne
 	// If it doesn't exist, create a new one.
 	if( account == nullptr ) {
 		// Create entity.
-		m_lock_facility.lock_world( true );
+		ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 		assert( m_world.find_class( m_game_mode.get_default_entity_class_id() ) != nullptr );
 
 		const Entity& entity = m_world.create_entity( m_game_mode.get_default_entity_class_id() );
 
+		// The account is stored right away, so its entity must be too.
+		save_entity( entity );
+
 		Account new_account;
 		new_account.set_username( login_msg.get_username() );
 		new_account.set_password( login_msg.get_password() );
 		new_account.set_entity_id( entity.get_id() );
 		m_account_manager.add_account( new_account );
 
-		m_lock_facility.lock_world( false );
+		world_lock.unlock();
 
 		account = m_account_manager.find_account( login_msg.get_username() );
 		assert( account != nullptr );
@@ -294,22 +459,42 @@ void SessionHost::handle_message( const msg::OpenLogin& login_msg, Server::Conne
 		}
 	}
 
-	// Remember entity ID before lock is released.
+	// Associate entity.
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
+
 	Entity::ID entity_id = account->get_entity_id();
-	m_lock_facility.lock_account_manager( false );
+	Entity* entity = m_world.find_entity( entity_id );
 
-	// Remember username.
-	m_player_infos[conn_id].username = login_msg.get_username();
+	// The entity might not have been saved, e.g. when the server crashed
+	// before. Replace it, the account manager is still locked.
+	if( entity == nullptr ) {
+		assert( m_world.find_class( m_game_mode.get_default_entity_class_id() ) != nullptr );
 
-	// Associate entity.
-	m_lock_facility.lock_world( true );
+		entity = &m_world.create_entity( m_game_mode.get_default_entity_class_id() );
+		save_entity( *entity );
 
-	Entity* entity = m_world.find_entity( entity_id );
-	assert( entity != nullptr );
+		Account changed_account = *account;
+		changed_account.set_entity_id( entity->get_id() );
+		m_account_manager.update_account( changed_account );
 
-	m_player_infos[conn_id].entity = entity;
+		Log::Logger( Log::WARNING )
+			<< "Entity #" << entity_id << " of account " << login_msg.get_username()
+			<< " doesn't exist, replaced by ent#" << entity->get_id() << "." << Log::endl
+		;
 
-	m_lock_facility.lock_world( false );
+		entity_id = entity->get_id();
+	}
+
+	world_lock.unlock();
+	account_manager_lock.unlock();
+
+	// Remember username and entity.
+	m_lock_facility.lock_player_list( true );
+
+	info.username = login_msg.get_username();
+	info.entity = entity;
+
+	m_lock_facility.lock_player_list( false );
 
 	// Everything is good, log the player in!
 	msg::LoginOK ok_msg;
@@ -356,8 +541,9 @@ void SessionHost::handle_message( const msg::Ready& /*login_msg*/, Server::Conne
 		return;
 	}
 
-	// XXX
-	float height = 5.f * static_cast<float>( construct->get_chunk_size().y );
+	// Spawn on top of the surface.
+	generate_block_column( *construct, 0, 0 );
+	float height = static_cast<float>( construct->get_surface_height( 0, 0 ) );
 
 	// Client is ready, send him to the construct planet.
 	m_lock_facility.lock_planet( *construct, false );
@@ -365,16 +551,18 @@ void SessionHost::handle_message( const msg::Ready& /*login_msg*/, Server::Conne
 	beam_player( conn_id, "construct", sf::Vector3f( 0, height, 0 ), 225 );
 
 	// Trigger connect event. TODO Is this the right place?
+	m_lock_facility.lock_script_manager( true );
 	m_script_manager->trigger_connect_event( conn_id );
+	m_lock_facility.lock_script_manager( false );
 }
 
 void SessionHost::beam_player( Server::ConnectionID conn_id, const std::string& planet_id, const sf::Vector3f& position, float heading ) {
-	assert( conn_id < m_player_infos.size() && m_player_infos[conn_id].connected == true );
 	assert( !planet_id.empty() );
 	assert( position.x >= 0 && position.y >= 0 && position.z >= 0 );
 
 	// Get player info.
-	PlayerInfo& info = m_player_infos[conn_id];
+	PlayerInfo& info = get_player_info( conn_id );
+	assert( info.connected == true );
 
 	// Get planet.
 	m_lock_facility.lock_world( true );
@@ -394,7 +582,9 @@ void SessionHost::beam_player( Server::ConnectionID conn_id, const std::string&
 	m_world.link_entity_to_planet( info.entity->get_id(), planet_id );
 
 	// Save current planet.
+	m_lock_facility.lock_player_list( true );
 	info.planet = planet;
+	m_lock_facility.lock_player_list( false );
 
 	// Construct beam message.
 	msg::Beam beam_msg;
@@ -411,13 +601,17 @@ void SessionHost::beam_player( Server::ConnectionID conn_id, const std::string&
 	bool result = planet->transform( position, chunk_pos, block_pos );
 	assert( result == true );
 
-	// Update view cuboid.
-	info.view_cuboid.x = static_cast<Planet::ScalarType>( chunk_pos.x - std::min( chunk_pos.x, m_max_view_radius ) );
-	info.view_cuboid.y = static_cast<Planet::ScalarType>( chunk_pos.y - std::min( chunk_pos.y, m_max_view_radius ) );
-	info.view_cuboid.z = static_cast<Planet::ScalarType>( chunk_pos.z - std::min( chunk_pos.z, m_max_view_radius ) );
-	info.view_cuboid.width = std::min( static_cast<Planet::ScalarType>( planet->get_size().x - chunk_pos.x ), m_max_view_radius );
-	info.view_cuboid.height = std::min( static_cast<Planet::ScalarType>( planet->get_size().y - chunk_pos.y ), m_max_view_radius );
-	info.view_cuboid.depth = std::min( static_cast<Planet::ScalarType>( planet->get_size().z - chunk_pos.z ), m_max_view_radius );
+	// Generate terrain around the player, nearest chunks first.
+	m_generator_queue.request_area( *planet, chunk_pos, m_max_view_radius );
+
+	// Interest follows the player's entity. It covers at least the chunks the
+	// client requests around it, no matter in which order.
+	m_lock_facility.lock_player_list( true );
+
+	info.view_cuboid = planet->get_chunk_cuboid( chunk_pos, m_max_view_radius );
+	m_interest_manager.set_interest( conn_id, *planet, info.view_cuboid );
+
+	m_lock_facility.lock_player_list( false );
 
 	// Send message.
 	m_server->send_message( beam_msg, conn_id );
@@ -451,10 +645,11 @@ void SessionHost::beam_player( Server::ConnectionID conn_id, const std::string&
 }
 
 void SessionHost::handle_message( const msg::RequestChunk& req_chunk_msg, Server::ConnectionID conn_id ) {
-	PlayerInfo& info = m_player_infos[conn_id];
+	const PlayerInfo& info = get_player_info( conn_id );
+	Planet* planet = get_player_planet( conn_id );
 
 	// Make sure client is at a planet.
-	if( info.planet == nullptr ) {
+	if( planet == nullptr ) {
 		Log::Logger( Log::ERR ) << "Client #" << conn_id << " requested a chunk but isn't on a planet." << Log::endl;
 		m_server->disconnect_client( conn_id );
 		return;
@@ -462,9 +657,9 @@ void SessionHost::handle_message( const msg::RequestChunk& req_chunk_msg, Server
 
 	// Check for valid chunk position.
 	if(
-		req_chunk_msg.get_position().x >= info.planet->get_size().x ||
-		req_chunk_msg.get_position().y >= info.planet->get_size().y ||
-		req_chunk_msg.get_position().z >= info.planet->get_size().z
+		req_chunk_msg.get_position().x >= planet->get_size().x ||
+		req_chunk_msg.get_position().y >= planet->get_size().y ||
+		req_chunk_msg.get_position().z >= planet->get_size().z
 	) {
 		Log::Logger( Log::ERR ) << "Client #" << conn_id << " requested an invalid chunk." << Log::endl;
 		m_server->disconnect_client( conn_id );
@@ -472,23 +667,420 @@ void SessionHost::handle_message( const msg::RequestChunk& req_chunk_msg, Server
 	}
 
 	// Check if chunk exists.
-	if( !info.planet->has_chunk( req_chunk_msg.get_position() ) ) {
-		// TODO: Send EmptyChunk msg.
-	}
-	else {
-		// Check if chunk hasn't changed or client is connected from the local
-		// machine (so that it uses the same backend).
-		// TODO: Timestamp check.
-		if( info.local ) {
-			msg::ChunkUnchanged unch_msg;
-			unch_msg.set_position( req_chunk_msg.get_position() );
-			m_server->send_message( unch_msg, conn_id );
+	m_lock_facility.lock_planet( *planet, true );
+
+	// If the terrain hasn't been generated yet, answer when it's done.
+	if( !m_generator_queue.request_chunk( *planet, req_chunk_msg.get_position() ) ) {
+		PendingChunkRequest request = { conn_id, planet, req_chunk_msg };
+
+		{
+			boost::lock_guard<boost::mutex> lock( m_pending_chunk_requests_mutex );
+			m_pending_chunk_requests.push_back( request );
 		}
+
+		m_lock_facility.lock_planet( *planet, false );
+		return;
+	}
+
+	const Chunk* chunk = planet->find_chunk( req_chunk_msg.get_position() );
+	bool unchanged = false;
+
+	// Only ChunkUnchanged is answered. Chunk data isn't sent to remote clients:
+	// msg::Chunk is not part of the server protocol and its class IDs refer to
+	// the host's class cache, which remote clients don't know. Empty chunks are
+	// therefore not answered either.
+	if( chunk != nullptr ) {
+		// Check if chunk hasn't changed (the timestamp is the revision of the
+		// client's copy) or client is connected from the local machine (so that
+		// it uses the same backend).
+		unchanged = info.local || req_chunk_msg.get_timestamp() == chunk->get_revision();
+	}
+
+	m_lock_facility.lock_planet( *planet, false );
+
+	if( unchanged ) {
+		msg::ChunkUnchanged unch_msg;
+		unch_msg.set_position( req_chunk_msg.get_position() );
+		m_server->send_message( unch_msg, conn_id );
 	}
 }
 
 void SessionHost::stop() {
 	m_server->stop();
+
+	if( m_generator_queue.is_running() ) {
+		m_generator_queue.stop();
+	}
+
+	if( m_autosave_service ) {
+		if( m_autosave_service->is_running() ) {
+			m_autosave_service->stop();
+		}
+
+		// Final save.
+		std::size_t num_saved = m_autosave_service->save();
+		AutosaveService::Statistics stats = m_autosave_service->get_statistics();
+
+		Log::Logger( Log::INFO )
+			<< "Saved " << num_saved << " chunk(s) in " << stats.last_save_time / 1000 << " ms ("
+			<< stats.num_saves << " save(s), " << stats.num_saved_chunks << " chunk(s) in total, longest planet lock "
+			<< stats.max_lock_time << " us)." << Log::endl
+		;
+
+		m_autosave_service.reset();
+	}
+
+	if( m_entity_store ) {
+		save_entities();
+		m_entity_store.reset();
+	}
+
+	// Commit edits made until now.
+	BlockJournalMap::iterator journal_iter( m_journals.begin() );
+	BlockJournalMap::iterator journal_iter_end( m_journals.end() );
+
+	for( ; journal_iter != journal_iter_end; ++journal_iter ) {
+		if( journal_iter->second->is_running() ) {
+			journal_iter->second->stop();
+		}
+	}
+}
+
+bool SessionHost::load_saved_planet( Planet& planet ) {
+	assert( m_lock_facility.is_world_locked() );
+
+	std::string directory = m_autosave_service->get_planet_directory( planet.get_id() );
+
+	if( !PlanetReader::is_saved_planet( directory ) ) {
+		return true;
+	}
+
+	PlanetReader reader( directory );
+	Planet::ClassArray classes;
+	std::size_t num_loaded = 0;
+	bool planet_locked = false;
+
+	try {
+		reader.open();
+
+		if( reader.get_size() != planet.get_size() || reader.get_chunk_size() != planet.get_chunk_size() ) {
+			Log::Logger( Log::FATAL ) << "Saved planet \"" << planet.get_id() << "\" has a different size." << Log::endl;
+			return false;
+		}
+
+		// Generate missing terrain like the saved one.
+		planet.set_seed( reader.get_seed() );
+
+		for( std::size_t cls_idx = 0; cls_idx < reader.get_num_classes(); ++cls_idx ) {
+			const Class* cls = get_or_load_class( reader.get_class_id( cls_idx ) );
+
+			if( cls == nullptr ) {
+				Log::Logger( Log::FATAL ) << "Failed to load class " << reader.get_class_id( cls_idx ).get() << " of saved planet \"" << planet.get_id() << "\"." << Log::endl;
+				return false;
+			}
+
+			classes.push_back( cls );
+		}
+
+		m_lock_facility.lock_planet( planet, true );
+		planet_locked = true;
+
+		num_loaded = reader.load_planet( planet, classes );
+
+		m_lock_facility.lock_planet( planet, false );
+		planet_locked = false;
+	}
+	catch( const PlanetReader::ReadException& e ) {
+		if( planet_locked ) {
+			m_lock_facility.lock_planet( planet, false );
+		}
+
+		Log::Logger( Log::FATAL ) << "Failed to load planet \"" << planet.get_id() << "\": " << e.what() << Log::endl;
+		return false;
+	}
+
+	Log::Logger( Log::INFO ) << "Loaded " << num_loaded << " chunk(s) of planet \"" << planet.get_id() << "\"." << Log::endl;
+	return true;
+}
+
+bool SessionHost::attach_planet_image( Planet& planet ) {
+	assert( m_lock_facility.is_world_locked() );
+
+	std::string path = (boost::filesystem::path( m_autosave_service->get_planet_directory( planet.get_id() ) ) / PlanetImage::FILENAME).string();
+
+	if( !boost::filesystem::exists( path ) ) {
+		return true;
+	}
+
+	// Only the index is read here, chunks are paged in by the planet when
+	// they're accessed.
+	std::unique_ptr<PlanetImage> image( new PlanetImage );
+	Planet::ClassArray classes;
+
+	try {
+		image->open( path );
+	}
+	catch( const PlanetImage::ReadException& e ) {
+		Log::Logger( Log::FATAL ) << "Failed to open image of planet \"" << planet.get_id() << "\": " << e.what() << Log::endl;
+		return false;
+	}
+
+	if( image->get_size() != planet.get_size() || image->get_chunk_size() != planet.get_chunk_size() ) {
+		Log::Logger( Log::FATAL ) << "Image of planet \"" << planet.get_id() << "\" has a different size." << Log::endl;
+		return false;
+	}
+
+	for( std::size_t cls_idx = 0; cls_idx < image->get_num_classes(); ++cls_idx ) {
+		const Class* cls = get_or_load_class( image->get_class_id( cls_idx ) );
+
+		if( cls == nullptr ) {
+			Log::Logger( Log::FATAL ) << "Failed to load class " << image->get_class_id( cls_idx ).get() << " of planet image \"" << planet.get_id() << "\"." << Log::endl;
+			return false;
+		}
+
+		classes.push_back( cls );
+	}
+
+	// Don't generate terrain over the image's columns.
+	Planet::Vector position( 0, 0, 0 );
+
+	for( position.z = 0; position.z < planet.get_size().z; ++position.z ) {
+		for( position.x = 0; position.x < planet.get_size().x; ++position.x ) {
+			for( position.y = 0; position.y < planet.get_size().y; ++position.y ) {
+				if( image->has_chunk( position ) ) {
+					m_generator_queue.set_generated( planet, position );
+					break;
+				}
+			}
+		}
+	}
+
+	m_lock_facility.lock_planet( planet, true );
+	planet.attach_image( *image, classes );
+	m_lock_facility.lock_planet( planet, false );
+
+	Log::Logger( Log::INFO )
+		<< "Attached image of planet \"" << planet.get_id() << "\" (" << image->get_num_stored_chunks() << " stored chunk(s), "
+		<< image->get_file_size() / 1024 << " KiB)." << Log::endl
+	;
+
+	delete m_planet_images[planet.get_id()];
+	m_planet_images[planet.get_id()] = image.release();
+
+	return true;
+}
+
+bool SessionHost::replay_block_journal( Planet& planet ) {
+	assert( m_lock_facility.is_world_locked() );
+
+	std::string directory = m_autosave_service->get_planet_directory( planet.get_id() );
+	std::vector<FlexID> class_ids;
+	BlockJournal::EditArray edits;
+	Planet::ClassArray classes;
+
+	try {
+		BlockJournal::read( directory, class_ids, edits );
+	}
+	catch( const BlockJournal::IOException& e ) {
+		Log::Logger( Log::FATAL ) << "Failed to read journal of planet \"" << planet.get_id() << "\": " << e.what() << Log::endl;
+		return false;
+	}
+
+	for( std::size_t cls_idx = 0; cls_idx < class_ids.size(); ++cls_idx ) {
+		const Class* cls = get_or_load_class( class_ids[cls_idx] );
+
+		if( cls == nullptr ) {
+			Log::Logger( Log::FATAL ) << "Failed to load class " << class_ids[cls_idx].get() << " of journal of planet \"" << planet.get_id() << "\"." << Log::endl;
+			return false;
+		}
+
+		classes.push_back( cls );
+	}
+
+	if( !edits.empty() ) {
+		m_lock_facility.lock_planet( planet, true );
+
+		// Edits were made on generated terrain that might not have been saved
+		// yet. Generate it first, so it's neither missing under the edits nor
+		// generated over them later.
+		for( std::size_t edit_idx = 0; edit_idx < edits.size(); ++edit_idx ) {
+			generate_block_column( planet, edits[edit_idx].position.x, edits[edit_idx].position.z );
+		}
+
+		std::size_t num_applied = BlockJournal::apply( planet, edits, classes );
+		m_lock_facility.lock_planet( planet, false );
+
+		Log::Logger( Log::INFO ) << "Replayed " << num_applied << " of " << edits.size() << " journaled edit(s) of planet \"" << planet.get_id() << "\"." << Log::endl;
+	}
+
+	// Old segments are kept until the next save covers the replayed edits.
+	std::unique_ptr<BlockJournal> journal( new BlockJournal( directory ) );
+
+	try {
+		journal->open();
+	}
+	catch( const BlockJournal::IOException& e ) {
+		Log::Logger( Log::ERR ) << "Edits of planet \"" << planet.get_id() << "\" won't be journaled: " << e.what() << Log::endl;
+		return true;
+	}
+
+	journal->start();
+
+	delete m_journals[planet.get_id()];
+	m_journals[planet.get_id()] = journal.release();
+
+	return true;
+}
+
+bool SessionHost::load_saved_entities() {
+	assert( m_lock_facility.is_world_locked() );
+
+	std::unique_ptr<EntityStore> store( new EntityStore( m_entities_path ) );
+	EntityStore::ClassArray classes;
+
+	try {
+		store->open();
+	}
+	catch( const EntityStore::ReadException& e ) {
+		Log::Logger( Log::FATAL ) << "Failed to open saved entities: " << e.what() << Log::endl;
+		return false;
+	}
+
+	for( std::size_t cls_idx = 0; cls_idx < store->get_num_classes(); ++cls_idx ) {
+		const Class* cls = get_or_load_class( store->get_class_id( cls_idx ) );
+
+		if( cls == nullptr ) {
+			Log::Logger( Log::FATAL ) << "Failed to load class " << store->get_class_id( cls_idx ).get() << " of saved entities." << Log::endl;
+			return false;
+		}
+
+		classes.push_back( cls );
+	}
+
+	std::size_t num_loaded = store->load_entities( m_world, classes );
+
+	Log::Logger( Log::INFO ) << "Loaded " << num_loaded << " entit" << (num_loaded == 1 ? "y" : "ies") << "." << Log::endl;
+
+	m_entity_store.reset( store.release() );
+	return true;
+}
+
+void SessionHost::save_entities() {
+	m_lock_facility.lock_world( true );
+
+	try {
+		std::size_t num_saved = m_entity_store->save( m_world );
+		Log::Logger( Log::INFO ) << "Saved " << num_saved << " changed entit" << (num_saved == 1 ? "y" : "ies") << "." << Log::endl;
+	}
+	catch( const EntityStore::WriteException& e ) {
+		Log::Logger( Log::ERR ) << "Failed to save entities: " << e.what() << Log::endl;
+	}
+
+	m_lock_facility.lock_world( false );
+}
+
+void SessionHost::save_entity( const Entity& entity ) {
+	assert( m_lock_facility.is_world_locked() );
+
+	if( !m_entity_store ) {
+		return;
+	}
+
+	try {
+		m_entity_store->save_entity( m_world, entity );
+	}
+	catch( const EntityStore::WriteException& e ) {
+		Log::Logger( Log::ERR ) << "Failed to save entity #" << entity.get_id() << ": " << e.what() << Log::endl;
+	}
+}
+
+void SessionHost::handle_autosave() {
+	// Entities are saved in the same cycle as the planets.
+	if( m_entity_store ) {
+		save_entities();
+	}
+}
+
+void SessionHost::journal_block( const Planet& planet, const WorldGate::BlockPosition& block_position, const Class* cls ) {
+	BlockJournalMap::iterator journal_iter = m_journals.find( planet.get_id() );
+
+	if( journal_iter == m_journals.end() ) {
+		return;
+	}
+
+	Planet::Vector chunk_pos(
+		static_cast<Planet::ScalarType>( block_position.x / planet.get_chunk_size().x ),
+		static_cast<Planet::ScalarType>( block_position.y / planet.get_chunk_size().y ),
+		static_cast<Planet::ScalarType>( block_position.z / planet.get_chunk_size().z )
+	);
+
+	journal_iter->second->append( block_position, cls, planet.find_chunk( chunk_pos )->get_revision() );
+}
+
+void SessionHost::handle_generated_column( const Planet& planet, Planet::ScalarType x, Planet::ScalarType z ) {
+	// Called from the generator's thread, or from generate_block_column() with
+	// the planet locked. Answers are only posted, so that's fine either way.
+	answer_pending_chunk_requests( &planet, x, z );
+}
+
+void SessionHost::answer_pending_chunk_requests( const Planet* planet, Planet::ScalarType x, Planet::ScalarType z ) {
+	PendingChunkRequestArray answerable;
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_pending_chunk_requests_mutex );
+		PendingChunkRequestArray::iterator request_iter = m_pending_chunk_requests.begin();
+
+		while( request_iter != m_pending_chunk_requests.end() ) {
+			if(
+				request_iter->planet == planet &&
+				request_iter->message.get_position().x == x &&
+				request_iter->message.get_position().z == z
+			) {
+				answerable.push_back( *request_iter );
+				request_iter = m_pending_chunk_requests.erase( request_iter );
+			}
+			else {
+				++request_iter;
+			}
+		}
+	}
+
+	// Answer in the connections' strands, so that the requests are handled in
+	// order with the connections' other messages.
+	for( std::size_t request_idx = 0; request_idx < answerable.size(); ++request_idx ) {
+		m_server->post( answerable[request_idx].conn_id, boost::bind( &SessionHost::answer_chunk_request, this, answerable[request_idx] ) );
+	}
+}
+
+void SessionHost::answer_chunk_request( const PendingChunkRequest& request ) {
+	bool answer = false;
+
+	// Skip if the player left or was beamed to another planet meanwhile.
+	m_lock_facility.lock_player_list( true );
+
+	answer =
+		request.conn_id < m_player_infos.size() &&
+		m_player_infos[request.conn_id].connected == true &&
+		m_player_infos[request.conn_id].planet == request.planet
+	;
+
+	m_lock_facility.lock_player_list( false );
+
+	if( answer ) {
+		handle_message( request.message, request.conn_id );
+	}
+}
+
+void SessionHost::generate_block_column( const Planet& planet, uint32_t x, uint32_t z ) {
+	Planet::Vector chunk_pos(
+		static_cast<Planet::ScalarType>( x / planet.get_chunk_size().x ),
+		0,
+		static_cast<Planet::ScalarType>( z / planet.get_chunk_size().z )
+	);
+
+	if( chunk_pos.x < planet.get_size().x && chunk_pos.z < planet.get_size().z ) {
+		m_generator_queue.generate_now( planet, chunk_pos );
+	}
 }
 
 const Class* SessionHost::get_or_load_class( const FlexID& id ) {
@@ -538,6 +1130,8 @@ std::size_t SessionHost::get_num_loaded_scripts() const {
 void SessionHost::rehash_scripts() {
 	Log::Logger( Log::INFO ) << "Searching for scripts in " << m_game_mode.get_num_packages() << " package(s)." << Log::endl;
 
+	m_lock_facility.lock_script_manager( true );
+
 	// Clear current script manager. TODO Trigger UNLOAD_EVENT.
 	m_script_manager->clear();
 	m_num_loaded_scripts = 0;
@@ -594,11 +1188,11 @@ void SessionHost::rehash_scripts() {
 			}
 		}
 	}
+
+	m_lock_facility.lock_script_manager( false );
 }
 
 void SessionHost::handle_message( const msg::Chat& chat_msg, Server::ConnectionID conn_id ) {
-	assert( conn_id < m_player_infos.size() );
-
 	// Check if the sent message is a command.
 	const sf::String& text = chat_msg.get_message();
 
@@ -633,28 +1227,36 @@ void SessionHost::handle_message( const msg::Chat& chat_msg, Server::ConnectionI
 
 		// Give to script manager.
 		if( command.empty() == false ) {
+			m_lock_facility.lock_script_manager( true );
 			m_script_manager->trigger_command( command, args, conn_id );
+			m_lock_facility.lock_script_manager( false );
 		}
 	}
 	else {
 		// No command, give to script manager normally.
+		m_lock_facility.lock_script_manager( true );
 		m_script_manager->trigger_chat_event( chat_msg.get_message(), chat_msg.get_channel(), conn_id );
+		m_lock_facility.lock_script_manager( false );
 	}
 }
 
 const std::string& SessionHost::get_client_username( uint16_t client_id ) const {
+	const PlayerInfo* info = nullptr;
+
 	// Make sure client ID is valid and connected.
-	if( client_id >= m_player_infos.size() ) {
-		throw std::runtime_error( "Invalid client ID." );
+	m_lock_facility.lock_player_list( true );
+
+	if( client_id < m_player_infos.size() && m_player_infos[client_id].connected == true ) {
+		info = &m_player_infos[client_id];
 	}
 
-	const PlayerInfo& info = m_player_infos[client_id];
+	m_lock_facility.lock_player_list( false );
 
-	if( info.connected == false ) {
+	if( info == nullptr ) {
 		throw std::runtime_error( "Invalid client ID." );
 	}
 
-	return info.username;
+	return info->username;
 }
 
 std::size_t SessionHost::get_num_connected_clients() const {
@@ -674,11 +1276,9 @@ void SessionHost::broadcast_chat_message( const sf::String& message, const sf::S
 	chat_msg.set_sender( sender );
 
 	// Deliver to all connected clients.
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected ) {
-			m_server->send_message( chat_msg, static_cast<Server::ConnectionID>( client_idx ) );
-		}
-	}
+	m_lock_facility.lock_player_list( true );
+	m_server->broadcast_if( chat_msg, ConnectedPlayerPredicate( m_player_infos ) );
+	m_lock_facility.lock_player_list( false );
 }
 
 void SessionHost::destroy_block( const WorldGate::BlockPosition& block_position, const std::string& planet_id ) {
@@ -687,16 +1287,17 @@ void SessionHost::destroy_block( const WorldGate::BlockPosition& block_position,
 	}
 
 	// Find planet.
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 	Planet* planet = m_world.find_planet( planet_id );
 
 	if( planet == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Planet not found." );
 	}
 
-	m_lock_facility.lock_planet( *planet, true );
-	m_lock_facility.lock_world( false );
+	ScopedLock planet_lock( m_lock_facility, *planet );
+	world_lock.unlock();
+
+	generate_block_column( *planet, block_position.x, block_position.z );
 
 	// Convert to "internal" coordinates.
 	Planet::Vector chunk_pos(
@@ -711,13 +1312,11 @@ void SessionHost::destroy_block( const WorldGate::BlockPosition& block_position,
 		chunk_pos.y >= planet->get_size().y ||
 		chunk_pos.z >= planet->get_size().z
 	) {
-		m_lock_facility.lock_planet( *planet, false );
 		throw std::runtime_error( "Block position out of range." );
 	}
 
 	// Make sure chunk at given position exists.
 	if( planet->has_chunk( chunk_pos ) == false ) {
-		m_lock_facility.lock_planet( *planet, false );
 		throw std::runtime_error( "No block at given position." );
 	}
 
@@ -730,26 +1329,23 @@ void SessionHost::destroy_block( const WorldGate::BlockPosition& block_position,
 
 	// Make sure block exists.
 	if( planet->find_block( chunk_pos, block_pos ) == nullptr ) {
-		m_lock_facility.lock_planet( *planet, false );
 		throw std::runtime_error( "No block at given position." );
 	}
 
 	// Destroy!
 	planet->reset_block( chunk_pos, block_pos );
+	journal_block( *planet, block_position, nullptr );
 
-	// Notify clients. TODO Only those in vicinity and on planet.
+	// Notify clients seeing the chunk.
 	msg::DestroyBlock db_msg;
 	db_msg.set_block_position( block_position );
 
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected == false ) {
-			continue;
-		}
-
-		m_server->send_message( db_msg, static_cast<Server::ConnectionID>( client_idx ) );
-	}
+	Server::ConnectionIDArray recipients;
 
-	m_lock_facility.lock_planet( *planet, false );
+	m_lock_facility.lock_player_list( true );
+	m_interest_manager.find_interested( *planet, chunk_pos, recipients );
+	m_server->broadcast( db_msg, recipients );
+	m_lock_facility.lock_player_list( false );
 }
 
 void SessionHost::set_block( const WorldGate::BlockPosition& block_position, const std::string& planet_id, const FlexID& cls_id ) {
@@ -762,12 +1358,11 @@ void SessionHost::set_block( const WorldGate::BlockPosition& block_position, con
 	}
 
 	// Check that class exists (or try to load).
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	const Class* cls = get_or_load_class( cls_id );
 
 	if( cls == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Class not found." );
 	}
 
@@ -775,11 +1370,12 @@ void SessionHost::set_block( const WorldGate::BlockPosition& block_position, con
 	Planet* planet = m_world.find_planet( planet_id );
 
 	if( planet == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Planet not found." );
 	}
 
-	m_lock_facility.lock_planet( *planet, true );
+	ScopedLock planet_lock( m_lock_facility, *planet );
+
+	generate_block_column( *planet, block_position.x, block_position.z );
 
 	// Transform coordinate.
 	sf::Vector3f f_block_position(
@@ -792,8 +1388,6 @@ void SessionHost::set_block( const WorldGate::BlockPosition& block_position, con
 	Chunk::Vector block_pos;
 
 	if( !planet->transform( f_block_position, chunk_pos, block_pos ) ) {
-		m_lock_facility.lock_planet( *planet, false );
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Block position out of range." );
 	}
 
@@ -804,33 +1398,61 @@ void SessionHost::set_block( const WorldGate::BlockPosition& block_position, con
 
 	// Set block.
 	planet->set_block( chunk_pos, block_pos, *cls );
+	journal_block( *planet, block_position, cls );
 
-	m_lock_facility.lock_planet( *planet, false );
-	m_lock_facility.lock_world( false );
+	planet_lock.unlock();
+	world_lock.unlock();
 
-	// Notify clients. TODO Only those in vicinity and on planet.
+	// Notify clients seeing the chunk.
 	msg::SetBlock sb_msg;
 	sb_msg.set_block_position( block_position );
 	sb_msg.set_class_id( cls_id.get() );
 
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected == false ) {
-			continue;
-		}
+	Server::ConnectionIDArray recipients;
+
+	m_lock_facility.lock_player_list( true );
+	m_interest_manager.find_interested( *planet, chunk_pos, recipients );
+	m_server->broadcast( sb_msg, recipients );
+	m_lock_facility.lock_player_list( false );
+}
+
+uint32_t SessionHost::get_surface_height( uint32_t x, uint32_t z, const std::string& planet_id ) {
+	if( planet_id.empty() ) {
+		throw std::runtime_error( "Invalid planet." );
+	}
 
-		m_server->send_message( sb_msg, static_cast<Server::ConnectionID>( client_idx ) );
+	// Find planet.
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
+	Planet* planet = m_world.find_planet( planet_id );
+
+	if( planet == nullptr ) {
+		throw std::runtime_error( "Planet not found." );
+	}
+
+	ScopedLock planet_lock( m_lock_facility, *planet );
+	world_lock.unlock();
+
+	if(
+		x >= static_cast<uint32_t>( planet->get_size().x ) * planet->get_chunk_size().x ||
+		z >= static_cast<uint32_t>( planet->get_size().z ) * planet->get_chunk_size().z
+	) {
+		throw std::runtime_error( "Column position out of range." );
 	}
+
+	generate_block_column( *planet, x, z );
+	return planet->get_surface_height( x, z );
 }
 
 void SessionHost::handle_message( const msg::Use& use_msg, Server::ConnectionID conn_id ) {
-	assert( conn_id < m_player_infos.size() );
-
-	const PlayerInfo& info = m_player_infos[conn_id];
+	const PlayerInfo& info = get_player_info( conn_id );
+	const Planet* planet = get_player_planet( conn_id );
 	assert( info.connected == true );
 	assert( info.entity != nullptr );
-	assert( info.planet != nullptr );
+	assert( planet != nullptr );
 
-	// Get used entity.
+	// Get used entity. Lock the script manager first, the use event is
+	// triggered with the world locked.
+	m_lock_facility.lock_script_manager( true );
 	m_lock_facility.lock_world( true );
 
 	const Entity* object = m_world.find_entity( use_msg.get_entity_id() );
@@ -838,6 +1460,7 @@ void SessionHost::handle_message( const msg::Use& use_msg, Server::ConnectionID
 	if( object == nullptr ) {
 		Log::Logger( Log::ERR ) << info.username << " tried to use entity #" << use_msg.get_entity_id() << " which doesn't exist." << Log::endl;
 		m_lock_facility.lock_world( false );
+		m_lock_facility.lock_script_manager( false );
 		return;
 	}
 
@@ -850,30 +1473,33 @@ void SessionHost::handle_message( const msg::Use& use_msg, Server::ConnectionID
 
 	const Planet* linked_planet = m_world.find_linked_planet( uppermost_entity->get_id() );
 
-	if( linked_planet != info.planet ) {
+	if( linked_planet != planet ) {
 		Log::Logger( Log::ERR ) << info.username << " tried to use entity #" << use_msg.get_entity_id() << " which is at another planet." << Log::endl;
 		m_lock_facility.lock_world( false );
+		m_lock_facility.lock_script_manager( false );
 		return;
 	}
 
-	// TODO Distance/range check.
+	// TODO Distance/range check. Use Planet::raycast() from the player's eyes
+	// once the server receives player positions.
 
 	// Hand over to script.
 	m_script_manager->trigger_use_event( *object, *info.entity, conn_id );
 
 	m_lock_facility.lock_world( false );
+	m_lock_facility.lock_script_manager( false );
 }
 
 void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::ConnectionID conn_id ) {
-	assert( conn_id < m_player_infos.size() );
-
-	const PlayerInfo& info = m_player_infos[conn_id];
+	const PlayerInfo& info = get_player_info( conn_id );
+	const Planet* planet = get_player_planet( conn_id );
 	assert( info.connected == true );
 	assert( info.entity != nullptr );
-	assert( info.planet != nullptr );
+	assert( planet != nullptr );
 
+	m_lock_facility.lock_script_manager( true ); // Block action event is triggered with world and planet locked.
 	m_lock_facility.lock_world( true ); // Keep world locked as entity is being accessed (actor).
-	m_lock_facility.lock_planet( *info.planet, true );
+	m_lock_facility.lock_planet( *planet, true );
 
 	// Convert to float coordinate so that transform() accepts it.
 	sf::Vector3f block_position(
@@ -886,9 +1512,12 @@ void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::Connec
 	Chunk::Vector block_pos;
 
 	// Transform to chunk and block coordinates.
-	if( info.planet->transform( block_position, chunk_pos, block_pos ) ) {
+	if( planet->transform( block_position, chunk_pos, block_pos ) ) {
 		// Verify the block exists.
-		if( info.planet->find_block( chunk_pos, block_pos ) != nullptr ) {
+		if( planet->find_block( chunk_pos, block_pos ) != nullptr ) {
+			// TODO Distance/range check. Use Planet::raycast() from the player's
+			// eyes once the server receives player positions.
+
 			// Get next block. Set to current block as a fallback.
 			msg::BlockAction::BlockPosition next_block = ba_msg.get_block_position();
 
@@ -898,7 +1527,7 @@ void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::Connec
 				}
 			}
 			else if( ba_msg.get_facing() == SOUTH ) {
-				if( next_block.z + 1 < info.planet->get_size().z * info.planet->get_chunk_size().z ) {
+				if( next_block.z + 1 < planet->get_size().z * planet->get_chunk_size().z ) {
 					++next_block.z;
 				}
 			}
@@ -908,7 +1537,7 @@ void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::Connec
 				}
 			}
 			else if( ba_msg.get_facing() == EAST ) {
-				if( next_block.x + 1 < info.planet->get_size().x * info.planet->get_chunk_size().x ) {
+				if( next_block.x + 1 < planet->get_size().x * planet->get_chunk_size().x ) {
 					++next_block.x;
 				}
 			}
@@ -918,7 +1547,7 @@ void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::Connec
 				}
 			}
 			else if( ba_msg.get_facing() == UP ) {
-				if( next_block.y + 1 < info.planet->get_size().y * info.planet->get_chunk_size().y ) {
+				if( next_block.y + 1 < planet->get_size().y * planet->get_chunk_size().y ) {
 					++next_block.y;
 				}
 			}
@@ -934,8 +1563,52 @@ void SessionHost::handle_message( const msg::BlockAction& ba_msg, Server::Connec
 		}
 	}
 
-	m_lock_facility.lock_planet( *info.planet, false );
+	m_lock_facility.lock_planet( *planet, false );
 	m_lock_facility.lock_world( false );
+	m_lock_facility.lock_script_manager( false );
+}
+
+PlayerInfo& SessionHost::get_player_info( Server::ConnectionID conn_id ) {
+	// The deque only grows at the end, so the reference stays valid. Fields
+	// written from the connection's own strand only may be read without lock
+	// there. The planet isn't one of them, see get_player_planet().
+	m_lock_facility.lock_player_list( true );
+
+	assert( conn_id < m_player_infos.size() );
+	PlayerInfo& info = m_player_infos[conn_id];
+
+	m_lock_facility.lock_player_list( false );
+
+	return info;
+}
+
+Planet* SessionHost::get_player_planet( Server::ConnectionID conn_id ) {
+	// beam_player() may run in other strands, e.g. from scripts.
+	m_lock_facility.lock_player_list( true );
+
+	assert( conn_id < m_player_infos.size() );
+	Planet* planet = m_player_infos[conn_id].planet;
+
+	m_lock_facility.lock_player_list( false );
+
+	return planet;
+}
+
+bool SessionHost::find_entity_chunk( const Entity& entity, const Planet*& planet, Planet::Vector& chunk_pos ) const {
+	const Entity* root = &entity;
+
+	while( root->get_parent() != nullptr ) {
+		root = root->get_parent();
+	}
+
+	planet = m_world.find_linked_planet( root->get_id() );
+
+	if( planet == nullptr ) {
+		return false;
+	}
+
+	Chunk::Vector block_pos;
+	return planet->transform( root->get_position(), chunk_pos, block_pos );
 }
 
 uint32_t SessionHost::create_entity( const FlexID& cls_id, const EntityPosition& position, const std::string& planet_id ) {
@@ -945,29 +1618,26 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, const EntityPosition&
 	}
 
 	// Get class.
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	const Class* cls = get_or_load_class( cls_id );
 
 	if( cls == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Class not found." );
 	}
 
 	// Check planet.
 	if( planet_id.empty() ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Invalid planet ID." );
 	}
 
 	const Planet* planet = m_world.find_planet( planet_id );
 
 	if( planet == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Planet not found." );
 	}
 
-	m_lock_facility.lock_planet( *planet, true );
+	ScopedLock planet_lock( m_lock_facility, *planet );
 
 	// Check position.
 	if(
@@ -978,8 +1648,6 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, const EntityPosition&
 		position.y >= static_cast<float>( planet->get_size().y * planet->get_chunk_size().y ) ||
 		position.z >= static_cast<float>( planet->get_size().z * planet->get_chunk_size().z )
 	) {
-		m_lock_facility.lock_planet( *planet, false );
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Invalid entity position." );
 	}
 
@@ -993,11 +1661,16 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, const EntityPosition&
 	// Remember properties.
 	Entity::ID ent_id = entity.get_id();
 	float heading = entity.get_rotation().y;
+	Planet::Vector chunk_pos;
+	Chunk::Vector block_pos;
 
-	m_lock_facility.lock_planet( *planet, false );
-	m_lock_facility.lock_world( false );
+	bool result = planet->transform( position, chunk_pos, block_pos );
+	assert( result == true );
+
+	planet_lock.unlock();
+	world_lock.unlock();
 
-	// Notify clients. TODO: Only for specific planet.
+	// Notify clients seeing the chunk.
 	msg::CreateEntity msg;
 
 	msg.set_class( cls_id.get() );
@@ -1005,39 +1678,47 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, const EntityPosition&
 	msg.set_id( ent_id );
 	msg.set_position( position );
 
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected ) {
-			m_server->send_message( msg, static_cast<Server::ConnectionID>( client_idx ) );
-		}
-	}
+	Server::ConnectionIDArray recipients;
+
+	m_lock_facility.lock_player_list( true );
+	m_interest_manager.find_interested( *planet, chunk_pos, recipients );
+	m_server->broadcast( msg, recipients );
+	m_lock_facility.lock_player_list( false );
 
 	return ent_id;
 }
 
 uint32_t SessionHost::get_client_entity_id( uint32_t client_id ) const {
+	const Entity* entity = nullptr;
+
 	// Check for valid client ID.
-	if( client_id >= m_player_infos.size() || m_player_infos[client_id].connected == false ) {
-		throw std::runtime_error( "Invalid client ID." );
+	m_lock_facility.lock_player_list( true );
+
+	if( client_id < m_player_infos.size() && m_player_infos[client_id].connected == true ) {
+		entity = m_player_infos[client_id].entity;
 	}
 
-	assert( m_player_infos[client_id].entity != nullptr );
+	m_lock_facility.lock_player_list( false );
+
+	if( entity == nullptr ) {
+		throw std::runtime_error( "Invalid client ID." );
+	}
 
 	// Get ID.
 	m_lock_facility.lock_world( true );
-	uint32_t entity_id = m_player_infos[client_id].entity->get_id();
+	uint32_t entity_id = entity->get_id();
 	m_lock_facility.lock_world( false );
 
 	return entity_id;
 }
 
 void SessionHost::get_entity_position( uint32_t entity_id, EntityPosition& position, std::string& planet_id ) {
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	// Check for entity.
 	const Entity* ent = m_world.find_entity( entity_id );
 
 	if( ent == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Entity not found." );
 	}
 
@@ -1045,18 +1726,14 @@ void SessionHost::get_entity_position( uint32_t entity_id, EntityPosition& posit
 	const Planet* planet = m_world.find_linked_planet( entity_id );
 
 	if( planet == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Entity not linked to a planet." );
 	}
 
-	m_lock_facility.lock_planet( *planet, true );
+	ScopedLock planet_lock( m_lock_facility, *planet );
 
 	// Apply position info.
 	position = ent->get_position();
 	planet_id = planet->get_id();
-
-	m_lock_facility.lock_planet( *planet, false );
-	m_lock_facility.lock_world( false );
 }
 
 uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t parent_id, const std::string& hook_id ) {
@@ -1065,18 +1742,16 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t parent_id, c
 		throw std::runtime_error( "Invalid class." );
 	}
 
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	const Class* cls = get_or_load_class( cls_id );
 
 	if( cls == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Class not found." );
 	}
 
 	// Check for valid hook.
 	if( hook_id.empty() ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Invalid hook." );
 	}
 
@@ -1084,7 +1759,6 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t parent_id, c
 	const Entity* parent_ent = m_world.find_entity( parent_id );
 
 	if( parent_ent == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Parent entity not found." );
 	}
 
@@ -1097,10 +1771,14 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t parent_id, c
 	// Remember properties.
 	Entity::ID ent_id = ent.get_id();
 	sf::Vector3f ent_position = ent.get_position();
+	const Planet* planet = nullptr;
+	Planet::Vector chunk_pos;
+	bool located = find_entity_chunk( ent, planet, chunk_pos );
 
-	m_lock_facility.lock_world( false );
+	world_lock.unlock();
 
-	// Notify clients. TODO: Only for clients in range.
+	// Notify clients seeing the top-level parent, or everybody if it isn't on a
+	// planet.
 	msg::CreateEntity msg;
 
 	msg.set_class( cls_id.get() );
@@ -1110,10 +1788,18 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t parent_id, c
 	msg.set_parent_hook( hook_id );
 	msg.set_parent_id( parent_id );
 
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected ) {
-			m_server->send_message( msg, static_cast<Server::ConnectionID>( client_idx ) );
-		}
+	if( located ) {
+		Server::ConnectionIDArray recipients;
+
+		m_lock_facility.lock_player_list( true );
+		m_interest_manager.find_interested( *planet, chunk_pos, recipients );
+		m_server->broadcast( msg, recipients );
+		m_lock_facility.lock_player_list( false );
+	}
+	else {
+		m_lock_facility.lock_player_list( true );
+		m_server->broadcast_if( msg, ConnectedPlayerPredicate( m_player_infos ) );
+		m_lock_facility.lock_player_list( false );
 	}
 
 	return ent_id;
@@ -1125,12 +1811,11 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t container_id
 		throw std::runtime_error( "Invalid class." );
 	}
 
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	const Class* cls = get_or_load_class( cls_id );
 
 	if( cls == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Class not found." );
 	}
 
@@ -1138,7 +1823,6 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t container_id
 	const Entity* parent_ent = m_world.find_entity( container_id );
 
 	if( parent_ent == nullptr ) {
-		m_lock_facility.lock_world( false );
 		throw std::runtime_error( "Parent entity not found." );
 	}
 
@@ -1151,10 +1835,14 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t container_id
 	// Remember properties.
 	Entity::ID ent_id = ent.get_id();
 	sf::Vector3f ent_position = ent.get_position();
+	const Planet* planet = nullptr;
+	Planet::Vector chunk_pos;
+	bool located = find_entity_chunk( ent, planet, chunk_pos );
 
-	m_lock_facility.lock_world( false );
+	world_lock.unlock();
 
-	// Notify clients. TODO: Only for clients in range.
+	// Notify clients seeing the container, or everybody if it isn't on a
+	// planet.
 	msg::CreateEntity msg;
 
 	msg.set_class( cls_id.get() );
@@ -1166,31 +1854,34 @@ uint32_t SessionHost::create_entity( const FlexID& cls_id, uint32_t container_id
 
 	// TODO Send only to player who currently has the container open? (hard to
 	// tell with current code)
-	for( std::size_t client_idx = 0; client_idx < m_player_infos.size(); ++client_idx ) {
-		if( m_player_infos[client_idx].connected ) {
-			m_server->send_message( msg, static_cast<Server::ConnectionID>( client_idx ) );
-		}
+	if( located ) {
+		Server::ConnectionIDArray recipients;
+
+		m_lock_facility.lock_player_list( true );
+		m_interest_manager.find_interested( *planet, chunk_pos, recipients );
+		m_server->broadcast( msg, recipients );
+		m_lock_facility.lock_player_list( false );
+	}
+	else {
+		m_lock_facility.lock_player_list( true );
+		m_server->broadcast_if( msg, ConnectedPlayerPredicate( m_player_infos ) );
+		m_lock_facility.lock_player_list( false );
 	}
 
 	return ent_id;
 }
 
 std::string SessionHost::get_entity_class_id( uint32_t entity_id ) {
-	m_lock_facility.lock_world( true );
+	ScopedLock world_lock( m_lock_facility, ScopedLock::WORLD );
 
 	// Get entity.
 	const Entity* entity = m_world.find_entity( entity_id );
 
 	if( entity == nullptr ) {
 		throw std::runtime_error( "Entity not found." );
-		m_lock_facility.lock_world( false );
 	}
 
-	std::string class_id = entity->get_class().get_id().get();
-
-	m_lock_facility.lock_world( false );
-
-	return class_id;
+	return entity->get_class().get_id().get();
 }
 
 }
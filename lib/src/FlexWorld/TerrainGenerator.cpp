@@ -1,18 +1,12 @@
-#ifndef NDEBUG
-#define OUTPUT_DEBUG_IMAGE
-#endif
-
 #include <FlexWorld/TerrainGenerator.hpp>
 #include <FlexWorld/Planet.hpp>
+#include <FlexWorld/HeightmapGenerator.hpp>
 
-#ifdef OUTPUT_DEBUG_IMAGE
-	#include <SFML/Graphics/Image.hpp> // XXX 
-#endif
-
-#include <libnoise/noise.h>
-#include <stdexcept>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
 #include <cassert>
-#include <iostream> // XXX 
 
 namespace fw {
 
@@ -20,7 +14,8 @@ TerrainGenerator::TerrainGenerator( const Class& default_cls ) :
 	m_default_cls( &default_cls ),
 	m_seed( 0 ),
 	m_base_height( 0 ),
-	m_max_height( 0 )
+	m_max_height( 0 ),
+	m_num_threads( 1 )
 {
 }
 
@@ -33,6 +28,9 @@ std::size_t TerrainGenerator::get_num_layers() const {
 }
 
 void TerrainGenerator::add_layer( const Layer& layer ) {
+	assert( layer.min_height < layer.max_height );
+	assert( layer.cls != nullptr );
+
 	m_layers.push_back( layer );
 }
 
@@ -66,134 +64,272 @@ void TerrainGenerator::set_maximum_height( uint32_t height ) {
 	m_max_height = height;
 }
 
-void TerrainGenerator::generate( Planet& planet, const util::Cuboid<uint32_t>& cuboid ) {
+std::size_t TerrainGenerator::get_num_threads() const {
+	return m_num_threads;
+}
+
+void TerrainGenerator::set_num_threads( std::size_t num_threads ) {
+	assert( num_threads > 0 );
+	m_num_threads = num_threads;
+}
+
+void TerrainGenerator::resolve_spans( SpanArray& spans ) const {
+	// Span borders are the base height and all layer borders.
+	std::vector<uint32_t> borders( 1, 0 );
+
+	borders.push_back( m_base_height );
+
+	for( std::size_t layer_idx = 0; layer_idx < m_layers.size(); ++layer_idx ) {
+		borders.push_back( m_layers[layer_idx].min_height );
+		borders.push_back( m_layers[layer_idx].max_height );
+	}
+
+	std::sort( borders.begin(), borders.end() );
+	borders.erase( std::unique( borders.begin(), borders.end() ), borders.end() );
+	borders.push_back( std::numeric_limits<uint32_t>::max() );
+
+	spans.clear();
+
+	for( std::size_t border_idx = 0; border_idx + 1 < borders.size(); ++border_idx ) {
+		Span span = { borders[border_idx], borders[border_idx + 1], nullptr };
+
+		if( span.min_y >= m_base_height ) {
+			span.cls = m_default_cls;
+		}
+
+		// Last covering layer wins.
+		for( std::size_t layer_idx = m_layers.size(); layer_idx > 0; --layer_idx ) {
+			const Layer& layer = m_layers[layer_idx - 1];
+
+			if( layer.min_height <= span.min_y && layer.max_height >= span.max_y ) {
+				span.cls = layer.cls;
+				break;
+			}
+		}
+
+		// Merge with previous span of the same class.
+		if( !spans.empty() && spans.back().cls == span.cls ) {
+			spans.back().max_y = span.max_y;
+		}
+		else {
+			spans.push_back( span );
+		}
+	}
+}
+
+void TerrainGenerator::sample_heights(
+	const util::Cuboid<uint32_t>& cuboid,
+	uint32_t job_width,
+	uint32_t job_depth,
+	std::size_t first_job,
+	std::size_t job_step,
+	HeightArray& tops
+) const {
+	HeightmapGenerator heightmap;
+
+	heightmap.set_seed( m_seed );
+	heightmap.set_persistence( 1.1 );
+	heightmap.set_frequency( 1.0 / 800.0 );
+
+	std::vector<double> values( static_cast<std::size_t>( job_width ) * job_depth );
+	uint32_t num_jobs_x = (cuboid.width + job_width - 1) / job_width;
+	uint32_t num_jobs_z = (cuboid.depth + job_depth - 1) / job_depth;
+	std::size_t num_jobs = static_cast<std::size_t>( num_jobs_x ) * num_jobs_z;
+	double max_height = static_cast<double>( m_max_height );
+	double value = 0;
+
+	for( std::size_t job_idx = first_job; job_idx < num_jobs; job_idx += job_step ) {
+		uint32_t min_x = static_cast<uint32_t>( job_idx % num_jobs_x ) * job_width;
+		uint32_t min_z = static_cast<uint32_t>( job_idx / num_jobs_x ) * job_depth;
+		uint32_t max_x = std::min( min_x + job_width, cuboid.width );
+		uint32_t max_z = std::min( min_z + job_depth, cuboid.depth );
+
+		heightmap.generate(
+			static_cast<int32_t>( cuboid.x + min_x ),
+			static_cast<int32_t>( cuboid.z + min_z ),
+			max_x - min_x,
+			max_z - min_z,
+			&values[0]
+		);
+
+		for( uint32_t z = min_z; z < max_z; ++z ) {
+			for( uint32_t x = min_x; x < max_x; ++x ) {
+				value = values[(z - min_z) * (max_x - min_x) + (x - min_x)];
+				value = std::max( -1.0, std::min( 1.0, value ) );
+				value = (value + 1.0) / 2.0f;
+				value *= max_height;
+
+				tops[z * cuboid.width + x] = m_base_height + static_cast<uint32_t>( value );
+			}
+		}
+	}
+}
+
+void TerrainGenerator::generate( Planet& planet, const util::Cuboid<uint32_t>& cuboid ) const {
 	assert( cuboid.x + cuboid.width <= planet.get_size().x * planet.get_chunk_size().x );
 	assert( cuboid.y + cuboid.height <= planet.get_size().y * planet.get_chunk_size().y );
 	assert( cuboid.z + cuboid.depth <= planet.get_size().z * planet.get_chunk_size().z );
 	assert( cuboid.y + m_base_height + m_max_height <= planet.get_size().y * planet.get_chunk_size().y );
 
-	// Prepare Perlin noise generator.
-	using namespace noise::module;
-	Perlin perlin;
-
-	perlin.SetSeed( m_seed );
-	perlin.SetPersistence( 1.1 );
+	if( cuboid.width == 0 || cuboid.height == 0 || cuboid.depth == 0 ) {
+		return;
+	}
 
-	// Prepare loops.
-	uint32_t max_x = cuboid.x + cuboid.width;
-	uint32_t max_z = cuboid.z + cuboid.depth;
-	Planet::Vector initial_chunk_pos( 0, 0, 0 );
-	Chunk::Vector initial_block_pos( 0, 0, 0 );
-	Chunk::Vector chunk_size = planet.get_chunk_size();
-	double value = 0;
-	uint32_t final_value = 0;
-	uint32_t y = 0;
-
-	// Get initial chunk and block positions.
-	bool result = planet.transform(
-		Planet::Coordinate(
-			static_cast<float>( cuboid.x ),
-			static_cast<float>( cuboid.y ),
-			static_cast<float>( cuboid.z )
-		),
-		initial_chunk_pos,
-		initial_block_pos
-	);
+	const Chunk::Vector& chunk_size = planet.get_chunk_size();
 
-	assert( result );
-	if( !result ) {
-		throw std::runtime_error( "Failed to transform planet coordinate." );
+	// Sample surface heights, one job per chunk column. Jobs are distributed
+	// round-robin, and each writes its own part of the height array.
+	HeightArray tops( static_cast<std::size_t>( cuboid.width ) * cuboid.depth );
+	std::size_t num_jobs =
+		static_cast<std::size_t>( (cuboid.width + chunk_size.x - 1) / chunk_size.x ) *
+		static_cast<std::size_t>( (cuboid.depth + chunk_size.z - 1) / chunk_size.z )
+	;
+	std::size_t num_threads = std::min( m_num_threads, num_jobs );
+	boost::thread_group threads;
+
+	for( std::size_t thread_idx = 1; thread_idx < num_threads; ++thread_idx ) {
+		threads.create_thread(
+			boost::bind(
+				&TerrainGenerator::sample_heights,
+				this,
+				boost::cref( cuboid ),
+				static_cast<uint32_t>( chunk_size.x ),
+				static_cast<uint32_t>( chunk_size.z ),
+				thread_idx,
+				num_threads,
+				boost::ref( tops )
+			)
+		);
 	}
 
-	Planet::Vector chunk_pos = initial_chunk_pos;
-	Chunk::Vector block_pos = initial_block_pos;
-	double max_height = static_cast<double>( m_max_height );
-	double base = static_cast<double>( m_base_height );
-
-#ifdef OUTPUT_DEBUG_IMAGE
-	sf::Image debug_image;
-	debug_image.create( cuboid.width, cuboid.depth );
-#endif
-
-	for( uint32_t z = cuboid.z; z < max_z; ++z ) {
-		for( uint32_t x = cuboid.x; x < max_x; ++x ) {
-			value = perlin.GetValue(
-				static_cast<double>( x ) / 800.0,
-				0.1,
-				static_cast<double>( z ) / 800.0
-			);
+	sample_heights( cuboid, chunk_size.x, chunk_size.z, 0, num_threads, tops );
+	threads.join_all();
+
+	// Create the chunks of every chunk column up to its highest surface.
+	uint32_t cuboid_top = cuboid.y + cuboid.height;
+	Planet::Vector chunk_pos( 0, 0, 0 );
+	Planet::ScalarType first_chunk_y = static_cast<Planet::ScalarType>( cuboid.y / chunk_size.y );
+
+	for( uint32_t min_z = cuboid.z - cuboid.z % chunk_size.z; min_z < cuboid.z + cuboid.depth; min_z += chunk_size.z ) {
+		for( uint32_t min_x = cuboid.x - cuboid.x % chunk_size.x; min_x < cuboid.x + cuboid.width; min_x += chunk_size.x ) {
+			uint32_t top = 0;
+
+			for( uint32_t z = std::max( min_z, cuboid.z ); z < std::min( min_z + chunk_size.z, cuboid.z + cuboid.depth ); ++z ) {
+				for( uint32_t x = std::max( min_x, cuboid.x ); x < std::min( min_x + chunk_size.x, cuboid.x + cuboid.width ); ++x ) {
+					top = std::max( top, tops[(z - cuboid.z) * cuboid.width + (x - cuboid.x)] );
+				}
+			}
 
-			value = std::max( -1.0, std::min( 1.0, value ) );
-			value = (value + 1.0) / 2.0f;
-			value *= max_height;
-
-#ifdef OUTPUT_DEBUG_IMAGE
-			debug_image.setPixel(
-				x,
-				z,
-				sf::Color(
-					static_cast<sf::Uint8>( value * 255.0 ),
-					static_cast<sf::Uint8>( value * 255.0 ),
-					static_cast<sf::Uint8>( value * 255.0 )
+			Planet::ScalarType last_chunk_y = static_cast<Planet::ScalarType>(
+				std::min(
+					std::max( std::min( top, cuboid_top ) / chunk_size.y, static_cast<uint32_t>( first_chunk_y ) ),
+					static_cast<uint32_t>( planet.get_size().y - 1 )
 				)
 			);
-#endif
-
-			final_value = m_base_height + static_cast<uint32_t>( value );
 
-			// Save blocks at planet.
-			block_pos.y = initial_block_pos.y;
-			chunk_pos.y = initial_chunk_pos.y;
+			chunk_pos.x = static_cast<Planet::ScalarType>( min_x / chunk_size.x );
+			chunk_pos.z = static_cast<Planet::ScalarType>( min_z / chunk_size.z );
 
-			if( !planet.has_chunk( chunk_pos ) ) {
-				planet.create_chunk( chunk_pos );
+			for( chunk_pos.y = first_chunk_y; chunk_pos.y <= last_chunk_y; ++chunk_pos.y ) {
+				if( !planet.has_chunk( chunk_pos ) ) {
+					planet.create_chunk( chunk_pos );
+				}
 			}
+		}
+	}
 
-			for(
-				y = cuboid.y;
-				y < final_value && y < cuboid.y + cuboid.height;
-				++y
-			) {
-				// Skip base blocks. TODO
-				if( y >= m_base_height ) {
-					// Set the block.
-					planet.set_block( chunk_pos, block_pos, *m_default_cls );
-				}
+	// Write the blocks of every span at once.
+	SpanArray spans;
+	resolve_spans( spans );
 
-				// Advance block.
-				++block_pos.y;
+	for( std::size_t span_idx = 0; span_idx < spans.size(); ++span_idx ) {
+		uint32_t min_y = std::max( spans[span_idx].min_y, cuboid.y );
+		uint32_t max_y = std::min( spans[span_idx].max_y, cuboid_top );
 
-				if( block_pos.y >= chunk_size.y ) {
-					block_pos.y = 0;
-					++chunk_pos.y;
+		if( spans[span_idx].cls == nullptr || min_y >= max_y ) {
+			continue;
+		}
 
-					// Create chunk.
-					if( !planet.has_chunk( chunk_pos ) ) {
-						planet.create_chunk( chunk_pos );
-					}
-				}
-			}
+		planet.fill_columns(
+			Planet::BlockCuboid( cuboid.x, min_y, cuboid.z, cuboid.width, max_y - min_y, cuboid.depth ),
+			tops,
+			*spans[span_idx].cls
+		);
+	}
+}
 
-			++block_pos.x;
-			if( block_pos.x >= chunk_size.x ) {
-				block_pos.x = 0;
-				++chunk_pos.x;
-			}
+void TerrainGenerator::generate_chunk( Planet& planet, const Planet::Vector& chunk_pos ) const {
+	assert( chunk_pos.x < planet.get_size().x );
+	assert( chunk_pos.y < planet.get_size().y );
+	assert( chunk_pos.z < planet.get_size().z );
+
+	const Chunk::Vector& chunk_size = planet.get_chunk_size();
+	util::Cuboid<uint32_t> cuboid(
+		static_cast<uint32_t>( chunk_pos.x ) * chunk_size.x,
+		static_cast<uint32_t>( chunk_pos.y ) * chunk_size.y,
+		static_cast<uint32_t>( chunk_pos.z ) * chunk_size.z,
+		chunk_size.x,
+		chunk_size.y,
+		chunk_size.z
+	);
+
+	// Height grid of the chunk's columns.
+	HeightArray tops( static_cast<std::size_t>( chunk_size.x ) * chunk_size.z );
+	sample_heights( cuboid, chunk_size.x, chunk_size.z, 0, 1, tops );
+
+	// Resolve the class of every Y position once.
+	SpanArray spans;
+	Planet::ClassArray classes;
+	std::vector<Chunk::Block> row_blocks( chunk_size.y, Chunk::INVALID_BLOCK );
+	std::size_t span_idx = 0;
+
+	resolve_spans( spans );
+
+	for( uint32_t y = 0; y < chunk_size.y; ++y ) {
+		while( spans[span_idx].max_y <= cuboid.y + y ) {
+			++span_idx;
+		}
+
+		if( spans[span_idx].cls == nullptr ) {
+			continue;
+		}
+
+		Planet::ClassArray::iterator cls_iter = std::find( classes.begin(), classes.end(), spans[span_idx].cls );
+
+		if( cls_iter == classes.end() ) {
+			cls_iter = classes.insert( classes.end(), spans[span_idx].cls );
 		}
 
-		chunk_pos.x = initial_chunk_pos.x;
-		block_pos.x = initial_block_pos.x;
+		row_blocks[y] = static_cast<Chunk::Block>( cls_iter - classes.begin() );
+	}
+
+	// Fill rows up to the columns' tops.
+	std::vector<Chunk::Block> blocks( static_cast<std::size_t>( chunk_size.x ) * chunk_size.y * chunk_size.z, Chunk::INVALID_BLOCK );
+	bool has_blocks = false;
+
+	for( uint32_t z = 0; z < chunk_size.z; ++z ) {
+		for( uint32_t y = 0; y < chunk_size.y; ++y ) {
+			if( row_blocks[y] == Chunk::INVALID_BLOCK ) {
+				continue;
+			}
+
+			Chunk::Block* row = &blocks[(z * chunk_size.y + y) * chunk_size.x];
+			const uint32_t* row_tops = &tops[z * chunk_size.x];
 
-		++block_pos.z;
-		if( block_pos.z >= chunk_size.z ) {
-			block_pos.z = 0;
-			++chunk_pos.z;
+			for( uint32_t x = 0; x < chunk_size.x; ++x ) {
+				if( cuboid.y + y < row_tops[x] ) {
+					row[x] = row_blocks[y];
+					has_blocks = true;
+				}
+			}
 		}
 	}
 
-#ifdef OUTPUT_DEBUG_IMAGE
-	debug_image.saveToFile( "debug.png" );
-#endif
+	if( !has_blocks && !planet.has_chunk( chunk_pos ) ) {
+		return;
+	}
+
+	planet.set_chunk_blocks( chunk_pos, &blocks[0], classes );
 }
 
 // --------------------------------------------------
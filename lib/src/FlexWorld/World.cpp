@@ -98,6 +98,29 @@ Entity& World::create_entity( const FlexID& class_id ) {
 	return *result.first->second;
 }
 
+Entity& World::create_entity( Entity::ID id, const Class& cls ) {
+	assert( find_entity( id ) == nullptr );
+	assert( find_class( cls.get_id() ) == &cls );
+
+	Entity* ent = new Entity( cls );
+	ent->set_id( id );
+
+	// Hint at the end, restored entities usually come in ascending order.
+	EntityMap::iterator ent_iter = m_entities.insert(
+		m_entities.end(),
+		std::pair<const Entity::ID, Entity*>(
+			id,
+			ent
+		)
+	);
+
+	if( id >= m_next_entity_id ) {
+		m_next_entity_id = id + 1;
+	}
+
+	return *ent_iter->second;
+}
+
 Entity* World::find_entity( Entity::ID id ) {
 	if( id >= m_next_entity_id ) {
 		return nullptr;
@@ -162,6 +185,13 @@ Planet* World::find_linked_planet( Entity::ID entity_id ) {
 	return link_iter != m_links.end() ? link_iter->second : nullptr;
 }
 
+const Planet* World::find_linked_planet( Entity::ID entity_id ) const {
+	assert( find_entity( entity_id ) != nullptr );
+
+	LinkMap::const_iterator link_iter = m_links.find( entity_id );
+	return link_iter != m_links.end() ? link_iter->second : nullptr;
+}
+
 void World::unlink_entity_from_planet( Entity::ID entity_id ) {
 	assert( find_linked_planet( entity_id ) != nullptr );
 
@@ -185,6 +215,14 @@ World::PlanetConstIterator World::planets_end() const {
 	return m_planets.end();
 }
 
+World::EntityConstIterator World::entities_begin() const {
+	return m_entities.begin();
+}
+
+World::EntityConstIterator World::entities_end() const {
+	return m_entities.end();
+}
+
 void World::attach_entity( Entity::ID source_id, Entity::ID target_id, const std::string& hook_id ) {
 	Entity* source = find_entity( source_id );
 	Entity* target = find_entity( target_id );
@@ -1,3 +1,203 @@
-int main() {
+#include <FlexWorld/Config.hpp>
+#include <FlexWorld/GameModeDriver.hpp>
+#include <FlexWorld/SessionHost.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/AccountManager.hpp>
+#include <FlexWorld/AccountStore.hpp>
+#include <FlexWorld/World.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <csignal>
+
+struct Options {
+	Options() :
+		ip( "0.0.0.0" ),
+		port( 2593 ),
+		num_threads( boost::thread::hardware_concurrency() ),
+		player_limit( 0 ),
+		data_path( "." )
+	{
+	}
+
+	std::string ip;
+	unsigned short port;
+	std::size_t num_threads;
+	std::size_t player_limit;
+	std::string data_path;
+};
+
+void print_usage() {
+	std::cout << "Usage: flexworld-server [OPTION...]" << std::endl
+		<< "Run a dedicated FlexWorld server." << std::endl
+		<< std::endl
+		<< "Options:" << std::endl
+		<< "  --ip IP          Address to listen on (default: 0.0.0.0)." << std::endl
+		<< "  --port PORT      Port to listen on (default: 2593)." << std::endl
+		<< "  --threads N      Number of threads running the network I/O and message" << std::endl
+		<< "                   handlers (default: number of CPU cores)." << std::endl
+		<< "  --players N      Player limit (default: unlimited)." << std::endl
+		<< "  --data PATH      Directory for accounts, planets and entities (default: .)." << std::endl
+	;
+}
+
+bool parse_options( int argc, char** argv, Options& options ) {
+	for( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+		std::string arg = argv[arg_idx];
+
+		if( arg_idx + 1 >= argc ) {
+			return false;
+		}
+
+		std::string value = argv[++arg_idx];
+
+		try {
+			if( arg == "--ip" ) {
+				options.ip = value;
+			}
+			else if( arg == "--port" ) {
+				options.port = boost::lexical_cast<unsigned short>( value );
+			}
+			else if( arg == "--threads" ) {
+				options.num_threads = boost::lexical_cast<std::size_t>( value );
+			}
+			else if( arg == "--players" ) {
+				options.player_limit = boost::lexical_cast<std::size_t>( value );
+			}
+			else if( arg == "--data" ) {
+				options.data_path = value;
+			}
+			else {
+				return false;
+			}
+		}
+		catch( const boost::bad_lexical_cast& /*e*/ ) {
+			return false;
+		}
+	}
+
+	// hardware_concurrency() returns 0 if unknown.
+	if( options.num_threads == 0 ) {
+		options.num_threads = 1;
+	}
+
+	return true;
+}
+
+void run_io_service( boost::asio::io_service* io_service ) {
+	io_service->run();
+}
+
+void handle_signal( boost::asio::io_service* io_service, const boost::system::error_code& error ) {
+	if( !error ) {
+		std::cout << "Shutting down..." << std::endl;
+		io_service->stop();
+	}
+}
+
+int main( int argc, char** argv ) {
+	Options options;
+
+	if( !parse_options( argc, argv, options ) ) {
+		print_usage();
+		return 1;
+	}
+
+	// Load game mode.
+	std::ifstream in( (fw::ROOT_DATA_DIRECTORY + std::string( "modes/sandbox.yml" )).c_str() );
+	std::stringstream buffer;
+	fw::GameMode game_mode;
+
+	buffer << in.rdbuf();
+
+	try {
+		game_mode = fw::GameModeDriver::deserialize( buffer.str() );
+	}
+	catch( const fw::GameModeDriver::DeserializeException& e ) {
+		std::cerr << "Failed to load game mode: " << e.what() << std::endl;
+		return 1;
+	}
+
+	// Prepare backend.
+	boost::asio::io_service io_service;
+	fw::AccountManager account_manager;
+	fw::AccountStore account_store( options.data_path + "/accounts" );
+	fw::LockFacility lock_facility;
+	fw::World world;
+
+	try {
+		boost::filesystem::create_directories( options.data_path );
+		account_store.open();
+
+		// Migrate accounts saved as YAML files before.
+		if( account_store.get_num_accounts() == 0 ) {
+			std::size_t num_failed = 0;
+			std::size_t num_imported = account_store.import_directory( account_store.get_directory(), num_failed );
+
+			if( num_imported > 0 || num_failed > 0 ) {
+				std::cout << "Imported " << num_imported << " accounts (" << num_failed << " failed)." << std::endl;
+			}
+		}
+
+		account_manager.set_store( &account_store );
+	}
+	catch( const boost::filesystem::filesystem_error& e ) {
+		std::cerr << "Failed to create data directory: " << e.what() << std::endl;
+		return 1;
+	}
+	catch( const fw::AccountStore::ReadException& e ) {
+		std::cerr << "Failed to open account store: " << e.what() << std::endl;
+		return 1;
+	}
+	catch( const fw::AccountStore::WriteException& e ) {
+		std::cerr << "Failed to import accounts: " << e.what() << std::endl;
+		return 1;
+	}
+
+	// Setup session host.
+	fw::SessionHost host( io_service, lock_facility, account_manager, world, game_mode );
+
+	host.add_search_path( fw::ROOT_DATA_DIRECTORY + std::string( "packages" ) );
+	host.set_auth_mode( fw::SessionHost::OPEN_AUTH );
+	host.set_planets_path( options.data_path + "/planets" );
+	host.set_entities_path( options.data_path + "/entities" );
+	host.set_ip( options.ip );
+	host.set_port( options.port );
+
+	if( options.player_limit > 0 ) {
+		host.set_player_limit( options.player_limit );
+	}
+
+	if( !host.start() ) {
+		std::cerr << "Failed to start server on " << options.ip << ":" << options.port << "." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Listening on " << options.ip << ":" << options.port << " with " << options.num_threads << " thread(s)." << std::endl;
+
+	// Stop the I/O threads on SIGINT or SIGTERM.
+	boost::asio::signal_set signals( io_service, SIGINT, SIGTERM );
+	signals.async_wait( boost::bind( &handle_signal, &io_service, boost::asio::placeholders::error ) );
+
+	// Connections are handled in their strands, so messages of different
+	// connections are processed in parallel.
+	boost::thread_group threads;
+
+	for( std::size_t thread_idx = 0; thread_idx < options.num_threads; ++thread_idx ) {
+		threads.create_thread( boost::bind( &run_io_service, &io_service ) );
+	}
+
+	threads.join_all();
+
+	// No handlers are running anymore, save and disconnect everybody.
+	host.stop();
+
 	return 0;
 }
@@ -36,6 +36,18 @@ void ExampleWorldGate::set_block( const BlockPosition& block_position, const std
 	}
 }
 
+uint32_t ExampleWorldGate::get_surface_height( uint32_t x, uint32_t z, const std::string& planet ) {
+	if( x != 7 || z != 8 ) {
+		throw std::runtime_error( "Invalid column position." );
+	}
+
+	if( planet != "planet" ) {
+		throw std::runtime_error( "Invalid planet." );
+	}
+
+	return 42;
+}
+
 uint32_t ExampleWorldGate::create_entity( const fw::FlexID& cls_id, const EntityPosition& position, const std::string& planet_id ) {
 	if( cls_id.get() != "some/class" ) {
 		throw std::runtime_error( "Invalid class." );
@@ -9,6 +9,7 @@ class ExampleWorldGate : public fw::lua::WorldGate {
 	public:
 		void destroy_block( const BlockPosition& block_position, const std::string& planet );
 		void set_block( const BlockPosition& block_position, const std::string& planet, const fw::FlexID& cls );
+		uint32_t get_surface_height( uint32_t x, uint32_t z, const std::string& planet );
 		uint32_t create_entity( const fw::FlexID& cls_id, const EntityPosition& position, const std::string& planet_id );
 		uint32_t create_entity( const fw::FlexID& cls_id, uint32_t parent_id, const std::string& hook_id );
 		uint32_t create_entity( const fw::FlexID& cls_id, uint32_t container_id );
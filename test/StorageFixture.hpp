@@ -0,0 +1,30 @@
+#pragma once
+
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+
+/** Fixture for tests that write files.
+ * Provides a unique temporary directory and some block classes. The directory
+ * is removed together with its contents when the fixture is destroyed, so it
+ * is also cleaned up if a test throws.
+ */
+struct StorageFixture {
+	StorageFixture() :
+		directory( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path( "fwtest-%%%%-%%%%" ) ),
+		grass( fw::FlexID::make( "fw.base.nature/grass" ) ),
+		stone( fw::FlexID::make( "fw.base.nature/stone" ) ),
+		sand( fw::FlexID::make( "fw.base.nature/sand" ) )
+	{
+	}
+
+	~StorageFixture() {
+		boost::system::error_code error;
+		boost::filesystem::remove_all( directory, error );
+	}
+
+	boost::filesystem::path directory;
+	const fw::Class grass;
+	const fw::Class stone;
+	const fw::Class sand;
+};
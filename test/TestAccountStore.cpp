@@ -0,0 +1,225 @@
+#include "Config.hpp"
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/AccountStore.hpp>
+#include <FlexWorld/AccountManager.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <sstream>
+#include <fstream>
+
+BOOST_FIXTURE_TEST_CASE( TestAccountStore, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	std::string data_path = (directory / AccountStore::DATA_FILENAME).string();
+	std::string index_path = (directory / AccountStore::INDEX_FILENAME).string();
+
+	// Initial state.
+	{
+		AccountStore store( directory.string() );
+
+		BOOST_CHECK( store.get_directory() == directory.string() );
+		BOOST_CHECK( store.is_open() == false );
+
+		// Missing directory.
+		store.open();
+
+		BOOST_CHECK( store.is_open() == true );
+		BOOST_CHECK( store.get_num_accounts() == 0 );
+		BOOST_CHECK( fs::exists( data_path ) == true );
+
+		Account account;
+		BOOST_CHECK( store.find_account( "John", account ) == false );
+	}
+
+	// Put, replace and remove accounts.
+	{
+		AccountStore store( directory.string() );
+		store.open();
+
+		Account account;
+		account.set_username( "John" );
+		account.set_password( "meowfoo" );
+		account.set_entity_id( 11 );
+
+		store.put_account( account );
+		BOOST_CHECK( store.get_num_accounts() == 1 );
+
+		account.set_password( "newpass" );
+		store.put_account( account );
+		BOOST_CHECK( store.get_num_accounts() == 1 );
+
+		account.set_username( "Tank" );
+		account.set_password( "meowfoo" );
+		account.set_entity_id( 22 );
+		store.put_account( account );
+
+		account.set_username( "Gone" );
+		store.put_account( account );
+		BOOST_CHECK( store.get_num_accounts() == 3 );
+
+		BOOST_CHECK( store.remove_account( "Gone" ) == true );
+		BOOST_CHECK( store.remove_account( "Gone" ) == false );
+		BOOST_CHECK( store.get_num_accounts() == 2 );
+
+		Account found;
+		BOOST_REQUIRE( store.find_account( "John", found ) == true );
+		BOOST_CHECK( found.get_username() == "John" );
+		BOOST_CHECK( found.get_password() == "newpass" );
+		BOOST_CHECK( found.get_entity_id() == 11 );
+		BOOST_CHECK( store.find_account( "Gone", found ) == false );
+	}
+
+	// Reopen with index.
+	{
+		BOOST_CHECK( fs::exists( index_path ) == true );
+
+		AccountStore store( directory.string() );
+		store.open();
+
+		BOOST_CHECK( store.get_num_accounts() == 2 );
+
+		Account found;
+		BOOST_REQUIRE( store.find_account( "Tank", found ) == true );
+		BOOST_CHECK( found.get_password() == "meowfoo" );
+		BOOST_CHECK( found.get_entity_id() == 22 );
+		BOOST_CHECK( store.find_account( "Gone", found ) == false );
+
+		// Written after the index, picked up with the next open.
+		found.set_username( "Late" );
+		store.put_account( found );
+		store.remove_account( "John" );
+
+		// Simulate a crash: keep the previous index.
+		fs::copy_file( index_path, index_path + ".old" );
+	}
+
+	{
+		fs::remove( index_path );
+		fs::rename( index_path + ".old", index_path );
+
+		AccountStore store( directory.string() );
+		store.open();
+
+		Account found;
+		BOOST_CHECK( store.get_num_accounts() == 2 );
+		BOOST_CHECK( store.find_account( "Late", found ) == true );
+		BOOST_CHECK( store.find_account( "John", found ) == false );
+	}
+
+	// Damaged index and data tail.
+	{
+		{
+			std::ofstream out( index_path.c_str(), std::ios::binary | std::ios::trunc );
+			out << "FWXX";
+		}
+
+		uintmax_t size = fs::file_size( data_path );
+		fs::resize_file( data_path, size - 2 );
+
+		AccountStore store( directory.string() );
+		store.open();
+
+		// Last record (removing John) is dropped.
+		Account found;
+		BOOST_CHECK( fs::file_size( data_path ) < size - 2 );
+		BOOST_CHECK( store.get_num_accounts() == 3 );
+		BOOST_CHECK( store.find_account( "John", found ) == true );
+		BOOST_CHECK( store.find_account( "Late", found ) == true );
+	}
+
+	// Many accounts (growing the index).
+	{
+		AccountStore store( directory.string() );
+		store.open();
+
+		for( uint32_t account_idx = 0; account_idx < 1000; ++account_idx ) {
+			std::stringstream username;
+			username << "Player" << account_idx;
+
+			Account account;
+			account.set_username( username.str() );
+			account.set_password( "pass" );
+			account.set_entity_id( account_idx );
+
+			store.put_account( account );
+		}
+
+		for( uint32_t account_idx = 0; account_idx < 1000; account_idx += 2 ) {
+			std::stringstream username;
+			username << "Player" << account_idx;
+
+			store.remove_account( username.str() );
+		}
+
+		BOOST_CHECK( store.get_num_accounts() == 503 );
+		store.flush();
+
+		AccountStore reopened( directory.string() );
+		reopened.open();
+
+		BOOST_CHECK( reopened.get_num_accounts() == 503 );
+
+		Account found;
+		BOOST_CHECK( reopened.find_account( "Player998", found ) == false );
+		BOOST_REQUIRE( reopened.find_account( "Player999", found ) == true );
+		BOOST_CHECK( found.get_entity_id() == 999 );
+	}
+
+	// Import YAML accounts.
+	{
+		fs::remove_all( directory );
+
+		AccountStore store( directory.string() );
+		store.open();
+
+		std::size_t num_failed = 0;
+
+		BOOST_CHECK( store.import_directory( DATA_DIRECTORY + "/saves/test/accounts", num_failed ) == 2 );
+		BOOST_CHECK( num_failed == 1 );
+		BOOST_CHECK( store.get_num_accounts() == 2 );
+
+		Account found;
+		BOOST_REQUIRE( store.find_account( "John", found ) == true );
+		BOOST_CHECK( found.get_password() == "meowfoo" );
+		BOOST_CHECK( found.get_entity_id() == 11 );
+		BOOST_REQUIRE( store.find_account( "Tank", found ) == true );
+		BOOST_CHECK( found.get_entity_id() == 22 );
+	}
+
+	// Account manager backed by the store.
+	{
+		AccountStore store( directory.string() );
+		store.open();
+
+		AccountManager mgr;
+		mgr.set_store( &store );
+
+		BOOST_CHECK( mgr.get_store() == &store );
+		BOOST_CHECK( mgr.get_num_accounts() == 2 );
+
+		const Account* account = mgr.find_account( "Tank" );
+		BOOST_REQUIRE( account != nullptr );
+		BOOST_CHECK( account->get_password() == "meowfoo" );
+		BOOST_CHECK( mgr.find_account( "Nobody" ) == nullptr );
+
+		Account new_account;
+		new_account.set_username( "Neo" );
+		new_account.set_password( "thereisnospoon" );
+		new_account.set_entity_id( 33 );
+		mgr.add_account( new_account );
+
+		new_account.set_entity_id( 34 );
+		mgr.update_account( new_account );
+		mgr.remove_account( "John" );
+
+		BOOST_CHECK( mgr.get_num_accounts() == 2 );
+
+		Account found;
+		BOOST_REQUIRE( store.find_account( "Neo", found ) == true );
+		BOOST_CHECK( found.get_entity_id() == 34 );
+		BOOST_CHECK( store.find_account( "John", found ) == false );
+	}
+}
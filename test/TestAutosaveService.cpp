@@ -0,0 +1,188 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/AutosaveService.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+class TestAutosaveServiceHandler : public fw::AutosaveService::Handler {
+	public:
+		TestAutosaveServiceHandler() :
+			m_num_autosaves( 0 )
+		{
+		}
+
+		void handle_autosave() {
+			++m_num_autosaves;
+		}
+
+		std::size_t m_num_autosaves;
+};
+
+BOOST_FIXTURE_TEST_CASE( TestAutosaveService, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const Planet::Vector SIZE( 4, 2, 4 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	// Initial state.
+	{
+		LockFacility facility;
+		AutosaveService service( facility, directory.string() );
+
+		BOOST_CHECK( service.get_directory() == directory.string() );
+		BOOST_CHECK( service.get_planet_directory( "construct" ) == (directory / "construct").string() );
+		BOOST_CHECK( service.get_interval() == 300 );
+		BOOST_CHECK( service.is_saving() == false );
+		BOOST_CHECK( service.is_running() == false );
+		BOOST_CHECK( service.get_num_pending_chunks() == 0 );
+
+		AutosaveService::Statistics stats = service.get_statistics();
+		BOOST_CHECK( stats.num_saves == 0 );
+		BOOST_CHECK( stats.num_failed_saves == 0 );
+		BOOST_CHECK( stats.num_saved_chunks == 0 );
+		BOOST_CHECK( stats.last_num_chunks == 0 );
+		BOOST_CHECK( stats.max_lock_time == 0 );
+		BOOST_CHECK( stats.total_lock_time == 0 );
+
+		service.set_interval( 10 );
+		BOOST_CHECK( service.get_interval() == 10 );
+
+		// Nothing to save.
+		BOOST_CHECK( service.save() == 0 );
+		BOOST_CHECK( service.get_statistics().num_saves == 1 );
+	}
+
+	// Add and remove planets.
+	{
+		LockFacility facility;
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		AutosaveService service( facility, directory.string() );
+
+		facility.create_planet_lock( planet );
+
+		BOOST_CHECK( service.has_planet( planet ) == false );
+		service.add_planet( planet );
+		BOOST_CHECK( service.has_planet( planet ) == true );
+		BOOST_CHECK( fs::is_directory( directory / "construct" ) == true );
+
+		service.remove_planet( planet );
+		BOOST_CHECK( service.has_planet( planet ) == false );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Save dirty chunks only.
+	{
+		LockFacility facility;
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		AutosaveService service( facility, directory.string() );
+
+		facility.create_planet_lock( planet );
+		service.add_planet( planet );
+
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 0, 64, 10, 64 ), stone );
+		planet.fill_region( Planet::BlockCuboid( 0, 10, 0, 64, 1, 64 ), grass );
+
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 16 );
+		BOOST_CHECK( service.save() == 16 );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+		BOOST_CHECK( service.get_num_pending_chunks() == 0 );
+
+		AutosaveService::Statistics stats = service.get_statistics();
+		BOOST_CHECK( stats.num_saves == 1 );
+		BOOST_CHECK( stats.num_failed_saves == 0 );
+		BOOST_CHECK( stats.num_saved_chunks == 16 );
+		BOOST_CHECK( stats.last_num_chunks == 16 );
+		BOOST_CHECK( stats.max_lock_time <= stats.total_lock_time );
+
+		// Unchanged chunks aren't saved again.
+		BOOST_CHECK( service.save() == 0 );
+
+		planet.set_block( Planet::Vector( 3, 0, 3 ), Chunk::Vector( 1, 2, 3 ), grass );
+		planet.create_chunk( Planet::Vector( 0, 1, 0 ) );
+		planet.set_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 0, 0 ), stone );
+
+		BOOST_CHECK( service.save() == 2 );
+
+		stats = service.get_statistics();
+		BOOST_CHECK( stats.num_saves == 3 );
+		BOOST_CHECK( stats.num_saved_chunks == 18 );
+		BOOST_CHECK( stats.last_num_chunks == 2 );
+
+		service.remove_planet( planet );
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Load saved planet.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		PlanetReader reader( (directory / "construct").string() );
+
+		reader.open();
+
+		Planet::ClassArray classes;
+
+		for( std::size_t cls_idx = 0; cls_idx < reader.get_num_classes(); ++cls_idx ) {
+			classes.push_back( reader.get_class_id( cls_idx ) == grass.get_id() ? &grass : &stone );
+		}
+
+		BOOST_CHECK( reader.load_planet( planet, classes ) == 17 );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 0, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 10, 0 ) ) == &grass );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 11, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 3, 0, 3 ), Chunk::Vector( 1, 2, 3 ) ) == &grass );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 0, 0 ) ) == &stone );
+	}
+
+	// Save in the worker thread.
+	{
+		LockFacility facility;
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		AutosaveService service( facility, directory.string() );
+		TestAutosaveServiceHandler handler;
+
+		facility.create_planet_lock( planet );
+		service.add_planet( planet );
+		service.set_handler( handler );
+		service.set_interval( 1 );
+		service.start();
+
+		BOOST_CHECK( service.is_running() == true );
+
+		facility.lock_planet( planet, true );
+		planet.create_chunk( Planet::Vector( 1, 1, 1 ) );
+		planet.set_block( Planet::Vector( 1, 1, 1 ), Chunk::Vector( 5, 5, 5 ), grass );
+		facility.lock_planet( planet, false );
+
+		for( std::size_t wait_idx = 0; wait_idx < 50 && service.get_statistics().num_saved_chunks == 0; ++wait_idx ) {
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 100 ) );
+		}
+
+		service.stop();
+
+		BOOST_CHECK( service.is_running() == false );
+		BOOST_CHECK( service.get_statistics().num_saved_chunks == 1 );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+
+		// The handler has been notified after the save (read after joining).
+		BOOST_CHECK( handler.m_num_autosaves > 0 );
+
+		PlanetReader reader( (directory / "construct").string() );
+		reader.open();
+
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 1, 1, 1 ) ) == true );
+
+		service.remove_planet( planet );
+		facility.destroy_planet_lock( planet );
+	}
+}
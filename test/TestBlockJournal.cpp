@@ -0,0 +1,363 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/BlockJournal.hpp>
+#include <FlexWorld/AutosaveService.hpp>
+#include <FlexWorld/RegionFile.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+BOOST_FIXTURE_TEST_CASE( TestBlockJournal, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const Planet::Vector SIZE( 4, 2, 4 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	// Initial state.
+	{
+		BlockJournal journal( directory.string() );
+
+		BOOST_CHECK( journal.get_directory() == directory.string() );
+		BOOST_CHECK( journal.is_open() == false );
+		BOOST_CHECK( journal.is_running() == false );
+		BOOST_CHECK( journal.get_commit_interval() == 10 );
+		BOOST_CHECK( journal.get_num_buffered_bytes() == 0 );
+
+		BlockJournal::Statistics stats = journal.get_statistics();
+		BOOST_CHECK( stats.num_edits == 0 );
+		BOOST_CHECK( stats.num_commits == 0 );
+		BOOST_CHECK( stats.num_failed_commits == 0 );
+		BOOST_CHECK( stats.num_bytes == 0 );
+
+		journal.set_commit_interval( 50 );
+		BOOST_CHECK( journal.get_commit_interval() == 50 );
+
+		// Nothing to read.
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 0 );
+		BOOST_CHECK( class_ids.empty() == true );
+		BOOST_CHECK( edits.empty() == true );
+	}
+
+	// Append, sync and read.
+	{
+		BlockJournal journal( directory.string() );
+		journal.open();
+
+		BOOST_CHECK( journal.is_open() == true );
+		BOOST_CHECK( journal.get_segment() == 1 );
+		BOOST_CHECK( fs::exists( directory / "journal.1.fwj" ) == true );
+
+		journal.append( Planet::BlockPosition( 1, 2, 3 ), &grass, 5 );
+		journal.append( Planet::BlockPosition( 63, 31, 63 ), &stone, 2 );
+		journal.append( Planet::BlockPosition( 1, 2, 3 ), nullptr, 6 );
+		journal.append( Planet::BlockPosition( 4, 5, 6 ), &grass, 3 );
+
+		BOOST_CHECK( journal.get_num_buffered_bytes() > 0 );
+		BOOST_CHECK( journal.get_statistics().num_edits == 4 );
+
+		journal.sync();
+
+		BOOST_CHECK( journal.get_num_buffered_bytes() == 0 );
+		BOOST_CHECK( journal.get_statistics().num_commits == 2 );
+
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 1 );
+		BOOST_REQUIRE( class_ids.size() == 2 );
+		BOOST_CHECK( class_ids[0] == grass.get_id() );
+		BOOST_CHECK( class_ids[1] == stone.get_id() );
+
+		BOOST_REQUIRE( edits.size() == 4 );
+		BOOST_CHECK( edits[0].position == Planet::BlockPosition( 1, 2, 3 ) );
+		BOOST_CHECK( edits[0].cls == 0 );
+		BOOST_CHECK( edits[0].revision == 5 );
+		BOOST_CHECK( edits[1].position == Planet::BlockPosition( 63, 31, 63 ) );
+		BOOST_CHECK( edits[1].cls == 1 );
+		BOOST_CHECK( edits[1].revision == 2 );
+		BOOST_CHECK( edits[2].cls == Chunk::INVALID_BLOCK );
+		BOOST_CHECK( edits[2].revision == 6 );
+		BOOST_CHECK( edits[3].position == Planet::BlockPosition( 4, 5, 6 ) );
+		BOOST_CHECK( edits[3].cls == 0 );
+
+		// Class records are repeated in new segments.
+		BOOST_CHECK( journal.rotate() == 1 );
+		BOOST_CHECK( journal.get_segment() == 2 );
+
+		journal.append( Planet::BlockPosition( 7, 8, 9 ), &stone, 4 );
+		journal.sync();
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 2 );
+		BOOST_CHECK( class_ids.size() == 2 );
+		BOOST_REQUIRE( edits.size() == 5 );
+		BOOST_CHECK( edits[4].position == Planet::BlockPosition( 7, 8, 9 ) );
+		BOOST_CHECK( edits[4].cls == 1 );
+
+		// Remove covered segments.
+		journal.remove_segments( 1 );
+
+		BOOST_CHECK( fs::exists( directory / "journal.1.fwj" ) == false );
+		BOOST_CHECK( fs::exists( directory / "journal.2.fwj" ) == true );
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 1 );
+		BOOST_CHECK( edits.size() == 1 );
+	}
+
+	// Reopening continues after existing segments.
+	{
+		BlockJournal journal( directory.string() );
+		journal.open();
+
+		BOOST_CHECK( journal.get_segment() == 3 );
+
+		journal.append( Planet::BlockPosition( 10, 11, 12 ), &grass, 7 );
+	}
+
+	{
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		// Buffered edits are committed on destruction.
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 2 );
+		BOOST_REQUIRE( edits.size() == 2 );
+		BOOST_CHECK( edits[1].position == Planet::BlockPosition( 10, 11, 12 ) );
+		BOOST_CHECK( class_ids[edits[1].cls] == grass.get_id() );
+	}
+
+	// Torn writes stop reading.
+	{
+		fs::path path = directory / "journal.3.fwj";
+		uintmax_t size = fs::file_size( path );
+
+		fs::resize_file( path, size - 3 );
+
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 2 );
+		BOOST_CHECK( edits.size() == 1 );
+
+		// Damaged records too.
+		fs::resize_file( path, size );
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 2 );
+		BOOST_CHECK( edits.size() == 1 );
+
+		fs::remove_all( directory );
+	}
+
+	// Records of a failed commit are kept for the next one.
+	{
+		BlockJournal journal( directory.string() );
+		journal.open();
+
+		journal.append( Planet::BlockPosition( 1, 2, 3 ), &grass, 5 );
+		journal.rotate();
+		journal.append( Planet::BlockPosition( 4, 5, 6 ), &stone, 3 );
+
+		// The new segment can't be created.
+		fs::create_directory( directory / "journal.2.fwj" );
+
+		std::size_t num_buffered_bytes = journal.get_num_buffered_bytes();
+
+		BOOST_CHECK_THROW( journal.sync(), BlockJournal::IOException );
+		BOOST_CHECK( journal.get_statistics().num_failed_commits == 1 );
+		BOOST_CHECK( journal.get_num_buffered_bytes() > 0 );
+		BOOST_CHECK( journal.get_num_buffered_bytes() < num_buffered_bytes );
+
+		fs::remove( directory / "journal.2.fwj" );
+		journal.sync();
+
+		BOOST_CHECK( journal.get_num_buffered_bytes() == 0 );
+
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BOOST_CHECK( BlockJournal::read( directory.string(), class_ids, edits ) == 2 );
+		BOOST_REQUIRE( edits.size() == 2 );
+		BOOST_CHECK( edits[0].position == Planet::BlockPosition( 1, 2, 3 ) );
+		BOOST_CHECK( edits[1].position == Planet::BlockPosition( 4, 5, 6 ) );
+		BOOST_CHECK( class_ids[edits[1].cls] == stone.get_id() );
+	}
+
+	fs::remove_all( directory );
+
+	// Apply edits.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		Planet::ClassArray classes;
+		BlockJournal::EditArray edits;
+		BlockJournal::Edit edit;
+
+		classes.push_back( &grass );
+		classes.push_back( &stone );
+
+		planet.create_chunk( Planet::Vector( 0, 0, 0 ) );
+		planet.set_chunk_revision( Planet::Vector( 0, 0, 0 ), 10 );
+
+		Planet::ChunkPositionArray dirty;
+		planet.drain_dirty_chunks( dirty );
+
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() == 10 );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+
+		// Already in the planet.
+		edit.position = Planet::BlockPosition( 1, 1, 1 );
+		edit.cls = 0;
+		edit.revision = 10;
+		edits.push_back( edit );
+
+		// Newer.
+		edit.position = Planet::BlockPosition( 2, 2, 2 );
+		edit.cls = 1;
+		edit.revision = 11;
+		edits.push_back( edit );
+
+		edit.position = Planet::BlockPosition( 2, 2, 2 );
+		edit.cls = Chunk::INVALID_BLOCK;
+		edit.revision = 12;
+		edits.push_back( edit );
+
+		edit.position = Planet::BlockPosition( 3, 3, 3 );
+		edit.cls = 0;
+		edit.revision = 13;
+		edits.push_back( edit );
+
+		// Missing chunk is created.
+		edit.position = Planet::BlockPosition( 20, 20, 20 );
+		edit.cls = 1;
+		edit.revision = 3;
+		edits.push_back( edit );
+
+		// Removing from a missing chunk does nothing.
+		edit.position = Planet::BlockPosition( 40, 0, 40 );
+		edit.cls = Chunk::INVALID_BLOCK;
+		edit.revision = 4;
+		edits.push_back( edit );
+
+		// Out of range.
+		edit.position = Planet::BlockPosition( 64, 0, 0 );
+		edit.cls = 0;
+		edit.revision = 4;
+		edits.push_back( edit );
+
+		BOOST_CHECK( BlockJournal::apply( planet, edits, classes ) == 4 );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 1, 1 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 2, 2, 2 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 3, 3 ) ) == &grass );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() == 13 );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 1, 1 ), Chunk::Vector( 4, 4, 4 ) ) == &stone );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 1, 1, 1 ) )->get_revision() == 3 );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 2, 0, 2 ) ) == false );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 2 );
+
+		// Replaying again changes nothing.
+		BOOST_CHECK( BlockJournal::apply( planet, edits, classes ) == 0 );
+	}
+
+	// Commit thread and autosave integration.
+	{
+		LockFacility facility;
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		AutosaveService service( facility, directory.string() );
+		BlockJournal journal( service.get_planet_directory( "construct" ) );
+
+		facility.create_planet_lock( planet );
+		journal.open();
+		journal.set_commit_interval( 1 );
+		journal.start();
+		service.add_planet( planet, &journal );
+
+		BOOST_CHECK( journal.is_running() == true );
+
+		facility.lock_planet( planet, true );
+		planet.create_chunk( Planet::Vector( 1, 1, 1 ) );
+		planet.set_block( Planet::Vector( 1, 1, 1 ), Chunk::Vector( 5, 5, 5 ), grass );
+		journal.append( Planet::BlockPosition( 21, 21, 21 ), &grass, planet.find_chunk( Planet::Vector( 1, 1, 1 ) )->get_revision() );
+		facility.lock_planet( planet, false );
+
+		for( std::size_t wait_idx = 0; wait_idx < 50 && journal.get_num_buffered_bytes() > 0; ++wait_idx ) {
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+		}
+
+		BOOST_CHECK( journal.get_num_buffered_bytes() == 0 );
+
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BOOST_CHECK( BlockJournal::read( journal.get_directory(), class_ids, edits ) == 1 );
+		BOOST_CHECK( edits.size() == 1 );
+
+		// Saving rotates the journal and removes covered segments.
+		BOOST_CHECK( service.save() == 1 );
+		BOOST_CHECK( journal.get_segment() == 2 );
+		BOOST_CHECK( BlockJournal::read( journal.get_directory(), class_ids, edits ) == 1 );
+		BOOST_CHECK( edits.empty() == true );
+
+		journal.stop();
+		BOOST_CHECK( journal.is_running() == false );
+
+		service.remove_planet( planet );
+		facility.destroy_planet_lock( planet );
+	}
+
+	// A failed save keeps the journal until a save succeeded.
+	{
+		LockFacility facility;
+		Planet planet( "failing", SIZE, CHUNK_SIZE );
+		AutosaveService service( facility, directory.string() );
+		BlockJournal journal( service.get_planet_directory( "failing" ) );
+
+		facility.create_planet_lock( planet );
+		journal.open();
+		service.add_planet( planet, &journal );
+
+		// Block the region's temporary file with a directory.
+		fs::path blocker = fs::path( journal.get_directory() ) / (RegionFile::make_filename( Planet::Vector( 0, 0, 0 ) ) + ".tmp");
+		fs::create_directory( blocker );
+
+		planet.create_chunk( Planet::Vector( 0, 0, 0 ) );
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 1, 1 ), grass );
+		journal.append( Planet::BlockPosition( 1, 1, 1 ), &grass, planet.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() );
+		journal.sync();
+
+		service.save();
+		BOOST_CHECK( service.get_statistics().num_failed_saves == 1 );
+
+		std::vector<FlexID> class_ids;
+		BlockJournal::EditArray edits;
+
+		BlockJournal::read( journal.get_directory(), class_ids, edits );
+		BOOST_CHECK( edits.size() == 1 );
+
+		fs::remove( blocker );
+
+		// The pending chunk is written, the journal truncated again.
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 2, 2, 2 ), grass );
+		journal.append( Planet::BlockPosition( 2, 2, 2 ), &grass, planet.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() );
+
+		service.save();
+		BOOST_CHECK( service.get_statistics().num_saves == 1 );
+
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 3, 3 ), grass );
+		journal.append( Planet::BlockPosition( 3, 3, 3 ), &grass, planet.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() );
+
+		service.save();
+		BOOST_CHECK( service.get_statistics().num_saves == 2 );
+
+		BlockJournal::read( journal.get_directory(), class_ids, edits );
+		BOOST_CHECK( edits.empty() == true );
+
+		service.remove_planet( planet );
+		facility.destroy_planet_lock( planet );
+	}
+}
@@ -3,6 +3,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include <iomanip> // XXX 
+#include <vector>
+#include <algorithm>
 
 BOOST_AUTO_TEST_CASE( TestChunk ) {
 	using namespace fw;
@@ -54,6 +56,12 @@ BOOST_AUTO_TEST_CASE( TestChunk ) {
 		//flags = 0;
 		std::size_t raw_idx = 0;
 
+		BOOST_CHECK( chunk.get_num_blocks() == SIZE.x * SIZE.y * SIZE.z );
+		BOOST_CHECK( chunk.get_bits_per_block() == 16 );
+
+		std::vector<Chunk::Block> raw_data( chunk.get_num_blocks() );
+		chunk.get_raw_data( &raw_data[0] );
+
 		for( runner.z = 0; runner.z < SIZE.z; ++runner.z ) {
 			for( runner.y = 0; runner.y < SIZE.y; ++runner.y ) {
 				for( runner.x = 0; runner.x < SIZE.x; ++runner.x ) {
@@ -62,8 +70,8 @@ BOOST_AUTO_TEST_CASE( TestChunk ) {
 					}
 
 					if(
-						chunk.get_raw_data()[raw_idx] != id //||
-						//(chunk.get_raw_data()[raw_idx] >> Chunk::ID_BITS) != flags
+						raw_data[raw_idx] != id //||
+						//(raw_data[raw_idx] >> Chunk::ID_BITS) != flags
 					) {
 						all_sane = false;
 					}
@@ -116,4 +124,206 @@ BOOST_AUTO_TEST_CASE( TestChunk ) {
 
 		BOOST_CHECK( chunk.is_block_set( Chunk::Vector( 5, 10, 15 ) ) == false );
 	}
+
+	// Palette growth.
+	{
+		Chunk chunk( SIZE );
+		BOOST_CHECK( chunk.get_bits_per_block() == 0 );
+
+		// Empty + 1 class.
+		chunk.set_block( Chunk::Vector( 0, 0, 0 ), 100 );
+		BOOST_CHECK( chunk.get_bits_per_block() == 1 );
+
+		// Empty + 2 classes.
+		chunk.set_block( Chunk::Vector( 1, 0, 0 ), 200 );
+		BOOST_CHECK( chunk.get_bits_per_block() == 2 );
+
+		// Empty + 255 classes (fills 8 bit palette).
+		for( Chunk::Block id = 3; id <= 255; ++id ) {
+			chunk.set_block( Chunk::Vector( static_cast<Chunk::ScalarType>( id % SIZE.x ), static_cast<Chunk::ScalarType>( id / SIZE.x ), 1 ), static_cast<Chunk::Block>( 1000 + id ) );
+		}
+
+		BOOST_CHECK( chunk.get_bits_per_block() == 8 );
+
+		// Entries of classes that aren't used anymore are reused.
+		chunk.reset_block( Chunk::Vector( 1, 0, 0 ) );
+		chunk.set_block( Chunk::Vector( 1, 0, 0 ), 300 );
+		BOOST_CHECK( chunk.get_bits_per_block() == 8 );
+
+		// One more class exceeds the palette.
+		chunk.set_block( Chunk::Vector( 2, 0, 0 ), 400 );
+		BOOST_CHECK( chunk.get_bits_per_block() == 16 );
+
+		// Verify all blocks survived the growth.
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 0, 0, 0 ) ) == 100 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 1, 0, 0 ) ) == 300 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 2, 0, 0 ) ) == 400 );
+		BOOST_CHECK( chunk.is_block_set( Chunk::Vector( 3, 0, 0 ) ) == false );
+
+		bool all_sane = true;
+
+		for( Chunk::Block id = 3; id <= 255; ++id ) {
+			if( chunk.get_block( Chunk::Vector( static_cast<Chunk::ScalarType>( id % SIZE.x ), static_cast<Chunk::ScalarType>( id / SIZE.x ), 1 ) ) != 1000 + id ) {
+				all_sane = false;
+			}
+		}
+
+		BOOST_CHECK( all_sane == true );
+
+		// Reset in direct mode.
+		chunk.reset_block( Chunk::Vector( 0, 0, 0 ) );
+		BOOST_CHECK( chunk.is_block_set( Chunk::Vector( 0, 0, 0 ) ) == false );
+
+		// Clearing shrinks the chunk again.
+		chunk.clear();
+		BOOST_CHECK( chunk.get_bits_per_block() == 0 );
+	}
+
+	// Revisions.
+	{
+		Chunk chunk( SIZE );
+		Chunk::Revision revision = chunk.get_revision();
+
+		BOOST_CHECK( revision > 0 );
+
+		// Changes increase the revision.
+		chunk.set_block( Chunk::Vector( 1, 2, 3 ), 10 );
+		BOOST_CHECK( chunk.get_revision() > revision );
+		revision = chunk.get_revision();
+
+		chunk.reset_block( Chunk::Vector( 1, 2, 3 ) );
+		BOOST_CHECK( chunk.get_revision() > revision );
+		revision = chunk.get_revision();
+
+		chunk.fill( 5 );
+		BOOST_CHECK( chunk.get_revision() > revision );
+		revision = chunk.get_revision();
+
+		chunk.clear();
+		BOOST_CHECK( chunk.get_revision() > revision );
+		revision = chunk.get_revision();
+
+		// No-ops don't.
+		chunk.clear();
+		BOOST_CHECK( chunk.get_revision() == revision );
+
+		chunk.fill( 5 );
+		revision = chunk.get_revision();
+
+		chunk.fill( 5 );
+		chunk.set_block( Chunk::Vector( 1, 2, 3 ), 5 );
+		BOOST_CHECK( chunk.get_revision() == revision );
+
+		// Restore a stored revision.
+		chunk.set_revision( 1234 );
+		BOOST_CHECK( chunk.get_revision() == 1234 );
+
+		chunk.set_block( Chunk::Vector( 1, 2, 3 ), 6 );
+		BOOST_CHECK( chunk.get_revision() == 1235 );
+	}
+
+	// Uniform chunks.
+	{
+		Chunk chunk( SIZE );
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+		BOOST_CHECK( chunk.is_empty() == true );
+
+		// Fill.
+		chunk.fill( 42 );
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+		BOOST_CHECK( chunk.is_empty() == false );
+		BOOST_CHECK( chunk.get_uniform_block() == 42 );
+		BOOST_CHECK( chunk.get_bits_per_block() == 0 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 3, 4, 5 ) ) == 42 );
+
+		std::vector<Chunk::Block> raw_data( chunk.get_num_blocks() );
+		chunk.get_raw_data( &raw_data[0] );
+		BOOST_CHECK( std::count( raw_data.begin(), raw_data.end(), 42 ) == static_cast<long>( raw_data.size() ) );
+
+		// Setting the same block keeps the chunk uniform.
+		chunk.set_block( Chunk::Vector( 3, 4, 5 ), 42 );
+		BOOST_CHECK( chunk.is_uniform() == true );
+
+		// A differing block expands the chunk.
+		chunk.set_block( Chunk::Vector( 3, 4, 5 ), 43 );
+
+		BOOST_CHECK( chunk.is_uniform() == false );
+		BOOST_CHECK( chunk.get_bits_per_block() == 1 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 3, 4, 5 ) ) == 43 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 3, 4, 6 ) ) == 42 );
+
+		// Reverting the edit collapses the chunk.
+		chunk.set_block( Chunk::Vector( 3, 4, 5 ), 42 );
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+		BOOST_CHECK( chunk.get_uniform_block() == 42 );
+
+		// Resetting all blocks makes the chunk empty again.
+		Chunk::Vector runner( 0, 0, 0 );
+
+		for( runner.z = 0; runner.z < SIZE.z; ++runner.z ) {
+			for( runner.y = 0; runner.y < SIZE.y; ++runner.y ) {
+				for( runner.x = 0; runner.x < SIZE.x; ++runner.x ) {
+					chunk.reset_block( runner );
+				}
+			}
+		}
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+		BOOST_CHECK( chunk.is_empty() == true );
+	}
+
+	// Set raw data.
+	{
+		Chunk chunk( SIZE );
+		std::vector<Chunk::Block> raw_data( chunk.get_num_blocks(), Chunk::INVALID_BLOCK );
+		std::vector<Chunk::Block> result( chunk.get_num_blocks() );
+		Chunk::Revision revision = chunk.get_revision();
+
+		// Uniform data doesn't allocate storage.
+		chunk.set_raw_data( &raw_data[0] );
+
+		BOOST_CHECK( chunk.is_empty() == true );
+		BOOST_CHECK( chunk.get_revision() > revision );
+
+		std::fill( raw_data.begin(), raw_data.end(), 7 );
+		chunk.set_raw_data( &raw_data[0] );
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+		BOOST_CHECK( chunk.get_uniform_block() == 7 );
+
+		// Smallest palette for 3 distinct values.
+		std::fill( raw_data.begin(), raw_data.begin() + 100, Chunk::INVALID_BLOCK );
+		raw_data[2000] = 9;
+		chunk.set_raw_data( &raw_data[0] );
+		chunk.get_raw_data( &result[0] );
+
+		BOOST_CHECK( chunk.get_bits_per_block() == 2 );
+		BOOST_CHECK( result == raw_data );
+		BOOST_CHECK( chunk.is_block_set( Chunk::Vector( 0, 0, 0 ) ) == false );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 0, 13, 7 ) ) == 9 );
+
+		// Edits after setting keep working.
+		chunk.set_block( Chunk::Vector( 0, 13, 7 ), 7 );
+		BOOST_CHECK( chunk.get_block( Chunk::Vector( 0, 13, 7 ) ) == 7 );
+
+		for( std::size_t block_idx = 0; block_idx < 100; ++block_idx ) {
+			chunk.set_block( Chunk::Vector( static_cast<Chunk::ScalarType>( block_idx % 16 ), static_cast<Chunk::ScalarType>( block_idx / 16 ), 0 ), 7 );
+		}
+
+		BOOST_CHECK( chunk.is_uniform() == true );
+
+		// Too many values for a palette.
+		for( std::size_t block_idx = 0; block_idx < raw_data.size(); ++block_idx ) {
+			raw_data[block_idx] = static_cast<Chunk::Block>( block_idx % 300 );
+		}
+
+		chunk.set_raw_data( &raw_data[0] );
+		chunk.get_raw_data( &result[0] );
+
+		BOOST_CHECK( chunk.get_bits_per_block() == 16 );
+		BOOST_CHECK( result == raw_data );
+	}
 }
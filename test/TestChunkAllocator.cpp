@@ -0,0 +1,116 @@
+#include <FlexWorld/ChunkAllocator.hpp>
+#include <FlexWorld/Chunk.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestChunkAllocator ) {
+	using namespace fw;
+
+	static const Chunk::Vector SIZE( 16, 16, 16 );
+
+	// Initial state.
+	{
+		ChunkAllocator allocator;
+
+		BOOST_CHECK( allocator.get_num_slabs() == 0 );
+		BOOST_CHECK( allocator.get_num_slab_bytes() == 0 );
+		BOOST_CHECK( allocator.get_num_allocations() == 0 );
+	}
+
+	// Allocate and release memory.
+	{
+		ChunkAllocator allocator;
+
+		void* first = allocator.allocate( 100 );
+		void* second = allocator.allocate( 100 );
+
+		BOOST_CHECK( first != second );
+		BOOST_CHECK( allocator.get_num_slabs() == 1 );
+		BOOST_CHECK( allocator.get_num_allocations() == 2 );
+
+		// Released slots are reused.
+		allocator.release( first, 100 );
+		BOOST_CHECK( allocator.get_num_allocations() == 1 );
+		BOOST_CHECK( allocator.allocate( 100 ) == first );
+
+		// Different slot sizes use different slabs.
+		allocator.allocate( 1000 );
+		BOOST_CHECK( allocator.get_num_slabs() == 2 );
+
+		// Slots bigger than a slab.
+		allocator.allocate( ChunkAllocator::SLAB_SIZE * 2 );
+		BOOST_CHECK( allocator.get_num_slabs() == 3 );
+		BOOST_CHECK( allocator.get_num_slab_bytes() >= ChunkAllocator::SLAB_SIZE * 3 );
+
+		allocator.clear();
+
+		BOOST_CHECK( allocator.get_num_slabs() == 0 );
+		BOOST_CHECK( allocator.get_num_slab_bytes() == 0 );
+		BOOST_CHECK( allocator.get_num_allocations() == 0 );
+	}
+
+	// Chunks.
+	{
+		ChunkAllocator allocator;
+		std::vector<Chunk*> chunks;
+
+		for( std::size_t chunk_idx = 0; chunk_idx < 100; ++chunk_idx ) {
+			chunks.push_back( &allocator.create_chunk( SIZE ) );
+		}
+
+		BOOST_CHECK( allocator.get_num_allocations() == 100 );
+
+		// Block storage is taken from the allocator.
+		for( std::size_t chunk_idx = 0; chunk_idx < chunks.size(); ++chunk_idx ) {
+			Chunk& chunk = *chunks[chunk_idx];
+
+			BOOST_CHECK( chunk.get_size() == SIZE );
+			BOOST_CHECK( chunk.is_empty() == true );
+
+			chunk.set_block( Chunk::Vector( 1, 2, 3 ), static_cast<Chunk::Block>( chunk_idx ) );
+		}
+
+		BOOST_CHECK( allocator.get_num_allocations() == 200 );
+
+		// Storage growth and shrinking.
+		for( Chunk::Block id = 0; id < 300; ++id ) {
+			chunks[0]->set_block(
+				Chunk::Vector(
+					static_cast<Chunk::ScalarType>( id % SIZE.x ),
+					static_cast<Chunk::ScalarType>( (id / SIZE.x) % SIZE.y ),
+					static_cast<Chunk::ScalarType>( 8 + id / (SIZE.x * SIZE.y) )
+				),
+				id
+			);
+		}
+
+		BOOST_CHECK( chunks[0]->get_bits_per_block() == 16 );
+		BOOST_CHECK( chunks[0]->get_block( Chunk::Vector( 1, 2, 3 ) ) == 0 );
+		BOOST_CHECK( chunks[0]->get_block( Chunk::Vector( 11, 2, 9 ) ) == 299 );
+		BOOST_CHECK( allocator.get_num_allocations() == 200 );
+
+		chunks[0]->clear();
+		BOOST_CHECK( allocator.get_num_allocations() == 199 );
+
+		bool all_sane = true;
+
+		for( std::size_t chunk_idx = 1; chunk_idx < chunks.size(); ++chunk_idx ) {
+			if( chunks[chunk_idx]->get_block( Chunk::Vector( 1, 2, 3 ) ) != chunk_idx ) {
+				all_sane = false;
+			}
+		}
+
+		BOOST_CHECK( all_sane == true );
+
+		// Destroying chunks releases storage and the chunk itself.
+		allocator.destroy_chunk( *chunks[1] );
+		BOOST_CHECK( allocator.get_num_allocations() == 197 );
+
+		// Bulk release.
+		allocator.clear();
+
+		BOOST_CHECK( allocator.get_num_slabs() == 0 );
+		BOOST_CHECK( allocator.get_num_allocations() == 0 );
+	}
+}
@@ -0,0 +1,101 @@
+#include <FlexWorld/ChunkDirectory.hpp>
+#include <FlexWorld/Chunk.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <memory>
+
+BOOST_AUTO_TEST_CASE( TestChunkDirectory ) {
+	using namespace fw;
+
+	static const ChunkDirectory::Vector SIZE( 8, 4, 8 );
+	static const Chunk::Vector CHUNK_SIZE( 1, 1, 1 );
+
+	// Initial state.
+	{
+		ChunkDirectory directory( SIZE );
+
+		BOOST_CHECK( directory.get_size() == SIZE );
+		BOOST_CHECK( directory.get_mode() == ChunkDirectory::DENSE );
+		BOOST_CHECK( directory.get_num_chunks() == 0 );
+		BOOST_CHECK( directory.find( ChunkDirectory::Vector( 0, 0, 0 ) ) == nullptr );
+		BOOST_CHECK( directory.find( ChunkDirectory::Vector( 7, 3, 7 ) ) == nullptr );
+	}
+
+	// Automatic mode selection.
+	{
+		ChunkDirectory small( ChunkDirectory::Vector( 128, 128, 128 ) );
+		ChunkDirectory huge( ChunkDirectory::Vector( 0xffff, 0xffff, 0xffff ) );
+
+		BOOST_CHECK( small.get_mode() == ChunkDirectory::DENSE );
+		BOOST_CHECK( huge.get_mode() == ChunkDirectory::HASHED );
+	}
+
+	// Insert and find in both modes.
+	{
+		ChunkDirectory::Mode modes[] = { ChunkDirectory::DENSE, ChunkDirectory::HASHED };
+
+		for( std::size_t mode_idx = 0; mode_idx < 2; ++mode_idx ) {
+			ChunkDirectory directory( SIZE, modes[mode_idx] );
+			BOOST_CHECK( directory.get_mode() == modes[mode_idx] );
+
+			std::vector<std::shared_ptr<Chunk>> chunks;
+			ChunkDirectory::Vector pos( 0, 0, 0 );
+
+			// Insert every other position, enough to make the hash table grow.
+			for( pos.z = 0; pos.z < SIZE.z; ++pos.z ) {
+				for( pos.y = 0; pos.y < SIZE.y; ++pos.y ) {
+					for( pos.x = 0; pos.x < SIZE.x; ++pos.x ) {
+						if( (pos.x + pos.y + pos.z) % 2 == 0 ) {
+							chunks.push_back( std::shared_ptr<Chunk>( new Chunk( CHUNK_SIZE ) ) );
+							directory.insert( pos, *chunks.back() );
+						}
+					}
+				}
+			}
+
+			BOOST_REQUIRE( directory.get_num_chunks() == chunks.size() );
+
+			// Verify lookups.
+			bool all_sane = true;
+			std::size_t chunk_idx = 0;
+
+			for( pos.z = 0; pos.z < SIZE.z; ++pos.z ) {
+				for( pos.y = 0; pos.y < SIZE.y; ++pos.y ) {
+					for( pos.x = 0; pos.x < SIZE.x; ++pos.x ) {
+						if( (pos.x + pos.y + pos.z) % 2 == 0 ) {
+							if(
+								directory.find( pos ) != chunks[chunk_idx].get() ||
+								&directory.get_chunk( chunk_idx ) != chunks[chunk_idx].get() ||
+								directory.get_position( chunk_idx ) != pos
+							) {
+								all_sane = false;
+							}
+
+							++chunk_idx;
+						}
+						else if( directory.find( pos ) != nullptr ) {
+							all_sane = false;
+						}
+					}
+				}
+			}
+
+			BOOST_CHECK( all_sane == true );
+
+			// Clear.
+			directory.clear();
+
+			BOOST_CHECK( directory.get_num_chunks() == 0 );
+			BOOST_CHECK( directory.find( ChunkDirectory::Vector( 0, 0, 0 ) ) == nullptr );
+			BOOST_CHECK( directory.find( ChunkDirectory::Vector( 7, 3, 6 ) ) == nullptr );
+
+			// Reuse after clearing.
+			directory.insert( ChunkDirectory::Vector( 7, 3, 6 ), *chunks[0] );
+
+			BOOST_CHECK( directory.get_num_chunks() == 1 );
+			BOOST_CHECK( directory.find( ChunkDirectory::Vector( 7, 3, 6 ) ) == chunks[0].get() );
+			BOOST_CHECK( directory.find( ChunkDirectory::Vector( 0, 0, 0 ) ) == nullptr );
+		}
+	}
+}
@@ -3,6 +3,8 @@
 #include <FlexWorld/FlexID.hpp>
 
 #include <boost/test/unit_test.hpp>
+#include <vector>
+#include <memory>
 
 BOOST_AUTO_TEST_CASE( TestClassCache ) {
 	using namespace fw;
@@ -85,6 +87,83 @@ BOOST_AUTO_TEST_CASE( TestClassCache ) {
 		BOOST_CHECK( cache.get_num_holes() == 0 );
 	}
 
+	// Multiple uses at once.
+	{
+		ClassCache cache;
+
+		BOOST_CHECK( cache.cache( cls, 100 ) == 0 );
+		BOOST_CHECK( cache.cache( cls2 ) == 1 );
+
+		cache.forget( cls, 99 );
+		BOOST_CHECK( cache.get_num_cached_classes() == 2 );
+
+		cache.forget( cls );
+		BOOST_CHECK( cache.get_num_cached_classes() == 1 );
+		BOOST_CHECK( cache.is_id_valid( 0 ) == false );
+	}
+
+	// Reference counting by ID.
+	{
+		ClassCache cache;
+		ClassCache::IdType id = cache.cache( cls );
+
+		cache.add_refs( id, 10 );
+		BOOST_CHECK( cache.get_num_refs( id ) == 11 );
+
+		cache.release_refs( id, 10 );
+		BOOST_CHECK( cache.get_num_refs( id ) == 1 );
+		BOOST_CHECK( cache.get_num_cached_classes() == 1 );
+
+		cache.release_refs( id, 1 );
+		BOOST_CHECK( cache.get_num_cached_classes() == 0 );
+		BOOST_CHECK( cache.is_id_valid( id ) == false );
+	}
+
+	// Churn with many classes.
+	{
+		static const std::size_t NUM_CLASSES = 1000;
+
+		ClassCache cache;
+		std::vector<std::unique_ptr<Class>> classes;
+
+		for( std::size_t cls_idx = 0; cls_idx < NUM_CLASSES; ++cls_idx ) {
+			classes.push_back( std::unique_ptr<Class>( new Class( class_id ) ) );
+			BOOST_REQUIRE( cache.cache( *classes.back() ) == cls_idx );
+		}
+
+		// Forget every other class, the IDs become holes.
+		for( std::size_t cls_idx = 0; cls_idx < NUM_CLASSES; cls_idx += 2 ) {
+			cache.forget( *classes[cls_idx] );
+		}
+
+		BOOST_CHECK( cache.get_num_cached_classes() == NUM_CLASSES / 2 );
+		BOOST_CHECK( cache.get_num_holes() == NUM_CLASSES / 2 );
+
+		// Remaining classes are still found.
+		bool all_sane = true;
+
+		for( std::size_t cls_idx = 1; cls_idx < NUM_CLASSES; cls_idx += 2 ) {
+			if( cache.cache( *classes[cls_idx] ) != cls_idx || &cache.get_class( static_cast<ClassCache::IdType>( cls_idx ) ) != classes[cls_idx].get() ) {
+				all_sane = false;
+			}
+		}
+
+		BOOST_CHECK( all_sane == true );
+
+		// Caching again fills all holes.
+		for( std::size_t cls_idx = 0; cls_idx < NUM_CLASSES; cls_idx += 2 ) {
+			ClassCache::IdType id = cache.cache( *classes[cls_idx] );
+
+			if( id % 2 != 0 || &cache.get_class( id ) != classes[cls_idx].get() ) {
+				all_sane = false;
+			}
+		}
+
+		BOOST_CHECK( all_sane == true );
+		BOOST_CHECK( cache.get_num_cached_classes() == NUM_CLASSES );
+		BOOST_CHECK( cache.get_num_holes() == 0 );
+	}
+
 	// Clear.
 	{
 		ClassCache cache;
@@ -204,18 +204,18 @@ BOOST_AUTO_TEST_CASE( TestClient ) {
 		service.poll();
 
 		// Receive message at server.
-		char buf[17];
+		char buf[21];
 
-		std::size_t num_received = peer.receive( buffer( buf, 17 ) );
+		std::size_t num_received = peer.receive( buffer( buf, 21 ) );
 
-		BOOST_REQUIRE( num_received == 17 );
-		BOOST_REQUIRE( buf[0] == 0 ); // Message ID.
+		BOOST_REQUIRE( num_received == 21 );
+		BOOST_REQUIRE( buf[4] == 0 ); // Message ID (after length).
 
 		// Deserialize.
 		msg.set_username( "foo" );
 		msg.set_password( "foo" );
 		msg.set_server_password( "foo" );
-		msg.deserialize( buf + 1, 16 );
+		msg.deserialize( buf + 5, 16 );
 
 		BOOST_CHECK( msg.get_username() == "Tank" );
 		BOOST_CHECK( msg.get_password() == "h4x0r" );
@@ -0,0 +1,249 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/EntityStore.hpp>
+#include <FlexWorld/World.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+BOOST_FIXTURE_TEST_CASE( TestEntityStore, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const FlexID BALL_ID = FlexID::make( "fw.base/ball" );
+	static const FlexID CHEST_ID = FlexID::make( "fw.base/chest" );
+	static const Planet::Vector SIZE( 2, 2, 2 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	Class ball( BALL_ID );
+	Class chest( CHEST_ID );
+
+	ball.set_name( "Ball" );
+	chest.set_name( "Chest" );
+	chest.set_hook( "inside", sf::Vector3f( 0, 0, 0 ) );
+
+	// Initial state.
+	{
+		EntityStore store( directory.string() );
+
+		BOOST_CHECK( store.get_directory() == directory.string() );
+		BOOST_CHECK( store.get_path() == (directory / EntityStore::FILENAME).string() );
+		BOOST_CHECK( store.is_open() == false );
+
+		// Missing file.
+		store.open();
+
+		BOOST_CHECK( store.is_open() == true );
+		BOOST_CHECK( store.get_num_classes() == 0 );
+		BOOST_CHECK( store.get_num_entities() == 0 );
+		BOOST_CHECK( store.get_num_records() == 0 );
+	}
+
+	// Save world.
+	{
+		World world;
+		world.create_planet( "construct", SIZE, CHUNK_SIZE );
+		world.add_class( ball );
+		world.add_class( chest );
+
+		Entity& first = world.create_entity( BALL_ID );
+		first.set_position( sf::Vector3f( 1.5f, 2.0f, -3.25f ) );
+		first.set_rotation( sf::Vector3f( 0.0f, 90.0f, 0.0f ) );
+		world.link_entity_to_planet( first.get_id(), "construct" );
+
+		Entity& container = world.create_entity( CHEST_ID );
+		container.set_name( "Treasure" );
+		container.set_position( sf::Vector3f( 10, 11, 12 ) );
+		world.link_entity_to_planet( container.get_id(), "construct" );
+
+		Entity& content = world.create_entity( BALL_ID );
+		content.set_amount( 42 );
+		world.attach_entity( content.get_id(), container.get_id(), "inside" );
+
+		// Not linked to any planet.
+		world.create_entity( BALL_ID );
+
+		EntityStore store( directory.string() );
+		store.open();
+
+		BOOST_CHECK( store.save( world ) == 4 );
+		BOOST_CHECK( fs::exists( store.get_path() ) == true );
+		BOOST_CHECK( fs::exists( store.get_path() + ".tmp" ) == false );
+		BOOST_CHECK( store.get_num_entities() == 4 );
+		BOOST_CHECK( store.get_num_records() == 4 );
+
+		// Unchanged entities aren't written again.
+		uintmax_t size = fs::file_size( store.get_path() );
+
+		BOOST_CHECK( store.save( world ) == 0 );
+		BOOST_CHECK( fs::file_size( store.get_path() ) == size );
+
+		// Changes are appended.
+		first.set_position( sf::Vector3f( 5, 6, 7 ) );
+		world.delete_entity( 3 );
+
+		BOOST_CHECK( store.save( world ) == 2 );
+		BOOST_CHECK( fs::file_size( store.get_path() ) > size );
+		BOOST_CHECK( store.get_num_entities() == 3 );
+		BOOST_CHECK( store.get_num_records() == 6 );
+	}
+
+	// Load world.
+	{
+		EntityStore store( directory.string() );
+		store.open();
+
+		BOOST_CHECK( store.get_num_entities() == 3 );
+		BOOST_CHECK( store.get_num_records() == 6 );
+		BOOST_REQUIRE( store.get_num_classes() == 2 );
+		BOOST_CHECK( store.get_class_id( 0 ) == BALL_ID );
+		BOOST_CHECK( store.get_class_id( 1 ) == CHEST_ID );
+
+		World world;
+		world.create_planet( "construct", SIZE, CHUNK_SIZE );
+		world.add_class( ball );
+		world.add_class( chest );
+
+		EntityStore::ClassArray classes;
+		classes.push_back( world.find_class( BALL_ID ) );
+		classes.push_back( world.find_class( CHEST_ID ) );
+
+		BOOST_CHECK( store.load_entities( world, classes ) == 3 );
+		BOOST_CHECK( world.get_num_entities() == 3 );
+
+		const Entity* first = world.find_entity( 0 );
+		BOOST_REQUIRE( first != nullptr );
+		BOOST_CHECK( &first->get_class() == world.find_class( BALL_ID ) );
+		BOOST_CHECK( first->get_position() == sf::Vector3f( 5, 6, 7 ) );
+		BOOST_CHECK( first->get_rotation() == sf::Vector3f( 0.0f, 90.0f, 0.0f ) );
+		BOOST_CHECK( first->get_name() == "Ball" );
+		BOOST_CHECK( world.find_linked_planet( 0 ) == world.find_planet( "construct" ) );
+
+		const Entity* container = world.find_entity( 1 );
+		BOOST_REQUIRE( container != nullptr );
+		BOOST_CHECK( container->get_name() == "Treasure" );
+		BOOST_CHECK( container->get_position() == sf::Vector3f( 10, 11, 12 ) );
+		BOOST_CHECK( container->get_num_children( "inside" ) == 1 );
+
+		const Entity* content = world.find_entity( 2 );
+		BOOST_REQUIRE( content != nullptr );
+		BOOST_CHECK( content->get_parent() == container );
+		BOOST_CHECK( content->get_amount() == 42 );
+		BOOST_CHECK( container->get_child_hook( *content ) == "inside" );
+		BOOST_CHECK( world.find_planet( "construct" )->get_num_entities() == 2 );
+
+		BOOST_CHECK( world.find_entity( 3 ) == nullptr );
+
+		// New entities don't reuse stored IDs.
+		BOOST_CHECK( world.create_entity( BALL_ID ).get_id() == 3 );
+
+		// Nothing changed but the new entity.
+		BOOST_CHECK( store.save( world ) == 1 );
+		BOOST_CHECK( store.get_num_entities() == 4 );
+	}
+
+	// Missing classes and planets.
+	{
+		EntityStore store( directory.string() );
+		store.open();
+
+		World world;
+		world.add_class( ball );
+
+		EntityStore::ClassArray classes;
+		classes.push_back( world.find_class( BALL_ID ) );
+		classes.push_back( nullptr );
+
+		// The chest and its content are dropped.
+		BOOST_CHECK( store.load_entities( world, classes ) == 2 );
+		BOOST_CHECK( world.find_entity( 0 ) != nullptr );
+		BOOST_CHECK( world.find_entity( 1 ) == nullptr );
+		BOOST_CHECK( world.find_entity( 2 ) == nullptr );
+		BOOST_CHECK( world.find_entity( 3 ) != nullptr );
+		BOOST_CHECK( world.find_linked_planet( 0 ) == nullptr );
+		BOOST_CHECK( store.get_num_entities() == 2 );
+	}
+
+	// Damaged tail is dropped and compacted.
+	{
+		std::string path = (directory / EntityStore::FILENAME).string();
+		uintmax_t size = fs::file_size( path );
+
+		fs::resize_file( path, size - 2 );
+
+		EntityStore store( directory.string() );
+		store.open();
+
+		BOOST_CHECK( store.get_num_entities() == 3 );
+
+		World world;
+		world.create_planet( "construct", SIZE, CHUNK_SIZE );
+		world.add_class( ball );
+		world.add_class( chest );
+
+		EntityStore::ClassArray classes;
+		classes.push_back( world.find_class( BALL_ID ) );
+		classes.push_back( world.find_class( CHEST_ID ) );
+
+		BOOST_CHECK( store.load_entities( world, classes ) == 3 );
+		BOOST_CHECK( store.save( world ) == 3 );
+		BOOST_CHECK( store.get_num_records() == 3 );
+
+		EntityStore reopened( directory.string() );
+		reopened.open();
+
+		BOOST_CHECK( reopened.get_num_entities() == 3 );
+		BOOST_CHECK( reopened.get_num_records() == 3 );
+	}
+
+	// Save single entities.
+	{
+		World world;
+		world.add_class( ball );
+
+		Entity& first = world.create_entity( BALL_ID );
+		Entity& second = world.create_entity( BALL_ID );
+
+		EntityStore store( (directory / "single").string() );
+		store.open();
+
+		// A new store is written as a whole.
+		BOOST_CHECK( store.save_entity( world, first ) == true );
+		BOOST_CHECK( store.get_num_entities() == 2 );
+		BOOST_CHECK( store.get_num_records() == 2 );
+
+		// Unchanged entities aren't written again.
+		BOOST_CHECK( store.save_entity( world, second ) == false );
+
+		second.set_amount( 3 );
+		world.create_entity( BALL_ID );
+
+		BOOST_CHECK( store.save_entity( world, second ) == true );
+		BOOST_CHECK( store.get_num_entities() == 2 );
+		BOOST_CHECK( store.get_num_records() == 3 );
+
+		// The other new entity is left to save().
+		BOOST_CHECK( store.save( world ) == 1 );
+
+		EntityStore reopened( (directory / "single").string() );
+		reopened.open();
+
+		BOOST_CHECK( reopened.get_num_entities() == 3 );
+		BOOST_CHECK( reopened.get_num_records() == 4 );
+	}
+
+	// Invalid header.
+	{
+		{
+			std::ofstream out( (directory / EntityStore::FILENAME).string().c_str(), std::ios::binary | std::ios::trunc );
+			out << "FWXX";
+		}
+
+		EntityStore store( directory.string() );
+
+		BOOST_CHECK_THROW( store.open(), EntityStore::ReadException );
+		BOOST_CHECK( store.is_open() == false );
+	}
+}
@@ -0,0 +1,266 @@
+#include <FlexWorld/GeneratorQueue.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+class GeneratedColumnRecorder : public fw::GeneratorQueue::Handler {
+	public:
+		GeneratedColumnRecorder() :
+			m_num_calls( 0 )
+		{
+		}
+
+		void handle_generated_column( const fw::Planet& /*planet*/, fw::Planet::ScalarType x, fw::Planet::ScalarType z ) {
+			boost::lock_guard<boost::mutex> lock( m_mutex );
+
+			m_columns.push_back( fw::Planet::Vector( x, 0, z ) );
+			++m_num_calls;
+		}
+
+		std::size_t get_num_calls() {
+			boost::lock_guard<boost::mutex> lock( m_mutex );
+			return m_num_calls;
+		}
+
+		std::vector<fw::Planet::Vector> m_columns;
+
+	private:
+		boost::mutex m_mutex;
+		std::size_t m_num_calls;
+};
+
+BOOST_AUTO_TEST_CASE( TestGeneratorQueue ) {
+	using namespace fw;
+
+	static const Class grass_cls( FlexID::make( "fw.base.nature/grass" ) );
+
+	TerrainGenerator generator( grass_cls );
+	generator.set_seed( 1337 );
+	generator.set_base_height( 20 );
+	generator.set_maximum_height( 10 );
+
+	// Initial state.
+	{
+		LockFacility facility;
+		GeneratorQueue queue( facility );
+
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+		BOOST_CHECK( queue.is_running() == false );
+	}
+
+	// Add and remove planets.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+
+		facility.create_planet_lock( planet );
+
+		// Planets not added count as generated.
+		BOOST_CHECK( queue.has_planet( planet ) == false );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 1, 2, 3 ) ) == true );
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 2, 3 ) ) == true );
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+
+		queue.add_planet( planet, generator );
+		BOOST_CHECK( queue.has_planet( planet ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 1, 2, 3 ) ) == false );
+
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 2, 3 ) ) == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 1 );
+
+		// Removing drops requests.
+		queue.remove_planet( planet );
+		BOOST_CHECK( queue.has_planet( planet ) == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Request chunks and process synchronously.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+		GeneratedColumnRecorder recorder;
+
+		facility.create_planet_lock( planet );
+		queue.add_planet( planet, generator );
+		queue.set_handler( recorder );
+
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 0, 2 ) ) == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 1 );
+
+		// Chunks of the same column share the request.
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 3, 2 ) ) == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 1 );
+
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 3, 0, 0 ) ) == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 2 );
+
+		// Nothing generated yet.
+		BOOST_CHECK( planet.get_num_chunks() == 0 );
+
+		BOOST_CHECK( queue.process_queue() == 2 );
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 1, 0, 2 ) ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 1, 3, 2 ) ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 3, 1, 0 ) ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 0, 0, 0 ) ) == false );
+
+		// Handler called in order.
+		BOOST_REQUIRE( recorder.m_columns.size() == 2 );
+		BOOST_CHECK( recorder.m_columns[0] == Planet::Vector( 1, 0, 2 ) );
+		BOOST_CHECK( recorder.m_columns[1] == Planet::Vector( 3, 0, 0 ) );
+
+		// Only the requested columns have been generated.
+		BOOST_CHECK( planet.get_surface_height( 16, 32 ) >= 20 );
+		BOOST_CHECK( planet.get_surface_height( 63, 15 ) >= 20 );
+		BOOST_CHECK( planet.get_surface_height( 0, 0 ) == 0 );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 0, 0, 0 ) ) == false );
+
+		// Generated columns aren't queued again.
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 1, 2 ) ) == true );
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Request area.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 8, 4, 8 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+		GeneratedColumnRecorder recorder;
+
+		facility.create_planet_lock( planet );
+		queue.add_planet( planet, generator );
+		queue.set_handler( recorder );
+
+		// Clipped at the planet's border.
+		queue.request_area( planet, Planet::Vector( 0, 0, 0 ), 2 );
+		BOOST_CHECK( queue.get_num_queued_columns() == 9 );
+
+		queue.request_area( planet, Planet::Vector( 4, 0, 4 ), 1 );
+		BOOST_CHECK( queue.get_num_queued_columns() == 18 );
+
+		BOOST_CHECK( queue.process_queue() == 18 );
+		BOOST_REQUIRE( recorder.m_columns.size() == 18 );
+
+		// Nearest columns come first.
+		BOOST_CHECK( recorder.m_columns[0] == Planet::Vector( 0, 0, 0 ) );
+		BOOST_CHECK( recorder.m_columns[9] == Planet::Vector( 4, 0, 4 ) );
+
+		for( std::size_t column_idx = 1; column_idx < 4; ++column_idx ) {
+			BOOST_CHECK( recorder.m_columns[column_idx].x <= 1 && recorder.m_columns[column_idx].z <= 1 );
+		}
+
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 2, 0, 2 ) ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 3, 0, 0 ) ) == false );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 5, 0, 5 ) ) == true );
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 6, 0, 6 ) ) == false );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Generate immediately.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+		GeneratedColumnRecorder recorder;
+
+		facility.create_planet_lock( planet );
+		queue.add_planet( planet, generator );
+		queue.set_handler( recorder );
+
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 2, 0, 2 ) ) == false );
+
+		facility.lock_planet( planet, true );
+		queue.generate_now( planet, Planet::Vector( 2, 0, 2 ) );
+		facility.lock_planet( planet, false );
+
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 2, 0, 2 ) ) == true );
+		BOOST_CHECK( planet.get_surface_height( 40, 40 ) >= 20 );
+		BOOST_REQUIRE( recorder.m_columns.size() == 1 );
+		BOOST_CHECK( recorder.m_columns[0] == Planet::Vector( 2, 0, 2 ) );
+
+		// The queued request is skipped.
+		BOOST_CHECK( queue.get_num_queued_columns() == 1 );
+		BOOST_CHECK( queue.process_queue() == 0 );
+		BOOST_CHECK( recorder.m_columns.size() == 1 );
+
+		// Generated columns aren't notified again.
+		facility.lock_planet( planet, true );
+		queue.generate_now( planet, Planet::Vector( 2, 0, 2 ) );
+		facility.lock_planet( planet, false );
+
+		BOOST_CHECK( recorder.m_columns.size() == 1 );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Mark columns as generated.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+		GeneratedColumnRecorder recorder;
+
+		facility.create_planet_lock( planet );
+		queue.add_planet( planet, generator );
+		queue.set_handler( recorder );
+
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 1, 0, 1 ) ) == false );
+
+		queue.set_generated( planet, Planet::Vector( 1, 2, 1 ) );
+		queue.set_generated( planet, Planet::Vector( 3, 0, 3 ) );
+
+		BOOST_CHECK( queue.is_generated( planet, Planet::Vector( 1, 0, 1 ) ) == true );
+		BOOST_CHECK( queue.request_chunk( planet, Planet::Vector( 3, 1, 3 ) ) == true );
+
+		// Nothing is generated over.
+		BOOST_CHECK( queue.process_queue() == 0 );
+		BOOST_CHECK( recorder.m_columns.size() == 0 );
+		BOOST_CHECK( planet.get_num_chunks() == 0 );
+
+		facility.destroy_planet_lock( planet );
+	}
+
+	// Generate in the worker thread.
+	{
+		LockFacility facility;
+		Planet planet( "foo", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+		GeneratorQueue queue( facility );
+		GeneratedColumnRecorder recorder;
+
+		facility.create_planet_lock( planet );
+		queue.add_planet( planet, generator );
+		queue.set_handler( recorder );
+
+		queue.start();
+		BOOST_CHECK( queue.is_running() == true );
+
+		queue.request_area( planet, Planet::Vector( 1, 0, 1 ), 4 );
+
+		while( recorder.get_num_calls() < 16 ) {
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+		}
+
+		queue.stop();
+		BOOST_CHECK( queue.is_running() == false );
+		BOOST_CHECK( queue.get_num_queued_columns() == 0 );
+
+		for( Planet::ScalarType x = 0; x < 4; ++x ) {
+			for( Planet::ScalarType z = 0; z < 4; ++z ) {
+				BOOST_CHECK( queue.is_generated( planet, Planet::Vector( x, 0, z ) ) == true );
+			}
+		}
+
+		facility.destroy_planet_lock( planet );
+	}
+}
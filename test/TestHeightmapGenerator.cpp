@@ -0,0 +1,118 @@
+#include <FlexWorld/HeightmapGenerator.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <cmath>
+
+BOOST_AUTO_TEST_CASE( TestHeightmapGenerator ) {
+	using namespace fw;
+
+	// Initial state.
+	{
+		HeightmapGenerator heightmap;
+
+		BOOST_CHECK( heightmap.get_seed() == 0 );
+		BOOST_CHECK( heightmap.get_num_octaves() == 6 );
+		BOOST_CHECK( heightmap.get_persistence() == 0.5 );
+		BOOST_CHECK( heightmap.get_frequency() == 1.0 );
+		BOOST_CHECK(
+			HeightmapGenerator::get_batch_width() == 1 ||
+			HeightmapGenerator::get_batch_width() == 2 ||
+			HeightmapGenerator::get_batch_width() == 4
+		);
+	}
+
+	// Basic properties.
+	{
+		HeightmapGenerator heightmap;
+
+		heightmap.set_seed( 1234 );
+		heightmap.set_num_octaves( 3 );
+		heightmap.set_persistence( 1.1 );
+		heightmap.set_frequency( 0.25 );
+
+		BOOST_CHECK( heightmap.get_seed() == 1234 );
+		BOOST_CHECK( heightmap.get_num_octaves() == 3 );
+		BOOST_CHECK( heightmap.get_persistence() == 1.1 );
+		BOOST_CHECK( heightmap.get_frequency() == 0.25 );
+	}
+
+	// Values of a single octave are in range and zero at lattice points.
+	{
+		HeightmapGenerator heightmap;
+
+		heightmap.set_seed( 42 );
+		heightmap.set_num_octaves( 1 );
+		heightmap.set_frequency( 0.1 );
+
+		double min_value = 0.0;
+		double max_value = 0.0;
+
+		for( int z = -50; z < 50; ++z ) {
+			for( int x = -50; x < 50; ++x ) {
+				double value = heightmap.get_value( x, z );
+
+				min_value = std::min( min_value, value );
+				max_value = std::max( max_value, value );
+			}
+		}
+
+		BOOST_CHECK( min_value >= -1.0 && min_value < 0.0 );
+		BOOST_CHECK( max_value <= 1.0 && max_value > 0.0 );
+		BOOST_CHECK( std::abs( heightmap.get_value( 30.0, -20.0 ) ) < 1e-12 );
+	}
+
+	// Seeds.
+	{
+		HeightmapGenerator heightmap;
+		HeightmapGenerator other;
+
+		heightmap.set_seed( 1 );
+		other.set_seed( 1 );
+		BOOST_CHECK( heightmap.get_value( 12.3, 45.6 ) == other.get_value( 12.3, 45.6 ) );
+
+		other.set_seed( 2 );
+		BOOST_CHECK( heightmap.get_value( 12.3, 45.6 ) != other.get_value( 12.3, 45.6 ) );
+	}
+
+	// Batches match single samples, with the terrain generator's parameters
+	// and frequencies giving short and single sample runs.
+	{
+		static const double FREQUENCIES[] = { 1.0 / 800.0, 1.0 / 7.0, 0.5, 3.0 };
+		static const uint32_t WIDTH = 37;
+		static const uint32_t DEPTH = 11;
+
+		for( std::size_t freq_idx = 0; freq_idx < sizeof( FREQUENCIES ) / sizeof( FREQUENCIES[0] ); ++freq_idx ) {
+			HeightmapGenerator heightmap;
+
+			heightmap.set_seed( 4711 );
+			heightmap.set_persistence( 1.1 );
+			heightmap.set_frequency( FREQUENCIES[freq_idx] );
+
+			std::vector<double> values( WIDTH * DEPTH );
+			heightmap.generate( -13, 1000, WIDTH, DEPTH, &values[0] );
+
+			double max_error = 0.0;
+
+			for( uint32_t z = 0; z < DEPTH; ++z ) {
+				for( uint32_t x = 0; x < WIDTH; ++x ) {
+					double expected = heightmap.get_value( static_cast<double>( -13 + static_cast<int>( x ) ), static_cast<double>( 1000 + z ) );
+					max_error = std::max( max_error, std::abs( values[z * WIDTH + x] - expected ) );
+				}
+			}
+
+			BOOST_CHECK( max_error < 1e-9 );
+		}
+	}
+
+	// Empty grids.
+	{
+		HeightmapGenerator heightmap;
+		double value = 123.0;
+
+		heightmap.generate( 0, 0, 0, 5, &value );
+		heightmap.generate( 0, 0, 5, 0, &value );
+
+		BOOST_CHECK( value == 123.0 );
+	}
+}
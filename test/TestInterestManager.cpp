@@ -0,0 +1,107 @@
+#include <FlexWorld/InterestManager.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+
+BOOST_AUTO_TEST_CASE( TestInterestManager ) {
+	using namespace fw;
+
+	typedef InterestManager::ChunkCuboid ChunkCuboid;
+	typedef InterestManager::ConnectionIDArray ConnectionIDArray;
+
+	Planet construct( "construct", Planet::Vector( 64, 4, 64 ), Chunk::Vector( 16, 16, 16 ) );
+	Planet moon( "moon", Planet::Vector( 16, 4, 16 ), Chunk::Vector( 16, 16, 16 ) );
+
+	// Initial state.
+	{
+		InterestManager manager;
+
+		BOOST_CHECK( manager.get_cell_size() == InterestManager::DEFAULT_CELL_SIZE );
+		BOOST_CHECK( manager.get_num_interests() == 0 );
+		BOOST_CHECK( manager.find_planet( 0 ) == nullptr );
+
+		ConnectionIDArray connections( 1, 5 );
+		manager.find_interested( construct, Planet::Vector( 0, 0, 0 ), connections );
+
+		BOOST_CHECK( connections.empty() );
+	}
+
+	// Find connections.
+	{
+		InterestManager manager( 8 );
+
+		// Overlapping views on the construct, one on the moon.
+		manager.set_interest( 0, construct, ChunkCuboid( 0, 0, 0, 21, 4, 21 ) );
+		manager.set_interest( 1, construct, ChunkCuboid( 10, 0, 10, 21, 4, 21 ) );
+		manager.set_interest( 3, moon, ChunkCuboid( 0, 0, 0, 16, 4, 16 ) );
+
+		BOOST_CHECK( manager.get_num_interests() == 3 );
+		BOOST_CHECK( manager.find_planet( 0 ) == &construct );
+		BOOST_CHECK( manager.find_planet( 2 ) == nullptr );
+		BOOST_CHECK( manager.find_planet( 3 ) == &moon );
+		BOOST_CHECK( manager.get_view( 1 ).x == 10 );
+
+		ConnectionIDArray connections;
+
+		manager.find_interested( construct, Planet::Vector( 0, 0, 0 ), connections );
+		BOOST_REQUIRE( connections.size() == 1 );
+		BOOST_CHECK( connections[0] == 0 );
+
+		manager.find_interested( construct, Planet::Vector( 15, 2, 20 ), connections );
+		std::sort( connections.begin(), connections.end() );
+		BOOST_REQUIRE( connections.size() == 2 );
+		BOOST_CHECK( connections[0] == 0 );
+		BOOST_CHECK( connections[1] == 1 );
+
+		// Same cell, but outside of the first view.
+		manager.find_interested( construct, Planet::Vector( 21, 0, 21 ), connections );
+		BOOST_REQUIRE( connections.size() == 1 );
+		BOOST_CHECK( connections[0] == 1 );
+
+		manager.find_interested( construct, Planet::Vector( 63, 0, 63 ), connections );
+		BOOST_CHECK( connections.empty() );
+
+		manager.find_interested( moon, Planet::Vector( 5, 0, 5 ), connections );
+		BOOST_REQUIRE( connections.size() == 1 );
+		BOOST_CHECK( connections[0] == 3 );
+
+		// Move a view.
+		manager.set_interest( 0, construct, ChunkCuboid( 40, 0, 40, 21, 4, 21 ) );
+		BOOST_CHECK( manager.get_num_interests() == 3 );
+
+		manager.find_interested( construct, Planet::Vector( 0, 0, 0 ), connections );
+		BOOST_CHECK( connections.empty() );
+
+		manager.find_interested( construct, Planet::Vector( 50, 3, 60 ), connections );
+		BOOST_REQUIRE( connections.size() == 1 );
+		BOOST_CHECK( connections[0] == 0 );
+
+		// Change planet.
+		manager.set_interest( 3, construct, ChunkCuboid( 50, 0, 50, 14, 4, 14 ) );
+
+		manager.find_interested( moon, Planet::Vector( 5, 0, 5 ), connections );
+		BOOST_CHECK( connections.empty() );
+
+		manager.find_interested( construct, Planet::Vector( 55, 0, 55 ), connections );
+		std::sort( connections.begin(), connections.end() );
+		BOOST_REQUIRE( connections.size() == 2 );
+		BOOST_CHECK( connections[0] == 0 );
+		BOOST_CHECK( connections[1] == 3 );
+
+		// Remove interests.
+		manager.remove_interest( 0 );
+		manager.remove_interest( 0 );
+		manager.set_interest( 3, construct, ChunkCuboid() );
+
+		BOOST_CHECK( manager.get_num_interests() == 1 );
+		BOOST_CHECK( manager.find_planet( 0 ) == nullptr );
+		BOOST_CHECK( manager.find_planet( 3 ) == nullptr );
+
+		manager.find_interested( construct, Planet::Vector( 55, 0, 55 ), connections );
+		BOOST_CHECK( connections.empty() );
+
+		manager.find_interested( construct, Planet::Vector( 20, 0, 20 ), connections );
+		BOOST_REQUIRE( connections.size() == 1 );
+		BOOST_CHECK( connections[0] == 1 );
+	}
+}
@@ -18,8 +18,10 @@ BOOST_AUTO_TEST_CASE( TestLockFacility ) {
 	{
 		LockFacility facility;
 
+		BOOST_CHECK( facility.is_script_manager_locked() == false );
 		BOOST_CHECK( facility.is_account_manager_locked() == false );
 		BOOST_CHECK( facility.is_world_locked() == false );
+		BOOST_CHECK( facility.is_player_list_locked() == false );
 		BOOST_CHECK( facility.get_num_planet_locks() == 0 );
 		BOOST_CHECK( facility.get_num_locked_planets() == 0 );
 	}
@@ -80,6 +82,29 @@ BOOST_AUTO_TEST_CASE( TestLockFacility ) {
 		BOOST_CHECK( facility.is_world_locked() == false );
 	}
 
+	// Lock script manager and player list in the documented order.
+	{
+		LockFacility facility;
+
+		facility.lock_script_manager( true );
+		facility.lock_world( true );
+		facility.lock_player_list( true );
+		BOOST_CHECK( facility.is_script_manager_locked() == true );
+		BOOST_CHECK( facility.is_player_list_locked() == true );
+
+		// Lock twice.
+		facility.lock_player_list( true );
+		facility.lock_player_list( false );
+		BOOST_CHECK( facility.is_player_list_locked() == true );
+
+		facility.lock_player_list( false );
+		facility.lock_world( false );
+		facility.lock_script_manager( false );
+		BOOST_CHECK( facility.is_player_list_locked() == false );
+		BOOST_CHECK( facility.is_world_locked() == false );
+		BOOST_CHECK( facility.is_script_manager_locked() == false );
+	}
+
 	// Planets.
 	{
 		LockFacility facility;
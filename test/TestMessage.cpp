@@ -808,7 +808,9 @@ BOOST_AUTO_TEST_CASE( TestChunkMessage ) {
 
 	uint16_t num_blocks = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
 	source.insert( source.end(), reinterpret_cast<const char*>( &num_blocks ), reinterpret_cast<const char*>( &num_blocks ) + sizeof( num_blocks ) );
-	source.insert( source.end(), reinterpret_cast<const char*>( source_chunk.get_raw_data() ), reinterpret_cast<const char*>( source_chunk.get_raw_data() ) + sizeof( Chunk::Block ) * num_blocks );
+	std::vector<Chunk::Block> raw_data( num_blocks );
+	source_chunk.get_raw_data( &raw_data[0] );
+	source.insert( source.end(), reinterpret_cast<const char*>( &raw_data[0] ), reinterpret_cast<const char*>( &raw_data[0] ) + sizeof( Chunk::Block ) * num_blocks );
 
 	// Serialize.
 	{
@@ -823,6 +825,25 @@ BOOST_AUTO_TEST_CASE( TestChunkMessage ) {
 		BOOST_CHECK( source == buffer );
 	}
 
+	// Uniform chunks are stored as a single block.
+	{
+		Chunk uniform_chunk( Chunk::Vector( CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE ) );
+		msg::Chunk msg;
+
+		msg.set_blocks( uniform_chunk );
+
+		BOOST_CHECK( msg.get_num_blocks() == 1 );
+		BOOST_CHECK( msg.is_uniform() == true );
+		BOOST_CHECK( msg.get_block( 0 ) == Chunk::INVALID_BLOCK );
+
+		uniform_chunk.fill( 1337 );
+		msg.set_blocks( uniform_chunk );
+
+		BOOST_CHECK( msg.get_num_blocks() == 1 );
+		BOOST_CHECK( msg.is_uniform() == true );
+		BOOST_CHECK( msg.get_block( 0 ) == 1337 );
+	}
+
 	// Serialize with zero block count.
 	{
 		msg::Chunk msg;
@@ -834,6 +855,7 @@ BOOST_AUTO_TEST_CASE( TestChunkMessage ) {
 	// Serialize with too many blocks.
 	{
 		Chunk big_chunk( Chunk::Vector( 64, 64, 64 ) );
+		big_chunk.set_block( Chunk::Vector( 0, 0, 0 ), 0 ); // Uniform chunks are sent as one block.
 
 		msg::Chunk msg;
 
@@ -5,6 +5,7 @@
 #include <FWU/Cuboid.hpp>
 #include <boost/test/unit_test.hpp>
 #include <sstream>
+#include <algorithm>
 
 BOOST_AUTO_TEST_CASE( TestPlanet ) {
 	using namespace fw;
@@ -19,7 +20,11 @@ BOOST_AUTO_TEST_CASE( TestPlanet ) {
 		BOOST_CHECK( planet.get_id() == "construct" );
 		BOOST_CHECK( planet.get_size() == PLANET_SIZE );
 		BOOST_CHECK( planet.get_chunk_size() == CHUNK_SIZE );
+		BOOST_CHECK( planet.get_seed() == 0 );
 		BOOST_CHECK( planet.get_num_entities() == 0 );
+
+		planet.set_seed( -1337 );
+		BOOST_CHECK( planet.get_seed() == -1337 );
 	}
 
 	// Transform coordinate.
@@ -64,6 +69,29 @@ BOOST_AUTO_TEST_CASE( TestPlanet ) {
 		BOOST_CHECK( planet.transform( invalid_coordinate, chunk_position, block_position ) == false );
 	}
 
+	// Chunk cuboids.
+	{
+		Planet planet( "construct", Planet::Vector( 64, 16, 64 ), CHUNK_SIZE );
+
+		// Inside the planet.
+		Planet::ChunkCuboid cuboid = planet.get_chunk_cuboid( Planet::Vector( 30, 8, 20 ), 5 );
+
+		BOOST_CHECK( cuboid.x == 25 && cuboid.y == 3 && cuboid.z == 15 );
+		BOOST_CHECK( cuboid.width == 11 && cuboid.height == 11 && cuboid.depth == 11 );
+
+		// Moved inside at the borders.
+		cuboid = planet.get_chunk_cuboid( Planet::Vector( 2, 15, 63 ), 5 );
+
+		BOOST_CHECK( cuboid.x == 0 && cuboid.y == 5 && cuboid.z == 53 );
+		BOOST_CHECK( cuboid.width == 11 && cuboid.height == 11 && cuboid.depth == 11 );
+
+		// Clamped to the planet's size.
+		cuboid = planet.get_chunk_cuboid( Planet::Vector( 0, 3, 63 ), 30 );
+
+		BOOST_CHECK( cuboid.x == 0 && cuboid.y == 0 && cuboid.z == 3 );
+		BOOST_CHECK( cuboid.width == 61 && cuboid.height == 16 && cuboid.depth == 61 );
+	}
+
 	// Check for non-existing chunks.
 	{
 		Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
@@ -84,8 +112,17 @@ BOOST_AUTO_TEST_CASE( TestPlanet ) {
 
 		planet.create_chunk( POSITION );
 		BOOST_CHECK( planet.get_num_chunks() == 1 );
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 1 );
 		BOOST_CHECK( planet.has_chunk( POSITION ) == true );
-		BOOST_CHECK( planet.get_raw_chunk_data( POSITION ) != nullptr );
+		BOOST_REQUIRE( planet.find_chunk( POSITION ) != nullptr );
+		BOOST_CHECK( planet.find_chunk( POSITION )->is_empty() == true );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 1, 0, 0 ) ) == nullptr );
+
+		// New chunk must be empty.
+		std::vector<Chunk::Block> raw_data( CHUNK_SIZE.x * CHUNK_SIZE.y * CHUNK_SIZE.z, 0 );
+		planet.get_raw_chunk_data( POSITION, &raw_data[0] );
+
+		BOOST_CHECK( *std::min_element( raw_data.begin(), raw_data.end() ) > Chunk::MAX_BLOCK_ID );
 	}
 
 	// Set some blocks.
@@ -140,7 +177,6 @@ BOOST_AUTO_TEST_CASE( TestPlanet ) {
 		for( chunk_pos.z = 0; chunk_pos.z < PLANET_SIZE.z; ++chunk_pos.z ) {
 			for( chunk_pos.y = 0; chunk_pos.y < PLANET_SIZE.y; ++chunk_pos.y ) {
 				for( chunk_pos.x = 0; chunk_pos.x < PLANET_SIZE.x; ++chunk_pos.x ) {
-					BOOST_CHECK( planet.get_raw_chunk_data( chunk_pos ) != nullptr );
 
 					for( block_pos.z = 0; block_pos.z < CHUNK_SIZE.z; ++block_pos.z ) {
 						for( block_pos.y = 0; block_pos.y < CHUNK_SIZE.y; ++block_pos.y ) {
@@ -177,9 +213,419 @@ BOOST_AUTO_TEST_CASE( TestPlanet ) {
 		planet.set_block( CHUNK_POSITION, BLOCK_POSITION, cls );
 
 		BOOST_CHECK( planet.find_block( CHUNK_POSITION, BLOCK_POSITION ) == &cls );
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 0 );
 
 		planet.reset_block( CHUNK_POSITION, BLOCK_POSITION );
 		BOOST_CHECK( planet.find_block( CHUNK_POSITION, BLOCK_POSITION ) == nullptr );
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 1 );
+	}
+
+	// Regions.
+	{
+		FlexID id;
+		id.parse( "fw.base/grass.yml" );
+		Class grass( id );
+
+		id.parse( "fw.base/stone.yml" );
+		Class stone( id );
+
+		Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+
+		// Fill a region covering one chunk completely and parts of others.
+		planet.fill_region( Planet::BlockCuboid( 0, 2, 0, 20, 14, 16 ), grass );
+
+		BOOST_CHECK( planet.get_num_chunks() == 2 );
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 0 );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 1, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 2, 0 ) ) == &grass );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 3, 15, 15 ) ) == &grass );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 4, 15, 15 ) ) == nullptr );
+
+		// Overwrite with a chunk-aligned region.
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 0, 16, 16, 16 ), stone );
+
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 1 );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 2, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 2, 0 ) ) == &grass );
+
+		// Reset parts of both chunks.
+		planet.reset_region( Planet::BlockCuboid( 15, 0, 0, 2, 16, 1 ) );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 15, 5, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 14, 5, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 5, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 5, 1 ) ) == &grass );
+
+		// Missing chunks are skipped.
+		planet.reset_region( Planet::BlockCuboid( 0, 0, 16, 32, 16, 16 ) );
+		BOOST_CHECK( planet.get_num_chunks() == 2 );
+
+		// Copy across chunk borders into another planet, unset blocks included.
+		Planet target( "target", PLANET_SIZE, CHUNK_SIZE );
+
+		target.fill_region( Planet::BlockCuboid( 0, 0, 0, 32, 16, 32 ), grass );
+		target.copy_region( planet, Planet::BlockCuboid( 14, 0, 0, 4, 4, 2 ), Planet::BlockPosition( 10, 1, 15 ) );
+
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 10, 1, 15 ) ) == &stone );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 11, 1, 15 ) ) == nullptr );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 12, 1, 15 ) ) == nullptr );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 10, 1, 0 ) ) == &stone );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 11, 1, 0 ) ) == &stone );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 12, 2, 0 ) ) == nullptr );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 12, 3, 0 ) ) == &grass );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 13, 4, 0 ) ) == &grass );
+		BOOST_CHECK( target.find_block( Planet::Vector( 0, 0, 1 ), Chunk::Vector( 14, 1, 0 ) ) == &grass );
+
+		// Copy of empty parts doesn't create chunks.
+		Planet empty_target( "empty", PLANET_SIZE, CHUNK_SIZE );
+
+		empty_target.copy_region( planet, Planet::BlockCuboid( 0, 0, 16, 32, 16, 16 ), Planet::BlockPosition( 0, 0, 0 ) );
+		BOOST_CHECK( empty_target.get_num_chunks() == 0 );
+
+		// Overlapping copy inside the same planet.
+		planet.copy_region( planet, Planet::BlockCuboid( 14, 5, 0, 4, 1, 1 ), Planet::BlockPosition( 15, 5, 0 ) );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 14, 5, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 15, 5, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 5, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 1, 5, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 2, 5, 0 ) ) == &grass );
+
+		// Fill columns of different heights.
+		{
+			Planet columns( "columns", Planet::Vector( 2, 2, 1 ), CHUNK_SIZE );
+			std::vector<uint32_t> tops( 32 * 16, 20 );
+
+			columns.fill_region( Planet::BlockCuboid( 0, 0, 0, 1, 4, 1 ), grass );
+
+			tops[0] = 2; // At the bottom, stays untouched.
+			tops[1] = 8;
+			tops[32] = 40; // Clipped to the cuboid.
+
+			for( std::size_t z = 0; z < 16; ++z ) {
+				for( std::size_t x = 16; x < 32; ++x ) {
+					tops[z * 32 + x] = 0;
+				}
+			}
+
+			columns.fill_columns( Planet::BlockCuboid( 0, 2, 0, 32, 28, 16 ), tops, stone );
+
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 2, 0 ) ) == &grass );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 3, 0 ) ) == &grass );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 1, 0 ) ) == nullptr );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 2, 0 ) ) == &stone );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 7, 0 ) ) == &stone );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 8, 0 ) ) == nullptr );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 2, 15, 0 ) ) == &stone );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 2, 3, 0 ) ) == &stone );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 2, 4, 0 ) ) == nullptr );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 13, 1 ) ) == &stone );
+			BOOST_CHECK( columns.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 14, 1 ) ) == nullptr );
+
+			// Chunks without blocks aren't created.
+			BOOST_CHECK( columns.get_num_chunks() == 2 );
+			BOOST_CHECK( columns.has_chunk( Planet::Vector( 1, 0, 0 ) ) == false );
+
+			BOOST_CHECK( columns.get_surface_height( 0, 0 ) == 4 );
+			BOOST_CHECK( columns.get_surface_height( 1, 0 ) == 8 );
+			BOOST_CHECK( columns.get_surface_height( 2, 0 ) == 20 );
+			BOOST_CHECK( columns.get_surface_height( 0, 1 ) == 30 );
+			BOOST_CHECK( columns.get_surface_height( 16, 0 ) == 0 );
+
+			// Same result as filling column by column.
+			Planet expected( "expected", Planet::Vector( 2, 2, 1 ), CHUNK_SIZE );
+
+			expected.fill_region( Planet::BlockCuboid( 0, 0, 0, 1, 4, 1 ), grass );
+
+			for( uint32_t z = 0; z < 16; ++z ) {
+				for( uint32_t x = 0; x < 32; ++x ) {
+					uint32_t top = std::min( tops[z * 32 + x], 30u );
+
+					if( top > 2 ) {
+						expected.fill_region( Planet::BlockCuboid( x, 2, z, 1, top - 2, 1 ), stone );
+					}
+				}
+			}
+
+			std::vector<Chunk::Block> data( 16 * 16 * 16 );
+			std::vector<Chunk::Block> expected_data( 16 * 16 * 16 );
+
+			for( Planet::ScalarType y = 0; y < 2; ++y ) {
+				columns.get_raw_chunk_data( Planet::Vector( 0, y, 0 ), &data[0] );
+				expected.get_raw_chunk_data( Planet::Vector( 0, y, 0 ), &expected_data[0] );
+
+				BOOST_CHECK( data == expected_data );
+			}
+		}
+
+		// Set all blocks of a chunk at once.
+		{
+			Planet chunks( "chunks", Planet::Vector( 1, 2, 1 ), CHUNK_SIZE );
+			std::vector<Chunk::Block> blocks( 16 * 16 * 16, Chunk::INVALID_BLOCK );
+			Planet::ClassArray classes;
+
+			classes.push_back( &grass );
+			classes.push_back( &stone );
+
+			chunks.fill_region( Planet::BlockCuboid( 0, 0, 0, 16, 32, 16 ), grass );
+
+			// Column 0/0 becomes empty in the upper chunk, column 1/0 gets stone
+			// at the bottom.
+			blocks[0 * 256 + 0 * 16 + 1] = 1;
+
+			for( std::size_t block_idx = 16 * 16 * 16 - 16; block_idx < 16 * 16 * 16; ++block_idx ) {
+				blocks[block_idx] = 0;
+			}
+
+			chunks.set_chunk_blocks( Planet::Vector( 0, 1, 0 ), &blocks[0], classes );
+
+			BOOST_CHECK( chunks.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 1, 0, 0 ) ) == &stone );
+			BOOST_CHECK( chunks.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 0, 0 ) ) == nullptr );
+			BOOST_CHECK( chunks.find_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 5, 15, 15 ) ) == &grass );
+			BOOST_CHECK( chunks.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 15, 0 ) ) == &grass );
+			BOOST_CHECK( chunks.is_chunk_dirty( Planet::Vector( 0, 1, 0 ) ) == true );
+
+			BOOST_CHECK( chunks.get_surface_height( 0, 0 ) == 16 );
+			BOOST_CHECK( chunks.get_surface_height( 1, 0 ) == 17 );
+			BOOST_CHECK( chunks.get_surface_height( 1, 15 ) == 32 );
+
+			// Missing chunks are created, unused classes aren't referenced.
+			Planet created( "created", Planet::Vector( 1, 2, 1 ), CHUNK_SIZE );
+
+			created.set_chunk_blocks( Planet::Vector( 0, 0, 0 ), &blocks[0], classes );
+			BOOST_CHECK( created.has_chunk( Planet::Vector( 0, 0, 0 ) ) == true );
+			BOOST_CHECK( created.get_surface_height( 1, 0 ) == 1 );
+
+			std::fill( blocks.begin(), blocks.end(), Chunk::INVALID_BLOCK );
+			blocks[5] = 1;
+			created.set_chunk_blocks( Planet::Vector( 0, 0, 0 ), &blocks[0], classes );
+
+			BOOST_CHECK( created.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 5, 0, 0 ) ) == &stone );
+			BOOST_CHECK( created.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 1, 0, 0 ) ) == nullptr );
+			BOOST_CHECK( created.get_surface_height( 1, 0 ) == 0 );
+			BOOST_CHECK( created.get_surface_height( 5, 0 ) == 1 );
+		}
+
+		// Get all blocks of a chunk and load them back.
+		{
+			Planet source( "source", Planet::Vector( 1, 1, 1 ), CHUNK_SIZE );
+			std::vector<Chunk::Block> blocks( 16 * 16 * 16 );
+			Planet::ClassArray classes;
+
+			source.fill_region( Planet::BlockCuboid( 0, 0, 0, 16, 4, 16 ), stone );
+			source.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 8, 2 ), grass );
+			source.get_chunk_blocks( Planet::Vector( 0, 0, 0 ), &blocks[0], classes );
+
+			// Indices in order of appearance.
+			BOOST_REQUIRE( classes.size() == 2 );
+			BOOST_CHECK( classes[0] == &stone );
+			BOOST_CHECK( classes[1] == &grass );
+			BOOST_CHECK( blocks[0] == 0 );
+			BOOST_CHECK( blocks[(2 * 16 + 8) * 16 + 3] == 1 );
+			BOOST_CHECK( blocks[(2 * 16 + 9) * 16 + 3] == Chunk::INVALID_BLOCK );
+
+			Planet loaded( "loaded", Planet::Vector( 1, 1, 1 ), CHUNK_SIZE );
+
+			loaded.load_chunk_blocks( Planet::Vector( 0, 0, 0 ), &blocks[0], classes, 4711 );
+
+			BOOST_CHECK( loaded.find_chunk( Planet::Vector( 0, 0, 0 ) )->get_revision() == 4711 );
+			BOOST_CHECK( loaded.is_chunk_dirty( Planet::Vector( 0, 0, 0 ) ) == false );
+			BOOST_CHECK( loaded.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 8, 2 ) ) == &grass );
+			BOOST_CHECK( loaded.find_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 15, 3, 15 ) ) == &stone );
+			BOOST_CHECK( loaded.get_surface_height( 3, 2 ) == 9 );
+			BOOST_CHECK( loaded.get_surface_height( 0, 0 ) == 4 );
+		}
+
+		// Reference counts stay consistent with single block edits.
+		planet.reset_region( Planet::BlockCuboid( 0, 0, 0, 32, 16, 16 ) );
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 0, 0 ), stone );
+		planet.reset_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 0, 0 ) );
+
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 2 );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 2, 5, 1 ) ) == nullptr );
+	}
+
+	// Dirty chunks.
+	{
+		FlexID id;
+		id.parse( "fw.base/grass.yml" );
+		Class cls( id );
+
+		Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+		Planet::ChunkPositionArray positions;
+
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+
+		// New chunks are dirty.
+		planet.create_chunk( Planet::Vector( 1, 0, 0 ) );
+		planet.create_chunk( Planet::Vector( 0, 0, 1 ) );
+
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 2 );
+		BOOST_CHECK( planet.is_chunk_dirty( Planet::Vector( 1, 0, 0 ) ) == true );
+		BOOST_CHECK( planet.is_chunk_dirty( Planet::Vector( 0, 0, 0 ) ) == false );
+
+		planet.drain_dirty_chunks( positions );
+
+		BOOST_REQUIRE( positions.size() == 2 );
+		BOOST_CHECK( positions[0] == Planet::Vector( 1, 0, 0 ) );
+		BOOST_CHECK( positions[1] == Planet::Vector( 0, 0, 1 ) );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+		BOOST_CHECK( planet.is_chunk_dirty( Planet::Vector( 1, 0, 0 ) ) == false );
+
+		// Edits make chunks dirty once and increase their revision.
+		Chunk::Revision revision = planet.find_chunk( Planet::Vector( 1, 0, 0 ) )->get_revision();
+
+		planet.set_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 0, 0 ), cls );
+		planet.set_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 1, 0, 0 ), cls );
+
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 1 );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 1, 0, 0 ) )->get_revision() > revision );
+
+		planet.reset_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 0, 0, 0 ) );
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 16, 1, 1, 1 ), cls );
+
+		positions.clear();
+		planet.drain_dirty_chunks( positions );
+
+		BOOST_REQUIRE( positions.size() == 2 );
+		BOOST_CHECK( positions[0] == Planet::Vector( 1, 0, 0 ) );
+		BOOST_CHECK( positions[1] == Planet::Vector( 0, 0, 1 ) );
+
+		// Regions.
+		planet.reset_region( Planet::BlockCuboid( 0, 0, 0, 32, 16, 32 ) );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 2 );
+
+		planet.clear();
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+	}
+
+	// Heightmap.
+	{
+		FlexID id;
+		id.parse( "fw.base/grass.yml" );
+		Class grass( id );
+
+		id.parse( "fw.base/stone.yml" );
+		Class stone( id );
+
+		Planet planet( "construct", Planet::Vector( 2, 2, 2 ), CHUNK_SIZE );
+
+		BOOST_CHECK( planet.get_surface_height( 0, 0 ) == 0 );
+		BOOST_CHECK( planet.get_surface_height( 31, 31 ) == 0 );
+
+		// Single blocks only raise the surface.
+		planet.create_chunk( Planet::Vector( 0, 0, 0 ) );
+		planet.create_chunk( Planet::Vector( 0, 1, 0 ) );
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 4, 5 ), grass );
+		BOOST_CHECK( planet.get_surface_height( 3, 5 ) == 5 );
+
+		planet.set_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 3, 2, 5 ), grass );
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 1, 5 ), grass );
+		BOOST_CHECK( planet.get_surface_height( 3, 5 ) == 19 );
+		BOOST_CHECK( planet.get_surface_height( 4, 5 ) == 0 );
+
+		// Removing the topmost block finds the next one below, across chunks.
+		planet.reset_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 3, 2, 5 ) );
+		BOOST_CHECK( planet.get_surface_height( 3, 5 ) == 5 );
+
+		planet.reset_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 1, 5 ) );
+		BOOST_CHECK( planet.get_surface_height( 3, 5 ) == 5 );
+
+		planet.reset_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 3, 4, 5 ) );
+		BOOST_CHECK( planet.get_surface_height( 3, 5 ) == 0 );
+
+		// Regions.
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 0, 32, 10, 32 ), stone );
+		planet.fill_region( Planet::BlockCuboid( 10, 10, 10, 4, 12, 4 ), grass );
+
+		BOOST_CHECK( planet.get_surface_height( 0, 0 ) == 10 );
+		BOOST_CHECK( planet.get_surface_height( 31, 31 ) == 10 );
+		BOOST_CHECK( planet.get_surface_height( 10, 13 ) == 22 );
+
+		planet.reset_region( Planet::BlockCuboid( 10, 15, 10, 2, 7, 4 ) );
+		BOOST_CHECK( planet.get_surface_height( 10, 10 ) == 15 );
+		BOOST_CHECK( planet.get_surface_height( 12, 10 ) == 22 );
+
+		planet.reset_region( Planet::BlockCuboid( 0, 5, 0, 1, 5, 1 ) );
+		BOOST_CHECK( planet.get_surface_height( 0, 0 ) == 5 );
+
+		// Copies, unset blocks included.
+		planet.copy_region( planet, Planet::BlockCuboid( 10, 10, 10, 4, 12, 1 ), Planet::BlockPosition( 20, 5, 20 ) );
+		BOOST_CHECK( planet.get_surface_height( 20, 20 ) == 10 );
+		BOOST_CHECK( planet.get_surface_height( 22, 20 ) == 17 );
+
+		planet.copy_region( planet, Planet::BlockCuboid( 0, 20, 0, 2, 12, 1 ), Planet::BlockPosition( 21, 1, 20 ) );
+		BOOST_CHECK( planet.get_surface_height( 21, 20 ) == 1 );
+		BOOST_CHECK( planet.get_surface_height( 22, 20 ) == 17 );
+
+		planet.clear();
+		BOOST_CHECK( planet.get_surface_height( 10, 10 ) == 0 );
+	}
+
+	// Raycasting.
+	{
+		FlexID id;
+		id.parse( "fw.base/grass.yml" );
+		Class cls( id );
+
+		Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+		Planet::BlockPosition block_position( 0, 0, 0 );
+		Facing facing = NUM_FACINGS;
+
+		// Nothing to hit.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 5.5f, 3.5f ), Planet::Coordinate( 1, 0, 0 ), 100.0f, block_position, facing ) == false );
+
+		planet.create_chunk( Planet::Vector( 1, 0, 0 ) );
+		planet.set_block( Planet::Vector( 1, 0, 0 ), Chunk::Vector( 4, 5, 3 ), cls );
+
+		// Straight rays, through a missing chunk.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 5.5f, 3.5f ), Planet::Coordinate( 1, 0, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+		BOOST_CHECK( facing == WEST );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 31.5f, 5.5f, 3.5f ), Planet::Coordinate( -2, 0, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+		BOOST_CHECK( facing == EAST );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 20.5f, 15.9f, 3.5f ), Planet::Coordinate( 0, -1, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+		BOOST_CHECK( facing == UP );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 20.5f, 5.5f, 31.0f ), Planet::Coordinate( 0, 0, -1 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+		BOOST_CHECK( facing == SOUTH );
+
+		// Maximum distance.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 5.5f, 3.5f ), Planet::Coordinate( 1, 0, 0 ), 19.6f, block_position, facing ) == true );
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 5.5f, 3.5f ), Planet::Coordinate( 1, 0, 0 ), 19.4f, block_position, facing ) == false );
+
+		// Origin outside of the planet.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( -10.0f, 5.5f, 3.5f ), Planet::Coordinate( 1, 0, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 20.5f, 50.0f, 3.5f ), Planet::Coordinate( 0, -1, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( facing == UP );
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( -10.0f, 5.5f, 3.5f ), Planet::Coordinate( -1, 0, 0 ), 100.0f, block_position, facing ) == false );
+
+		// Diagonal.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 0.5f, 0.5f ), Planet::Coordinate( 20, 5, 3 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 0.5f, 0.5f, 0.5f ), Planet::Coordinate( 20, 15, 3 ), 100.0f, block_position, facing ) == false );
+
+		// Origin inside a block.
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 20.5f, 5.5f, 3.5f ), Planet::Coordinate( 0, 1, 0 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 20, 5, 3 ) );
+
+		// Uniform chunks.
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 16, 16, 16, 16 ), cls );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 5.5f, 5.5f, 0.5f ), Planet::Coordinate( 0, 0, 1 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 5, 5, 16 ) );
+		BOOST_CHECK( facing == NORTH );
+
+		BOOST_CHECK( planet.raycast( Planet::Coordinate( 31.5f, 0.5f, 31.9f ), Planet::Coordinate( -1, 0, -1 ), 100.0f, block_position, facing ) == true );
+		BOOST_CHECK( block_position == Planet::BlockPosition( 15, 0, 16 ) );
+		BOOST_CHECK( facing == EAST );
 	}
 
 	// Entities.
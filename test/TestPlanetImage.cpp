@@ -0,0 +1,204 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/PlanetImage.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+BOOST_FIXTURE_TEST_CASE( TestPlanetImage, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const Planet::Vector SIZE( 4, 3, 4 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	std::string path = (directory / PlanetImage::FILENAME).string();
+
+	fs::create_directories( directory );
+
+	// Initial state.
+	{
+		PlanetImage image;
+
+		BOOST_CHECK( image.is_open() == false );
+		BOOST_CHECK( image.get_file_size() == 0 );
+		BOOST_CHECK( image.get_num_classes() == 0 );
+		BOOST_CHECK( image.get_num_stored_chunks() == 0 );
+	}
+
+	// Write image: uniform stone below y = 10, a grass layer, a single sand
+	// block and an empty chunk.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 0, 64, 10, 64 ), stone );
+		planet.fill_region( Planet::BlockCuboid( 0, 10, 0, 64, 1, 64 ), grass );
+		planet.fill_region( Planet::BlockCuboid( 0, 16, 0, 16, 16, 16 ), stone );
+		planet.set_block( Planet::Vector( 3, 0, 3 ), Chunk::Vector( 1, 12, 3 ), sand );
+		planet.create_chunk( Planet::Vector( 2, 2, 2 ) );
+
+		BOOST_CHECK( PlanetImage::write( path, planet ) == 18 );
+		BOOST_CHECK( fs::exists( path ) == true );
+		BOOST_CHECK( fs::exists( path + ".tmp" ) == false );
+	}
+
+	// Open image.
+	{
+		PlanetImage image;
+		image.open( path );
+
+		BOOST_CHECK( image.is_open() == true );
+		BOOST_CHECK( image.get_file_size() == fs::file_size( path ) );
+		BOOST_CHECK( image.get_id() == "construct" );
+		BOOST_CHECK( image.get_size() == SIZE );
+		BOOST_CHECK( image.get_chunk_size() == CHUNK_SIZE );
+		BOOST_REQUIRE( image.get_num_classes() == 3 );
+		BOOST_CHECK( image.get_class_id( 0 ) == stone.get_id() );
+		BOOST_CHECK( image.get_class_id( 1 ) == grass.get_id() );
+		BOOST_CHECK( image.get_class_id( 2 ) == sand.get_id() );
+
+		// Only the 16 chunks with stone and grass have bodies, each starting at
+		// its own page.
+		BOOST_CHECK( image.get_num_stored_chunks() == 16 );
+		BOOST_CHECK( image.get_file_size() >= 16 * 2 * PlanetImage::PAGE_SIZE );
+
+		BOOST_CHECK( image.has_chunk( Planet::Vector( 0, 0, 0 ) ) == true );
+		BOOST_CHECK( image.is_chunk_uniform( Planet::Vector( 0, 0, 0 ) ) == false );
+		BOOST_CHECK( image.has_chunk( Planet::Vector( 0, 1, 0 ) ) == true );
+		BOOST_CHECK( image.is_chunk_uniform( Planet::Vector( 0, 1, 0 ) ) == true );
+		BOOST_CHECK( image.has_chunk( Planet::Vector( 2, 2, 2 ) ) == true );
+		BOOST_CHECK( image.is_chunk_uniform( Planet::Vector( 2, 2, 2 ) ) == true );
+		BOOST_CHECK( image.has_chunk( Planet::Vector( 1, 1, 0 ) ) == false );
+		BOOST_CHECK( image.is_chunk_uniform( Planet::Vector( 1, 1, 0 ) ) == false );
+
+		std::vector<Chunk::Block> blocks( 16 * 16 * 16 );
+		Chunk::Revision revision = 0;
+
+		BOOST_CHECK( image.read_chunk( Planet::Vector( 1, 1, 0 ), &blocks[0], revision ) == false );
+
+		BOOST_REQUIRE( image.read_chunk( Planet::Vector( 3, 0, 3 ), &blocks[0], revision ) == true );
+		BOOST_CHECK( revision != 0 );
+		BOOST_CHECK( blocks[0] == 0 );
+		BOOST_CHECK( blocks[10 * 16] == 1 );
+		BOOST_CHECK( blocks[11 * 16] == Chunk::INVALID_BLOCK );
+		BOOST_CHECK( blocks[(3 * 16 + 12) * 16 + 1] == 2 );
+
+		BOOST_REQUIRE( image.read_chunk( Planet::Vector( 0, 1, 0 ), &blocks[0], revision ) == true );
+		BOOST_CHECK( std::count( blocks.begin(), blocks.end(), 0 ) == 16 * 16 * 16 );
+
+		BOOST_REQUIRE( image.read_chunk( Planet::Vector( 2, 2, 2 ), &blocks[0], revision ) == true );
+		BOOST_CHECK( std::count( blocks.begin(), blocks.end(), Chunk::INVALID_BLOCK ) == 16 * 16 * 16 );
+
+		image.close();
+		BOOST_CHECK( image.is_open() == false );
+	}
+
+	// Page chunks into a planet.
+	{
+		PlanetImage image;
+		image.open( path );
+
+		Planet::ClassArray classes;
+		classes.push_back( &stone );
+		classes.push_back( &grass );
+		classes.push_back( &sand );
+
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		planet.attach_image( image, classes );
+
+		BOOST_CHECK( planet.get_image() == &image );
+		BOOST_CHECK( planet.get_num_chunks() == 0 );
+		BOOST_CHECK( planet.get_num_paged_chunks() == 0 );
+
+		// Accessing chunks pages them in.
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 1, 1, 0 ) ) == false );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 0, 1, 0 ) ) == true );
+		BOOST_CHECK( planet.get_num_chunks() == 1 );
+		BOOST_CHECK( planet.get_num_uniform_chunks() == 1 );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 3, 0, 3 ), Chunk::Vector( 1, 12, 3 ) ) == &sand );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 3, 0, 3 ), Chunk::Vector( 1, 10, 3 ) ) == &grass );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 2, 2, 2 ) ) != nullptr );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 2, 2, 2 ) )->is_empty() == true );
+		BOOST_CHECK( planet.get_num_chunks() == 3 );
+		BOOST_CHECK( planet.get_num_paged_chunks() == 3 );
+
+		// Paged in chunks aren't dirty and keep their revisions.
+		std::vector<Chunk::Block> blocks( 16 * 16 * 16 );
+		Chunk::Revision revision = 0;
+
+		image.read_chunk( Planet::Vector( 3, 0, 3 ), &blocks[0], revision );
+
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+		BOOST_CHECK( planet.find_chunk( Planet::Vector( 3, 0, 3 ) )->get_revision() == revision );
+
+		// Surface heights page in the whole column.
+		BOOST_CHECK( planet.get_surface_height( 0, 0 ) == 32 );
+		BOOST_CHECK( planet.get_surface_height( 49, 51 ) == 13 );
+		BOOST_CHECK( planet.get_surface_height( 50, 51 ) == 11 );
+		BOOST_CHECK( planet.get_num_paged_chunks() == 4 );
+
+		// Edits apply to the paged in chunk.
+		planet.set_block( Planet::Vector( 1, 0, 1 ), Chunk::Vector( 0, 15, 0 ), sand );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 1, 0, 1 ), Chunk::Vector( 0, 0, 0 ) ) == &stone );
+		BOOST_CHECK( planet.is_chunk_dirty( Planet::Vector( 1, 0, 1 ) ) == true );
+		BOOST_CHECK( planet.get_surface_height( 16, 16 ) == 16 );
+
+		// Chunks in memory shadow the image's.
+		blocks.assign( blocks.size(), Chunk::INVALID_BLOCK );
+		blocks[0] = 0;
+		planet.set_chunk_blocks( Planet::Vector( 2, 0, 2 ), &blocks[0], classes );
+
+		BOOST_CHECK( planet.find_block( Planet::Vector( 2, 0, 2 ), Chunk::Vector( 0, 10, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 2, 0, 2 ), Chunk::Vector( 0, 0, 0 ) ) == &stone );
+		BOOST_CHECK( planet.get_surface_height( 32, 32 ) == 1 );
+		BOOST_CHECK( planet.get_surface_height( 33, 32 ) == 0 );
+
+		// Detaching keeps paged in chunks.
+		std::size_t num_chunks = planet.get_num_chunks();
+		planet.detach_image();
+
+		BOOST_CHECK( planet.get_image() == nullptr );
+		BOOST_CHECK( planet.get_num_chunks() == num_chunks );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 3, 0, 3 ) ) == true );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 3, 0, 0 ) ) == false );
+
+		planet.attach_image( image, classes );
+		planet.clear();
+
+		BOOST_CHECK( planet.get_image() == nullptr );
+		BOOST_CHECK( planet.get_num_paged_chunks() == 0 );
+		BOOST_CHECK( planet.has_chunk( Planet::Vector( 3, 0, 0 ) ) == false );
+	}
+
+	// Invalid images are rejected.
+	{
+		PlanetImage image;
+
+		BOOST_CHECK_THROW( image.open( (directory / "missing.fwi").string() ), PlanetImage::ReadException );
+		BOOST_CHECK( image.is_open() == false );
+
+		std::string damaged_path = (directory / "damaged.fwi").string();
+
+		{
+			std::ofstream out( damaged_path.c_str(), std::ios::binary );
+			out << "FWPI but nothing else";
+		}
+
+		BOOST_CHECK_THROW( image.open( damaged_path ), PlanetImage::ReadException );
+		BOOST_CHECK( image.is_open() == false );
+
+		// Truncated bodies.
+		fs::remove( damaged_path );
+		fs::copy_file( path, damaged_path );
+		fs::resize_file( damaged_path, fs::file_size( path ) / 2 );
+
+		BOOST_CHECK_THROW( image.open( damaged_path ), PlanetImage::ReadException );
+	}
+}
@@ -0,0 +1,79 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+BOOST_FIXTURE_TEST_CASE( TestPlanetReader, StorageFixture ) {
+	using namespace fw;
+
+	static const Planet::Vector SIZE( 20, 1, 4 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	// Missing planet.
+	{
+		PlanetReader reader( directory.string() );
+
+		BOOST_CHECK( reader.get_directory() == directory.string() );
+		BOOST_CHECK( reader.is_open() == false );
+		BOOST_CHECK( PlanetReader::is_saved_planet( directory.string() ) == false );
+		BOOST_CHECK_THROW( reader.open(), PlanetReader::ReadException );
+		BOOST_CHECK( reader.is_open() == false );
+	}
+
+	// Load chunks on demand.
+	{
+		Planet planet( "foo", SIZE, CHUNK_SIZE );
+
+		planet.create_chunk( Planet::Vector( 0, 0, 0 ) );
+		planet.set_block( Planet::Vector( 0, 0, 0 ), Chunk::Vector( 0, 0, 0 ), grass );
+		planet.create_chunk( Planet::Vector( 17, 0, 2 ) );
+		planet.set_block( Planet::Vector( 17, 0, 2 ), Chunk::Vector( 5, 6, 7 ), grass );
+
+		PlanetWriter writer( directory.string(), planet );
+		writer.open();
+		writer.write_planet( planet );
+		writer.flush();
+
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		BOOST_CHECK( reader.is_open() == true );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 0, 0, 0 ) ) == true );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 1, 0, 0 ) ) == false );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 17, 0, 2 ) ) == true );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 9, 0, 0 ) ) == false );
+
+		Planet loaded( "foo", SIZE, CHUNK_SIZE );
+		Planet::ClassArray classes( 1, &grass );
+
+		BOOST_CHECK( reader.load_chunk( loaded, Planet::Vector( 1, 0, 0 ), classes ) == false );
+		BOOST_CHECK( reader.load_chunk( loaded, Planet::Vector( 17, 0, 2 ), classes ) == true );
+		BOOST_CHECK( loaded.get_num_chunks() == 1 );
+		BOOST_CHECK( loaded.find_block( Planet::Vector( 17, 0, 2 ), Chunk::Vector( 5, 6, 7 ) ) == &grass );
+		BOOST_CHECK( loaded.find_chunk( Planet::Vector( 17, 0, 2 ) )->get_revision() == planet.find_chunk( Planet::Vector( 17, 0, 2 ) )->get_revision() );
+
+		// Unresolved classes.
+		Planet::ClassArray unresolved( 1, nullptr );
+		BOOST_CHECK_THROW( reader.load_chunk( loaded, Planet::Vector( 0, 0, 0 ), unresolved ), PlanetReader::ReadException );
+	}
+
+	// Damaged region file.
+	{
+		{
+			std::ofstream out( (directory / "0.0.0.fwr").string().c_str(), std::ios::binary | std::ios::trunc );
+			out << "garbage";
+		}
+
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		BOOST_CHECK_THROW( reader.has_chunk( Planet::Vector( 0, 0, 0 ) ), PlanetReader::ReadException );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 17, 0, 2 ) ) == true );
+	}
+}
@@ -0,0 +1,182 @@
+#include "StorageFixture.hpp"
+
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+BOOST_FIXTURE_TEST_CASE( TestPlanetWriter, StorageFixture ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const Planet::Vector SIZE( 10, 2, 10 );
+	static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+	// Initial state.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		PlanetWriter writer( directory.string(), planet );
+
+		BOOST_CHECK( writer.get_directory() == directory.string() );
+		BOOST_CHECK( writer.is_open() == false );
+		BOOST_CHECK( writer.get_num_pending_chunks() == 0 );
+	}
+
+	// Write planet.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+
+		planet.fill_region( Planet::BlockCuboid( 0, 0, 0, 160, 10, 160 ), stone );
+		planet.fill_region( Planet::BlockCuboid( 0, 10, 0, 160, 1, 160 ), grass );
+		planet.create_chunk( Planet::Vector( 9, 1, 9 ) );
+		planet.set_block( Planet::Vector( 9, 1, 9 ), Chunk::Vector( 1, 2, 3 ), sand );
+		planet.set_seed( -123456 );
+
+		PlanetWriter writer( directory.string(), planet );
+		writer.open();
+
+		BOOST_CHECK( writer.is_open() == true );
+		BOOST_CHECK( fs::is_directory( directory ) == true );
+
+		BOOST_CHECK( writer.write_planet( planet ) == 101 );
+		BOOST_CHECK( writer.get_num_pending_chunks() == 101 );
+		BOOST_CHECK( writer.get_num_classes() == 3 );
+
+		// Nothing written before flushing.
+		BOOST_CHECK( PlanetReader::is_saved_planet( directory.string() ) == false );
+
+		writer.flush();
+
+		BOOST_CHECK( writer.get_num_pending_chunks() == 0 );
+		BOOST_CHECK( PlanetReader::is_saved_planet( directory.string() ) == true );
+		BOOST_CHECK( fs::exists( directory / "0.0.0.fwr" ) == true );
+		BOOST_CHECK( fs::exists( directory / "1.0.1.fwr" ) == true );
+		BOOST_CHECK( fs::exists( directory / "0.1.0.fwr" ) == false );
+	}
+
+	// Read back.
+	{
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		BOOST_CHECK( reader.get_id() == "construct" );
+		BOOST_CHECK( reader.get_size() == SIZE );
+		BOOST_CHECK( reader.get_chunk_size() == CHUNK_SIZE );
+		BOOST_CHECK( reader.get_seed() == -123456 );
+		BOOST_REQUIRE( reader.get_num_classes() == 3 );
+
+		Planet::ClassArray classes( reader.get_num_classes(), nullptr );
+
+		for( std::size_t cls_idx = 0; cls_idx < classes.size(); ++cls_idx ) {
+			if( reader.get_class_id( cls_idx ) == grass.get_id() ) {
+				classes[cls_idx] = &grass;
+			}
+			else if( reader.get_class_id( cls_idx ) == stone.get_id() ) {
+				classes[cls_idx] = &stone;
+			}
+			else if( reader.get_class_id( cls_idx ) == sand.get_id() ) {
+				classes[cls_idx] = &sand;
+			}
+		}
+
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+
+		BOOST_CHECK( reader.load_planet( planet, classes ) == 101 );
+		BOOST_CHECK( planet.get_num_chunks() == 101 );
+		BOOST_CHECK( planet.get_num_dirty_chunks() == 0 );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 4, 0, 4 ), Chunk::Vector( 0, 9, 0 ) ) == &stone );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 4, 0, 4 ), Chunk::Vector( 0, 10, 0 ) ) == &grass );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 4, 0, 4 ), Chunk::Vector( 0, 11, 0 ) ) == nullptr );
+		BOOST_CHECK( planet.find_block( Planet::Vector( 9, 1, 9 ), Chunk::Vector( 1, 2, 3 ) ) == &sand );
+		BOOST_CHECK( planet.get_surface_height( 100, 100 ) == 11 );
+		BOOST_CHECK( planet.get_surface_height( 145, 147 ) == 19 );
+	}
+
+	// Write changed chunks only.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		Planet::Vector position( 3, 0, 3 );
+
+		planet.fill_region( Planet::BlockCuboid( 48, 0, 48, 16, 16, 16 ), sand );
+		planet.set_seed( -123456 );
+
+		PlanetWriter writer( directory.string(), planet );
+		writer.open();
+
+		// The class table of the existing save is kept.
+		BOOST_CHECK( writer.get_num_classes() == 3 );
+
+		writer.write_chunk( planet, position );
+		writer.flush();
+
+		BOOST_CHECK( writer.get_num_classes() == 3 );
+
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		std::vector<Chunk::Block> blocks( 16 * 16 * 16 );
+		Chunk::Revision revision = 0;
+
+		BOOST_REQUIRE( reader.read_chunk( position, &blocks[0], revision ) == true );
+		BOOST_CHECK( reader.get_class_id( blocks[0] ) == sand.get_id() );
+		BOOST_CHECK( reader.get_class_id( blocks[4095] ) == sand.get_id() );
+		BOOST_CHECK( revision == planet.find_chunk( position )->get_revision() );
+
+		// Other chunks of the region are kept.
+		BOOST_REQUIRE( reader.read_chunk( Planet::Vector( 4, 0, 3 ), &blocks[0], revision ) == true );
+		BOOST_CHECK( reader.get_class_id( blocks[0] ) == stone.get_id() );
+		BOOST_CHECK( blocks[4095] == Chunk::INVALID_BLOCK );
+	}
+
+	// A changed seed is written even without chunks.
+	{
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		planet.set_seed( 42 );
+
+		PlanetWriter writer( directory.string(), planet );
+		writer.open();
+		writer.flush();
+
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		BOOST_CHECK( reader.get_seed() == 42 );
+		BOOST_CHECK( reader.get_num_classes() == 3 );
+	}
+
+	// New classes are appended to the table.
+	{
+		static const Class water( FlexID::make( "fw.base.nature/water" ) );
+
+		Planet planet( "construct", SIZE, CHUNK_SIZE );
+		planet.create_chunk( Planet::Vector( 0, 1, 0 ) );
+		planet.set_block( Planet::Vector( 0, 1, 0 ), Chunk::Vector( 0, 0, 0 ), water );
+
+		PlanetWriter writer( directory.string(), planet );
+		writer.open();
+		writer.write_planet( planet );
+
+		BOOST_CHECK( writer.get_num_classes() == 4 );
+		writer.flush();
+
+		PlanetReader reader( directory.string() );
+		reader.open();
+
+		BOOST_REQUIRE( reader.get_num_classes() == 4 );
+		BOOST_CHECK( reader.get_class_id( 3 ) == water.get_id() );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 0, 1, 0 ) ) == true );
+		BOOST_CHECK( reader.has_chunk( Planet::Vector( 0, 0, 0 ) ) == true );
+	}
+
+	// Incompatible planets are rejected.
+	{
+		Planet planet( "construct", Planet::Vector( 4, 4, 4 ), CHUNK_SIZE );
+		PlanetWriter writer( directory.string(), planet );
+
+		BOOST_CHECK_THROW( writer.open(), PlanetWriter::WriteException );
+		BOOST_CHECK( writer.is_open() == false );
+	}
+}
@@ -0,0 +1,88 @@
+#include <FlexWorld/ReceiveBuffer.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+
+BOOST_AUTO_TEST_CASE( TestReceiveBuffer ) {
+	using namespace fw;
+
+	// Initial state.
+	{
+		ReceiveBuffer buffer;
+
+		BOOST_CHECK( buffer.get_capacity() == ReceiveBuffer::DEFAULT_CAPACITY );
+		BOOST_CHECK( buffer.get_size() == 0 );
+		BOOST_CHECK( buffer.get_free_size() == ReceiveBuffer::DEFAULT_CAPACITY );
+	}
+
+	// Commit and consume.
+	{
+		ReceiveBuffer buffer( 16 );
+
+		char* free_space = buffer.prepare( 8 );
+		BOOST_CHECK( buffer.get_free_size() == 16 );
+
+		std::memcpy( free_space, "abcdefghij", 10 );
+		buffer.commit( 10 );
+
+		BOOST_CHECK( buffer.get_size() == 10 );
+		BOOST_CHECK( buffer.get_free_size() == 6 );
+		BOOST_CHECK( std::memcmp( buffer.get_data(), "abcdefghij", 10 ) == 0 );
+
+		// Consuming doesn't move data.
+		const char* data = buffer.get_data();
+		buffer.consume( 4 );
+
+		BOOST_CHECK( buffer.get_size() == 6 );
+		BOOST_CHECK( buffer.get_data() == data + 4 );
+		BOOST_CHECK( std::memcmp( buffer.get_data(), "efghij", 6 ) == 0 );
+
+		// Enough free space, nothing moved.
+		BOOST_CHECK( buffer.prepare( 6 ) == data + 10 );
+		BOOST_CHECK( buffer.get_data() == data + 4 );
+
+		// Not enough free space at the end: unconsumed data moved to front.
+		free_space = buffer.prepare( 8 );
+
+		BOOST_CHECK( buffer.get_capacity() == 16 );
+		BOOST_CHECK( buffer.get_data() == data );
+		BOOST_CHECK( free_space == data + 6 );
+		BOOST_CHECK( buffer.get_free_size() == 10 );
+		BOOST_CHECK( std::memcmp( buffer.get_data(), "efghij", 6 ) == 0 );
+
+		// Consuming everything starts over at the front.
+		buffer.consume( 6 );
+
+		BOOST_CHECK( buffer.get_size() == 0 );
+		BOOST_CHECK( buffer.get_free_size() == 16 );
+	}
+
+	// Grow.
+	{
+		ReceiveBuffer buffer( 8 );
+
+		std::memcpy( buffer.prepare( 8 ), "01234567", 8 );
+		buffer.commit( 8 );
+		buffer.consume( 2 );
+
+		char* free_space = buffer.prepare( 4 );
+
+		BOOST_CHECK( buffer.get_capacity() == 16 );
+		BOOST_CHECK( buffer.get_size() == 6 );
+		BOOST_CHECK( buffer.get_free_size() == 10 );
+		BOOST_CHECK( free_space == buffer.get_data() + 6 );
+		BOOST_CHECK( std::memcmp( buffer.get_data(), "234567", 6 ) == 0 );
+
+		// Grow beyond doubling.
+		buffer.prepare( 100 );
+
+		BOOST_CHECK( buffer.get_capacity() == 106 );
+		BOOST_CHECK( buffer.get_size() == 6 );
+		BOOST_CHECK( std::memcmp( buffer.get_data(), "234567", 6 ) == 0 );
+
+		buffer.clear();
+
+		BOOST_CHECK( buffer.get_size() == 0 );
+		BOOST_CHECK( buffer.get_free_size() == 106 );
+	}
+}
@@ -0,0 +1,132 @@
+#include <FlexWorld/RegionFile.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestRegionFile ) {
+	using namespace fw;
+	namespace fs = boost::filesystem;
+
+	static const std::size_t NUM_BLOCKS = 16 * 16 * 16;
+
+	// Positions.
+	{
+		BOOST_CHECK( RegionFile::get_region_position( Planet::Vector( 0, 7, 8 ) ) == Planet::Vector( 0, 0, 1 ) );
+		BOOST_CHECK( RegionFile::get_region_position( Planet::Vector( 17, 16, 255 ) ) == Planet::Vector( 2, 2, 31 ) );
+		BOOST_CHECK( RegionFile::get_entry_index( Planet::Vector( 0, 0, 0 ) ) == 0 );
+		BOOST_CHECK( RegionFile::get_entry_index( Planet::Vector( 9, 0, 0 ) ) == 1 );
+		BOOST_CHECK( RegionFile::get_entry_index( Planet::Vector( 7, 7, 7 ) ) == RegionFile::NUM_ENTRIES - 1 );
+		BOOST_CHECK( RegionFile::get_region_key( Planet::Vector( 1, 0, 0 ) ) != RegionFile::get_region_key( Planet::Vector( 0, 0, 1 ) ) );
+		BOOST_CHECK( RegionFile::make_filename( Planet::Vector( 1, 2, 3 ) ) == "1.2.3.fwr" );
+	}
+
+	// Encode and decode records.
+	{
+		std::vector<Chunk::Block> blocks( NUM_BLOCKS, Chunk::INVALID_BLOCK );
+		std::vector<Chunk::Block> decoded( NUM_BLOCKS, 0 );
+		RegionFile::Buffer record;
+
+		// Uniform.
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+		BOOST_CHECK( record.size() == 3 );
+
+		RegionFile::decode_chunk( &record[0], record.size(), &decoded[0], NUM_BLOCKS );
+		BOOST_CHECK( decoded == blocks );
+
+		// Runs.
+		std::fill( blocks.begin(), blocks.begin() + 1000, 3 );
+		blocks[2000] = 7;
+
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+		BOOST_CHECK( record.size() == 1 + 4 * 4 );
+
+		RegionFile::decode_chunk( &record[0], record.size(), &decoded[0], NUM_BLOCKS );
+		BOOST_CHECK( decoded == blocks );
+
+		// Plain values when runs don't pay off.
+		for( std::size_t block_idx = 0; block_idx < NUM_BLOCKS; ++block_idx ) {
+			blocks[block_idx] = static_cast<Chunk::Block>( block_idx % 5 );
+		}
+
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+		BOOST_CHECK( record.size() == 1 + 2 * NUM_BLOCKS );
+
+		RegionFile::decode_chunk( &record[0], record.size(), &decoded[0], NUM_BLOCKS );
+		BOOST_CHECK( decoded == blocks );
+
+		// Damaged records.
+		std::fill( blocks.begin(), blocks.end(), 1 );
+		blocks[0] = 2;
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+
+		BOOST_CHECK_THROW( RegionFile::decode_chunk( &record[0], record.size() - 4, &decoded[0], NUM_BLOCKS ), RegionFile::FormatException );
+		BOOST_CHECK_THROW( RegionFile::decode_chunk( &record[0], record.size(), &decoded[0], NUM_BLOCKS - 1 ), RegionFile::FormatException );
+
+		record[0] = 42;
+		BOOST_CHECK_THROW( RegionFile::decode_chunk( &record[0], record.size(), &decoded[0], NUM_BLOCKS ), RegionFile::FormatException );
+	}
+
+	// Save and load.
+	{
+		fs::path path = fs::temp_directory_path() / fs::unique_path( "fwtest-%%%%-%%%%.fwr" );
+		std::vector<Chunk::Block> blocks( NUM_BLOCKS, 5 );
+		RegionFile::Buffer record;
+		RegionFile region;
+
+		BOOST_CHECK( region.get_num_chunks() == 0 );
+		BOOST_CHECK( region.has_chunk( 0 ) == false );
+		BOOST_CHECK( region.get_revision( 0 ) == 0 );
+
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+		region.set_record( 3, record, 10 );
+		blocks[100] = 6;
+		RegionFile::encode_chunk( &blocks[0], NUM_BLOCKS, record );
+		region.set_record( 511, record, 20 );
+
+		BOOST_CHECK( region.get_num_chunks() == 2 );
+		region.save( path.string() );
+
+		BOOST_CHECK( fs::exists( path ) == true );
+		BOOST_CHECK( fs::exists( path.string() + ".tmp" ) == false );
+
+		RegionFile loaded;
+		loaded.load( path.string() );
+
+		BOOST_CHECK( loaded.get_num_chunks() == 2 );
+		BOOST_CHECK( loaded.has_chunk( 3 ) == true );
+		BOOST_CHECK( loaded.has_chunk( 4 ) == false );
+		BOOST_CHECK( loaded.get_revision( 3 ) == 10 );
+		BOOST_CHECK( loaded.get_revision( 511 ) == 20 );
+		BOOST_CHECK( loaded.get_record( 511 ) == record );
+
+		// Index only.
+		{
+			std::ifstream in( path.string().c_str(), std::ios::binary );
+			std::vector<RegionFile::Entry> entries( RegionFile::NUM_ENTRIES );
+
+			RegionFile::read_index( in, &entries[0] );
+
+			BOOST_CHECK( entries[0].offset == 0 );
+			BOOST_CHECK( entries[3].offset == RegionFile::HEADER_SIZE );
+			BOOST_CHECK( entries[3].length == 3 );
+			BOOST_CHECK( entries[511].offset == RegionFile::HEADER_SIZE + 3 );
+			BOOST_CHECK( entries[511].length == record.size() );
+			BOOST_CHECK( entries[511].revision == 20 );
+		}
+
+		// Truncated file.
+		fs::resize_file( path, RegionFile::HEADER_SIZE + 4 );
+		BOOST_CHECK_THROW( loaded.load( path.string() ), RegionFile::FormatException );
+
+		fs::resize_file( path, 10 );
+		BOOST_CHECK_THROW( loaded.load( path.string() ), RegionFile::FormatException );
+
+		fs::remove( path );
+		BOOST_CHECK_THROW( loaded.load( path.string() ), RegionFile::IOException );
+
+		// Failed loads keep the previous state.
+		BOOST_CHECK( loaded.get_num_chunks() == 2 );
+	}
+}
@@ -0,0 +1,95 @@
+#include <FlexWorld/ScopedLock.hpp>
+#include <FlexWorld/LockFacility.hpp>
+#include <FlexWorld/Planet.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+
+BOOST_AUTO_TEST_CASE( TestScopedLock ) {
+	using namespace fw;
+
+	// Lock until out of scope.
+	{
+		LockFacility facility;
+
+		{
+			ScopedLock lock( facility, ScopedLock::WORLD );
+
+			BOOST_CHECK( lock.is_locked() == true );
+			BOOST_CHECK( facility.is_world_locked() == true );
+			BOOST_CHECK( facility.is_script_manager_locked() == false );
+			BOOST_CHECK( facility.is_account_manager_locked() == false );
+			BOOST_CHECK( facility.is_player_list_locked() == false );
+		}
+
+		BOOST_CHECK( facility.is_world_locked() == false );
+
+		{
+			ScopedLock script_manager_lock( facility, ScopedLock::SCRIPT_MANAGER );
+			ScopedLock account_manager_lock( facility, ScopedLock::ACCOUNT_MANAGER );
+			ScopedLock player_list_lock( facility, ScopedLock::PLAYER_LIST );
+
+			BOOST_CHECK( facility.is_script_manager_locked() == true );
+			BOOST_CHECK( facility.is_account_manager_locked() == true );
+			BOOST_CHECK( facility.is_player_list_locked() == true );
+		}
+
+		BOOST_CHECK( facility.is_script_manager_locked() == false );
+		BOOST_CHECK( facility.is_account_manager_locked() == false );
+		BOOST_CHECK( facility.is_player_list_locked() == false );
+	}
+
+	// Unlock early.
+	{
+		LockFacility facility;
+
+		{
+			ScopedLock lock( facility, ScopedLock::WORLD );
+			ScopedLock nested_lock( facility, ScopedLock::WORLD );
+
+			nested_lock.unlock();
+			BOOST_CHECK( nested_lock.is_locked() == false );
+			BOOST_CHECK( facility.is_world_locked() == true );
+
+			lock.unlock();
+			BOOST_CHECK( lock.is_locked() == false );
+			BOOST_CHECK( facility.is_world_locked() == false );
+		}
+
+		BOOST_CHECK( facility.is_world_locked() == false );
+	}
+
+	// Planets.
+	{
+		LockFacility facility;
+		Planet foo( "foo", Planet::Vector( 1, 1, 1 ), Chunk::Vector( 1, 1, 1 ) );
+
+		facility.create_planet_lock( foo );
+
+		{
+			ScopedLock lock( facility, foo );
+
+			BOOST_CHECK( facility.is_planet_locked( foo ) == true );
+			BOOST_CHECK( facility.get_num_locked_planets() == 1 );
+		}
+
+		BOOST_CHECK( facility.is_planet_locked( foo ) == false );
+		BOOST_CHECK( facility.get_num_locked_planets() == 0 );
+
+		facility.destroy_planet_lock( foo );
+	}
+
+	// Unlock when an exception is thrown.
+	{
+		LockFacility facility;
+
+		try {
+			ScopedLock lock( facility, ScopedLock::WORLD );
+			throw std::runtime_error( "Fail." );
+		}
+		catch( const std::runtime_error& ) {
+		}
+
+		BOOST_CHECK( facility.is_world_locked() == false );
+	}
+}
@@ -3,7 +3,17 @@
 #include <SFML/System/Clock.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
 #include <set>
+#include <algorithm>
+#include <cstring>
+
+struct OddConnectionPredicate {
+	bool operator()( fw::Server::ConnectionID conn_id ) const {
+		return conn_id % 2 == 1;
+	}
+};
 
 class ServerHandler : public fw::Server::Handler {
 	public:
@@ -57,6 +67,77 @@ class ServerHandler : public fw::Server::Handler {
 		std::size_t m_num_logins;
 };
 
+// Handler for a server run by several threads. Echoes logins, checks their
+// order and that handlers of the same connection don't run concurrently.
+class ConcurrentServerHandler : public fw::Server::Handler {
+	public:
+		ConcurrentServerHandler() :
+			server( nullptr ),
+			num_connected( 0 ),
+			num_logins( 0 ),
+			num_errors( 0 )
+		{
+		}
+
+		void handle_connect( fw::Server::ConnectionID id ) {
+			boost::lock_guard<boost::mutex> lock( mutex );
+
+			if( next_sequence.size() <= id ) {
+				next_sequence.resize( id + 1, 0 );
+				in_handler.resize( id + 1, false );
+			}
+
+			++num_connected;
+		}
+
+		void handle_disconnect( fw::Server::ConnectionID /*id*/ ) {
+			boost::lock_guard<boost::mutex> lock( mutex );
+			--num_connected;
+		}
+
+		void handle_message( const fw::msg::OpenLogin& msg, fw::Server::ConnectionID sender ) {
+			{
+				boost::lock_guard<boost::mutex> lock( mutex );
+
+				if( in_handler[sender] || boost::lexical_cast<std::size_t>( msg.get_password() ) != next_sequence[sender] ) {
+					++num_errors;
+				}
+
+				in_handler[sender] = true;
+				++next_sequence[sender];
+			}
+
+			// Give other threads a chance to run handlers of the same connection.
+			boost::this_thread::yield();
+			server->send_message( msg, sender );
+
+			{
+				boost::lock_guard<boost::mutex> lock( mutex );
+
+				in_handler[sender] = false;
+				++num_logins;
+			}
+		}
+
+		std::size_t get_num_connected() {
+			boost::lock_guard<boost::mutex> lock( mutex );
+			return num_connected;
+		}
+
+		std::size_t get_num_logins() {
+			boost::lock_guard<boost::mutex> lock( mutex );
+			return num_logins;
+		}
+
+		fw::Server* server;
+		boost::mutex mutex;
+		std::vector<std::size_t> next_sequence;
+		std::vector<bool> in_handler;
+		std::size_t num_connected;
+		std::size_t num_logins;
+		std::size_t num_errors;
+};
+
 BOOST_AUTO_TEST_CASE( TestServer ) {
 	using namespace fw;
 	using namespace boost::asio;
@@ -335,19 +416,19 @@ BOOST_AUTO_TEST_CASE( TestServer ) {
 		}
 
 		// Receive messages.
-		char buf[17];
+		char buf[21];
 		std::size_t num_received = 0;
 
 		for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
 			clients[client_idx]->non_blocking( true );
 
 			for( std::size_t msg_idx = 0; msg_idx < NUM_MESSAGES; ++msg_idx ) {
-				num_received = clients[client_idx]->receive( buffer( buf, 17 ) );
+				num_received = clients[client_idx]->receive( buffer( buf, 21 ) );
 
-				BOOST_REQUIRE( num_received == 17 );
+				BOOST_REQUIRE( num_received == 21 );
 
-				BOOST_REQUIRE( buf[0] == 0 ); // Message ID.
-				BOOST_REQUIRE( msg.deserialize( buf + 1, 16 ) == 16 );
+				BOOST_REQUIRE( buf[4] == 0 ); // Message ID (after length).
+				BOOST_REQUIRE( msg.deserialize( buf + 5, 16 ) == 16 );
 
 				BOOST_CHECK( msg.get_username() == "Kitty" );
 				BOOST_CHECK( msg.get_password() == "Cat" );
@@ -355,4 +436,301 @@ BOOST_AUTO_TEST_CASE( TestServer ) {
 			}
 		}
 	}
+
+	// Send a burst exceeding the socket buffers (server -> client).
+	{
+		enum { NUM_MESSAGES = 100000 };
+		enum { MESSAGE_SIZE = 21 };
+
+		io_service service;
+		ServerHandler handler;
+
+		Server server( service, handler );
+
+		server.set_ip( IP );
+		server.set_port( PORT );
+
+		BOOST_REQUIRE( server.start() == true );
+
+		ip::tcp::socket client( service );
+		ip::tcp::endpoint endpoint( ip::address::from_string( IP ), PORT );
+
+		client.connect( endpoint );
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_connected_clients().size() != 1 ) {
+				service.poll();
+			}
+
+			BOOST_REQUIRE( timer.getElapsedTime() < TIMEOUT );
+		}
+
+		msg::OpenLogin msg;
+		msg.set_username( "Kitty" );
+		msg.set_password( "Cat" );
+		msg.set_server_password( "Meowz" );
+
+		for( std::size_t msg_idx = 0; msg_idx < NUM_MESSAGES; ++msg_idx ) {
+			server.send_message( msg, 0 );
+		}
+
+		// Receive while the server continues short writes.
+		std::vector<char> received;
+		char buf[4096];
+		boost::system::error_code error;
+		sf::Clock timer;
+
+		client.non_blocking( true );
+
+		while( timer.getElapsedTime() < TIMEOUT && received.size() < NUM_MESSAGES * MESSAGE_SIZE ) {
+			service.poll();
+
+			std::size_t num_received = client.receive( buffer( buf, sizeof( buf ) ), 0, error );
+			received.insert( received.end(), buf, buf + num_received );
+		}
+
+		BOOST_REQUIRE( received.size() == NUM_MESSAGES * MESSAGE_SIZE );
+
+		for( std::size_t msg_idx = 0; msg_idx < NUM_MESSAGES; ++msg_idx ) {
+			const char* data = &received[msg_idx * MESSAGE_SIZE];
+
+			BOOST_REQUIRE( data[4] == 0 ); // Message ID (after length).
+			BOOST_REQUIRE( msg.deserialize( data + 5, MESSAGE_SIZE - 5 ) == MESSAGE_SIZE - 5 );
+		}
+
+		BOOST_CHECK( msg.get_username() == "Kitty" );
+	}
+
+	// Broadcast messages (server -> clients).
+	{
+		enum { NUM_CLIENTS = 3 };
+		enum { MESSAGE_SIZE = 21 };
+
+		io_service service;
+		ServerHandler handler;
+
+		Server server( service, handler );
+
+		server.set_ip( IP );
+		server.set_port( PORT );
+
+		BOOST_REQUIRE( server.start() == true );
+
+		std::unique_ptr<ip::tcp::socket> clients[NUM_CLIENTS];
+		ip::tcp::endpoint endpoint( ip::address::from_string( IP ), PORT );
+
+		for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+			clients[client_idx].reset( new ip::tcp::socket( service ) );
+			clients[client_idx]->connect( endpoint );
+		}
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_connected_clients().size() != NUM_CLIENTS ) {
+				service.poll();
+			}
+
+			BOOST_REQUIRE( timer.getElapsedTime() < TIMEOUT );
+		}
+
+		msg::OpenLogin msg;
+		msg.set_username( "Kitty" );
+		msg.set_password( "Cat" );
+		msg.set_server_password( "Meowz" );
+
+		Server::ConnectionIDArray recipients;
+		recipients.push_back( 0 );
+		recipients.push_back( 2 );
+
+		BOOST_CHECK( server.broadcast( msg ) == 3 );
+		BOOST_CHECK( server.broadcast( msg, recipients ) == 2 );
+		BOOST_CHECK( server.broadcast( msg, Server::ConnectionIDArray() ) == 0 );
+		BOOST_CHECK( server.broadcast_if( msg, OddConnectionPredicate() ) == 1 );
+
+		// Mixed with single messages.
+		server.send_message( msg, 1 );
+
+		while( service.poll() > 0 ) {
+		}
+
+		// Client 0 and 2 got 2 messages, client 1 got 3.
+		std::size_t expected_num_messages[NUM_CLIENTS] = { 2, 3, 2 };
+		char buf[4 * MESSAGE_SIZE];
+
+		for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+			std::size_t expected_size = expected_num_messages[client_idx] * MESSAGE_SIZE;
+			std::size_t num_received = read( *clients[client_idx], buffer( buf, expected_size ) );
+
+			BOOST_REQUIRE( num_received == expected_size );
+
+			for( std::size_t msg_idx = 0; msg_idx < expected_num_messages[client_idx]; ++msg_idx ) {
+				BOOST_REQUIRE( buf[msg_idx * MESSAGE_SIZE + 4] == 0 ); // Message ID (after length).
+				BOOST_REQUIRE( msg.deserialize( buf + msg_idx * MESSAGE_SIZE + 5, MESSAGE_SIZE - 5 ) == MESSAGE_SIZE - 5 );
+			}
+
+			clients[client_idx]->non_blocking( true );
+
+			boost::system::error_code error;
+			BOOST_CHECK( clients[client_idx]->receive( buffer( buf, sizeof( buf ) ), 0, error ) == 0 );
+		}
+	}
+
+	// Messages split across reads, then invalid data (client -> server).
+	{
+		enum { NUM_MESSAGES = 1000 };
+		enum { SEGMENT_SIZE = 7 };
+
+		io_service service;
+		ServerHandler handler;
+
+		Server server( service, handler );
+
+		server.set_ip( IP );
+		server.set_port( PORT );
+
+		BOOST_REQUIRE( server.start() == true );
+
+		ip::tcp::socket client( service );
+		ip::tcp::endpoint endpoint( ip::address::from_string( IP ), PORT );
+
+		client.connect( endpoint );
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_connected_clients().size() != 1 ) {
+				service.poll();
+			}
+
+			BOOST_REQUIRE( timer.getElapsedTime() < TIMEOUT );
+		}
+
+		msg::OpenLogin msg;
+		msg.set_username( "Tank" );
+		msg.set_password( "h4x0r" );
+		msg.set_server_password( "me0w" );
+
+		ServerProtocol::Buffer buf;
+
+		for( std::size_t msg_idx = 0; msg_idx < NUM_MESSAGES; ++msg_idx ) {
+			ServerProtocol::serialize_message( msg, buf );
+		}
+
+		for( std::size_t offset = 0; offset < buf.size(); offset += SEGMENT_SIZE ) {
+			write( client, buffer( &buf[offset], std::min<std::size_t>( SEGMENT_SIZE, buf.size() - offset ) ) );
+			service.poll();
+		}
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_num_logins() != NUM_MESSAGES ) {
+				service.poll();
+			}
+
+			BOOST_CHECK( handler.get_num_logins() == NUM_MESSAGES );
+		}
+
+		// Frame too small for any message: disconnect.
+		ServerProtocol::MessageLength length = 1;
+		char bogus[sizeof( length ) + 1] = { 0 };
+		std::memcpy( bogus, &length, sizeof( length ) );
+
+		write( client, buffer( bogus, sizeof( bogus ) ) );
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_connected_clients().size() != 0 ) {
+				service.poll();
+			}
+
+			BOOST_CHECK( handler.get_connected_clients().empty() );
+			BOOST_CHECK( server.get_num_peers() == 0 );
+		}
+	}
+
+	// IO service run by several threads.
+	{
+		enum { NUM_THREADS = 4 };
+		enum { NUM_CLIENTS = 8 };
+		enum { NUM_MESSAGES = 500 };
+
+		io_service service;
+		io_service client_service;
+		ConcurrentServerHandler handler;
+
+		Server server( service, handler );
+		handler.server = &server;
+
+		server.set_ip( IP );
+		server.set_port( PORT );
+
+		BOOST_REQUIRE( server.start() == true );
+
+		boost::thread_group threads;
+
+		for( std::size_t thread_idx = 0; thread_idx < NUM_THREADS; ++thread_idx ) {
+			threads.create_thread( boost::bind( &io_service::run, &service ) );
+		}
+
+		std::unique_ptr<ip::tcp::socket> clients[NUM_CLIENTS];
+		ip::tcp::endpoint endpoint( ip::address::from_string( IP ), PORT );
+
+		for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+			clients[client_idx].reset( new ip::tcp::socket( client_service ) );
+			clients[client_idx]->connect( endpoint );
+		}
+
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < TIMEOUT && handler.get_num_connected() != NUM_CLIENTS ) {
+				boost::this_thread::yield();
+			}
+
+			BOOST_REQUIRE( handler.get_num_connected() == NUM_CLIENTS );
+		}
+
+		// Every client sends numbered logins, interleaved with the others.
+		ServerProtocol::Buffer bufs[NUM_CLIENTS];
+
+		for( std::size_t msg_idx = 0; msg_idx < NUM_MESSAGES; ++msg_idx ) {
+			msg::OpenLogin msg;
+			msg.set_username( "Tank" );
+			msg.set_password( boost::lexical_cast<std::string>( msg_idx ) );
+			msg.set_server_password( "me0w" );
+
+			for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+				ServerProtocol::serialize_message( msg, bufs[client_idx] );
+			}
+		}
+
+		for( std::size_t offset = 0; offset < bufs[0].size(); offset += 1000 ) {
+			for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+				write( *clients[client_idx], buffer( &bufs[client_idx][offset], std::min<std::size_t>( 1000, bufs[client_idx].size() - offset ) ) );
+			}
+		}
+
+		// Echoes arrive in order.
+		for( std::size_t client_idx = 0; client_idx < NUM_CLIENTS; ++client_idx ) {
+			ServerProtocol::Buffer received( bufs[client_idx].size() );
+
+			read( *clients[client_idx], buffer( &received[0], received.size() ) );
+			BOOST_CHECK( received == bufs[client_idx] );
+		}
+
+		BOOST_CHECK( handler.get_num_logins() == NUM_CLIENTS * NUM_MESSAGES );
+		BOOST_CHECK( handler.num_errors == 0 );
+
+		// Stopping closes all connections, the threads return afterwards.
+		server.stop();
+		threads.join_all();
+
+		BOOST_CHECK( handler.get_num_connected() == 0 );
+		BOOST_CHECK( server.get_num_peers() == 0 );
+	}
 }
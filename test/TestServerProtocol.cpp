@@ -3,6 +3,7 @@
 #include <FlexWorld/Messages/OpenLogin.hpp>
 
 #include <boost/test/unit_test.hpp>
+#include <cstring>
 
 class SPHandler : public fw::MessageHandler<fw::ServerMessageList, fw::ServerProtocol::ConnectionID> {
 	public:
@@ -24,21 +25,58 @@ class SPHandler : public fw::MessageHandler<fw::ServerMessageList, fw::ServerPro
 		bool m_login_handled;
 };
 
+static void append_length( fw::ServerProtocol::MessageLength length, fw::ServerProtocol::Buffer& buffer ) {
+	buffer.resize( buffer.size() + sizeof( length ) );
+	std::memcpy( &buffer[buffer.size() - sizeof( length )], &length, sizeof( length ) );
+}
+
 BOOST_AUTO_TEST_CASE( TestServerProtocol ) {
 	using namespace fw;
 
 	ServerProtocol protocol;
 	SPHandler handler;
 
-	// Incomplete message.
+	// Empty buffer and incomplete length.
+	{
+		ServerProtocol::Buffer buffer;
+		BOOST_CHECK( protocol.dispatch( buffer, handler, 9949 ) == 0 );
+
+		buffer.resize( sizeof( ServerProtocol::MessageLength ) - 1, 0 );
+		BOOST_CHECK( protocol.dispatch( buffer, handler, 9949 ) == 0 );
+	}
+
+	// Message ID only.
+	{
+		ServerProtocol::Buffer buffer;
+		append_length( 1, buffer );
+		buffer.push_back( static_cast<char>( 244 ) );
+
+		BOOST_CHECK_THROW( protocol.dispatch( buffer, handler, 9949 ), ServerProtocol::BogusMessageDataException );
+	}
+
+	// Too large message.
 	{
-		ServerProtocol::Buffer buffer( 1, 244 ); // Message ID only.
+		ServerProtocol::Buffer buffer;
+		append_length( ServerProtocol::MAX_MESSAGE_LENGTH + 1, buffer );
+
 		BOOST_CHECK_THROW( protocol.dispatch( buffer, handler, 9949 ), ServerProtocol::BogusMessageDataException );
 	}
 
+	// Incomplete message (detected by length only).
+	{
+		ServerProtocol::Buffer buffer;
+		append_length( 10, buffer );
+		buffer.resize( buffer.size() + 9, static_cast<char>( 244 ) );
+
+		BOOST_CHECK( protocol.dispatch( buffer, handler, 9949 ) == 0 );
+	}
+
 	// Dispatch unknown message.
 	{
-		ServerProtocol::Buffer buffer( 2, 244 ); // 244 = unknown message ID.
+		ServerProtocol::Buffer buffer;
+		append_length( 2, buffer );
+		buffer.resize( buffer.size() + 2, static_cast<char>( 244 ) ); // 244 = unknown message ID.
+
 		std::size_t eaten = 0;
 
 		BOOST_CHECK_THROW( eaten = protocol.dispatch( buffer, handler, 9949 ), ServerProtocol::UnknownMessageIDException );
@@ -52,6 +90,7 @@ BOOST_AUTO_TEST_CASE( TestServerProtocol ) {
 		const std::string password( "h4x0r" );
 		const std::string server_password( "me0w" );
 		
+		append_length( 17, buffer );
 		buffer.push_back( static_cast<char>( tpl::IndexOf<fw::msg::OpenLogin, ServerMessageList>::RESULT ) );
 		buffer.push_back( static_cast<char>( username.size() ) );
 		buffer.insert( buffer.end(), username.begin(), username.end() );
@@ -62,8 +101,43 @@ BOOST_AUTO_TEST_CASE( TestServerProtocol ) {
 
 		std::size_t eaten = 0;
 
+		// Everything but the last byte.
+		BOOST_CHECK_NO_THROW( eaten = protocol.dispatch( &buffer[0], buffer.size() - 1, handler, 9949 ) );
+		BOOST_CHECK( eaten == 0 );
+		BOOST_CHECK( handler.m_login_handled == false );
+
 		BOOST_CHECK_NO_THROW( eaten = protocol.dispatch( buffer, handler, 9949 ) );
-		BOOST_CHECK( eaten == 17 );
+		BOOST_CHECK( eaten == 21 );
+		BOOST_CHECK( handler.m_login_handled == true );
+
+		// Length not matching the message.
+		handler.m_login_handled = false;
+		buffer.push_back( 0 );
+
+		ServerProtocol::MessageLength length = 18;
+		std::memcpy( &buffer[0], &length, sizeof( length ) );
+
+		BOOST_CHECK_THROW( protocol.dispatch( buffer, handler, 9949 ), ServerProtocol::BogusMessageDataException );
+	}
+
+	// Serialize message.
+	{
+		msg::OpenLogin login;
+		login.set_username( "Tank" );
+		login.set_password( "h4x0r" );
+		login.set_server_password( "me0w" );
+
+		ServerProtocol::Buffer buffer( 3, 0 );
+		ServerProtocol::serialize_message( login, buffer );
+
+		BOOST_REQUIRE( buffer.size() == 3 + 21 );
+
+		ServerProtocol::MessageLength length = 0;
+		std::memcpy( &length, &buffer[3], sizeof( length ) );
+		BOOST_CHECK( length == 17 );
+
+		handler.m_login_handled = false;
+		BOOST_CHECK( protocol.dispatch( &buffer[3], buffer.size() - 3, handler, 9949 ) == 21 );
 		BOOST_CHECK( handler.m_login_handled == true );
 	}
 }
@@ -1,18 +1,28 @@
 #include "Config.hpp"
 #include "ExceptionChecker.hpp"
+#include "StorageFixture.hpp"
 
 #include <FlexWorld/SessionHost.hpp>
 #include <FlexWorld/AccountManager.hpp>
+#include <FlexWorld/Account.hpp>
 #include <FlexWorld/LockFacility.hpp>
 #include <FlexWorld/World.hpp>
 #include <FlexWorld/GameMode.hpp>
 #include <FlexWorld/Client.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/BlockJournal.hpp>
+#include <FlexWorld/EntityStore.hpp>
 #include <FlexWorld/Messages/OpenLogin.hpp>
+#include <FlexWorld/Messages/Ready.hpp>
+#include <FlexWorld/Messages/RequestChunk.hpp>
+#include <FlexWorld/Types.hpp>
 
 #include <FWU/Log.hpp>
 #include <SFML/System/Clock.hpp>
 #include <boost/asio.hpp>
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 
 using util::Log;
 
@@ -107,6 +117,100 @@ BOOST_AUTO_TEST_CASE( TestSessionHost ) {
 		lock_facility.destroy_planet_lock( *planet );
 	}
 
+	// The terrain seed is saved with the planet and restored on restart.
+	{
+		StorageFixture storage;
+		std::string planet_directory = (storage.directory / "planets" / "construct").string();
+		int seed = 0;
+
+		for( int run = 0; run < 2; ++run ) {
+			LockFacility lock_facility;
+			World world;
+			boost::asio::io_service service;
+			AccountManager acc_mgr;
+
+			SessionHost host( service, lock_facility, acc_mgr, world, game_mode );
+			host.set_ip( "127.0.0.1" );
+			host.set_port( 2593 );
+			host.add_search_path( DATA_DIRECTORY + "/packages" );
+			host.set_planets_path( (storage.directory / "planets").string() );
+
+			BOOST_REQUIRE( host.start() );
+
+			const Planet* construct = world.find_planet( "construct" );
+			BOOST_REQUIRE( construct != nullptr );
+
+			if( run == 1 ) {
+				BOOST_CHECK( construct->get_seed() == seed );
+			}
+
+			host.stop();
+
+			PlanetReader reader( planet_directory );
+			BOOST_REQUIRE_NO_THROW( reader.open() );
+			BOOST_CHECK( reader.get_seed() == construct->get_seed() );
+
+			// Change the saved seed, so the next run can't get it by chance.
+			Planet planet( "construct", construct->get_size(), construct->get_chunk_size() );
+			seed = construct->get_seed() + 1;
+			planet.set_seed( seed );
+
+			PlanetWriter writer( planet_directory, planet );
+			writer.open();
+			writer.flush();
+		}
+	}
+
+	// Journaled edits are replayed over the generated terrain.
+	{
+		StorageFixture storage;
+		std::string planet_directory = (storage.directory / "planets" / "construct").string();
+
+		// Save only the seed, so the terrain is known.
+		{
+			Planet planet( "construct", Planet::Vector( 256, 16, 256 ), Chunk::Vector( 16, 16, 16 ) );
+			planet.set_seed( 1 );
+
+			PlanetWriter writer( planet_directory, planet );
+			writer.open();
+			writer.flush();
+		}
+
+		// Remove the lowest generated block of a column that wasn't saved. The
+		// edit is newer than any generated chunk (one revision per block).
+		{
+			BlockJournal journal( planet_directory );
+			journal.open();
+			journal.append( Planet::BlockPosition( 100, 50, 100 ), nullptr, 100000 );
+		}
+
+		LockFacility lock_facility;
+		World world;
+		boost::asio::io_service service;
+		AccountManager acc_mgr;
+
+		SessionHost host( service, lock_facility, acc_mgr, world, game_mode );
+		host.set_ip( "127.0.0.1" );
+		host.set_port( 2593 );
+		host.add_search_path( DATA_DIRECTORY + "/packages" );
+		host.set_planets_path( (storage.directory / "planets").string() );
+
+		BOOST_REQUIRE( host.start() );
+
+		// Request the column. The terrain of the seed is higher than the block.
+		BOOST_CHECK( host.get_surface_height( 100, 100, "construct" ) > 51 );
+
+		const Planet* construct = world.find_planet( "construct" );
+		BOOST_REQUIRE( construct != nullptr );
+
+		lock_facility.lock_planet( *construct, true );
+		BOOST_CHECK( construct->find_block( Planet::Vector( 6, 3, 6 ), Chunk::Vector( 4, 2, 4 ) ) == nullptr );
+		BOOST_CHECK( construct->find_block( Planet::Vector( 6, 3, 6 ), Chunk::Vector( 5, 2, 4 ) ) != nullptr );
+		lock_facility.lock_planet( *construct, false );
+
+		host.stop();
+	}
+
 	Log::Logger.set_min_level( Log::DEBUG );
 }
 
@@ -115,7 +219,12 @@ class TestSessionHostGateClientHandler : public fw::Client::Handler {
 	public:
 		TestSessionHostGateClientHandler() :
 			fw::Client::Handler(),
-			m_num_chat_messages_received( 0 )
+			m_logged_in( false ),
+			m_beamed( false ),
+			m_num_chat_messages_received( 0 ),
+			m_num_destroy_block_messages_received( 0 ),
+			m_num_set_block_messages_received( 0 ),
+			m_num_create_entity_messages_received( 0 )
 		{
 		}
 
@@ -126,26 +235,41 @@ class TestSessionHostGateClientHandler : public fw::Client::Handler {
 
 		void handle_message( const fw::msg::DestroyBlock& msg, fw::Server::ConnectionID /*conn_id*/ ) {
 			m_last_destroy_block_message = msg;
+			++m_num_destroy_block_messages_received;
 		}
 
 		void handle_message( const fw::msg::SetBlock& msg, fw::Server::ConnectionID /*conn_id*/ ) {
 			m_last_set_block_message = msg;
+			++m_num_set_block_messages_received;
 		}
 
 		void handle_message( const fw::msg::CreateEntity& msg, fw::Server::ConnectionID /*conn_id*/ ) {
 			m_last_create_entity_message = msg;
+			++m_num_create_entity_messages_received;
 		}
 
 		void handle_message( const fw::msg::AttachEntity& msg, fw::Server::ConnectionID /*conn_id*/ ) {
 			m_last_attach_entity_message = msg;
 		}
 
+		void handle_message( const fw::msg::LoginOK& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_logged_in = true;
+		}
+
+		void handle_message( const fw::msg::Beam& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_beamed = true;
+		}
+
 		void handle_message( const fw::msg::ServerInfo& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {}
-		void handle_message( const fw::msg::LoginOK& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {}
 		void handle_connect( fw::Server::ConnectionID /*conn_id*/ ) {}
 		void handle_disconnect( fw::Server::ConnectionID /*conn_id*/ ) {}
 
+		bool m_logged_in;
+		bool m_beamed;
 		std::size_t m_num_chat_messages_received;
+		std::size_t m_num_destroy_block_messages_received;
+		std::size_t m_num_set_block_messages_received;
+		std::size_t m_num_create_entity_messages_received;
 		fw::msg::Chat m_last_chat_message;
 		fw::msg::DestroyBlock m_last_destroy_block_message;
 		fw::msg::SetBlock m_last_set_block_message;
@@ -294,6 +418,25 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		BOOST_CHECK( handler2.m_last_chat_message.get_channel() == sf::String( "IAmA" ) );
 		BOOST_CHECK( handler2.m_last_chat_message.get_sender() == sf::String( "Kitty" ) );
 
+		// Login with a wrong password gets disconnected and releases the account
+		// manager.
+		{
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Tank" );
+			ol_msg.set_password( "wrong" );
+
+			client2.send_message( ol_msg );
+
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && host.get_num_connected_clients() != 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
+			BOOST_CHECK( lock_facility.is_account_manager_locked() == false );
+		}
+
 		// Stop session host.
 		host.stop();
 		io_service.run();
@@ -361,6 +504,31 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
 		}
 
+		// Login and get beamed to the construct, so the client sees the
+		// chunks around its entity.
+		{
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Destroyer" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+
+			client.send_message( msg::Ready() );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_beamed ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_beamed );
+		}
+
 		// Destroy block.
 		BOOST_CHECK_NO_THROW(
 			host.destroy_block(
@@ -373,8 +541,16 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		);
 		BOOST_CHECK( planet->find_block( CHUNK_POS, BLOCK_POS ) == nullptr );
 
-		// Poll IO service.
-		io_service.poll();
+		// Poll until the client received the message.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_destroy_block_messages_received < 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_num_destroy_block_messages_received == 1 );
+		}
 
 		// Check that client received destroy block message.
 		BOOST_CHECK(
@@ -391,6 +567,10 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		BOOST_CHECK_EXCEPTION( host.destroy_block( lua::WorldGate::BlockPosition( 99999, 99999, 99999 ), PLANET_ID ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Block position out of range." ) );
 		BOOST_CHECK_EXCEPTION( host.destroy_block( lua::WorldGate::BlockPosition( 0, 0, 0 ), "foobar" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Planet not found." ) );
 		BOOST_CHECK_EXCEPTION( host.destroy_block( lua::WorldGate::BlockPosition( 0, 0, 0 ), "" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid planet." ) );
+
+		// Failed calls release their locks.
+		BOOST_CHECK( lock_facility.is_world_locked() == false );
+		BOOST_CHECK( lock_facility.get_num_locked_planets() == 0 );
 	}
 
 	// set_block
@@ -453,6 +633,31 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
 		}
 
+		// Login and get beamed to the construct, so the client sees the
+		// chunks around its entity.
+		{
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Setter" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+
+			client.send_message( msg::Ready() );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_beamed ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_beamed );
+		}
+
 		// Set block.
 		BOOST_CHECK_NO_THROW(
 			host.set_block(
@@ -471,8 +676,16 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 			BOOST_CHECK( set_cls->get_id() == CLASS_ID );
 		}
 
-		// Poll IO service.
-		io_service.poll();
+		// Poll until the client received the message.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_set_block_messages_received < 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_num_set_block_messages_received == 1 );
+		}
 
 		// Check that client received set block message.
 		BOOST_CHECK(
@@ -490,6 +703,10 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		BOOST_CHECK_EXCEPTION( host.set_block( lua::WorldGate::BlockPosition( 0, 0, 0 ), "", CLASS_ID ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid planet." ) );
 		BOOST_CHECK_EXCEPTION( host.set_block( lua::WorldGate::BlockPosition( 0, 0, 0 ), PLANET_ID, FlexID::make( "package" ) ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid class." ) );
 		BOOST_CHECK_EXCEPTION( host.set_block( lua::WorldGate::BlockPosition( 0, 0, 0 ), PLANET_ID, FlexID::make( "no/exist" ) ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Class not found." ) );
+
+		// Failed calls release their locks.
+		BOOST_CHECK( lock_facility.is_world_locked() == false );
+		BOOST_CHECK( lock_facility.get_num_locked_planets() == 0 );
 	}
 
 	// create_entity
@@ -547,28 +764,66 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
 		}
 
-		// Create entity.
+		// Login and get beamed to the construct, so the client sees the
+		// chunks around its entity.
+		{
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Creator" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+
+			client.send_message( msg::Ready() );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_beamed ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_beamed );
+		}
+
+		// Create entity. The player's entity is the first one.
+		std::size_t num_create_entity_messages = handler.m_num_create_entity_messages_received;
+		fw::Entity::ID entity_id = 0;
+
 		BOOST_CHECK_NO_THROW(
-			host.create_entity(
+			entity_id = host.create_entity(
 				CLASS_ID,
 				ENTITY_POS,
 				PLANET_ID
 			)
 		);
 
+		BOOST_CHECK( entity_id == 1 );
+
 		// Verify.
-		const Entity* entity = world.find_entity( 0 );
+		const Entity* entity = world.find_entity( entity_id );
 
 		BOOST_REQUIRE( entity != nullptr );
 		BOOST_CHECK( entity->get_class().get_id() == CLASS_ID );
 		BOOST_CHECK( entity->get_position() == ENTITY_POS );
 		BOOST_CHECK( world.find_linked_planet( entity->get_id() )->get_id() == PLANET_ID );
 
-		// Poll IO service.
-		io_service.poll();
+		// Poll until the client received the message.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_create_entity_messages_received < num_create_entity_messages + 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_num_create_entity_messages_received == num_create_entity_messages + 1 );
+		}
 
 		// Check that client received message.
-		BOOST_CHECK( handler.m_last_create_entity_message.get_id() == 0 );
+		BOOST_CHECK( handler.m_last_create_entity_message.get_id() == entity_id );
 		BOOST_CHECK( handler.m_last_create_entity_message.get_heading() == 0 );
 		BOOST_CHECK( handler.m_last_create_entity_message.get_class() == CLASS_ID.get() );
 		BOOST_CHECK( handler.m_last_create_entity_message.get_position() == ENTITY_POS );
@@ -592,8 +847,16 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		BOOST_CHECK( attached_entity->get_parent() == entity );
 		BOOST_CHECK( entity->has_child( *attached_entity, "inventory" ) == true );
 
-		// Poll IO service.
-		io_service.poll();
+		// Poll until the client received the message.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_create_entity_messages_received < num_create_entity_messages + 2 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_num_create_entity_messages_received == num_create_entity_messages + 2 );
+		}
 
 		BOOST_CHECK( handler.m_last_create_entity_message.get_id() == attached_entity->get_id() );
 		BOOST_CHECK( handler.m_last_create_entity_message.get_heading() == 0 );
@@ -620,8 +883,16 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 		BOOST_CHECK( stowed_entity->get_parent() == attached_entity );
 		BOOST_CHECK( attached_entity->has_child( *stowed_entity, "_cont" ) == true );
 
-		// Poll IO service.
-		io_service.poll();
+		// Poll until the client received the message.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_create_entity_messages_received < num_create_entity_messages + 3 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_num_create_entity_messages_received == num_create_entity_messages + 3 );
+		}
 
 		BOOST_CHECK( handler.m_last_create_entity_message.get_id() == stowed_entity->get_id() );
 		BOOST_CHECK( handler.m_last_create_entity_message.get_heading() == 0 );
@@ -787,6 +1058,444 @@ BOOST_AUTO_TEST_CASE( TestSessionHostGate ) {
 			std::runtime_error,
 			ExceptionChecker<std::runtime_error>( "Entity not found." )
 		);
+
+		BOOST_CHECK( lock_facility.is_world_locked() == false );
+	}
+
+	Log::Logger.set_min_level( Log::DEBUG );
+}
+
+class TestSessionHostViewClientHandler : public fw::Client::Handler {
+	public:
+		TestSessionHostViewClientHandler() :
+			fw::Client::Handler(),
+			m_logged_in( false ),
+			m_beamed( false ),
+			m_num_chunks_unchanged( 0 ),
+			m_num_set_block_messages_received( 0 )
+		{
+		}
+
+		void handle_message( const fw::msg::LoginOK& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_logged_in = true;
+		}
+
+		void handle_message( const fw::msg::Beam& msg, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_last_beam_message = msg;
+			m_beamed = true;
+		}
+
+		void handle_message( const fw::msg::ChunkUnchanged& msg, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_unchanged_chunks.push_back( msg.get_position() );
+			++m_num_chunks_unchanged;
+		}
+
+		void handle_message( const fw::msg::SetBlock& msg, fw::Server::ConnectionID /*conn_id*/ ) {
+			m_last_set_block_message = msg;
+			++m_num_set_block_messages_received;
+		}
+
+		void handle_message( const fw::msg::ServerInfo& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {}
+		void handle_message( const fw::msg::CreateEntity& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {}
+		void handle_message( const fw::msg::Chat& /*msg*/, fw::Server::ConnectionID /*conn_id*/ ) {}
+		void handle_connect( fw::Server::ConnectionID /*conn_id*/ ) {}
+		void handle_disconnect( fw::Server::ConnectionID /*conn_id*/ ) {}
+
+		bool m_logged_in;
+		bool m_beamed;
+		fw::msg::Beam m_last_beam_message;
+		std::size_t m_num_chunks_unchanged;
+		std::vector<fw::Planet::Vector> m_unchanged_chunks;
+		fw::msg::SetBlock m_last_set_block_message;
+		std::size_t m_num_set_block_messages_received;
+};
+
+BOOST_AUTO_TEST_CASE( TestSessionHostView ) {
+	using namespace fw;
+
+	Log::Logger.set_min_level( Log::FATAL );
+
+	GameMode mode;
+	AccountManager account_manager;
+
+	mode.set_default_entity_class_id( FlexID::make( "fw.struct.simple/grass" ) );
+	mode.add_package( FlexID::make( "sessionhostscripts" ) );
+
+	enum { TIMEOUT = 5000 };
+
+	// Request the whole client view of the default construct planet, then
+	// change the player's chunk.
+	{
+		// Setup host.
+		boost::asio::io_service io_service;
+		LockFacility lock_facility;
+		World world;
+		SessionHost host( io_service, lock_facility, account_manager, world, mode );
+
+		host.set_ip( "127.0.0.1" );
+		host.set_port( 2593 );
+		host.add_search_path( DATA_DIRECTORY + std::string( "/packages" ) );
+		host.set_auth_mode( SessionHost::OPEN_AUTH );
+
+		BOOST_REQUIRE( host.start() );
+
+		TestSessionHostViewClientHandler handler;
+		Client client( io_service, handler );
+
+		client.start( host.get_ip(), host.get_port() );
+
+		// Login and get beamed to the construct.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && host.get_num_connected_clients() != 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
+
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Tank" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+
+			client.send_message( msg::Ready() );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_beamed ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_beamed );
+		}
+
+		const Planet* planet = world.find_planet( handler.m_last_beam_message.get_planet_name() );
+		BOOST_REQUIRE( planet != nullptr );
+		BOOST_CHECK( handler.m_last_beam_message.get_planet_size() == planet->get_size() );
+
+		// Request chunks like the client does.
+		Planet::Vector chunk_pos;
+		Planet::Vector surface_chunk_pos;
+		Chunk::Vector block_pos;
+
+		BOOST_REQUIRE( planet->transform( handler.m_last_beam_message.get_position(), chunk_pos, block_pos ) );
+		BOOST_REQUIRE(
+			planet->transform(
+				handler.m_last_beam_message.get_position() - sf::Vector3f( 0, 1, 0 ),
+				surface_chunk_pos,
+				block_pos
+			)
+		);
+
+		Planet::ChunkCuboid cuboid = planet->get_chunk_cuboid( chunk_pos, VIEW_RADIUS );
+		Planet::Vector runner;
+
+		BOOST_CHECK( cuboid.contains( surface_chunk_pos.x, surface_chunk_pos.y, surface_chunk_pos.z ) );
+
+		for( runner.z = cuboid.z; runner.z < cuboid.z + cuboid.depth; ++runner.z ) {
+			for( runner.y = cuboid.y; runner.y < cuboid.y + cuboid.height; ++runner.y ) {
+				for( runner.x = cuboid.x; runner.x < cuboid.x + cuboid.width; ++runner.x ) {
+					msg::RequestChunk req_msg;
+					req_msg.set_position( runner );
+					req_msg.set_timestamp( 0 );
+					client.send_message( req_msg );
+				}
+			}
+		}
+
+		// Request the surface chunk again. The host handles requests in order,
+		// so once both answers arrived no request of the view made it
+		// disconnect the client.
+		{
+			msg::RequestChunk req_msg;
+			req_msg.set_position( surface_chunk_pos );
+			req_msg.set_timestamp( 0 );
+			client.send_message( req_msg );
+		}
+
+		std::size_t num_surface_answers = 0;
+		sf::Clock timer;
+
+		while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && num_surface_answers < 2 ) {
+			io_service.poll();
+			num_surface_answers = std::count( handler.m_unchanged_chunks.begin(), handler.m_unchanged_chunks.end(), surface_chunk_pos );
+		}
+
+		BOOST_CHECK( num_surface_answers == 2 );
+		BOOST_CHECK( host.get_num_connected_clients() == 1 );
+
+		// Requests don't move the interest away from the player's entity, not
+		// even one outside of the view.
+		Planet::Vector far_chunk_pos(
+			static_cast<Planet::ScalarType>( planet->get_size().x - 1 ),
+			0,
+			static_cast<Planet::ScalarType>( planet->get_size().z - 1 )
+		);
+
+		BOOST_REQUIRE( !cuboid.contains( far_chunk_pos.x, far_chunk_pos.y, far_chunk_pos.z ) );
+
+		{
+			msg::RequestChunk req_msg;
+			req_msg.set_position( far_chunk_pos );
+			req_msg.set_timestamp( 0 );
+			client.send_message( req_msg );
+		}
+
+		while(
+			timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) &&
+			std::find( handler.m_unchanged_chunks.begin(), handler.m_unchanged_chunks.end(), far_chunk_pos ) == handler.m_unchanged_chunks.end()
+		) {
+			io_service.poll();
+		}
+
+		BOOST_REQUIRE( std::find( handler.m_unchanged_chunks.begin(), handler.m_unchanged_chunks.end(), far_chunk_pos ) != handler.m_unchanged_chunks.end() );
+
+		// Changes of the player's own chunk still reach the client.
+		lua::WorldGate::BlockPosition player_block_position(
+			static_cast<uint32_t>( handler.m_last_beam_message.get_position().x ),
+			static_cast<uint32_t>( handler.m_last_beam_message.get_position().y ),
+			static_cast<uint32_t>( handler.m_last_beam_message.get_position().z )
+		);
+
+		BOOST_CHECK_NO_THROW( host.set_block( player_block_position, planet->get_id(), FlexID::make( "fw.struct.simple/grass" ) ) );
+
+		while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && handler.m_num_set_block_messages_received == 0 ) {
+			io_service.poll();
+		}
+
+		BOOST_CHECK( handler.m_num_set_block_messages_received == 1 );
+		BOOST_CHECK( handler.m_last_set_block_message.get_block_position() == player_block_position );
+
+		// Stop session host.
+		host.stop();
+		io_service.run();
+	}
+
+	// A parked request is answered when a script generates its column.
+	{
+		// Setup host.
+		boost::asio::io_service io_service;
+		LockFacility lock_facility;
+		World world;
+		SessionHost host( io_service, lock_facility, account_manager, world, mode );
+
+		host.set_ip( "127.0.0.1" );
+		host.set_port( 2593 );
+		host.add_search_path( DATA_DIRECTORY + std::string( "/packages" ) );
+		host.set_auth_mode( SessionHost::OPEN_AUTH );
+
+		BOOST_REQUIRE( host.start() );
+
+		TestSessionHostViewClientHandler handler;
+		Client client( io_service, handler );
+
+		client.start( host.get_ip(), host.get_port() );
+
+		// Login and get beamed to the construct.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && host.get_num_connected_clients() != 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
+
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Scripter" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+
+			client.send_message( msg::Ready() );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_beamed ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_beamed );
+		}
+
+		const Planet* planet = world.find_planet( handler.m_last_beam_message.get_planet_name() );
+		BOOST_REQUIRE( planet != nullptr );
+
+		// Keep the generator's worker from generating. Handlers run in this
+		// thread, so they still get the (recursive) planet lock.
+		lock_facility.lock_planet( *planet, true );
+
+		// Request a chunk far away from the player. Its column isn't generated,
+		// so the request is parked.
+		Planet::Vector far_chunk_pos(
+			static_cast<Planet::ScalarType>( planet->get_size().x - 1 ),
+			0,
+			static_cast<Planet::ScalarType>( planet->get_size().z - 1 )
+		);
+
+		{
+			msg::RequestChunk req_msg;
+			req_msg.set_position( far_chunk_pos );
+			req_msg.set_timestamp( 0 );
+			client.send_message( req_msg );
+		}
+
+		sf::Clock timer;
+
+		while( timer.getElapsedTime() < sf::milliseconds( 100 ) ) {
+			io_service.poll();
+		}
+
+		// Generate the column like a script does.
+		BOOST_CHECK_NO_THROW(
+			host.get_surface_height(
+				static_cast<uint32_t>( far_chunk_pos.x ) * planet->get_chunk_size().x,
+				static_cast<uint32_t>( far_chunk_pos.z ) * planet->get_chunk_size().z,
+				planet->get_id()
+			)
+		);
+
+		lock_facility.lock_planet( *planet, false );
+		timer.restart();
+
+		while(
+			timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) &&
+			std::find( handler.m_unchanged_chunks.begin(), handler.m_unchanged_chunks.end(), far_chunk_pos ) == handler.m_unchanged_chunks.end()
+		) {
+			io_service.poll();
+		}
+
+		BOOST_CHECK( std::find( handler.m_unchanged_chunks.begin(), handler.m_unchanged_chunks.end(), far_chunk_pos ) != handler.m_unchanged_chunks.end() );
+
+		// Stop session host.
+		host.stop();
+		io_service.run();
+	}
+
+	// An account whose entity got lost gets a new one.
+	{
+		// Setup host.
+		boost::asio::io_service io_service;
+		LockFacility lock_facility;
+		World world;
+		SessionHost host( io_service, lock_facility, account_manager, world, mode );
+
+		host.set_ip( "127.0.0.1" );
+		host.set_port( 2593 );
+		host.add_search_path( DATA_DIRECTORY + std::string( "/packages" ) );
+		host.set_auth_mode( SessionHost::OPEN_AUTH );
+
+		// The entity doesn't exist in the world.
+		Account lost_account;
+		lost_account.set_username( "Lost" );
+		lost_account.set_password( "h4x0r" );
+		lost_account.set_entity_id( 1000 );
+		account_manager.add_account( lost_account );
+
+		BOOST_REQUIRE( host.start() );
+
+		TestSessionHostViewClientHandler handler;
+		Client client( io_service, handler );
+
+		client.start( host.get_ip(), host.get_port() );
+
+		// Login.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && host.get_num_connected_clients() != 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
+
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Lost" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+		}
+
+		const Account* account = account_manager.find_account( "Lost" );
+		BOOST_REQUIRE( account != nullptr );
+
+		BOOST_CHECK( account->get_entity_id() != 1000 );
+		BOOST_CHECK( world.find_entity( account->get_entity_id() ) != nullptr );
+
+		// Stop session host.
+		host.stop();
+		io_service.run();
+	}
+
+	// The entity of a new account is saved right away.
+	{
+		StorageFixture storage;
+
+		// Setup host.
+		boost::asio::io_service io_service;
+		LockFacility lock_facility;
+		World world;
+		SessionHost host( io_service, lock_facility, account_manager, world, mode );
+
+		host.set_ip( "127.0.0.1" );
+		host.set_port( 2593 );
+		host.add_search_path( DATA_DIRECTORY + std::string( "/packages" ) );
+		host.set_auth_mode( SessionHost::OPEN_AUTH );
+		host.set_entities_path( (storage.directory / "entities").string() );
+
+		BOOST_REQUIRE( host.start() );
+
+		TestSessionHostViewClientHandler handler;
+		Client client( io_service, handler );
+
+		client.start( host.get_ip(), host.get_port() );
+
+		// Login.
+		{
+			sf::Clock timer;
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && host.get_num_connected_clients() != 1 ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( host.get_num_connected_clients() == 1 );
+
+			msg::OpenLogin ol_msg;
+			ol_msg.set_username( "Newbie" );
+			ol_msg.set_password( "h4x0r" );
+			client.send_message( ol_msg );
+
+			while( timer.getElapsedTime() < sf::milliseconds( TIMEOUT ) && !handler.m_logged_in ) {
+				io_service.poll();
+			}
+
+			BOOST_REQUIRE( handler.m_logged_in );
+		}
+
+		const Account* account = account_manager.find_account( "Newbie" );
+		BOOST_REQUIRE( account != nullptr );
+
+		// Read the store like after a crash.
+		EntityStore store( (storage.directory / "entities").string() );
+		BOOST_REQUIRE_NO_THROW( store.open() );
+		BOOST_CHECK( store.get_num_entities() == 1 );
+
+		// Stop session host.
+		host.stop();
+		io_service.run();
 	}
 
 	Log::Logger.set_min_level( Log::DEBUG );
@@ -4,6 +4,7 @@
 
 #include <SFML/Graphics/Image.hpp> // XXX 
 #include <boost/test/unit_test.hpp>
+#include <vector>
 #include <ctime>
 
 BOOST_AUTO_TEST_CASE( TestTerrainGenerator ) {
@@ -22,6 +23,7 @@ BOOST_AUTO_TEST_CASE( TestTerrainGenerator ) {
 		BOOST_CHECK( gen.get_seed() == 0 );
 		BOOST_CHECK( gen.get_base_height() == 0 );
 		BOOST_CHECK( gen.get_maximum_height() == 0 );
+		BOOST_CHECK( gen.get_num_threads() == 1 );
 
 		TerrainGenerator::Layer layer;
 
@@ -37,10 +39,12 @@ BOOST_AUTO_TEST_CASE( TestTerrainGenerator ) {
 		gen.set_seed( 12345 );
 		gen.set_base_height( 4455 );
 		gen.set_maximum_height( 9524 );
+		gen.set_num_threads( 4 );
 
 		BOOST_CHECK( gen.get_seed() == 12345 );
 		BOOST_CHECK( gen.get_base_height() == 4455 );
 		BOOST_CHECK( gen.get_maximum_height() == 9524 );
+		BOOST_CHECK( gen.get_num_threads() == 4 );
 	}
 
 	// Check layer equality.
@@ -111,4 +115,198 @@ BOOST_AUTO_TEST_CASE( TestTerrainGenerator ) {
 			gen.generate( planet, util::Cuboid<uint32_t>( 0, 0, 0, 64, 64, 64 ) );
 		}
 	}
+
+	// Output is the same for any number of threads.
+	{
+		const Planet::Vector planet_size( 5, 4, 3 );
+		const Chunk::Vector chunk_size( 16, 16, 16 );
+		const util::Cuboid<uint32_t> cuboid( 3, 5, 7, 70, 50, 40 );
+
+		TerrainGenerator gen( default_cls );
+
+		gen.set_seed( 4711 );
+		gen.set_base_height( 10 );
+		gen.set_maximum_height( 30 );
+
+		Planet reference( "reference", planet_size, chunk_size );
+		gen.generate( reference, cuboid );
+
+		BOOST_CHECK( reference.get_num_chunks() > 0 );
+
+		std::vector<Chunk::Block> data( 16 * 16 * 16 );
+		std::vector<Chunk::Block> reference_data( 16 * 16 * 16 );
+
+		for( std::size_t num_threads = 2; num_threads <= 8; num_threads += 3 ) {
+			Planet planet( "planet", planet_size, chunk_size );
+
+			gen.set_num_threads( num_threads );
+			gen.generate( planet, cuboid );
+
+			BOOST_REQUIRE( planet.get_num_chunks() == reference.get_num_chunks() );
+
+			Planet::Vector chunk_pos( 0, 0, 0 );
+
+			for( chunk_pos.z = 0; chunk_pos.z < planet_size.z; ++chunk_pos.z ) {
+				for( chunk_pos.y = 0; chunk_pos.y < planet_size.y; ++chunk_pos.y ) {
+					for( chunk_pos.x = 0; chunk_pos.x < planet_size.x; ++chunk_pos.x ) {
+						BOOST_REQUIRE( planet.has_chunk( chunk_pos ) == reference.has_chunk( chunk_pos ) );
+
+						if( !planet.has_chunk( chunk_pos ) ) {
+							continue;
+						}
+
+						planet.get_raw_chunk_data( chunk_pos, &data[0] );
+						reference.get_raw_chunk_data( chunk_pos, &reference_data[0] );
+
+						BOOST_CHECK( data == reference_data );
+					}
+				}
+			}
+
+			for( uint32_t z = cuboid.z; z < cuboid.z + cuboid.depth; ++z ) {
+				for( uint32_t x = cuboid.x; x < cuboid.x + cuboid.width; ++x ) {
+					BOOST_CHECK( planet.get_surface_height( x, z ) == reference.get_surface_height( x, z ) );
+				}
+			}
+		}
+
+		// Single chunks give the same blocks.
+		Planet chunks( "chunks", planet_size, chunk_size );
+		Planet::Vector chunk_pos( 0, 0, 0 );
+
+		for( chunk_pos.z = 0; chunk_pos.z < planet_size.z; ++chunk_pos.z ) {
+			for( chunk_pos.y = 0; chunk_pos.y < planet_size.y; ++chunk_pos.y ) {
+				for( chunk_pos.x = 0; chunk_pos.x < planet_size.x; ++chunk_pos.x ) {
+					gen.generate_chunk( chunks, chunk_pos );
+				}
+			}
+		}
+
+		Planet whole( "whole", planet_size, chunk_size );
+		gen.generate( whole, util::Cuboid<uint32_t>( 0, 0, 0, 80, 64, 48 ) );
+
+		for( chunk_pos.z = 0; chunk_pos.z < planet_size.z; ++chunk_pos.z ) {
+			for( chunk_pos.y = 0; chunk_pos.y < planet_size.y; ++chunk_pos.y ) {
+				for( chunk_pos.x = 0; chunk_pos.x < planet_size.x; ++chunk_pos.x ) {
+					if( !chunks.has_chunk( chunk_pos ) ) {
+						// Only chunks without blocks are skipped.
+						if( whole.has_chunk( chunk_pos ) ) {
+							BOOST_CHECK( whole.find_chunk( chunk_pos )->is_empty() );
+						}
+
+						continue;
+					}
+
+					BOOST_REQUIRE( whole.has_chunk( chunk_pos ) );
+
+					chunks.get_raw_chunk_data( chunk_pos, &data[0] );
+					whole.get_raw_chunk_data( chunk_pos, &reference_data[0] );
+
+					BOOST_CHECK( data == reference_data );
+				}
+			}
+		}
+
+		for( uint32_t z = 0; z < 48; ++z ) {
+			for( uint32_t x = 0; x < 80; ++x ) {
+				BOOST_CHECK( chunks.get_surface_height( x, z ) == whole.get_surface_height( x, z ) );
+			}
+		}
+
+		// Sampled heights are within the limits.
+		for( uint32_t z = cuboid.z; z < cuboid.z + cuboid.depth; ++z ) {
+			for( uint32_t x = cuboid.x; x < cuboid.x + cuboid.width; ++x ) {
+				BOOST_CHECK( reference.get_surface_height( x, z ) <= 40 );
+			}
+		}
+	}
+
+	// Layers.
+	{
+		const Planet::Vector planet_size( 3, 3, 2 );
+		const Chunk::Vector chunk_size( 16, 16, 16 );
+		const Class stone_cls( FlexID::make( "fw.base.nature/stone" ) );
+
+		TerrainGenerator gen( default_cls );
+
+		gen.set_seed( 99 );
+		gen.set_base_height( 20 );
+		gen.set_maximum_height( 10 );
+
+		// Stone below the surface, dirt in between, overridden by cls0 in the
+		// middle.
+		TerrainGenerator::Layer layer;
+
+		layer.min_height = 0;
+		layer.max_height = 24;
+		layer.cls = &stone_cls;
+		gen.add_layer( layer );
+
+		layer.min_height = 24;
+		layer.max_height = 27;
+		layer.cls = &cls1;
+		gen.add_layer( layer );
+
+		layer.min_height = 10;
+		layer.max_height = 12;
+		layer.cls = &cls0;
+		gen.add_layer( layer );
+
+		Planet planet( "planet", planet_size, chunk_size );
+		Planet chunks( "chunks", planet_size, chunk_size );
+
+		gen.generate( planet, util::Cuboid<uint32_t>( 0, 0, 0, 48, 48, 32 ) );
+
+		Planet::Vector chunk_pos( 0, 0, 0 );
+
+		for( chunk_pos.z = 0; chunk_pos.z < planet_size.z; ++chunk_pos.z ) {
+			for( chunk_pos.y = 0; chunk_pos.y < planet_size.y; ++chunk_pos.y ) {
+				for( chunk_pos.x = 0; chunk_pos.x < planet_size.x; ++chunk_pos.x ) {
+					gen.generate_chunk( chunks, chunk_pos );
+				}
+			}
+		}
+
+		bool all_correct = true;
+
+		for( uint32_t z = 0; z < 32; ++z ) {
+			for( uint32_t x = 0; x < 48; ++x ) {
+				uint32_t top = planet.get_surface_height( x, z );
+
+				BOOST_CHECK( top >= 20 && top <= 30 );
+				BOOST_CHECK( chunks.get_surface_height( x, z ) == top );
+
+				for( uint32_t y = 0; y < 48; ++y ) {
+					const Class* expected = nullptr;
+
+					if( y < top ) {
+						if( y >= 10 && y < 12 ) {
+							expected = &cls0;
+						}
+						else if( y < 24 ) {
+							expected = &stone_cls;
+						}
+						else if( y < 27 ) {
+							expected = &cls1;
+						}
+						else {
+							expected = &default_cls;
+						}
+					}
+
+					Planet::Vector block_chunk_pos( static_cast<Planet::ScalarType>( x / 16 ), static_cast<Planet::ScalarType>( y / 16 ), static_cast<Planet::ScalarType>( z / 16 ) );
+					Chunk::Vector block_pos( static_cast<Chunk::ScalarType>( x % 16 ), static_cast<Chunk::ScalarType>( y % 16 ), static_cast<Chunk::ScalarType>( z % 16 ) );
+
+					const Class* found = planet.has_chunk( block_chunk_pos ) ? planet.find_block( block_chunk_pos, block_pos ) : nullptr;
+					const Class* chunk_found = chunks.has_chunk( block_chunk_pos ) ? chunks.find_block( block_chunk_pos, block_pos ) : nullptr;
+
+					if( found != expected || chunk_found != expected ) {
+						all_correct = false;
+					}
+				}
+			}
+		}
+
+		BOOST_CHECK( all_correct == true );
+	}
 }
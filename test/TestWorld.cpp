@@ -128,6 +128,40 @@ BOOST_AUTO_TEST_CASE( TestWorld ) {
 		BOOST_CHECK( world.find_entity( 2 ) == nullptr );
 	}
 
+	// Create entities with given IDs.
+	{
+		FlexID id = FlexID::make( "id.base/ball" );
+
+		Class cls( id );
+
+		World world;
+		world.add_class( cls );
+
+		Entity& ent = world.create_entity( 5, *world.find_class( id ) );
+		BOOST_CHECK( ent.get_id() == 5 );
+		BOOST_CHECK( &ent.get_class() == world.find_class( id ) );
+		BOOST_CHECK( &ent == world.find_entity( 5 ) );
+
+		world.create_entity( 2, *world.find_class( id ) );
+		BOOST_CHECK( world.find_entity( 2 ) != nullptr );
+		BOOST_CHECK( world.find_entity( 3 ) == nullptr );
+
+		// New IDs follow the greatest one.
+		BOOST_CHECK( world.create_entity( id ).get_id() == 6 );
+		BOOST_CHECK( world.get_num_entities() == 3 );
+
+		// Iterate in ID order.
+		World::EntityConstIterator iter = world.entities_begin();
+
+		BOOST_REQUIRE( iter != world.entities_end() );
+		BOOST_CHECK( iter->first == 2 );
+		BOOST_REQUIRE( ++iter != world.entities_end() );
+		BOOST_CHECK( iter->first == 5 );
+		BOOST_REQUIRE( ++iter != world.entities_end() );
+		BOOST_CHECK( iter->first == 6 );
+		BOOST_CHECK( ++iter == world.entities_end() );
+	}
+
 	// Delete entities.
 	{
 		FlexID id = FlexID::make( "id.base/ball" );
@@ -54,6 +54,10 @@ BOOST_AUTO_TEST_CASE( TestWorldLuaModule ) {
 		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:set_block( {10, 20, 30}, \"foobar\", \"some/class\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid planet." ) );
 		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:set_block( {10, 20, 30}, \"planet\", \"some/lass\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid class." ) );
 
+		BOOST_CHECK_NO_THROW( state.doString( "assert( fw.world:get_surface_height( {7, 8}, \"planet\" ) == 42 )" ) );
+		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:get_surface_height( {8, 7}, \"planet\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid column position." ) );
+		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:get_surface_height( {7, 8}, \"foobar\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid planet." ) );
+
 		BOOST_CHECK_NO_THROW( state.doString( "assert( fw.world:create_entity( \"some/class\", {11, 22, 33}, \"planet\" ) == 938 )" ) );
 		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:create_entity( \"foo/bar\", {11, 22, 33}, \"planet\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid class." ) );
 		BOOST_CHECK_EXCEPTION( state.doString( "fw.world:create_entity( \"some/class\", {0, 0, 0}, \"planet\" )" ), std::runtime_error, ExceptionChecker<std::runtime_error>( "Invalid entity position." ) );
@@ -125,6 +129,20 @@ BOOST_AUTO_TEST_CASE( TestWorldLuaModule ) {
 		BOOST_CHECK( check_error( "Invalid class.", "fw.world:set_block( {1, 2, 3}, \"planet\", \"package\" )", state ) == true );
 		BOOST_CHECK( check_error( "Invalid class.", "fw.world:set_block( {1, 2, 3}, \"planet\", \"faulty/class!\" )", state ) == true );
 
+		// get_surface_height
+		BOOST_CHECK( check_error( "Wrong number of arguments.", "fw.world:get_surface_height()", state ) == true );
+		BOOST_CHECK( check_error( "Wrong number of arguments.", "fw.world:get_surface_height( {7, 8} )", state ) == true );
+		BOOST_CHECK( check_error( "Wrong number of arguments.", "fw.world:get_surface_height( {7, 8}, \"planet\", 123 )", state ) == true );
+
+		BOOST_CHECK( check_error( "Expected table for position.", "fw.world:get_surface_height( 123, \"planet\" )", state ) == true );
+		BOOST_CHECK( check_error( "Wrong number of elements in position table.", "fw.world:get_surface_height( {7}, \"planet\" )", state ) == true );
+		BOOST_CHECK( check_error( "Wrong number of elements in position table.", "fw.world:get_surface_height( {7, 8, 9}, \"planet\" )", state ) == true );
+		BOOST_CHECK( check_error( "Expected number for x position.", "fw.world:get_surface_height( {\"a\", 8}, \"planet\" )", state ) == true );
+		BOOST_CHECK( check_error( "Expected number for z position.", "fw.world:get_surface_height( {7, \"a\"}, \"planet\" )", state ) == true );
+
+		BOOST_CHECK( check_error( "Expected string for planet.", "fw.world:get_surface_height( {7, 8}, 0 )", state ) == true );
+		BOOST_CHECK( check_error( "Invalid planet.", "fw.world:get_surface_height( {7, 8}, \"\" )", state ) == true );
+
 		// create_entity
 		BOOST_CHECK( check_error( "Wrong number of arguments.", "fw.world:create_entity()", state ) == true );
 		BOOST_CHECK( check_error( "Wrong number of arguments.", "fw.world:create_entity( \"some/class\", {1, 2, 3}, \"planet\", 123 )", state ) == true );
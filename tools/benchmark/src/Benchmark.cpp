@@ -0,0 +1,33 @@
+#include "Benchmark.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+static volatile uint64_t sink = 0;
+
+Stopwatch::Stopwatch() :
+	m_start( std::chrono::steady_clock::now() )
+{
+}
+
+void Stopwatch::restart() {
+	m_start = std::chrono::steady_clock::now();
+}
+
+double Stopwatch::get_elapsed_ms() const {
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_start ).count();
+}
+
+void print_result( const std::string& name, double ms, uint64_t num_operations ) {
+	std::cout << "  " << std::left << std::setw( 48 ) << name << std::right << std::fixed << std::setprecision( 2 ) << std::setw( 10 ) << ms << " ms";
+
+	if( num_operations > 0 ) {
+		std::cout << std::setw( 12 ) << std::setprecision( 2 ) << (ms * 1000000.0 / static_cast<double>( num_operations )) << " ns/op";
+	}
+
+	std::cout << std::endl;
+}
+
+void consume( uint64_t value ) {
+	sink = sink + value;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/** Stopwatch measuring wall clock time.
+ */
+class Stopwatch {
+	public:
+		/** Ctor.
+		 * Starts the stopwatch.
+		 */
+		Stopwatch();
+
+		/** Restart.
+		 */
+		void restart();
+
+		/** Get elapsed time.
+		 * @return Elapsed time in milliseconds.
+		 */
+		double get_elapsed_ms() const;
+
+	private:
+		std::chrono::steady_clock::time_point m_start;
+};
+
+/** Print a benchmark result line.
+ * @param name Name of measured operation.
+ * @param ms Time in milliseconds.
+ * @param num_operations Number of operations (used for per-operation time, 0 to skip).
+ */
+void print_result( const std::string& name, double ms, uint64_t num_operations );
+
+/** Prevent the compiler from optimizing a result away.
+ * @param value Value.
+ */
+void consume( uint64_t value );
+
+// Benchmarks.
+void benchmark_chunk_allocator();
+void benchmark_chunk_directory();
+void benchmark_entity_store();
+void benchmark_heightmap_generator();
+void benchmark_planet_image();
+void benchmark_planet_io();
+void benchmark_receive();
+void benchmark_terrain_generator();
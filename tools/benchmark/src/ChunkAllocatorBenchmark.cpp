@@ -0,0 +1,148 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/ChunkAllocator.hpp>
+#include <FlexWorld/Chunk.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#ifdef LINUX
+	#include <sys/types.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+using fw::Chunk;
+using fw::ChunkAllocator;
+
+namespace {
+
+// Same dimensions as the construct planet created by the server.
+static const uint16_t PLANET_SIZE = 16;
+static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+static const std::size_t NUM_ROUNDS = 5;
+
+// Fill a chunk like the terrain generator does: stone below a wavy surface,
+// a few ores, air above.
+void generate( Chunk& chunk, uint16_t chunk_x, uint16_t chunk_y, uint16_t chunk_z ) {
+	Chunk::Vector runner( 0, 0, 0 );
+
+	for( runner.z = 0; runner.z < CHUNK_SIZE.z; ++runner.z ) {
+		for( runner.x = 0; runner.x < CHUNK_SIZE.x; ++runner.x ) {
+			uint32_t x = chunk_x * CHUNK_SIZE.x + runner.x;
+			uint32_t z = chunk_z * CHUNK_SIZE.z + runner.z;
+			uint32_t height = 64 + (x * 7 + z * 13) % 32;
+
+			for( runner.y = 0; runner.y < CHUNK_SIZE.y; ++runner.y ) {
+				uint32_t y = chunk_y * CHUNK_SIZE.y + runner.y;
+
+				if( y < height ) {
+					chunk.set_block( runner, static_cast<Chunk::Block>( ((x ^ y ^ z) % 97 == 0) ? 2 : (y + 1 == height ? 1 : 0) ) );
+				}
+			}
+		}
+	}
+}
+
+uint64_t read_status_kib( const char* key ) {
+	std::ifstream in( "/proc/self/status" );
+	std::string token;
+	uint64_t value = 0;
+
+	while( in >> token ) {
+		if( token == key ) {
+			in >> value;
+			break;
+		}
+	}
+
+	return value;
+}
+
+template <class Create, class Destroy>
+void run_variant( const std::string& name, Create create, Destroy destroy ) {
+	std::vector<Chunk*> chunks;
+	double generate_ms = 0.0;
+	double teardown_ms = 0.0;
+	uint64_t num_set = 0;
+
+	chunks.reserve( PLANET_SIZE * PLANET_SIZE * PLANET_SIZE );
+
+	for( std::size_t round = 0; round < NUM_ROUNDS; ++round ) {
+		Stopwatch stopwatch;
+
+		for( uint16_t z = 0; z < PLANET_SIZE; ++z ) {
+			for( uint16_t y = 0; y < PLANET_SIZE / 2; ++y ) {
+				for( uint16_t x = 0; x < PLANET_SIZE; ++x ) {
+					chunks.push_back( &create() );
+					generate( *chunks.back(), x, y, z );
+				}
+			}
+		}
+
+		generate_ms += stopwatch.get_elapsed_ms();
+		num_set += !chunks.back()->is_empty();
+
+		stopwatch.restart();
+		destroy( chunks );
+		chunks.clear();
+		teardown_ms += stopwatch.get_elapsed_ms();
+	}
+
+	uint64_t num_chunks = static_cast<uint64_t>( NUM_ROUNDS ) * PLANET_SIZE * PLANET_SIZE * (PLANET_SIZE / 2);
+
+	print_result( name + " (generate)", generate_ms, num_chunks );
+	print_result( name + " (teardown)", teardown_ms, num_chunks );
+	consume( num_set );
+}
+
+template <class Create, class Destroy>
+void run_isolated( const std::string& name, Create create, Destroy destroy ) {
+#ifdef LINUX
+	// Run in a child process so peak RSS isn't inflated by the other variant.
+	std::cout << std::flush;
+	pid_t pid = fork();
+
+	if( pid == 0 ) {
+		uint64_t base_kib = read_status_kib( "VmRSS:" );
+
+		run_variant( name, create, destroy );
+		std::cout << "  " << name << " peak RSS: " << (read_status_kib( "VmHWM:" ) - base_kib) << " KiB" << std::endl;
+		_exit( 0 );
+	}
+
+	int status = 0;
+	waitpid( pid, &status, 0 );
+#else
+	run_variant( name, create, destroy );
+#endif
+}
+
+}
+
+void benchmark_chunk_allocator() {
+	run_isolated(
+		"heap",
+		[]() -> Chunk& {
+			return *new Chunk( CHUNK_SIZE );
+		},
+		[]( std::vector<Chunk*>& chunks ) {
+			for( std::size_t chunk_idx = 0; chunk_idx < chunks.size(); ++chunk_idx ) {
+				delete chunks[chunk_idx];
+			}
+		}
+	);
+
+	ChunkAllocator allocator;
+
+	run_isolated(
+		"ChunkAllocator",
+		[&allocator]() -> Chunk& {
+			return allocator.create_chunk( CHUNK_SIZE );
+		},
+		[&allocator]( std::vector<Chunk*>& /*chunks*/ ) {
+			allocator.clear();
+		}
+	);
+}
@@ -0,0 +1,130 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/ChunkDirectory.hpp>
+#include <FlexWorld/Chunk.hpp>
+
+#include <map>
+#include <vector>
+#include <memory>
+
+using fw::Chunk;
+using fw::ChunkDirectory;
+
+namespace {
+
+// Ordering used by Planet before the chunk directory was introduced.
+struct VectorLess {
+	bool operator()( const ChunkDirectory::Vector& first, const ChunkDirectory::Vector& second ) const {
+		if( first.z != second.z ) {
+			return first.z < second.z;
+		}
+
+		if( first.y != second.y ) {
+			return first.y < second.y;
+		}
+
+		return first.x < second.x;
+	}
+};
+
+typedef std::map<ChunkDirectory::Vector, Chunk*, VectorLess> ChunkMap;
+typedef std::vector<ChunkDirectory::Vector> VectorArray;
+
+static const ChunkDirectory::Vector PLANET_SIZE( 16, 8, 16 );
+static const std::size_t NUM_RANDOM_LOOKUPS = 10000000;
+static const std::size_t NUM_SCANS = 1000;
+
+template <class Lookup>
+void run_lookups( const std::string& name, const VectorArray& random_positions, Lookup lookup ) {
+	uint64_t hits = 0;
+	Stopwatch stopwatch;
+
+	for( std::size_t pos_idx = 0; pos_idx < random_positions.size(); ++pos_idx ) {
+		hits += lookup( random_positions[pos_idx] ) != nullptr;
+	}
+
+	print_result( name + " (random)", stopwatch.get_elapsed_ms(), random_positions.size() );
+
+	// Scan all positions, like the mesher and terrain generator do.
+	ChunkDirectory::Vector pos( 0, 0, 0 );
+	stopwatch.restart();
+
+	for( std::size_t scan_idx = 0; scan_idx < NUM_SCANS; ++scan_idx ) {
+		for( pos.z = 0; pos.z < PLANET_SIZE.z; ++pos.z ) {
+			for( pos.y = 0; pos.y < PLANET_SIZE.y; ++pos.y ) {
+				for( pos.x = 0; pos.x < PLANET_SIZE.x; ++pos.x ) {
+					hits += lookup( pos ) != nullptr;
+				}
+			}
+		}
+	}
+
+	print_result(
+		name + " (scan)",
+		stopwatch.get_elapsed_ms(),
+		static_cast<uint64_t>( NUM_SCANS ) * PLANET_SIZE.x * PLANET_SIZE.y * PLANET_SIZE.z
+	);
+
+	consume( hits );
+}
+
+}
+
+void benchmark_chunk_directory() {
+	// Create a chunk for the lower half of the planet, like generated terrain.
+	std::vector<std::shared_ptr<Chunk>> chunks;
+	ChunkMap map;
+	ChunkDirectory dense( PLANET_SIZE, ChunkDirectory::DENSE );
+	ChunkDirectory hashed( PLANET_SIZE, ChunkDirectory::HASHED );
+	ChunkDirectory::Vector pos( 0, 0, 0 );
+
+	for( pos.z = 0; pos.z < PLANET_SIZE.z; ++pos.z ) {
+		for( pos.y = 0; pos.y < PLANET_SIZE.y / 2; ++pos.y ) {
+			for( pos.x = 0; pos.x < PLANET_SIZE.x; ++pos.x ) {
+				chunks.push_back( std::shared_ptr<Chunk>( new Chunk( Chunk::Vector( 1, 1, 1 ) ) ) );
+
+				map[pos] = chunks.back().get();
+				dense.insert( pos, *chunks.back() );
+				hashed.insert( pos, *chunks.back() );
+			}
+		}
+	}
+
+	// Prepare random positions (fixed LCG so runs are comparable).
+	VectorArray random_positions( NUM_RANDOM_LOOKUPS );
+	uint32_t state = 12345;
+
+	for( std::size_t pos_idx = 0; pos_idx < NUM_RANDOM_LOOKUPS; ++pos_idx ) {
+		state = state * 1664525u + 1013904223u;
+		random_positions[pos_idx].x = static_cast<ChunkDirectory::ScalarType>( (state >> 8) % PLANET_SIZE.x );
+		state = state * 1664525u + 1013904223u;
+		random_positions[pos_idx].y = static_cast<ChunkDirectory::ScalarType>( (state >> 8) % PLANET_SIZE.y );
+		state = state * 1664525u + 1013904223u;
+		random_positions[pos_idx].z = static_cast<ChunkDirectory::ScalarType>( (state >> 8) % PLANET_SIZE.z );
+	}
+
+	run_lookups(
+		"std::map",
+		random_positions,
+		[&map]( const ChunkDirectory::Vector& position ) -> Chunk* {
+			ChunkMap::const_iterator iter = map.find( position );
+			return iter == map.end() ? nullptr : iter->second;
+		}
+	);
+
+	run_lookups(
+		"ChunkDirectory::DENSE",
+		random_positions,
+		[&dense]( const ChunkDirectory::Vector& position ) {
+			return dense.find( position );
+		}
+	);
+
+	run_lookups(
+		"ChunkDirectory::HASHED",
+		random_positions,
+		[&hashed]( const ChunkDirectory::Vector& position ) {
+			return hashed.find( position );
+		}
+	);
+}
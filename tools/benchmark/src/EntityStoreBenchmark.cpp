@@ -0,0 +1,105 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/EntityStore.hpp>
+#include <FlexWorld/World.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+#include <random>
+#include <sstream>
+
+using fw::Chunk;
+using fw::Class;
+using fw::Entity;
+using fw::EntityStore;
+using fw::FlexID;
+using fw::Planet;
+using fw::World;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+static const std::size_t NUM_ENTITIES = 1000000;
+static const std::size_t NUM_CHANGED_ENTITIES = 10000;
+
+void setup_world( World& world, const Class& cls ) {
+	world.create_planet( "construct", Planet::Vector( 4, 4, 4 ), Chunk::Vector( 16, 16, 16 ) );
+	world.add_class( cls );
+}
+
+}
+
+void benchmark_entity_store() {
+	static const Class ball_cls( FlexID::make( "fw.base/ball" ) );
+
+	fs::path directory = fs::temp_directory_path() / fs::unique_path( "fwbench-%%%%-%%%%" );
+
+	{
+		World world;
+		std::mt19937 random( 1337 );
+		std::uniform_real_distribution<float> distribution( 0.0f, 64.0f );
+
+		setup_world( world, ball_cls );
+
+		for( std::size_t entity_idx = 0; entity_idx < NUM_ENTITIES; ++entity_idx ) {
+			Entity& entity = world.create_entity( ball_cls.get_id() );
+
+			entity.set_position( sf::Vector3f( distribution( random ), distribution( random ), distribution( random ) ) );
+			world.link_entity_to_planet( entity.get_id(), "construct" );
+		}
+
+		EntityStore store( directory.string() );
+		store.open();
+
+		{
+			Stopwatch stopwatch;
+			std::size_t num_written = store.save( world );
+			double ms = stopwatch.get_elapsed_ms();
+			std::stringstream name;
+
+			name << "save " << num_written << " entities (" << fs::file_size( store.get_path() ) / 1024 << " KiB)";
+			print_result( name.str(), ms, num_written );
+		}
+
+		for( std::size_t entity_idx = 0; entity_idx < NUM_CHANGED_ENTITIES; ++entity_idx ) {
+			world.find_entity( static_cast<Entity::ID>( entity_idx * (NUM_ENTITIES / NUM_CHANGED_ENTITIES) ) )->set_position( sf::Vector3f( 1, 2, 3 ) );
+		}
+
+		{
+			Stopwatch stopwatch;
+			std::size_t num_written = store.save( world );
+			double ms = stopwatch.get_elapsed_ms();
+			std::stringstream name;
+
+			name << "save " << num_written << " changed of " << NUM_ENTITIES << " entities";
+			print_result( name.str(), ms, num_written );
+		}
+	}
+
+	{
+		World world;
+		EntityStore store( directory.string() );
+		EntityStore::ClassArray classes;
+
+		setup_world( world, ball_cls );
+
+		{
+			Stopwatch stopwatch;
+
+			store.open();
+			print_result( "open store (read and index)", stopwatch.get_elapsed_ms(), store.get_num_records() );
+		}
+
+		classes.push_back( world.find_class( ball_cls.get_id() ) );
+
+		{
+			Stopwatch stopwatch;
+			std::size_t num_loaded = store.load_entities( world, classes );
+
+			print_result( "load entities into world", stopwatch.get_elapsed_ms(), num_loaded );
+		}
+	}
+
+	fs::remove_all( directory );
+}
@@ -0,0 +1,50 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/HeightmapGenerator.hpp>
+
+#include <sstream>
+#include <vector>
+
+using fw::HeightmapGenerator;
+
+namespace {
+
+// Area of the construct, with the terrain generator's parameters.
+static const uint32_t SIZE = 256;
+static const std::size_t NUM_ROUNDS = 10;
+
+}
+
+void benchmark_heightmap_generator() {
+	HeightmapGenerator heightmap;
+
+	heightmap.set_seed( 1337 );
+	heightmap.set_persistence( 1.1 );
+	heightmap.set_frequency( 1.0 / 800.0 );
+
+	std::vector<double> values( SIZE * SIZE );
+	double sum = 0.0;
+	Stopwatch stopwatch;
+
+	for( std::size_t round_idx = 0; round_idx < NUM_ROUNDS; ++round_idx ) {
+		for( uint32_t z = 0; z < SIZE; ++z ) {
+			for( uint32_t x = 0; x < SIZE; ++x ) {
+				sum += heightmap.get_value( static_cast<double>( x ), static_cast<double>( z + round_idx * SIZE ) );
+			}
+		}
+	}
+
+	print_result( "get_value 256x256", stopwatch.get_elapsed_ms() / NUM_ROUNDS, SIZE * SIZE );
+	stopwatch.restart();
+
+	for( std::size_t round_idx = 0; round_idx < NUM_ROUNDS; ++round_idx ) {
+		heightmap.generate( 0, static_cast<int32_t>( round_idx * SIZE ), SIZE, SIZE, &values[0] );
+		sum += values[round_idx];
+	}
+
+	std::stringstream name;
+	name << "generate 256x256, batch width " << HeightmapGenerator::get_batch_width();
+
+	print_result( name.str(), stopwatch.get_elapsed_ms() / NUM_ROUNDS, SIZE * SIZE );
+	consume( static_cast<uint64_t>( sum ) );
+}
@@ -0,0 +1,66 @@
+#include "Benchmark.hpp"
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+struct BenchmarkInfo {
+	const char* name;
+	void (*function)();
+};
+
+static const BenchmarkInfo BENCHMARKS[] = {
+	{ "chunkalloc", &benchmark_chunk_allocator },
+	{ "chunkdir", &benchmark_chunk_directory },
+	{ "entitystore", &benchmark_entity_store },
+	{ "heightmap", &benchmark_heightmap_generator },
+	{ "planetimage", &benchmark_planet_image },
+	{ "planetio", &benchmark_planet_io },
+	{ "receive", &benchmark_receive },
+	{ "terrain", &benchmark_terrain_generator }
+};
+
+static const std::size_t NUM_BENCHMARKS = sizeof( BENCHMARKS ) / sizeof( BENCHMARKS[0] );
+
+void print_usage() {
+	std::cout << "Usage: fwbench [BENCHMARK...]" << std::endl
+		<< "Run FlexWorld benchmarks. Runs all benchmarks if none given." << std::endl
+		<< std::endl
+		<< "Benchmarks:" << std::endl
+	;
+
+	for( std::size_t bench_idx = 0; bench_idx < NUM_BENCHMARKS; ++bench_idx ) {
+		std::cout << "  " << BENCHMARKS[bench_idx].name << std::endl;
+	}
+}
+
+int main( int argc, char** argv ) {
+	if( argc < 2 ) {
+		for( std::size_t bench_idx = 0; bench_idx < NUM_BENCHMARKS; ++bench_idx ) {
+			std::cout << BENCHMARKS[bench_idx].name << ":" << std::endl;
+			BENCHMARKS[bench_idx].function();
+		}
+
+		return 0;
+	}
+
+	for( int arg_idx = 1; arg_idx < argc; ++arg_idx ) {
+		bool found = false;
+
+		for( std::size_t bench_idx = 0; bench_idx < NUM_BENCHMARKS; ++bench_idx ) {
+			if( std::strcmp( argv[arg_idx], BENCHMARKS[bench_idx].name ) == 0 ) {
+				std::cout << BENCHMARKS[bench_idx].name << ":" << std::endl;
+				BENCHMARKS[bench_idx].function();
+				found = true;
+				break;
+			}
+		}
+
+		if( !found ) {
+			print_usage();
+			return 1;
+		}
+	}
+
+	return 0;
+}
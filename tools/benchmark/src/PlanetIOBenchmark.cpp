@@ -0,0 +1,118 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/PlanetWriter.hpp>
+#include <FlexWorld/PlanetReader.hpp>
+#include <FlexWorld/TerrainGenerator.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+#include <sstream>
+
+using fw::Chunk;
+using fw::Class;
+using fw::FlexID;
+using fw::Planet;
+using fw::PlanetReader;
+using fw::PlanetWriter;
+using fw::TerrainGenerator;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Terrain reaches into the 4th chunk layer, so every column has 4 chunks of
+// 8 KiB raw data each: 6400 chunks, 50 MiB.
+static const Planet::Vector PLANET_SIZE( 40, 8, 40 );
+static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+
+uint64_t get_directory_size( const fs::path& directory ) {
+	uint64_t size = 0;
+	fs::directory_iterator dir_iter( directory );
+	fs::directory_iterator dir_iter_end;
+
+	for( ; dir_iter != dir_iter_end; ++dir_iter ) {
+		size += fs::file_size( dir_iter->path() );
+	}
+
+	return size;
+}
+
+}
+
+void benchmark_planet_io() {
+	static const Class grass_cls( FlexID::make( "fw.base.nature/grass" ) );
+	static const Class stone_cls( FlexID::make( "fw.base.nature/stone" ) );
+
+	TerrainGenerator generator( grass_cls );
+
+	generator.set_seed( 1337 );
+	generator.set_base_height( 50 );
+	generator.set_maximum_height( 10 );
+
+	TerrainGenerator::Layer layer;
+	layer.min_height = 0;
+	layer.max_height = 40;
+	layer.cls = &stone_cls;
+	generator.add_layer( layer );
+
+	Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+
+	generator.generate(
+		planet,
+		util::Cuboid<uint32_t>(
+			0, 0, 0,
+			static_cast<uint32_t>( PLANET_SIZE.x ) * CHUNK_SIZE.x,
+			static_cast<uint32_t>( PLANET_SIZE.y ) * CHUNK_SIZE.y,
+			static_cast<uint32_t>( PLANET_SIZE.z ) * CHUNK_SIZE.z
+		)
+	);
+
+	fs::path directory = fs::temp_directory_path() / fs::unique_path( "fwbench-%%%%-%%%%" );
+	uint64_t num_chunks = planet.get_num_chunks();
+
+	{
+		Stopwatch stopwatch;
+		PlanetWriter writer( directory.string(), planet );
+
+		writer.open();
+		writer.write_planet( planet );
+		writer.flush();
+
+		double ms = stopwatch.get_elapsed_ms();
+		std::stringstream name;
+
+		name << "save " << num_chunks << " chunks (" << num_chunks * 8 / 1024 << " MiB raw, " << get_directory_size( directory ) / 1024 << " KiB on disk)";
+		print_result( name.str(), ms, num_chunks );
+	}
+
+	{
+		Stopwatch stopwatch;
+		PlanetReader reader( directory.string() );
+		Planet loaded( "construct", PLANET_SIZE, CHUNK_SIZE );
+
+		reader.open();
+
+		Planet::ClassArray classes( reader.get_num_classes(), nullptr );
+
+		for( std::size_t cls_idx = 0; cls_idx < classes.size(); ++cls_idx ) {
+			classes[cls_idx] = reader.get_class_id( cls_idx ) == grass_cls.get_id() ? &grass_cls : &stone_cls;
+		}
+
+		consume( reader.load_planet( loaded, classes ) );
+		print_result( "load all chunks", stopwatch.get_elapsed_ms(), num_chunks );
+	}
+
+	{
+		Stopwatch stopwatch;
+		PlanetWriter writer( directory.string(), planet );
+
+		writer.open();
+		writer.write_chunk( planet, Planet::Vector( 20, 2, 20 ) );
+		writer.flush();
+
+		print_result( "save single chunk", stopwatch.get_elapsed_ms(), 1 );
+	}
+
+	fs::remove_all( directory );
+}
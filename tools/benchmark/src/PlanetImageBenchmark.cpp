@@ -0,0 +1,134 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/PlanetImage.hpp>
+#include <FlexWorld/TerrainGenerator.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/filesystem.hpp>
+#include <random>
+#include <sstream>
+
+using fw::Chunk;
+using fw::Class;
+using fw::FlexID;
+using fw::Planet;
+using fw::PlanetImage;
+using fw::TerrainGenerator;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Same terrain as the planet I/O benchmark: 6400 chunks, 50 MiB raw.
+static const Planet::Vector PLANET_SIZE( 40, 8, 40 );
+static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+static const std::size_t NUM_VISITED_COLUMNS = 64;
+
+}
+
+void benchmark_planet_image() {
+	static const Class grass_cls( FlexID::make( "fw.base.nature/grass" ) );
+	static const Class stone_cls( FlexID::make( "fw.base.nature/stone" ) );
+
+	TerrainGenerator generator( grass_cls );
+
+	generator.set_seed( 1337 );
+	generator.set_base_height( 50 );
+	generator.set_maximum_height( 10 );
+
+	TerrainGenerator::Layer layer;
+	layer.min_height = 0;
+	layer.max_height = 40;
+	layer.cls = &stone_cls;
+	generator.add_layer( layer );
+
+	Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+
+	generator.generate(
+		planet,
+		util::Cuboid<uint32_t>(
+			0, 0, 0,
+			static_cast<uint32_t>( PLANET_SIZE.x ) * CHUNK_SIZE.x,
+			static_cast<uint32_t>( PLANET_SIZE.y ) * CHUNK_SIZE.y,
+			static_cast<uint32_t>( PLANET_SIZE.z ) * CHUNK_SIZE.z
+		)
+	);
+
+	fs::path directory = fs::temp_directory_path() / fs::unique_path( "fwbench-%%%%-%%%%" );
+	std::string path = (directory / PlanetImage::FILENAME).string();
+	uint64_t num_chunks = planet.get_num_chunks();
+
+	fs::create_directories( directory );
+
+	{
+		Stopwatch stopwatch;
+		std::size_t num_written = PlanetImage::write( path, planet );
+		double ms = stopwatch.get_elapsed_ms();
+		std::stringstream name;
+
+		name << "write image of " << num_written << " chunks (" << fs::file_size( path ) / 1024 << " KiB)";
+		print_result( name.str(), ms, num_written );
+	}
+
+	PlanetImage image;
+	Planet::ClassArray classes;
+
+	{
+		Stopwatch stopwatch;
+
+		image.open( path );
+		print_result( "open image (header and index)", stopwatch.get_elapsed_ms(), 1 );
+	}
+
+	for( std::size_t cls_idx = 0; cls_idx < image.get_num_classes(); ++cls_idx ) {
+		classes.push_back( image.get_class_id( cls_idx ) == grass_cls.get_id() ? &grass_cls : &stone_cls );
+	}
+
+	{
+		Planet paged( "construct", PLANET_SIZE, CHUNK_SIZE );
+		std::mt19937 random( 1337 );
+		std::uniform_int_distribution<uint32_t> x_distribution( 0, static_cast<uint32_t>( PLANET_SIZE.x ) * CHUNK_SIZE.x - 1 );
+		std::uniform_int_distribution<uint32_t> z_distribution( 0, static_cast<uint32_t>( PLANET_SIZE.z ) * CHUNK_SIZE.z - 1 );
+		uint64_t height_sum = 0;
+
+		paged.attach_image( image, classes );
+
+		Stopwatch stopwatch;
+
+		for( std::size_t column_idx = 0; column_idx < NUM_VISITED_COLUMNS; ++column_idx ) {
+			height_sum += paged.get_surface_height( x_distribution( random ), z_distribution( random ) );
+		}
+
+		double ms = stopwatch.get_elapsed_ms();
+		std::stringstream name;
+
+		consume( height_sum );
+		name << "visit " << NUM_VISITED_COLUMNS << " random columns (" << paged.get_num_paged_chunks() << " of " << num_chunks << " chunks paged in)";
+		print_result( name.str(), ms, paged.get_num_paged_chunks() );
+	}
+
+	{
+		Planet paged( "construct", PLANET_SIZE, CHUNK_SIZE );
+		Planet::Vector position( 0, 0, 0 );
+		uint64_t num_found = 0;
+
+		paged.attach_image( image, classes );
+
+		Stopwatch stopwatch;
+
+		for( position.z = 0; position.z < PLANET_SIZE.z; ++position.z ) {
+			for( position.y = 0; position.y < PLANET_SIZE.y; ++position.y ) {
+				for( position.x = 0; position.x < PLANET_SIZE.x; ++position.x ) {
+					num_found += paged.has_chunk( position ) ? 1 : 0;
+				}
+			}
+		}
+
+		consume( num_found );
+		print_result( "page in all chunks", stopwatch.get_elapsed_ms(), num_found );
+	}
+
+	image.close();
+	fs::remove_all( directory );
+}
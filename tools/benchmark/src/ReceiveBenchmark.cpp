@@ -0,0 +1,144 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/ServerProtocol.hpp>
+#include <FlexWorld/MessageHandler.hpp>
+#include <FlexWorld/ReceiveBuffer.hpp>
+
+#include <sstream>
+#include <cstring>
+
+using fw::ReceiveBuffer;
+using fw::ServerMessageList;
+using fw::ServerProtocol;
+
+namespace {
+
+// Chunk-sized messages (4096 chars, 16 KiB payload) mixed with small block
+// updates, like a client loading the area around it.
+static const std::size_t NUM_ROUNDS = 4000;
+static const std::size_t NUM_BLOCK_UPDATES_PER_ROUND = 32;
+static const std::size_t CHUNK_MESSAGE_SIZE = 4096;
+static const std::size_t NUM_PASSES = 5;
+
+class CountingHandler : public fw::MessageHandler<ServerMessageList, ServerProtocol::ConnectionID> {
+	public:
+		using fw::MessageHandler<ServerMessageList, ServerProtocol::ConnectionID>::handle_message;
+
+		CountingHandler() :
+			num_messages( 0 )
+		{
+		}
+
+		void handle_message( const fw::msg::Chat& msg, ServerProtocol::ConnectionID /*sender*/ ) {
+			num_messages += msg.get_message().getSize();
+		}
+
+		void handle_message( const fw::msg::SetBlock& msg, ServerProtocol::ConnectionID /*sender*/ ) {
+			num_messages += msg.get_block_position().x;
+		}
+
+		uint64_t num_messages;
+};
+
+void build_stream( ServerProtocol::Buffer& stream, std::size_t& num_messages ) {
+	fw::msg::Chat chunk_msg;
+	chunk_msg.set_message( sf::String( std::string( CHUNK_MESSAGE_SIZE, 'x' ) ) );
+	chunk_msg.set_sender( "Server" );
+	chunk_msg.set_channel( "chunks" );
+
+	fw::msg::SetBlock block_msg;
+	block_msg.set_class_id( "fw.base.nature/grass" );
+
+	num_messages = 0;
+
+	for( std::size_t round_idx = 0; round_idx < NUM_ROUNDS; ++round_idx ) {
+		ServerProtocol::serialize_message( chunk_msg, stream );
+		++num_messages;
+
+		for( std::size_t update_idx = 0; update_idx < NUM_BLOCK_UPDATES_PER_ROUND; ++update_idx ) {
+			block_msg.set_block_position( fw::msg::SetBlock::BlockPosition( static_cast<uint32_t>( update_idx ), 0, 0 ) );
+			ServerProtocol::serialize_message( block_msg, stream );
+			++num_messages;
+		}
+	}
+}
+
+// Previous scheme: copy every read into a vector, move the remainder to the
+// front after each message.
+uint64_t receive_copying( const ServerProtocol::Buffer& stream, std::size_t read_size ) {
+	CountingHandler handler;
+	ServerProtocol::Buffer buffer;
+	std::vector<char> read_buffer( read_size );
+
+	for( std::size_t offset = 0; offset < stream.size(); offset += read_size ) {
+		std::size_t num_bytes_read = std::min( read_size, stream.size() - offset );
+
+		std::memcpy( &read_buffer[0], &stream[offset], num_bytes_read );
+		buffer.insert( buffer.end(), &read_buffer[0], &read_buffer[0] + num_bytes_read );
+
+		std::size_t consumed = 0;
+
+		while( (consumed = ServerProtocol::dispatch( buffer, handler, 0 )) > 0 ) {
+			std::memmove( &buffer[0], &buffer[consumed], buffer.size() - consumed );
+			buffer.resize( buffer.size() - consumed );
+		}
+	}
+
+	return handler.num_messages;
+}
+
+// Reads go to the free space of the receive buffer, messages are dispatched
+// in place.
+uint64_t receive_in_place( const ServerProtocol::Buffer& stream, std::size_t read_size ) {
+	CountingHandler handler;
+	ReceiveBuffer buffer;
+
+	for( std::size_t offset = 0; offset < stream.size(); ) {
+		char* free_space = buffer.prepare( read_size );
+		std::size_t num_bytes_read = std::min( buffer.get_free_size(), std::min( read_size, stream.size() - offset ) );
+
+		std::memcpy( free_space, &stream[offset], num_bytes_read );
+		buffer.commit( num_bytes_read );
+		offset += num_bytes_read;
+
+		std::size_t consumed = 0;
+
+		while( (consumed = ServerProtocol::dispatch( buffer.get_data(), buffer.get_size(), handler, 0 )) > 0 ) {
+			buffer.consume( consumed );
+		}
+	}
+
+	return handler.num_messages;
+}
+
+void run( const std::string& name, uint64_t (*function)( const ServerProtocol::Buffer&, std::size_t ), const ServerProtocol::Buffer& stream, std::size_t num_messages, std::size_t read_size ) {
+	Stopwatch stopwatch;
+
+	for( std::size_t pass_idx = 0; pass_idx < NUM_PASSES; ++pass_idx ) {
+		consume( function( stream, read_size ) );
+	}
+
+	double ms = stopwatch.get_elapsed_ms();
+	double mib_per_s = static_cast<double>( stream.size() * NUM_PASSES ) / (1024.0 * 1024.0) / (ms / 1000.0);
+	std::stringstream full_name;
+
+	full_name << name << ", " << read_size << " B reads (" << static_cast<uint64_t>( mib_per_s ) << " MiB/s)";
+	print_result( full_name.str(), ms, num_messages * NUM_PASSES );
+}
+
+}
+
+void benchmark_receive() {
+	ServerProtocol::Buffer stream;
+	std::size_t num_messages = 0;
+
+	build_stream( stream, num_messages );
+
+	static const std::size_t READ_SIZES[] = { 1024, 1460, 16384, 65536 };
+	static const std::size_t NUM_READ_SIZES = sizeof( READ_SIZES ) / sizeof( READ_SIZES[0] );
+
+	for( std::size_t size_idx = 0; size_idx < NUM_READ_SIZES; ++size_idx ) {
+		run( "copy + memmove", &receive_copying, stream, num_messages, READ_SIZES[size_idx] );
+		run( "receive buffer", &receive_in_place, stream, num_messages, READ_SIZES[size_idx] );
+	}
+}
@@ -0,0 +1,97 @@
+#include "Benchmark.hpp"
+
+#include <FlexWorld/TerrainGenerator.hpp>
+#include <FlexWorld/Planet.hpp>
+#include <FlexWorld/Class.hpp>
+
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <sstream>
+
+using fw::Chunk;
+using fw::Class;
+using fw::FlexID;
+using fw::Planet;
+using fw::TerrainGenerator;
+
+namespace {
+
+// Same settings as the construct generated by the server.
+static const Planet::Vector PLANET_SIZE( 16, 8, 16 );
+static const Chunk::Vector CHUNK_SIZE( 16, 16, 16 );
+static const util::Cuboid<uint32_t> CUBOID( 0, 0, 0, 256, 128, 256 );
+static const std::size_t NUM_ROUNDS = 3;
+
+void run_generator( const Class& cls, std::size_t num_threads ) {
+	TerrainGenerator generator( cls );
+
+	generator.set_seed( 1337 );
+	generator.set_base_height( 50 );
+	generator.set_maximum_height( 10 );
+	generator.set_num_threads( num_threads );
+
+	double best_ms = 0.0;
+
+	for( std::size_t round_idx = 0; round_idx < NUM_ROUNDS; ++round_idx ) {
+		Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+		Stopwatch stopwatch;
+
+		generator.generate( planet, CUBOID );
+
+		double ms = stopwatch.get_elapsed_ms();
+
+		if( round_idx == 0 || ms < best_ms ) {
+			best_ms = ms;
+		}
+
+		consume( planet.get_num_chunks() );
+	}
+
+	std::stringstream name;
+	name << "generate 256x128x256, " << num_threads << " thread(s)";
+
+	print_result( name.str(), best_ms, static_cast<uint64_t>( CUBOID.width ) * CUBOID.depth );
+}
+
+void run_chunk_generator( const Class& cls ) {
+	TerrainGenerator generator( cls );
+
+	generator.set_seed( 1337 );
+	generator.set_base_height( 50 );
+	generator.set_maximum_height( 10 );
+
+	Planet planet( "construct", PLANET_SIZE, CHUNK_SIZE );
+	Planet::Vector chunk_pos( 0, 0, 0 );
+	Stopwatch stopwatch;
+
+	for( chunk_pos.z = 0; chunk_pos.z < PLANET_SIZE.z; ++chunk_pos.z ) {
+		for( chunk_pos.y = 0; chunk_pos.y < PLANET_SIZE.y; ++chunk_pos.y ) {
+			for( chunk_pos.x = 0; chunk_pos.x < PLANET_SIZE.x; ++chunk_pos.x ) {
+				generator.generate_chunk( planet, chunk_pos );
+			}
+		}
+	}
+
+	print_result(
+		"generate_chunk 256x128x256",
+		stopwatch.get_elapsed_ms(),
+		static_cast<uint64_t>( PLANET_SIZE.x ) * PLANET_SIZE.y * PLANET_SIZE.z
+	);
+
+	consume( planet.get_num_chunks() );
+}
+
+}
+
+void benchmark_terrain_generator() {
+	static const Class grass_cls( FlexID::make( "fw.base.nature/grass" ) );
+
+	std::size_t max_threads = std::max( 1u, boost::thread::hardware_concurrency() );
+
+	for( std::size_t num_threads = 1; num_threads < max_threads; num_threads *= 2 ) {
+		run_generator( grass_cls, num_threads );
+	}
+
+	run_generator( grass_cls, max_threads );
+	run_chunk_generator( grass_cls );
+}